@@ -209,6 +209,29 @@ public value struct EventInfo
     property System::IntPtr EventRecord;
     property System::IntPtr TraceEventInfo;
     property System::UIntPtr TraceEventInfoSize;
+
+    /// <summary>
+    ///   The compiled schema (etk::CompiledSchema) cached by the trace log for
+    ///   the event, or zero. Lets the formatter skip parsing the message.
+    /// </summary>
+    property System::IntPtr CompiledSchema;
+
+    /// <summary>
+    ///   The cache of formatted messages (etk::FormattedMessageCache) of the
+    ///   trace log the event belongs to, or zero.
+    /// </summary>
+    property System::IntPtr MessageCache;
+
+    /// <summary>
+    ///   The key of the message of the event in <see cref="MessageCache"/>.
+    /// </summary>
+    property System::UInt64 MessageSequence;
+
+    /// <summary>
+    ///   The generation of <see cref="MessageCache"/> when the event was read.
+    ///   Messages formatted from it are only cached while it is current.
+    /// </summary>
+    property System::UInt64 MessageGeneration;
 };
 
 } // namespace EventTraceKit::Tracing
@@ -1,6 +1,7 @@
 #include "Descriptors.h"
 #include "IMessageFormatter.h"
 
+#include "etk/FormattedMessageCache.h"
 #include "etk/TdhMessageFormatter.h"
 
 namespace EventTraceKit
@@ -14,38 +15,56 @@ public:
         ParseTdhContext^ parseTdhContext,
         System::IFormatProvider^ /*formatProvider*/)
     {
-        size_t const bufferSize = 0x1000;
-        wchar_t buffer[bufferSize];
-
         etk::EventInfo nativeEventInfo(
             (EVENT_RECORD*)eventInfo.EventRecord.ToPointer(),
             (TRACE_EVENT_INFO*)eventInfo.TraceEventInfo.ToPointer(),
-            (size_t)eventInfo.TraceEventInfoSize.ToPointer());
+            (size_t)eventInfo.TraceEventInfoSize.ToPointer(),
+            (::etk::CompiledSchema const*)eventInfo.CompiledSchema.ToPointer());
         size_t pointerSize = (size_t)parseTdhContext->NativePointerSize;
 
-        if (formatter->FormatEventMessage(nativeEventInfo, pointerSize, buffer, bufferSize))
-            return gcnew System::String(buffer);
-        return nullptr;
+        // Rows shown again are taken from the message cache of the trace log.
+        auto cache = (::etk::FormattedMessageCache*)eventInfo.MessageCache.ToPointer();
+        uint64_t const sequence = eventInfo.MessageSequence;
+        if (cache && cache->TryGet(sequence, *message))
+            return gcnew System::String(message->data(), 0, (int)message->length());
+
+        System::String^ result = Format(nativeEventInfo, pointerSize);
+        if (cache && result)
+            cache->Add(sequence, *message, eventInfo.MessageGeneration);
+        return result;
     }
 
     System::String^ FormatEventMessage(
         void* record, void* info, size_t infoSize, size_t pointerSize)
     {
-        size_t const bufferSize = 0x1000;
-        wchar_t buffer[bufferSize];
-
         etk::EventInfo eventInfo((EVENT_RECORD*)record, (TRACE_EVENT_INFO*)info, infoSize);
-        if (formatter->FormatEventMessage(eventInfo, pointerSize, buffer, bufferSize))
-            return gcnew System::String(buffer);
-        return nullptr;
+        return Format(eventInfo, pointerSize);
     }
 
-    NativeTdhFormatter() : formatter(new ::etk::TdhMessageFormatter()) {}
+    NativeTdhFormatter()
+        : formatter(new ::etk::TdhMessageFormatter())
+        , message(new std::wstring())
+    {}
+
     ~NativeTdhFormatter() { this->!NativeTdhFormatter(); }
-    !NativeTdhFormatter() { delete formatter; }
+
+    !NativeTdhFormatter()
+    {
+        delete formatter;
+        delete message;
+    }
 
 private:
+    System::String^ Format(etk::EventInfo eventInfo, size_t pointerSize)
+    {
+        message->clear();
+        if (!formatter->FormatEventMessage(eventInfo, pointerSize, *message))
+            return nullptr;
+        return gcnew System::String(message->data(), 0, (int)message->length());
+    }
+
     ::etk::TdhMessageFormatter* formatter;
+    std::wstring* message;
 };
 
 } // namespace EventTraceKit
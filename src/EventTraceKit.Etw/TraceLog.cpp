@@ -1,4 +1,5 @@
 #include "TraceLog.h"
+#include "etk/TraceLogExporter.h"
 #include <msclr/marshal_cppstd.h>
 
 using namespace System;
@@ -33,6 +34,18 @@ private:
 
 } // namespace
 
+void TraceLogMessageCache::OnSchemasResolved(size_t const* indices, size_t count,
+                                             void* state)
+{
+    auto& cache = *static_cast<TraceLogMessageCache*>(state);
+    size_t const clearCount = cache.Log->GetClearCount();
+    for (size_t i = 0; i < count; ++i) {
+        cache.Messages.Remove(
+            etk::FormattedMessageCache::MakeSequence(clearCount, indices[i]));
+    }
+    cache.Resolutions.fetch_add(1, std::memory_order_release);
+}
+
 TraceLog::TraceLog()
 {
     onEventsChangedCallback = gcnew EventsChangedDelegate(this, &TraceLog::OnEventsChanged);
@@ -46,6 +59,15 @@ TraceLog::TraceLog()
 
     this->nativeLog = nativeLog.release();
     this->filteredLog = filteredLog.release();
+
+    messageCache = new TraceLogMessageCache(this->nativeLog);
+    this->nativeLog->SetSchemasResolvedCallback(&TraceLogMessageCache::OnSchemasResolved,
+                                                messageCache);
+
+    onRebuildProgressCallback = gcnew RebuildProgressDelegate(this, &TraceLog::OnRebuildProgress);
+    auto nativeProgressCallback = static_cast<etk::TraceLogRebuildProgressCallback*>(
+        Marshal::GetFunctionPointerForDelegate(onRebuildProgressCallback).ToPointer());
+    this->filteredLog->SetRebuildProgressCallback(nativeProgressCallback, nullptr);
 }
 
 void TraceLog::OnEventsChanged(UIntPtr newCount)
@@ -53,13 +75,62 @@ void TraceLog::OnEventsChanged(UIntPtr newCount)
     EventsChanged(newCount);
 }
 
+void TraceLog::OnRebuildProgress(UIntPtr scanned, UIntPtr total)
+{
+    RebuildProgress(scanned, total);
+}
+
+static TimeSpan ToTimeSpan(std::chrono::nanoseconds duration)
+{
+    return TimeSpan(static_cast<long long>(duration.count() / 100));
+}
+
+TraceLogRebuildStatistics TraceLog::GetRebuildStatistics()
+{
+    etk::TraceLogRebuildStatistics const stats = filteredLog->GetRebuildStatistics();
+
+    TraceLogRebuildStatistics result;
+    result.CompletedRebuilds = static_cast<unsigned>(stats.CompletedRebuilds);
+    result.CancelledRebuilds = static_cast<unsigned>(stats.CancelledRebuilds);
+    result.LastEventsScanned = static_cast<unsigned>(stats.LastEventsScanned);
+    result.LastDuration = ToTimeSpan(stats.LastDuration);
+    result.MaxDuration = ToTimeSpan(stats.MaxDuration);
+    result.TotalDuration = ToTimeSpan(stats.TotalDuration);
+    return result;
+}
+
 void TraceLog::SetFilter(TraceLogFilterPredicate^ filter)
 {
     auto t = std::make_unique<ManagedTraceLogFilter>(filter);
     this->filteredLog->SetFilter(t.get());
     t.release();
+    ++filterChanges;
 }
 
+void TraceLog::Export(String^ path, TraceLogExportFormat format)
+{
+    etk::TraceLogExportOptions options;
+    options.Format = format == TraceLogExportFormat::JsonLines
+                         ? etk::ExportFormat::JsonLines
+                         : etk::ExportFormat::Csv;
+    for (auto column = etk::ExportColumn::TimeStamp; column <= etk::ExportColumn::Message;
+         column = static_cast<etk::ExportColumn>(static_cast<unsigned>(column) + 1))
+        options.Columns.push_back(column);
+
+    etk::TraceLogExporter exporter(std::move(options));
+    HRESULT hr = exporter.ExportToFile(*filteredLog, marshal_as<std::wstring>(path));
+    if (FAILED(hr))
+        throw gcnew Win32Exception(hr);
+}
+
+void TraceLog::SetNotificationPolicy(TimeSpan maxLatency, unsigned maxBatchSize)
+{
+    etk::TraceLogNotificationPolicy policy;
+    policy.MaxLatency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::nanoseconds(maxLatency.Ticks * 100));
+    policy.MaxBatchSize = maxBatchSize;
+    filteredLog->SetNotificationPolicy(policy);
+}
 
 void TraceLog::UpdateTraceData(TraceProfileDescriptor^ profile)
 {
@@ -83,4 +154,9 @@ void TraceLog::UpdateTraceData(TraceProfileDescriptor^ profile)
     }
 }
 
+void TraceLog::SetSchemaCacheFile(String^ path)
+{
+    etk::SetSchemaCacheFile(marshal_as<std::wstring>(path));
+}
+
 } // namespace EventTraceKit::Tracing
@@ -1,8 +1,11 @@
 #pragma once
 #if __cplusplus_cli
+#include "etk/FormattedMessageCache.h"
 #include "etk/ITraceLog.h"
 #include "Descriptors.h"
 
+#include <atomic>
+
 namespace EventTraceKit::Tracing
 {
 
@@ -12,6 +15,39 @@ public delegate bool TraceLogFilterPredicate(
     System::IntPtr eventRecord, System::IntPtr traceEventInfo,
     System::UIntPtr traceEventInfoSize);
 
+// Formatted messages of the events of a trace log, keyed by their index in
+// the unfiltered log and the clear count of the log. Messages of events whose
+// schema is resolved or refreshed later are removed, and such resolutions are
+// counted.
+struct TraceLogMessageCache
+{
+    explicit TraceLogMessageCache(etk::ITraceLog* log)
+        : Log(log)
+    {}
+
+    static void OnSchemasResolved(size_t const* indices, size_t count, void* state);
+
+    etk::ITraceLog* const Log;
+    etk::FormattedMessageCache Messages;
+    std::atomic<size_t> Resolutions{0};
+};
+
+public enum class TraceLogExportFormat
+{
+    Csv,
+    JsonLines,
+};
+
+public value struct TraceLogRebuildStatistics
+{
+    property unsigned CompletedRebuilds;
+    property unsigned CancelledRebuilds;
+    property unsigned LastEventsScanned;
+    property System::TimeSpan LastDuration;
+    property System::TimeSpan MaxDuration;
+    property System::TimeSpan TotalDuration;
+};
+
 public ref class TraceLog : public System::IDisposable
 {
 public:
@@ -19,6 +55,10 @@ public:
         System::Runtime::InteropServices::CallingConvention::Cdecl)]
     delegate void EventsChangedDelegate(System::UIntPtr);
 
+    [System::Runtime::InteropServices::UnmanagedFunctionPointer(
+        System::Runtime::InteropServices::CallingConvention::Cdecl)]
+    delegate void RebuildProgressDelegate(System::UIntPtr, System::UIntPtr);
+
     TraceLog();
 
     ~TraceLog() { this->!TraceLog(); }
@@ -26,10 +66,17 @@ public:
     {
         delete nativeLog;
         delete filteredLog;
+        delete messageCache;
     }
 
     event System::Action<System::UIntPtr>^ EventsChanged;
 
+    /// <summary>
+    ///   Raised on the filter thread while the filtered view is rebuilt, with
+    ///   the number of scanned events and the total number of events.
+    /// </summary>
+    event System::Action<System::UIntPtr, System::UIntPtr>^ RebuildProgress;
+
     property unsigned EventCount
     {
         unsigned get() { return filteredLog->GetEventCount(); }
@@ -40,26 +87,79 @@ public:
         unsigned get() { return nativeLog->GetEventCount(); }
     }
 
-    void Clear() { nativeLog->Clear(); }
+    void Clear()
+    {
+        nativeLog->Clear();
+        messageCache->Messages.Clear();
+    }
 
     EventInfo GetEvent(int index)
     {
-        auto eventInfo = filteredLog->GetEvent(index);
+        // Read the generations first, so that messages of events changing
+        // meanwhile are not cached. The event is taken from the unfiltered log,
+        // since the filtered view may still refer to events of a cleared log.
+        size_t const clearCount = nativeLog->GetClearCount();
+        uint64_t const messageGeneration = messageCache->Messages.GetGeneration();
+
+        size_t sourceIndex;
+        if (!filteredLog->GetEvent(index, sourceIndex).Record())
+            return EventInfo();
+
+        auto eventInfo = nativeLog->GetEvent(sourceIndex);
         EventInfo info;
         info.EventRecord = System::IntPtr(const_cast<EVENT_RECORD*>(eventInfo.Record()));
         info.TraceEventInfo = System::IntPtr(const_cast<TRACE_EVENT_INFO*>(eventInfo.Info()));
         info.TraceEventInfoSize = System::UIntPtr((void*)eventInfo.InfoSize());
+        info.CompiledSchema =
+            System::IntPtr(const_cast<etk::CompiledSchema*>(eventInfo.Compiled()));
+        if (nativeLog->GetClearCount() == clearCount) {
+            info.MessageCache = System::IntPtr(&messageCache->Messages);
+            info.MessageSequence =
+                etk::FormattedMessageCache::MakeSequence(clearCount, sourceIndex);
+            info.MessageGeneration = messageGeneration;
+        }
         return info;
     }
 
     EventSessionInfo GetInfo() { return sessionInfo; }
 
+    TraceLogRebuildStatistics GetRebuildStatistics();
+
     void SetFilter(TraceLogFilterPredicate^ filter);
 
+    /// <summary>
+    ///   Writes the events of the filtered view with all header columns and
+    ///   their messages to a new file, replacing an existing one. The log must
+    ///   not be cleared while exporting.
+    /// </summary>
+    void Export(System::String^ path, TraceLogExportFormat format);
+
+    /// <summary>
+    ///   Sets how long, and for how many matched events, the filtered view may
+    ///   defer <see cref="EventsChanged"/> while filtering.
+    /// </summary>
+    void SetNotificationPolicy(System::TimeSpan maxLatency, unsigned maxBatchSize);
+
     void UpdateTraceData(TraceProfileDescriptor^ profile);
 
+    /// <summary>
+    ///   Sets the file used to persist resolved event schemas across sessions.
+    /// </summary>
+    static void SetSchemaCacheFile(System::String^ path);
+
 internal:
     etk::ITraceLog* Native() { return nativeLog; }
+    etk::IFilteredTraceLog* NativeFiltered() { return filteredLog; }
+    etk::FormattedMessageCache* NativeMessageCache() { return &messageCache->Messages; }
+
+    // Changes whenever rows of the filtered view may have changed other than
+    // by appending events: when the log is cleared, the filter is changed or
+    // schemas of stored events are resolved.
+    size_t GetViewGeneration()
+    {
+        return nativeLog->GetClearCount() + filterChanges +
+               messageCache->Resolutions.load(std::memory_order_acquire);
+    }
 
     void SetSessionInfo(EventSessionInfo sessionInfo)
     {
@@ -68,11 +168,15 @@ internal:
 
 private:
     void OnEventsChanged(System::UIntPtr newCount);
+    void OnRebuildProgress(System::UIntPtr scanned, System::UIntPtr total);
 
     EventSessionInfo sessionInfo;
     EventsChangedDelegate^ onEventsChangedCallback;
+    RebuildProgressDelegate^ onRebuildProgressCallback;
     etk::ITraceLog* nativeLog;
     etk::IFilteredTraceLog* filteredLog;
+    TraceLogMessageCache* messageCache;
+    size_t filterChanges;
 };
 
 } // namespace EventTraceKit::Tracing
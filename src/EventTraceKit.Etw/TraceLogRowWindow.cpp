@@ -0,0 +1,67 @@
+#include "TraceLogRowWindow.h"
+#include "InteropHelper.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace System;
+using msclr::interop::marshal_as;
+
+namespace EventTraceKit::Tracing
+{
+
+static_assert(static_cast<int>(TraceLogColumn::Message) ==
+              static_cast<int>(etk::ExportColumn::Message));
+
+TraceLogRowWindow::TraceLogRowWindow()
+    : window(new etk::TraceLogRowWindow())
+{
+}
+
+void TraceLogRowWindow::Update(TraceLog^ log, int first, int count,
+                               array<TraceLogColumn>^ columns)
+{
+    std::vector<etk::ExportColumn> nativeColumns;
+    nativeColumns.reserve(columns->Length);
+    for each (TraceLogColumn column in columns)
+        nativeColumns.push_back(static_cast<etk::ExportColumn>(column));
+
+    // Read the generation first, so that rows changing while updating leave
+    // the window outdated.
+    generation = log->GetViewGeneration();
+    this->log = log;
+
+    window->SetMessageCache(log->NativeMessageCache(), log->Native());
+    window->Update(*log->NativeFiltered(), static_cast<size_t>(std::max(first, 0)),
+                   static_cast<size_t>(std::max(count, 0)), nativeColumns);
+}
+
+int TraceLogRowWindow::AddColumn(TraceLogColumn column)
+{
+    window->AddColumn(static_cast<etk::ExportColumn>(column));
+    return static_cast<int>(window->GetColumnCount()) - 1;
+}
+
+int TraceLogRowWindow::IndexOf(TraceLogColumn column)
+{
+    for (size_t i = 0; i < window->GetColumnCount(); ++i) {
+        if (window->GetColumn(i) == static_cast<etk::ExportColumn>(column))
+            return static_cast<int>(i);
+    }
+
+    return -1;
+}
+
+Guid TraceLogRowWindow::GetGuid(int row, int column)
+{
+    return marshal_as<Guid>(window->GetGuid(row - FirstRow, column));
+}
+
+String^ TraceLogRowWindow::GetText(int row, int column)
+{
+    if (!window->HasText(row - FirstRow, column))
+        return nullptr;
+    return marshal_as<String^>(window->GetText(row - FirstRow, column));
+}
+
+} // namespace EventTraceKit::Tracing
@@ -0,0 +1,121 @@
+#pragma once
+#if __cplusplus_cli
+#include "etk/TraceLogRowWindow.h"
+#include "TraceLog.h"
+
+namespace EventTraceKit::Tracing
+{
+
+/// <summary>
+///   The columns of a <see cref="TraceLogRowWindow"/>. Mirrors the native
+///   export columns.
+/// </summary>
+public enum class TraceLogColumn
+{
+    TimeStamp,
+    ProviderId,
+    ProviderName,
+    Id,
+    Version,
+    Channel,
+    Level,
+    Opcode,
+    OpcodeName,
+    Task,
+    TaskName,
+    Keyword,
+    ProcessId,
+    ThreadId,
+    ProcessorIndex,
+    Message,
+};
+
+/// <summary>
+///   The cells of a range of rows of the filtered view of a trace log for the
+///   columns a grid shows. Only the requested columns are decoded, and
+///   messages are taken from the message cache of the log or formatted once
+///   per update.
+/// </summary>
+public ref class TraceLogRowWindow : public System::IDisposable
+{
+public:
+    TraceLogRowWindow();
+
+    ~TraceLogRowWindow() { this->!TraceLogRowWindow(); }
+    !TraceLogRowWindow()
+    {
+        delete window;
+        window = nullptr;
+    }
+
+    /// <summary>
+    ///   Decodes the columns of the rows [first, first + count) of the log.
+    ///   The range is clamped to the events of the log.
+    /// </summary>
+    void Update(TraceLog^ log, int first, int count, array<TraceLogColumn>^ columns);
+
+    /// <summary>
+    ///   Decodes another column for the rows of the window and returns its
+    ///   index. The window must be current.
+    /// </summary>
+    int AddColumn(TraceLogColumn column);
+
+    /// <summary>
+    ///   Whether the window was updated for the log and its rows have not
+    ///   changed since, other than by appending events.
+    /// </summary>
+    bool IsCurrent(TraceLog^ log)
+    {
+        return this->log == log && log != nullptr &&
+               generation == log->GetViewGeneration();
+    }
+
+    /// <summary>
+    ///   Whether the window holds the row. Rows are indices into the log.
+    /// </summary>
+    bool ContainsRow(int row)
+    {
+        return row >= FirstRow && row - FirstRow < RowCount;
+    }
+
+    /// <summary>
+    ///   Returns the index of the column in the window, or -1.
+    /// </summary>
+    int IndexOf(TraceLogColumn column);
+
+    property int FirstRow
+    {
+        int get() { return static_cast<int>(window->GetFirstRow()); }
+    }
+
+    property int RowCount
+    {
+        int get() { return static_cast<int>(window->GetRowCount()); }
+    }
+
+    /// <summary>
+    ///   The value of a cell of a numeric column. TimeStamp values are
+    ///   signed.
+    /// </summary>
+    unsigned long long GetNumber(int row, int column)
+    {
+        return window->GetNumber(row - FirstRow, column);
+    }
+
+    System::Guid GetGuid(int row, int column);
+
+    /// <summary>
+    ///   The value of a cell of a text column, or <see langword="null"/> if
+    ///   the cell has no value.
+    /// </summary>
+    System::String^ GetText(int row, int column);
+
+private:
+    etk::TraceLogRowWindow* window;
+    TraceLog^ log;
+    size_t generation;
+};
+
+} // namespace EventTraceKit::Tracing
+
+#endif // __cplusplus_cli
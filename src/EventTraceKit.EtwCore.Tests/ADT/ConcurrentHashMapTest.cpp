@@ -0,0 +1,246 @@
+#include "etk/ADT/ConcurrentHashMap.h"
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+TEST(ConcurrentHashMapTest, GetOrCreate)
+{
+    ConcurrentHashMap<int, std::string> map;
+    EXPECT_EQ(nullptr, map.Find(1));
+
+    int calls = 0;
+    auto factory = [&](int key) {
+        ++calls;
+        return std::make_pair(key, std::to_string(key));
+    };
+
+    std::string const& value = map.GetOrCreate(1, factory);
+    EXPECT_EQ("1", value);
+    EXPECT_EQ(&value, &map.GetOrCreate(1, factory));
+    EXPECT_EQ(&value, map.Find(1));
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(1u, map.Size());
+}
+
+TEST(ConcurrentHashMapTest, Grow)
+{
+    ConcurrentHashMap<int, int> map;
+
+    std::vector<int const*> values;
+    for (int i = 0; i < 10000; ++i) {
+        values.push_back(
+            &map.GetOrCreate(i, [](int key) { return std::make_pair(key, key * 2); }));
+    }
+
+    EXPECT_EQ(10000u, map.Size());
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(values[i], map.Find(i));
+        EXPECT_EQ(i * 2, *values[i]);
+    }
+}
+
+TEST(ConcurrentHashMapTest, Clear)
+{
+    ConcurrentHashMap<int, std::string> map;
+    auto factory = [](int key) { return std::make_pair(key, std::to_string(key)); };
+
+    // Values from before a clear remain readable until the next one.
+    std::string const& value = map.GetOrCreate(1, factory);
+    map.Clear();
+    EXPECT_EQ(nullptr, map.Find(1));
+    EXPECT_EQ(0u, map.Size());
+    EXPECT_EQ("1", value);
+
+    std::string const& newValue = map.GetOrCreate(1, factory);
+    EXPECT_EQ("1", newValue);
+    EXPECT_EQ(&newValue, map.Find(1));
+}
+
+TEST(ConcurrentHashMapTest, GetOrUpdate)
+{
+    ConcurrentHashMap<int, std::string> map;
+    auto isCurrent = [](std::string const& value) { return value != "stale"; };
+
+    std::string const& stale = map.GetOrUpdate(1, isCurrent, [](int key, auto previous) {
+        EXPECT_EQ(nullptr, previous);
+        return std::make_pair(key, std::string("stale"));
+    });
+    EXPECT_EQ("stale", stale);
+
+    // Replaced values stay readable until the map is cleared twice.
+    std::string const& value = map.GetOrUpdate(1, isCurrent, [](int key, auto previous) {
+        EXPECT_EQ("stale", *previous);
+        return std::make_pair(key, std::to_string(key));
+    });
+    EXPECT_EQ("1", value);
+    EXPECT_EQ(&value, map.Find(1));
+    EXPECT_EQ("stale", stale);
+    EXPECT_EQ(1u, map.Size());
+
+    int calls = 0;
+    EXPECT_EQ(&value, &map.GetOrUpdate(1, isCurrent, [&](int key, auto) {
+        ++calls;
+        return std::make_pair(key, std::string());
+    }));
+    EXPECT_EQ(0, calls);
+
+    // Factories may keep the existing value instead of replacing it.
+    auto isNeverCurrent = [](std::string const&) { return false; };
+    EXPECT_EQ(&value, &map.GetOrUpdate(1, isNeverCurrent, [&](int, auto previous) {
+        ++calls;
+        EXPECT_EQ(&value, previous);
+        return std::optional<std::pair<int, std::string>>();
+    }));
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(&value, map.Find(1));
+
+    // Replaced entries survive growth of the table.
+    auto factory = [](int key) { return std::make_pair(key, std::to_string(key)); };
+    for (int i = 2; i < 100; ++i)
+        map.GetOrCreate(i, factory);
+    EXPECT_EQ(&value, map.Find(1));
+
+    map.Clear();
+    EXPECT_EQ("stale", stale);
+}
+
+TEST(ConcurrentHashMapTest, Erase)
+{
+    ConcurrentHashMap<int, int> map;
+    auto factory = [](int key) { return std::make_pair(key, key * 2); };
+    for (int i = 0; i < 1000; ++i)
+        map.GetOrCreate(i, factory);
+
+    EXPECT_FALSE(map.Erase(1000));
+    for (int i = 0; i < 1000; i += 3)
+        EXPECT_TRUE(map.Erase(i));
+    EXPECT_EQ(666u, map.Size());
+
+    // Entries whose probe sequence passed an erased slot are still found.
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 3 == 0) {
+            EXPECT_EQ(nullptr, map.Find(i)) << i;
+        } else {
+            ASSERT_NE(nullptr, map.Find(i)) << i;
+            EXPECT_EQ(i * 2, *map.Find(i));
+        }
+    }
+
+    EXPECT_EQ(0, map.GetOrCreate(0, factory));
+    EXPECT_EQ(667u, map.Size());
+}
+
+TEST(ConcurrentHashMapTest, ReadGuard)
+{
+    ConcurrentHashMap<int, std::string, std::hash<int>, 1> map;
+    auto factory = [](int key) { return std::make_pair(key, std::to_string(key)); };
+    map.GetOrCreate(1, factory);
+
+    // An erased value stays allocated while a guard created before is alive,
+    // however often the shard frees other erased entries meanwhile.
+    {
+        ConcurrentHashMap<int, std::string, std::hash<int>, 1>::ReadGuard guard;
+        std::string const* value = map.Find(1, guard);
+        ASSERT_NE(nullptr, value);
+        EXPECT_TRUE(map.Erase(1));
+        EXPECT_EQ(nullptr, map.Find(1));
+
+        for (int i = 2; i < 100; ++i) {
+            map.GetOrCreate(i, factory);
+            EXPECT_TRUE(map.Erase(i));
+        }
+        EXPECT_EQ("1", *value);
+    }
+
+    for (int i = 100; i < 200; ++i) {
+        map.GetOrCreate(i, factory);
+        EXPECT_TRUE(map.Erase(i));
+    }
+    EXPECT_EQ(0u, map.Size());
+}
+
+TEST(ConcurrentHashMapTest, ConcurrentErase)
+{
+    ConcurrentHashMap<int, int> map;
+    int const keyCount = 256;
+    auto factory = [](int key) { return std::make_pair(key, key * 2); };
+
+    // Readers race with a thread that keeps erasing and inserting keys, which
+    // also rebuilds tables to drop tombstones.
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                for (int key = 0; key < keyCount; ++key) {
+                    ConcurrentHashMap<int, int>::ReadGuard guard;
+                    if (int const* value = map.Find(key, guard))
+                        ASSERT_EQ(key * 2, *value);
+                }
+            }
+        });
+    }
+
+    for (int round = 0; round < 200; ++round) {
+        for (int key = 0; key < keyCount; ++key)
+            map.GetOrCreate(key, factory);
+        for (int key = round % 2; key < keyCount; key += 2)
+            EXPECT_TRUE(map.Erase(key));
+        for (int key = 0; key < keyCount; ++key)
+            map.Erase(key);
+    }
+
+    done.store(true);
+    for (auto& thread : readers)
+        thread.join();
+    EXPECT_EQ(0u, map.Size());
+}
+
+TEST(ConcurrentHashMapTest, ConcurrentGetOrCreate)
+{
+    ConcurrentHashMap<int, int> map;
+    std::atomic<int> calls{};
+
+    int const threadCount = 8;
+    int const keyCount = 5000;
+    std::vector<std::vector<int const*>> results(threadCount);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < keyCount; ++i) {
+                // Threads walk the keys in different orders so that both
+                // lookups and insertions race with each other.
+                int const key = (t % 2 == 0) ? i : keyCount - 1 - i;
+                results[t].push_back(&map.GetOrCreate(key, [&](int key) {
+                    ++calls;
+                    return std::make_pair(key, key + 1);
+                }));
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(keyCount, calls.load());
+    EXPECT_EQ(static_cast<size_t>(keyCount), map.Size());
+    for (int t = 0; t < threadCount; ++t) {
+        for (int i = 0; i < keyCount; ++i) {
+            int const key = (t % 2 == 0) ? i : keyCount - 1 - i;
+            ASSERT_EQ(map.Find(key), results[t][i]);
+            EXPECT_EQ(key + 1, *results[t][i]);
+        }
+    }
+}
+
+} // namespace etk::tests
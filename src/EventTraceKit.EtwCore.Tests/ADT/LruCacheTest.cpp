@@ -0,0 +1,61 @@
+#include "etk/ADT/LruCache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+TEST(LruCacheTest, EvictsLeastRecentlyUsed)
+{
+    LruCache<int, std::string> cache(2);
+    auto factory = [](int key) { return std::to_string(key); };
+
+    cache.GetOrCreate(1, factory);
+    cache.GetOrCreate(2, factory);
+    EXPECT_NE(nullptr, cache.Find(1));
+
+    cache.GetOrCreate(3, factory);
+    EXPECT_EQ(2u, cache.Size());
+    EXPECT_EQ(nullptr, cache.Find(2));
+    EXPECT_EQ("1", *cache.Find(1));
+    EXPECT_EQ("3", *cache.Find(3));
+
+    cache.SetCapacity(1);
+    EXPECT_EQ(1u, cache.Size());
+    EXPECT_EQ(nullptr, cache.Find(1));
+}
+
+TEST(LruCacheTest, Weights)
+{
+    struct LengthWeigher
+    {
+        size_t operator()(std::string const& value) const { return value.size(); }
+    };
+
+    LruCache<int, std::string, std::hash<int>, LengthWeigher> cache(10);
+    cache.Insert(1, "aaaa");
+    cache.Insert(2, "bbbb");
+    EXPECT_EQ(8u, cache.Weight());
+
+    // Replacing a value updates the weight.
+    cache.Insert(1, "aa");
+    EXPECT_EQ(6u, cache.Weight());
+
+    cache.Insert(3, "cccccc");
+    EXPECT_EQ(nullptr, cache.Find(2));
+    EXPECT_EQ(8u, cache.Weight());
+
+    auto const [key, value] = cache.PopLeastRecent();
+    EXPECT_EQ(1, key);
+    EXPECT_EQ("aa", value);
+    EXPECT_EQ(6u, cache.Weight());
+
+    EXPECT_TRUE(cache.Remove(3));
+    EXPECT_FALSE(cache.Remove(3));
+    EXPECT_TRUE(cache.Empty());
+    EXPECT_EQ(0u, cache.Weight());
+}
+
+} // namespace etk::tests
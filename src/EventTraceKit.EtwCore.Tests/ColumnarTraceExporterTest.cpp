@@ -0,0 +1,389 @@
+#include "etk/ColumnarTraceExporter.h"
+
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+// Reads back the columnar format.
+class ExportReader
+{
+public:
+    struct Column
+    {
+        ColumnType Type;
+        USHORT InType;
+        std::string Name;
+    };
+
+    struct Table
+    {
+        GUID ProviderId;
+        USHORT EventId;
+        bool HasSchema;
+        std::vector<Column> Columns;
+    };
+
+    struct ColumnData
+    {
+        std::string Validity;
+        std::string Values;
+        std::string Heap;
+
+        bool IsValid(size_t row) const
+        {
+            return (static_cast<uint8_t>(Validity[row / 8]) >> (row % 8) & 1) != 0;
+        }
+
+        template<typename T>
+        T Get(size_t row) const
+        {
+            T value;
+            std::memcpy(&value, Values.data() + row * sizeof(T), sizeof(T));
+            return value;
+        }
+
+        std::string GetBytes(size_t row) const
+        {
+            auto const begin = Get<uint64_t>(row);
+            return Heap.substr(begin, Get<uint64_t>(row + 1) - begin);
+        }
+    };
+
+    struct Batch
+    {
+        uint32_t TableId;
+        size_t RowCount;
+        std::vector<ColumnData> Columns;
+    };
+
+    explicit ExportReader(std::string_view contents)
+        : contents(contents)
+    {}
+
+    bool Read()
+    {
+        if (Read<uint32_t>() != ColumnarTraceExporter::Magic ||
+            Read<uint32_t>() != ColumnarTraceExporter::FormatVersion)
+            return false;
+        Read<uint64_t>();
+
+        while (position < contents.size()) {
+            auto const type = Read<ColumnarTraceExporter::BlockType>();
+            Read<uint32_t>();
+            auto const bodySize = Read<uint64_t>();
+            size_t const bodyEnd = position + bodySize;
+            if (bodySize % 8 != 0 || bodyEnd > contents.size())
+                return false;
+
+            switch (type) {
+            case ColumnarTraceExporter::BlockType::Dictionary: ReadDictionary(); break;
+            case ColumnarTraceExporter::BlockType::Table: ReadTable(); break;
+            case ColumnarTraceExporter::BlockType::Batch: ReadBatch(); break;
+            default: return false;
+            }
+
+            if (position != bodyEnd)
+                return false;
+        }
+
+        return true;
+    }
+
+    std::vector<std::string> Dictionary;
+    std::vector<Table> Tables;
+    std::vector<Batch> Batches;
+
+private:
+    template<typename T>
+    T Read()
+    {
+        T value = {};
+        if (position + sizeof(T) <= contents.size())
+            std::memcpy(&value, contents.data() + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    std::string ReadPadded(size_t size)
+    {
+        std::string data(contents.substr(std::min(position, contents.size()), size));
+        position += (size + 7) & ~size_t(7);
+        return data;
+    }
+
+    std::string ReadBuffer() { return ReadPadded(Read<uint64_t>()); }
+
+    void ReadDictionary()
+    {
+        EXPECT_EQ(Dictionary.size(), Read<uint32_t>());
+        auto const count = Read<uint32_t>();
+        ColumnData strings;
+        strings.Values = ReadBuffer();
+        strings.Heap = ReadBuffer();
+        for (size_t i = 0; i < count; ++i)
+            Dictionary.push_back(strings.GetBytes(i));
+    }
+
+    void ReadTable()
+    {
+        EXPECT_EQ(Tables.size(), Read<uint32_t>());
+        auto const columnCount = Read<uint32_t>();
+
+        Table table;
+        table.ProviderId = Read<GUID>();
+        table.EventId = Read<uint16_t>();
+        Read<uint8_t>();
+        table.HasSchema = Read<uint8_t>() != 0;
+        Read<uint32_t>();
+
+        for (size_t i = 0; i < columnCount; ++i) {
+            Column column;
+            column.Type = Read<ColumnType>();
+            Read<uint8_t>();
+            column.InType = Read<uint16_t>();
+            column.Name = ReadPadded(Read<uint32_t>());
+            table.Columns.push_back(column);
+        }
+
+        Tables.push_back(table);
+    }
+
+    void ReadBatch()
+    {
+        Batch batch;
+        batch.TableId = Read<uint32_t>();
+        Read<uint32_t>();
+        batch.RowCount = static_cast<size_t>(Read<uint64_t>());
+
+        ASSERT_LT(batch.TableId, Tables.size());
+        for (Column const& column : Tables[batch.TableId].Columns) {
+            ColumnData data;
+            data.Validity = ReadBuffer();
+            data.Values = ReadBuffer();
+            if (column.Type == ColumnType::String || column.Type == ColumnType::Binary)
+                data.Heap = ReadBuffer();
+            batch.Columns.push_back(std::move(data));
+        }
+
+        Batches.push_back(std::move(batch));
+    }
+
+    std::string_view contents;
+    size_t position = 0;
+};
+
+size_t const HeaderColumnCount = 16;
+
+} // namespace
+
+TEST(ColumnarTraceExporterTest, Tables)
+{
+    TestSchema schema;
+    auto const info = schema.Add(L"Count", TDH_INTYPE_INT32, 4)
+                          .Add(L"Name", TDH_INTYPE_ANSISTRING)
+                          .Add(L"Enabled", TDH_INTYPE_BOOLEAN, 4)
+                          .SetProviderName(L"My-Provider")
+                          .SetTaskName(L"Work")
+                          .Build();
+
+    TestPayload first;
+    first.Add<int32_t>(-7).AddAnsiString("alpha").Add<uint32_t>(1);
+    TestPayload second;
+    second.Add<int32_t>(42).AddAnsiString("").Add<uint32_t>(0);
+    TestPayload truncated;
+    truncated.Add<int32_t>(3);
+
+    TestTraceLog log;
+    log.Add(first.MakeRecord(1, 10), info, schema.Size());
+    log.Add(MakeRecord(9, 20));
+    log.Add(second.MakeRecord(1, 30), info, schema.Size());
+    log.Add(truncated.MakeRecord(1, 40), info, schema.Size());
+
+    std::string output;
+    ColumnarTraceExporter exporter;
+    ASSERT_EQ(S_OK, exporter.Export(log, AppendOutput, &output));
+    EXPECT_EQ(2u, exporter.GetTableCount());
+    EXPECT_EQ(4u, exporter.GetStatistics().ExportedEvents);
+    EXPECT_EQ(output.size(), exporter.GetStatistics().WrittenBytes);
+
+    ExportReader reader(output);
+    ASSERT_TRUE(reader.Read());
+    EXPECT_EQ((std::vector<std::string>{"My-Provider", "Work"}), reader.Dictionary);
+    ASSERT_EQ(2u, reader.Tables.size());
+    ASSERT_EQ(2u, reader.Batches.size());
+
+    auto const& table = reader.Tables[0];
+    EXPECT_TRUE(table.HasSchema);
+    EXPECT_EQ(0, std::memcmp(&TestProviderId, &table.ProviderId, sizeof(GUID)));
+    EXPECT_EQ(1, table.EventId);
+    ASSERT_EQ(HeaderColumnCount + 3, table.Columns.size());
+    EXPECT_EQ("Index", table.Columns[0].Name);
+    EXPECT_EQ(ColumnType::Dictionary, table.Columns[3].Type);
+    EXPECT_EQ("Count", table.Columns[16].Name);
+    EXPECT_EQ(ColumnType::Int64, table.Columns[16].Type);
+    EXPECT_EQ(TDH_INTYPE_INT32, table.Columns[16].InType);
+    // ANSI strings are copied as bytes, since their code page is unknown.
+    EXPECT_EQ(ColumnType::Binary, table.Columns[17].Type);
+    EXPECT_EQ(ColumnType::Boolean, table.Columns[18].Type);
+
+    auto const& batch = reader.Batches[0];
+    EXPECT_EQ(0u, batch.TableId);
+    ASSERT_EQ(3u, batch.RowCount);
+    EXPECT_EQ(0u, batch.Columns[0].Get<uint64_t>(0));
+    EXPECT_EQ(2u, batch.Columns[0].Get<uint64_t>(1));
+    EXPECT_EQ(3u, batch.Columns[0].Get<uint64_t>(2));
+    EXPECT_EQ(1001, batch.Columns[1].Get<int64_t>(0));
+    EXPECT_EQ(0u, batch.Columns[3].Get<uint32_t>(0));
+    EXPECT_EQ(1u, batch.Columns[11].Get<uint32_t>(2));
+    EXPECT_EQ(30u, batch.Columns[13].Get<uint32_t>(1));
+
+    EXPECT_EQ(-7, batch.Columns[16].Get<int64_t>(0));
+    EXPECT_EQ(42, batch.Columns[16].Get<int64_t>(1));
+    EXPECT_EQ("alpha", batch.Columns[17].GetBytes(0));
+    EXPECT_TRUE(batch.Columns[17].IsValid(1));
+    EXPECT_EQ("", batch.Columns[17].GetBytes(1));
+    EXPECT_EQ(1, batch.Columns[18].Get<uint8_t>(0));
+    EXPECT_EQ(0, batch.Columns[18].Get<uint8_t>(1));
+
+    // The payload of the last event is too short for the schema.
+    for (size_t column = 16; column < 19; ++column)
+        EXPECT_FALSE(batch.Columns[column].IsValid(2));
+
+    // Events without schema only have header columns, with null names.
+    auto const& headerOnly = reader.Tables[1];
+    EXPECT_FALSE(headerOnly.HasSchema);
+    EXPECT_EQ(HeaderColumnCount, headerOnly.Columns.size());
+    EXPECT_EQ(1u, reader.Batches[1].TableId);
+    ASSERT_EQ(1u, reader.Batches[1].RowCount);
+    EXPECT_EQ(1u, reader.Batches[1].Columns[0].Get<uint64_t>(0));
+    EXPECT_EQ(9, reader.Batches[1].Columns[4].Get<uint16_t>(0));
+    EXPECT_FALSE(reader.Batches[1].Columns[3].IsValid(0));
+}
+
+TEST(ColumnarTraceExporterTest, TraceLoggingTables)
+{
+    // TraceLogging events all have id and version 0 and are told apart by
+    // their metadata.
+    TestSchema first;
+    first.Add(L"Count", TDH_INTYPE_UINT32, 4).SetTaskName(L"First").Build();
+    TestSchema second;
+    second.Add(L"Delta", TDH_INTYPE_INT64, 8).SetTaskName(L"Second").Build();
+
+    uint8_t firstMetadata[] = {'F', 'i', 'r', 's', 't', 0, 1};
+    uint8_t secondMetadata[] = {'S', 'e', 'c', 'o', 'n', 'd', 0, 2};
+    uint8_t firstMetadataCopy[] = {'F', 'i', 'r', 's', 't', 0, 1};
+
+    auto const makeItem = [](uint8_t* metadata, size_t size) {
+        EVENT_HEADER_EXTENDED_DATA_ITEM item = {};
+        item.ExtType = EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL;
+        item.DataSize = static_cast<USHORT>(size);
+        item.DataPtr = reinterpret_cast<ULONGLONG>(metadata);
+        return item;
+    };
+
+    EVENT_HEADER_EXTENDED_DATA_ITEM items[] = {
+        makeItem(firstMetadata, sizeof(firstMetadata)),
+        makeItem(secondMetadata, sizeof(secondMetadata)),
+        makeItem(firstMetadataCopy, sizeof(firstMetadataCopy)),
+    };
+
+    TestPayload firstPayload;
+    firstPayload.Add<uint32_t>(7);
+    TestPayload secondPayload;
+    secondPayload.Add<int64_t>(-3);
+    TestPayload thirdPayload;
+    thirdPayload.Add<uint32_t>(9);
+
+    EVENT_RECORD records[] = {firstPayload.MakeRecord(), secondPayload.MakeRecord(),
+                              thirdPayload.MakeRecord()};
+    for (size_t i = 0; i < std::size(records); ++i) {
+        records[i].EventHeader.Flags |= EVENT_HEADER_FLAG_EXTENDED_INFO;
+        records[i].ExtendedDataCount = 1;
+        records[i].ExtendedData = &items[i];
+    }
+
+    TestTraceLog log;
+    log.Add(records[0], first.Info(), first.Size());
+    log.Add(records[1], second.Info(), second.Size());
+    log.Add(records[2], first.Info(), first.Size());
+
+    std::string output;
+    ColumnarTraceExporter exporter;
+    ASSERT_EQ(S_OK, exporter.Export(log, AppendOutput, &output));
+    EXPECT_EQ(2u, exporter.GetTableCount());
+
+    ExportReader reader(output);
+    ASSERT_TRUE(reader.Read());
+    ASSERT_EQ(2u, reader.Tables.size());
+    ASSERT_EQ(2u, reader.Batches.size());
+    EXPECT_EQ((std::vector<std::string>{"First", "Second"}), reader.Dictionary);
+
+    ASSERT_EQ(HeaderColumnCount + 1, reader.Tables[0].Columns.size());
+    EXPECT_EQ("Count", reader.Tables[0].Columns[16].Name);
+    EXPECT_EQ(ColumnType::UInt64, reader.Tables[0].Columns[16].Type);
+    ASSERT_EQ(HeaderColumnCount + 1, reader.Tables[1].Columns.size());
+    EXPECT_EQ("Delta", reader.Tables[1].Columns[16].Name);
+    EXPECT_EQ(ColumnType::Int64, reader.Tables[1].Columns[16].Type);
+
+    auto const& firstBatch = reader.Batches[0];
+    EXPECT_EQ(0u, firstBatch.TableId);
+    ASSERT_EQ(2u, firstBatch.RowCount);
+    EXPECT_EQ(2u, firstBatch.Columns[0].Get<uint64_t>(1));
+    EXPECT_EQ(0u, firstBatch.Columns[11].Get<uint32_t>(0));
+    EXPECT_EQ(0u, firstBatch.Columns[11].Get<uint32_t>(1));
+    EXPECT_EQ(7u, firstBatch.Columns[16].Get<uint64_t>(0));
+    EXPECT_EQ(9u, firstBatch.Columns[16].Get<uint64_t>(1));
+
+    auto const& secondBatch = reader.Batches[1];
+    EXPECT_EQ(1u, secondBatch.TableId);
+    ASSERT_EQ(1u, secondBatch.RowCount);
+    EXPECT_EQ(1u, secondBatch.Columns[11].Get<uint32_t>(0));
+    EXPECT_EQ(-3, secondBatch.Columns[16].Get<int64_t>(0));
+}
+
+TEST(ColumnarTraceExporterTest, Batches)
+{
+    TestTraceLog log;
+    for (USHORT i = 0; i < 5; ++i)
+        log.Add(MakeRecord(i, i));
+
+    ColumnarExportOptions options;
+    options.BatchSize = 2;
+    options.BufferSize = 64;
+
+    std::string output;
+    ColumnarTraceExporter exporter(options);
+    ASSERT_EQ(S_OK, exporter.Export(log, AppendOutput, &output));
+
+    ExportReader reader(output);
+    ASSERT_TRUE(reader.Read());
+    ASSERT_EQ(3u, reader.Batches.size());
+    EXPECT_EQ(2u, reader.Batches[0].RowCount);
+    EXPECT_EQ(2u, reader.Batches[1].RowCount);
+    EXPECT_EQ(1u, reader.Batches[2].RowCount);
+    EXPECT_EQ(3u, reader.Batches[1].Columns[13].Get<uint32_t>(1));
+    EXPECT_EQ(4u, reader.Batches[2].Columns[0].Get<uint64_t>(0));
+
+    // Writing stops when the write callback fails.
+    size_t writes = 0;
+    auto const write = [](void const*, size_t, void* state) {
+        return ++*static_cast<size_t*>(state) < 3;
+    };
+    EXPECT_EQ(E_ABORT, exporter.Export(log, write, &writes));
+    EXPECT_EQ(3u, writes);
+}
+
+} // namespace etk::tests
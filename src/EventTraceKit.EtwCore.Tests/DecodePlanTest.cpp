@@ -0,0 +1,181 @@
+#include "etk/DecodePlan.h"
+
+#include "TestSupport.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+TEST(DecodePlanTest, FixedLayout)
+{
+    TestSchema schema;
+    auto const info = schema.Add(TDH_INTYPE_UINT32, 4)
+                          .Add(TDH_INTYPE_POINTER)
+                          .Add(TDH_INTYPE_UINT16, 2, 3)
+                          .Add(TDH_INTYPE_GUID, 16)
+                          .BuildEvent();
+
+    DecodePlan const plan(info);
+    EXPECT_EQ(4u, plan.GetPlannedPropertyCount());
+    EXPECT_EQ(4u, plan.GetFixedPropertyCount());
+
+    std::vector<std::byte> const payload(4 + 8 + 6 + 16);
+    DecodePlan::Location locations[4];
+
+    ASSERT_TRUE(plan.Locate(payload, 8, locations));
+    EXPECT_EQ(0u, locations[0].Offset);
+    EXPECT_EQ(4u, locations[0].Size);
+    EXPECT_EQ(4u, locations[1].Offset);
+    EXPECT_EQ(8u, locations[1].Size);
+    EXPECT_EQ(12u, locations[2].Offset);
+    EXPECT_EQ(6u, locations[2].Size);
+    EXPECT_EQ(3u, locations[2].Count);
+    EXPECT_EQ(2u, locations[2].Length);
+    EXPECT_EQ(18u, locations[3].Offset);
+
+    // Pointers of 32-bit processes are smaller.
+    ASSERT_TRUE(plan.Locate(payload, 4, locations));
+    EXPECT_EQ(4u, locations[1].Size);
+    EXPECT_EQ(8u, locations[2].Offset);
+    EXPECT_EQ(14u, locations[3].Offset);
+
+    // Short payloads are rejected.
+    EXPECT_FALSE(plan.Locate(cspan<std::byte>(payload).first(20), 8, locations));
+
+    // Leading properties are located on their own.
+    EXPECT_TRUE(plan.Locate(cspan<std::byte>(payload).first(4), 8,
+                            span<DecodePlan::Location>(locations, 1)));
+}
+
+TEST(DecodePlanTest, VariableLayout)
+{
+    TestSchema schema;
+    auto const info = schema.Add(TDH_INTYPE_UNICODESTRING)
+                          .Add(TDH_INTYPE_UINT16, 2)
+                          .Add(TDH_INTYPE_UINT32, 4)
+                          .CountFrom(1)
+                          .Add(TDH_INTYPE_UINT8, 1)
+                          .Add(TDH_INTYPE_BINARY)
+                          .LengthFrom(3)
+                          .Add(TDH_INTYPE_UINT64, 8)
+                          .BuildEvent();
+
+    DecodePlan const plan(info);
+    EXPECT_EQ(6u, plan.GetPlannedPropertyCount());
+    EXPECT_EQ(1u, plan.GetFixedPropertyCount());
+
+    TestPayload payload;
+    payload.AddString(u"abc")
+        .Add<uint16_t>(2)
+        .Add<uint32_t>(10)
+        .Add<uint32_t>(20)
+        .Add<uint8_t>(3)
+        .Add<uint8_t>(1)
+        .Add<uint8_t>(2)
+        .Add<uint8_t>(3)
+        .Add<uint64_t>(42);
+
+    DecodePlan::Location locations[6];
+    ASSERT_TRUE(plan.Locate(payload.Data(), 8, locations));
+    EXPECT_EQ(0u, locations[0].Offset);
+    EXPECT_EQ(8u, locations[0].Size);
+    EXPECT_EQ(8u, locations[1].Offset);
+    EXPECT_EQ(10u, locations[2].Offset);
+    EXPECT_EQ(8u, locations[2].Size);
+    EXPECT_EQ(2u, locations[2].Count);
+    EXPECT_EQ(18u, locations[3].Offset);
+    EXPECT_EQ(19u, locations[4].Offset);
+    EXPECT_EQ(3u, locations[4].Size);
+    EXPECT_EQ(3u, locations[4].Length);
+    EXPECT_EQ(22u, locations[5].Offset);
+    EXPECT_EQ(8u, locations[5].Size);
+
+    // Counts exceeding the payload are rejected.
+    TestPayload truncated;
+    truncated.AddString(u"abc").Add<uint16_t>(100).Add<uint32_t>(10);
+    EXPECT_FALSE(plan.Locate(truncated.Data(), 8, locations));
+}
+
+TEST(DecodePlanTest, PrefixedArraysAndStructs)
+{
+    // A TraceLogging array of structs { UINT32; UnicodeString; } whose count
+    // is stored in front of the elements, followed by an INT16.
+    TestSchema schema;
+    auto const info = schema.AddStruct(2, 2)
+                          .CountFrom(0)
+                          .Add(TDH_INTYPE_INT16, 2)
+                          .Add(TDH_INTYPE_UINT32, 4)
+                          .Add(TDH_INTYPE_UNICODESTRING)
+                          .BuildEvent(2);
+
+    DecodePlan const plan(info);
+    EXPECT_EQ(2u, plan.GetPlannedPropertyCount());
+    EXPECT_EQ(1u, plan.GetFixedPropertyCount());
+
+    TestPayload payload;
+    payload.Add<uint16_t>(2)
+        .Add<uint32_t>(1)
+        .AddString(u"a")
+        .Add<uint32_t>(2)
+        .AddString(u"bc")
+        .Add<int16_t>(-1);
+
+    DecodePlan::Location locations[2];
+    ASSERT_TRUE(plan.Locate(payload.Data(), 8, locations));
+    EXPECT_EQ(2u, locations[0].Offset);
+    EXPECT_EQ(2u, locations[0].Count);
+    EXPECT_EQ(18u, locations[0].Size);
+    EXPECT_EQ(20u, locations[1].Offset);
+    EXPECT_EQ(2u, locations[1].Size);
+}
+
+TEST(DecodePlanTest, StopsAtUnplannableProperty)
+{
+    // Struct members referring to other properties are not planned.
+    TestSchema schema;
+    auto const info = schema.Add(TDH_INTYPE_UINT32, 4)
+                          .AddStruct(3, 1)
+                          .Add(TDH_INTYPE_UINT32, 4)
+                          .Add(TDH_INTYPE_BINARY)
+                          .LengthFrom(0)
+                          .BuildEvent(3);
+
+    DecodePlan const plan(info);
+    EXPECT_EQ(1u, plan.GetPlannedPropertyCount());
+    EXPECT_EQ(1u, plan.GetFixedPropertyCount());
+
+    std::vector<std::byte> const payload(16);
+    DecodePlan::Location locations[2];
+    EXPECT_FALSE(plan.Locate(payload, 8, locations));
+}
+
+TEST(DecodePlanTest, CountsAndLengthsRequireIntegerTypes)
+{
+    // Fixed-size fields that are not integers cannot give counts or lengths.
+    USHORT const nonIntegerTypes[] = {TDH_INTYPE_FLOAT, TDH_INTYPE_BOOLEAN,
+                                      TDH_INTYPE_POINTER};
+    for (USHORT inType : nonIntegerTypes) {
+        TestSchema schema;
+        auto const info = schema.Add(inType, 4)
+                              .Add(TDH_INTYPE_BINARY)
+                              .LengthFrom(0)
+                              .Add(TDH_INTYPE_UINT8, 1)
+                              .CountFrom(0)
+                              .BuildEvent();
+
+        DecodePlan const plan(info);
+        EXPECT_EQ(1u, plan.GetPlannedPropertyCount()) << "in-type " << inType;
+    }
+
+    TestSchema schema;
+    auto const info = schema.Add(TDH_INTYPE_HEXINT32, 4)
+                          .Add(TDH_INTYPE_BINARY)
+                          .LengthFrom(0)
+                          .BuildEvent();
+    EXPECT_EQ(2u, DecodePlan(info).GetPlannedPropertyCount());
+}
+
+} // namespace etk::tests
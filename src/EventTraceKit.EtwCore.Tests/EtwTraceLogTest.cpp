@@ -0,0 +1,293 @@
+#include "etk/ITraceLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+GUID const ProviderId = {
+    0x3C2B1A09, 0x5555, 0x6666, {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88}};
+
+// TraceLogging metadata of an event without fields.
+std::vector<std::byte> MakeMetadata(char const* eventName)
+{
+    std::vector<std::byte> blob(3);
+    for (char const* p = eventName; *p; ++p)
+        blob.push_back(std::byte(*p));
+    blob.push_back(std::byte(0));
+
+    uint16_t const size = static_cast<uint16_t>(blob.size());
+    std::memcpy(blob.data(), &size, sizeof(size));
+    return blob;
+}
+
+class TestEvent
+{
+public:
+    explicit TestEvent(std::vector<std::byte> const& metadata)
+        : metadata(metadata)
+    {
+        item.ExtType = EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL;
+        item.DataSize = static_cast<USHORT>(this->metadata.size());
+        item.DataPtr = reinterpret_cast<ULONGLONG>(this->metadata.data());
+
+        record.EventHeader.ProviderId = ProviderId;
+        record.ExtendedDataCount = 1;
+        record.ExtendedData = &item;
+    }
+
+    TestEvent(TestEvent const&) = delete;
+    TestEvent& operator=(TestEvent const&) = delete;
+
+    EVENT_RECORD const& Record() const { return record; }
+
+private:
+    std::vector<std::byte> metadata;
+    EVENT_HEADER_EXTENDED_DATA_ITEM item = {};
+    EVENT_RECORD record = {};
+};
+
+class ResolvedIndices
+{
+public:
+    static void Callback(size_t const* indices, size_t count, void* state)
+    {
+        auto& self = *static_cast<ResolvedIndices*>(state);
+        std::lock_guard<std::mutex> lock(self.mutex);
+        self.indices.insert(self.indices.end(), indices, indices + count);
+    }
+
+    std::vector<size_t> Get()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return indices;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<size_t> indices;
+};
+
+void NoopCallback(size_t, void*)
+{}
+
+bool WaitForResolved(ITraceLog const& log, size_t count)
+{
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (log.GetResolvedEventCount() < count) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+std::wstring GetEventName(EventInfo const& info)
+{
+    wchar_t const* name = info.GetStringAt(info->TaskNameOffset);
+    return name ? name : L"<invalid>";
+}
+
+bool IsClosedEvent(void* /*record*/, void* info, size_t infoSize)
+{
+    EventInfo const event(nullptr, static_cast<TRACE_EVENT_INFO*>(info), infoSize);
+    return event && GetEventName(event) == L"Closed";
+}
+
+} // namespace
+
+TEST(EtwTraceLogTest, ResolvesSchemasInBackground)
+{
+    auto const log = CreateEtwTraceLog(&NoopCallback);
+    ResolvedIndices resolved;
+    log->SetSchemasResolvedCallback(&ResolvedIndices::Callback, &resolved);
+
+    TestEvent const opened(MakeMetadata("Opened"));
+    TestEvent const closed(MakeMetadata("Closed"));
+
+    log->ProcessEvent(opened.Record());
+    log->ProcessEvent(closed.Record());
+    log->ProcessEvent(opened.Record());
+    EXPECT_EQ(3u, log->GetEventCount());
+
+    ASSERT_TRUE(WaitForResolved(*log, 3));
+    for (size_t i = 0; i < 3; ++i)
+        ASSERT_NE(nullptr, log->GetEvent(i).Info()) << i;
+
+    EXPECT_EQ(L"Opened", GetEventName(log->GetEvent(0)));
+    EXPECT_EQ(L"Closed", GetEventName(log->GetEvent(1)));
+    EXPECT_EQ(L"Opened", GetEventName(log->GetEvent(2)));
+    EXPECT_EQ(log->GetEvent(0).Info(), log->GetEvent(2).Info());
+
+    // Events carry the compiled schema, so formatters do not parse the
+    // message again.
+    ASSERT_NE(nullptr, log->GetEvent(0).Compiled());
+    EXPECT_EQ(log->GetEvent(0).Compiled(), log->GetEvent(2).Compiled());
+
+    // The third event is only reported if its schema was still pending when
+    // it arrived.
+    auto indices = resolved.Get();
+    std::sort(indices.begin(), indices.end());
+    ASSERT_GE(indices.size(), 2u);
+    EXPECT_EQ(0u, indices[0]);
+    EXPECT_EQ(1u, indices[1]);
+    size_t const reportedCount = indices.size();
+
+    // Known schemas are attached immediately.
+    log->ProcessEvent(closed.Record());
+    EXPECT_EQ(4u, log->GetResolvedEventCount());
+    EXPECT_EQ(log->GetEvent(1).Info(), log->GetEvent(3).Info());
+    EXPECT_EQ(reportedCount, resolved.Get().size());
+}
+
+TEST(EtwTraceLogTest, ClearDiscardsPendingSchemas)
+{
+    auto const log = CreateEtwTraceLog(&NoopCallback);
+
+    std::deque<TestEvent> events;
+    for (int i = 0; i < 50; ++i)
+        events.emplace_back(MakeMetadata(("Event" + std::to_string(i)).c_str()));
+
+    EXPECT_EQ(0u, log->GetClearCount());
+    for (auto const& event : events)
+        log->ProcessEvent(event.Record());
+    log->Clear();
+    EXPECT_EQ(1u, log->GetClearCount());
+    EXPECT_EQ(0u, log->GetEventCount());
+    EXPECT_EQ(0u, log->GetResolvedEventCount());
+
+    log->ProcessEvent(events[0].Record());
+    ASSERT_TRUE(WaitForResolved(*log, 1));
+    EXPECT_EQ(L"Event0", GetEventName(log->GetEvent(0)));
+}
+
+TEST(EtwTraceLogTest, FilteredEventsReportSourceIndices)
+{
+    auto const [log, filteredLog] =
+        CreateFilteredTraceLog(&NoopCallback, new TraceLogFilter(&IsClosedEvent));
+
+    TestEvent const opened(MakeMetadata("Opened"));
+    TestEvent const closed(MakeMetadata("Closed"));
+    for (auto const* event : {&opened, &closed, &opened, &opened, &closed})
+        log->ProcessEvent(event->Record());
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (filteredLog->GetEventCount() < 2) {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    size_t sourceIndex = 0;
+    EventInfo const first = filteredLog->GetEvent(0, sourceIndex);
+    EXPECT_EQ(1u, sourceIndex);
+    EXPECT_EQ(log->GetEvent(1).Record(), first.Record());
+
+    EventInfo const second = filteredLog->GetEvent(1, sourceIndex);
+    EXPECT_EQ(4u, sourceIndex);
+    EXPECT_EQ(log->GetEvent(4).Record(), second.Record());
+}
+
+TEST(EtwTraceLogTest, CachesFailedSchemaLookups)
+{
+    auto const log = CreateEtwTraceLog(&NoopCallback);
+
+    // Metadata that is too short to describe an event.
+    TestEvent const invalid(std::vector<std::byte>{std::byte(2), std::byte(0)});
+
+    log->ProcessEvent(invalid.Record());
+    ASSERT_TRUE(WaitForResolved(*log, 1));
+    EXPECT_EQ(nullptr, log->GetEvent(0).Info());
+
+    log->ProcessEvent(invalid.Record());
+    log->ProcessEvent(invalid.Record());
+    EXPECT_EQ(3u, log->GetResolvedEventCount());
+
+    auto statistics = log->GetSchemaStatistics();
+    EXPECT_EQ(0u, statistics.ResolvedSchemas);
+    EXPECT_EQ(1u, statistics.UnresolvedSchemas);
+    EXPECT_EQ(1u, statistics.FailedLookups);
+    EXPECT_EQ(2u, statistics.UnresolvedEvents);
+
+    TraceLogSchemaRetryPolicy policy;
+    policy.RetryInterval = std::chrono::milliseconds(1);
+    log->SetSchemaRetryPolicy(policy);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    log->ProcessEvent(invalid.Record());
+    ASSERT_TRUE(WaitForResolved(*log, 4));
+    statistics = log->GetSchemaStatistics();
+    EXPECT_EQ(1u, statistics.UnresolvedSchemas);
+    EXPECT_EQ(2u, statistics.FailedLookups);
+
+    log->Clear();
+    EXPECT_EQ(0u, log->GetSchemaStatistics().UnresolvedSchemas);
+    EXPECT_EQ(2u, log->GetSchemaStatistics().FailedLookups);
+}
+
+TEST(EtwTraceLogTest, EvictsOnlyUnreferencedSchemas)
+{
+    auto const log = CreateEtwTraceLog(&NoopCallback);
+    log->SetSchemaCacheCapacity(0);
+
+    TestEvent const opened(MakeMetadata("Opened"));
+    TestEvent const invalid(std::vector<std::byte>{std::byte(2), std::byte(0)});
+
+    log->ProcessEvent(opened.Record());
+    ASSERT_TRUE(WaitForResolved(*log, 1));
+    log->ProcessEvent(invalid.Record());
+    ASSERT_TRUE(WaitForResolved(*log, 2));
+
+    // The failed lookup is evicted, the schema of the stored event is kept.
+    auto statistics = log->GetSchemaStatistics();
+    EXPECT_EQ(1u, statistics.EvictedSchemas);
+    EXPECT_EQ(1u, statistics.ResolvedSchemas);
+    EXPECT_EQ(0u, statistics.UnresolvedSchemas);
+    EXPECT_LT(0u, statistics.CachedSize);
+
+    log->ProcessEvent(opened.Record());
+    EXPECT_EQ(3u, log->GetResolvedEventCount());
+    EXPECT_EQ(L"Opened", GetEventName(log->GetEvent(0)));
+    EXPECT_EQ(log->GetEvent(0).Info(), log->GetEvent(2).Info());
+}
+
+TEST(EtwTraceLogTest, PinnedSchemasDoNotCountAgainstCapacity)
+{
+    auto const log = CreateEtwTraceLog(&NoopCallback);
+
+    TestEvent const opened(MakeMetadata("Opened"));
+    TestEvent const invalid(std::vector<std::byte>{std::byte(2), std::byte(0)});
+
+    log->ProcessEvent(opened.Record());
+    ASSERT_TRUE(WaitForResolved(*log, 1));
+
+    // The schema of the stored event alone exceeds the capacity.
+    log->SetSchemaCacheCapacity(log->GetSchemaStatistics().CachedSize - 1);
+
+    // The failed lookup is kept, so further events of it are not looked up
+    // again.
+    log->ProcessEvent(invalid.Record());
+    ASSERT_TRUE(WaitForResolved(*log, 2));
+    log->ProcessEvent(invalid.Record());
+    EXPECT_EQ(3u, log->GetResolvedEventCount());
+
+    auto const statistics = log->GetSchemaStatistics();
+    EXPECT_EQ(0u, statistics.EvictedSchemas);
+    EXPECT_EQ(1u, statistics.UnresolvedSchemas);
+    EXPECT_EQ(1u, statistics.FailedLookups);
+    EXPECT_EQ(1u, statistics.UnresolvedEvents);
+}
+
+} // namespace etk::tests
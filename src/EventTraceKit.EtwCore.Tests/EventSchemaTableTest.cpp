@@ -0,0 +1,349 @@
+#include "etk/EventSchemaTable.h"
+
+#include "etk/EventInfo.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+GUID const ProviderId = {
+    0x2A3B4C5D, 0x1111, 0x2222, {0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA}};
+GUID const TaskId = {
+    0x7E6F5A4B, 0x3333, 0x4444, {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08}};
+
+uint32_t const NoMessage = 0xFFFFFFFF;
+
+class Blob
+{
+public:
+    size_t Size() const { return data.size(); }
+
+    template<typename T>
+    size_t Put(T const& value)
+    {
+        size_t const offset = data.size();
+        data.resize(offset + sizeof(T));
+        std::memcpy(data.data() + offset, &value, sizeof(T));
+        return offset;
+    }
+
+    template<typename T>
+    void Patch(size_t offset, T const& value)
+    {
+        std::memcpy(data.data() + offset, &value, sizeof(T));
+    }
+
+    size_t PutCountedString(std::wstring const& str)
+    {
+        size_t const offset =
+            Put<uint32_t>(static_cast<uint32_t>(4 + (str.size() + 1) * 2));
+        PutUtf16(str);
+        return offset;
+    }
+
+    void PutUtf16(std::wstring const& str)
+    {
+        for (wchar_t c : str)
+            Put<uint16_t>(static_cast<uint16_t>(c));
+        Put<uint16_t>(0);
+    }
+
+    std::vector<std::byte> data;
+};
+
+// Builds a 'CRIM' blob for a provider with two events, laid out like the
+// output of the message compiler:
+//   Event 1 (v0): level "win:Informational" (message 101), task "Open",
+//                 keyword "Disk", template
+//                 { UInt32 Count; UInt16 Values[Count] (map "ValueMap");
+//                   struct Point { Int32 X; Int32 Y; } }
+//   Event 2 (v1): no template, message 100.
+std::vector<std::byte> BuildTemplate()
+{
+    Blob b;
+    b.Put<uint32_t>(0x4D495243); // CRIM
+    size_t const crimLength = b.Put<uint32_t>(0);
+    b.Put<uint16_t>(3);
+    b.Put<uint16_t>(1);
+    b.Put<uint32_t>(1);
+    b.Put(ProviderId);
+    size_t const providerOffset = b.Put<uint32_t>(0);
+
+    b.Patch<uint32_t>(providerOffset, static_cast<uint32_t>(b.Size()));
+    b.Put<uint32_t>(0x54564557); // WEVT
+    b.Put<uint32_t>(0);
+    b.Put<uint32_t>(NoMessage);
+    b.Put<uint32_t>(2);
+    b.Put<uint32_t>(4);
+    size_t const eventsOffset = b.Put<uint32_t>(0);
+    b.Put<uint32_t>(13);
+    size_t const attribsOffset = b.Put<uint32_t>(0);
+
+    b.Patch<uint32_t>(attribsOffset, static_cast<uint32_t>(b.Size()));
+    b.Put<uint32_t>(0x41565250); // PRVA
+    b.Put<uint32_t>(0);
+    b.Put<uint32_t>(1);
+    b.Put<uint32_t>(0x10000001);
+    b.Put<uint32_t>(static_cast<uint32_t>(b.Size() + 4));
+    b.PutUtf16(L"My-Provider");
+
+    uint32_t const levelOffset = static_cast<uint32_t>(b.Size());
+    b.Put<uint32_t>(4);
+    b.Put<uint32_t>(101);
+    b.Put<uint32_t>(static_cast<uint32_t>(b.Size() + 4));
+    b.PutCountedString(L"win:Informational");
+
+    uint32_t const taskOffset = static_cast<uint32_t>(b.Size());
+    b.Put<uint32_t>(7);
+    b.Put<uint32_t>(NoMessage);
+    b.Put(TaskId);
+    b.Put<uint32_t>(static_cast<uint32_t>(b.Size() + 4));
+    b.PutCountedString(L"Open");
+
+    uint32_t const keywordOffset = static_cast<uint32_t>(b.Size());
+    b.Put<uint64_t>(0x10);
+    b.Put<uint32_t>(NoMessage);
+    b.Put<uint32_t>(static_cast<uint32_t>(b.Size() + 4));
+    b.PutCountedString(L"Disk");
+    uint32_t const keywordsOffset = static_cast<uint32_t>(b.Put(keywordOffset));
+
+    uint32_t const mapOffset = static_cast<uint32_t>(b.Size());
+    b.Put<uint32_t>(0x50414D56); // VMAP
+    b.Put<uint32_t>(0);
+    b.Put<uint32_t>(static_cast<uint32_t>(b.Size() + 4));
+    b.PutCountedString(L"ValueMap");
+
+    uint32_t const templateOffset = static_cast<uint32_t>(b.Size());
+    b.Put<uint32_t>(0x504D4554); // TEMP
+    b.Put<uint32_t>(0);
+    b.Put<uint32_t>(3);
+    b.Put<uint32_t>(5);
+    size_t const propertiesOffset = b.Put<uint32_t>(0);
+    b.Put<uint32_t>(1);
+    b.Put(GUID());
+
+    b.Patch<uint32_t>(propertiesOffset, static_cast<uint32_t>(b.Size()));
+    struct Property
+    {
+        uint32_t Flags;
+        uint8_t InType;
+        uint8_t OutType;
+        uint16_t StructStart;
+        uint16_t MemberCount;
+        uint32_t MapOffset;
+        uint16_t Count;
+        uint16_t Length;
+        wchar_t const* Name;
+    };
+    Property const properties[] = {
+        {0, TDH_INTYPE_UINT32, 0, 0, 0, 0, 1, 4, L"Count"},
+        {0x10, TDH_INTYPE_UINT16, 0, 0, 0, mapOffset, 0, 2, L"Values"},
+        {0x1, 0, 0, 3, 2, 0, 1, 0, L"Point"},
+        {0, TDH_INTYPE_INT32, 0, 0, 0, 0, 1, 4, L"X"},
+        {0, TDH_INTYPE_INT32, 0, 0, 0, 0, 1, 4, L"Y"},
+    };
+    std::vector<size_t> nameOffsets;
+    for (auto const& p : properties) {
+        b.Put(p.Flags);
+        if ((p.Flags & 0x1) != 0) {
+            b.Put(p.StructStart);
+            b.Put(p.MemberCount);
+            b.Put<uint32_t>(0);
+        } else {
+            b.Put(p.InType);
+            b.Put(p.OutType);
+            b.Put<uint16_t>(0);
+            b.Put(p.MapOffset);
+        }
+        b.Put(p.Count);
+        b.Put(p.Length);
+        nameOffsets.push_back(b.Put<uint32_t>(0));
+    }
+    for (size_t i = 0; i < nameOffsets.size(); ++i)
+        b.Patch<uint32_t>(nameOffsets[i],
+                          static_cast<uint32_t>(b.PutCountedString(properties[i].Name)));
+
+    b.Patch<uint32_t>(eventsOffset, static_cast<uint32_t>(b.Size()));
+    b.Put<uint32_t>(0x544E5645); // EVNT
+    b.Put<uint32_t>(0);
+    b.Put<uint32_t>(2);
+    b.Put<uint32_t>(0);
+
+    EVENT_DESCRIPTOR descriptor = {};
+    descriptor.Id = 1;
+    descriptor.Level = 4;
+    descriptor.Task = 7;
+    descriptor.Keyword = 0x10;
+    b.Put(descriptor);
+    b.Put<uint32_t>(NoMessage);
+    b.Put(templateOffset);
+    b.Put<uint32_t>(0);
+    b.Put(levelOffset);
+    b.Put(taskOffset);
+    b.Put<uint32_t>(1);
+    b.Put(keywordsOffset);
+    b.Put<uint32_t>(0);
+
+    descriptor = {};
+    descriptor.Id = 2;
+    descriptor.Version = 1;
+    b.Put(descriptor);
+    b.Put<uint32_t>(100);
+    for (int i = 0; i < 7; ++i)
+        b.Put<uint32_t>(0);
+
+    b.Patch<uint32_t>(crimLength, static_cast<uint32_t>(b.Size()));
+    return b.data;
+}
+
+// Builds an RT_MESSAGETABLE resource with a single block of Unicode entries.
+std::vector<std::byte> BuildMessageTable(uint32_t firstId,
+                                         std::vector<std::wstring> const& messages)
+{
+    Blob b;
+    b.Put<uint32_t>(1);
+    b.Put(firstId);
+    b.Put<uint32_t>(firstId + static_cast<uint32_t>(messages.size()) - 1);
+    b.Put<uint32_t>(16);
+    for (auto const& message : messages) {
+        b.Put<uint16_t>(static_cast<uint16_t>(4 + (message.size() + 1) * 2));
+        b.Put<uint16_t>(1);
+        b.PutUtf16(message);
+    }
+    return b.data;
+}
+
+std::wstring GetName(EventInfo const& info, ULONG offset)
+{
+    wchar_t const* name = info.GetStringAt(offset);
+    return name ? name : L"<invalid>";
+}
+
+} // namespace
+
+TEST(EventSchemaTableTest, EventWithTemplate)
+{
+    EventSchemaTable table;
+    ASSERT_TRUE(table.AddTemplates(BuildTemplate()));
+    EXPECT_EQ(2u, table.GetEventCount());
+
+    auto const [infoPtr, infoSize] = table.Find(EventKey(ProviderId, 1, 0));
+    ASSERT_NE(nullptr, infoPtr);
+    EventInfo const info(nullptr, const_cast<TRACE_EVENT_INFO*>(infoPtr), infoSize);
+
+    EXPECT_EQ(DecodingSourceXMLFile, info->DecodingSource);
+    EXPECT_EQ(ProviderId, info->ProviderGuid);
+    EXPECT_EQ(TaskId, info->EventGuid);
+    EXPECT_EQ(1, info->EventDescriptor.Id);
+    EXPECT_EQ(0x10u, info->EventDescriptor.Keyword);
+    EXPECT_EQ(TEMPLATE_EVENT_DATA, info->Flags);
+    EXPECT_EQ(L"My-Provider", GetName(info, info->ProviderNameOffset));
+    EXPECT_EQ(L"win:Informational", GetName(info, info->LevelNameOffset));
+    EXPECT_EQ(L"Open", GetName(info, info->TaskNameOffset));
+    EXPECT_EQ(L"Disk", GetName(info, info->KeywordsNameOffset));
+    EXPECT_EQ(0u, info->OpcodeNameOffset);
+    EXPECT_EQ(0u, info->EventMessageOffset);
+
+    ASSERT_EQ(5u, info->PropertyCount);
+    ASSERT_EQ(3u, info->TopLevelPropertyCount);
+
+    auto const& count = info->EventPropertyInfoArray[0];
+    EXPECT_EQ(L"Count", GetName(info, count.NameOffset));
+    EXPECT_EQ(0, count.Flags);
+    EXPECT_EQ(TDH_INTYPE_UINT32, count.nonStructType.InType);
+    EXPECT_EQ(1, count.count);
+    EXPECT_EQ(4, count.length);
+
+    auto const& values = info->EventPropertyInfoArray[1];
+    EXPECT_EQ(L"Values", GetName(info, values.NameOffset));
+    EXPECT_EQ(PropertyParamCount, values.Flags);
+    EXPECT_EQ(0, values.countPropertyIndex);
+    EXPECT_EQ(L"ValueMap", GetName(info, values.nonStructType.MapNameOffset));
+
+    auto const& point = info->EventPropertyInfoArray[2];
+    EXPECT_EQ(L"Point", GetName(info, point.NameOffset));
+    EXPECT_EQ(PropertyStruct, point.Flags);
+    EXPECT_EQ(3, point.structType.StructStartIndex);
+    EXPECT_EQ(2, point.structType.NumOfStructMembers);
+
+    EXPECT_EQ(L"X", GetName(info, info->EventPropertyInfoArray[3].NameOffset));
+    EXPECT_EQ(L"Y", GetName(info, info->EventPropertyInfoArray[4].NameOffset));
+}
+
+TEST(EventSchemaTableTest, ResolvesMessages)
+{
+    auto const messages = BuildMessageTable(100, {L"Closed.\r\n", L"Information\r\n"});
+
+    EventSchemaTable table;
+    ASSERT_TRUE(table.AddTemplates(BuildTemplate(), messages));
+
+    auto const [firstPtr, firstSize] = table.Find(EventKey(ProviderId, 1, 0));
+    ASSERT_NE(nullptr, firstPtr);
+    EventInfo const first(nullptr, const_cast<TRACE_EVENT_INFO*>(firstPtr), firstSize);
+    EXPECT_EQ(L"Information", GetName(first, first->LevelNameOffset));
+
+    auto const [secondPtr, secondSize] = table.Find(EventKey(ProviderId, 2, 1));
+    ASSERT_NE(nullptr, secondPtr);
+    EventInfo const second(nullptr, const_cast<TRACE_EVENT_INFO*>(secondPtr), secondSize);
+    EXPECT_EQ(L"Closed.", GetName(second, second->EventMessageOffset));
+    EXPECT_EQ(0u, second->PropertyCount);
+}
+
+TEST(EventSchemaTableTest, UnknownEvent)
+{
+    EventSchemaTable table;
+    ASSERT_TRUE(table.AddTemplates(BuildTemplate()));
+
+    EXPECT_EQ(nullptr, std::get<0>(table.Find(EventKey(ProviderId, 1, 1))));
+    EXPECT_EQ(nullptr, std::get<0>(table.Find(EventKey(TaskId, 1, 0))));
+
+    table.Clear();
+    EXPECT_EQ(0u, table.GetEventCount());
+    EXPECT_EQ(nullptr, std::get<0>(table.Find(EventKey(ProviderId, 1, 0))));
+}
+
+TEST(EventSchemaTableTest, ProviderIds)
+{
+    EventSchemaTable table;
+    EXPECT_TRUE(table.GetProviderIds().empty());
+
+    ASSERT_TRUE(table.AddTemplates(BuildTemplate()));
+    auto const providerIds = table.GetProviderIds();
+    ASSERT_EQ(1u, providerIds.size());
+    EXPECT_EQ(ProviderId, providerIds[0]);
+    EXPECT_EQ(ProviderId, EventKey(ProviderId, 2, 1).GetProviderId());
+}
+
+TEST(EventSchemaTableTest, RejectsMalformedTemplates)
+{
+    EventSchemaTable table;
+    auto blob = BuildTemplate();
+
+    // Truncated blob.
+    EXPECT_FALSE(table.AddTemplates(cspan<std::byte>(blob.data(), blob.size() - 8)));
+
+    // Bad magic.
+    auto badMagic = blob;
+    badMagic[0] = std::byte('X');
+    EXPECT_FALSE(table.AddTemplates(badMagic));
+
+    // Provider offset outside of the blob.
+    auto badOffset = blob;
+    uint32_t const outside = static_cast<uint32_t>(blob.size());
+    std::memcpy(badOffset.data() + 32, &outside, sizeof(outside));
+    EXPECT_FALSE(table.AddTemplates(badOffset));
+
+    EXPECT_EQ(0u, table.GetEventCount());
+    EXPECT_TRUE(table.AddTemplates(blob));
+    EXPECT_EQ(2u, table.GetEventCount());
+}
+
+} // namespace etk::tests
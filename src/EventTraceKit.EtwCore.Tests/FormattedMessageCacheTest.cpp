@@ -0,0 +1,110 @@
+#include "etk/FormattedMessageCache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+TEST(FormattedMessageCacheTest, HitsAndMisses)
+{
+    FormattedMessageCache cache;
+
+    std::wstring message;
+    EXPECT_FALSE(cache.TryGet(1, message));
+
+    cache.Add(1, L"First", cache.GetGeneration());
+    cache.Add(2, L"Second", cache.GetGeneration());
+    ASSERT_TRUE(cache.TryGet(1, message));
+    EXPECT_EQ(L"First", message);
+
+    // Messages are replaced, e.g. after the schema of the event was resolved.
+    cache.Add(1, L"Replaced", cache.GetGeneration());
+    ASSERT_TRUE(cache.TryGet(1, message));
+    EXPECT_EQ(L"Replaced", message);
+
+    cache.Remove(2);
+    EXPECT_FALSE(cache.TryGet(2, message));
+
+    auto const statistics = cache.GetStatistics();
+    EXPECT_EQ(2u, statistics.Hits);
+    EXPECT_EQ(2u, statistics.Misses);
+    EXPECT_EQ(0u, statistics.Evictions);
+    EXPECT_EQ(1u, statistics.CachedMessages);
+    EXPECT_LT(0u, statistics.CachedSize);
+
+    cache.Clear();
+    EXPECT_FALSE(cache.TryGet(1, message));
+    EXPECT_EQ(0u, cache.GetStatistics().CachedMessages);
+    EXPECT_EQ(0u, cache.GetStatistics().CachedSize);
+}
+
+TEST(FormattedMessageCacheTest, BoundedByMemory)
+{
+    std::wstring const text(100, L'x');
+
+    FormattedMessageCache cache(SIZE_MAX);
+    cache.Add(0, text, cache.GetGeneration());
+    size_t const entrySize = cache.GetStatistics().CachedSize;
+
+    cache.SetCapacity(3 * entrySize);
+    for (uint64_t i = 1; i < 10; ++i) {
+        cache.Add(i, text, cache.GetGeneration());
+
+        // Keep the first message recently used.
+        std::wstring message;
+        EXPECT_TRUE(cache.TryGet(0, message));
+    }
+
+    auto const statistics = cache.GetStatistics();
+    EXPECT_EQ(3u, statistics.CachedMessages);
+    EXPECT_EQ(7u, statistics.Evictions);
+    EXPECT_LE(statistics.CachedSize, 3 * entrySize);
+
+    std::wstring message;
+    EXPECT_TRUE(cache.TryGet(0, message));
+    EXPECT_TRUE(cache.TryGet(8, message));
+    EXPECT_TRUE(cache.TryGet(9, message));
+    EXPECT_FALSE(cache.TryGet(7, message));
+
+    cache.SetCapacity(entrySize);
+    EXPECT_EQ(1u, cache.GetStatistics().CachedMessages);
+    EXPECT_EQ(9u, cache.GetStatistics().Evictions);
+
+    // Messages heavier than the capacity do not evict the others.
+    cache.Add(10, std::wstring(1000, L'y'), cache.GetGeneration());
+    EXPECT_FALSE(cache.TryGet(10, message));
+    EXPECT_EQ(1u, cache.GetStatistics().CachedMessages);
+    EXPECT_EQ(9u, cache.GetStatistics().Evictions);
+}
+
+TEST(FormattedMessageCacheTest, StaleGenerationsAreNotAdded)
+{
+    FormattedMessageCache cache;
+    uint64_t const first = FormattedMessageCache::MakeSequence(0, 5);
+    uint64_t const second = FormattedMessageCache::MakeSequence(1, 5);
+    EXPECT_NE(first, second);
+
+    // A message formatted while the log is cleared belongs to a removed event.
+    uint64_t generation = cache.GetGeneration();
+    cache.Clear();
+    cache.Add(first, L"Cleared", generation);
+
+    std::wstring message;
+    EXPECT_FALSE(cache.TryGet(first, message));
+    EXPECT_FALSE(cache.TryGet(second, message));
+
+    // Likewise for messages formatted while the schema of the event is resolved.
+    generation = cache.GetGeneration();
+    cache.Add(second, L"Unresolved", generation);
+    cache.Remove(second);
+    cache.Add(second, L"Unresolved", generation);
+    EXPECT_FALSE(cache.TryGet(second, message));
+
+    cache.Add(second, L"Resolved", cache.GetGeneration());
+    ASSERT_TRUE(cache.TryGet(second, message));
+    EXPECT_EQ(L"Resolved", message);
+}
+
+} // namespace etk::tests
@@ -0,0 +1,266 @@
+#include "etk/HeaderFilter.h"
+
+#include "etk/ITraceLog.h"
+#include "etk/Support/CpuInfo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+GUID const ProviderA = {
+    0x6D35524C, 0xC587, 0x476A, {0x92, 0xD3, 0xF3, 0x33, 0xD2, 0x23, 0xBD, 0xCF}};
+GUID const ProviderB = {
+    0x1A2B3C4D, 0x0001, 0x0002, {0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A}};
+
+CompareOp const AllOps[] = {
+    CompareOp::Equal,        CompareOp::NotEqual,   CompareOp::Less,
+    CompareOp::LessEqual,    CompareOp::Greater,    CompareOp::GreaterEqual,
+    CompareOp::AnyBitsSet,   CompareOp::AllBitsSet,
+};
+
+struct KernelSet
+{
+    char const* Name;
+    bool Supported;
+    HeaderFilterKernels Kernels;
+};
+
+std::vector<KernelSet> GetKernelSets()
+{
+    CpuFeatures const& features = GetCpuFeatures();
+    return {
+        {"SSE41", features.SSE41, {&kernels::Compare32SSE41, &kernels::Compare64SSE41}},
+        {"AVX2", features.AVX2, {&kernels::Compare32AVX2, &kernels::Compare64AVX2}},
+    };
+}
+
+class TestEvents
+{
+public:
+    explicit TestEvents(size_t count, unsigned seed = 42)
+        : records(count)
+    {
+        std::mt19937 rng(seed);
+        for (EVENT_RECORD& record : records) {
+            auto& header = record.EventHeader;
+            header.ProviderId = (rng() % 3 == 0) ? ProviderB : ProviderA;
+            header.EventDescriptor.Id = static_cast<USHORT>(rng() % 64);
+            header.EventDescriptor.Level = static_cast<UCHAR>(rng() % 6);
+            header.EventDescriptor.Keyword = uint64_t(1) << (rng() % 64);
+            header.ProcessId = 1000 + rng() % 4;
+            events.emplace_back(&record, nullptr, 0);
+        }
+    }
+
+    cspan<EventInfo> Events() const { return events; }
+
+private:
+    std::vector<EVENT_RECORD> records;
+    std::vector<EventInfo> events;
+};
+
+void ExpectSameSelection(SelectionBitmap const& expected, SelectionBitmap const& actual,
+                         size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        EXPECT_EQ(expected.IsSet(i), actual.IsSet(i)) << "at index " << i;
+}
+
+} // namespace
+
+TEST(HeaderFilterTest, SelectionBitmap_SelectFirst)
+{
+    SelectionBitmap selection;
+    selection.SelectFirst(70);
+
+    std::vector<size_t> selected;
+    selection.ForEachSet([&](size_t index) { selected.push_back(index); });
+
+    ASSERT_EQ(70u, selected.size());
+    EXPECT_EQ(0u, selected.front());
+    EXPECT_EQ(69u, selected.back());
+}
+
+TEST(HeaderFilterTest, Kernels_MatchScalar)
+{
+    std::mt19937 rng(1);
+    alignas(32) uint32_t column32[HeaderColumnBlock::Capacity];
+    alignas(32) uint64_t column64[HeaderColumnBlock::Capacity];
+    for (size_t i = 0; i < HeaderColumnBlock::Capacity; ++i) {
+        column32[i] = (i % 5 == 0) ? 0x80000001u : rng() % 16;
+        column64[i] = (i % 7 == 0) ? 0x8000000000000001ull : uint64_t(1) << (rng() % 64);
+    }
+
+    for (KernelSet const& set : GetKernelSets()) {
+        if (!set.Supported)
+            continue;
+
+        size_t const counts[] = {1, 13, 64, 255, 256};
+        uint32_t const values[] = {0, 7, 0x80000001u};
+
+        for (size_t count : counts) {
+            for (CompareOp op : AllOps) {
+                for (uint32_t value : values) {
+                    SelectionBitmap expected;
+                    SelectionBitmap actual;
+
+                    expected.SelectFirst(count);
+                    actual.SelectFirst(count);
+                    kernels::Compare32Scalar(column32, count, op, value, expected.data());
+                    set.Kernels.Compare32(column32, count, op, value, actual.data());
+                    ExpectSameSelection(expected, actual, HeaderColumnBlock::Capacity);
+
+                    uint64_t const value64 = uint64_t(value) << 31;
+                    expected.SelectFirst(count);
+                    actual.SelectFirst(count);
+                    kernels::Compare64Scalar(column64, count, op, value64,
+                                             expected.data());
+                    set.Kernels.Compare64(column64, count, op, value64, actual.data());
+                    ExpectSameSelection(expected, actual, HeaderColumnBlock::Capacity);
+                }
+            }
+        }
+    }
+}
+
+TEST(HeaderFilterTest, Evaluate_MatchesPerEventEvaluation)
+{
+    TestEvents const testEvents(HeaderColumnBlock::Capacity);
+    ProviderIndexMap providers;
+
+    HeaderPredicate const predicates[] = {
+        HeaderPredicate::Provider(ProviderA),
+        HeaderPredicate(HeaderField::Level, CompareOp::LessEqual, 3),
+        HeaderPredicate(HeaderField::Keyword, CompareOp::AnyBitsSet, 0xFFFF),
+    };
+    HeaderFilter const filter(predicates, providers);
+
+    HeaderColumnBlock block;
+    SelectionBitmap selection;
+    filter.Evaluate(testEvents.Events(), providers, block, selection);
+
+    size_t matches = 0;
+    for (size_t i = 0; i < testEvents.Events().size(); ++i) {
+        bool const expected =
+            filter.Matches(testEvents.Events()[i].Record()->EventHeader, providers);
+        EXPECT_EQ(expected, selection.IsSet(i));
+        matches += expected ? 1 : 0;
+    }
+
+    EXPECT_GT(matches, 0u);
+}
+
+TEST(HeaderFilterTest, Evaluate_ValueOutOfColumnRange)
+{
+    TestEvents const testEvents(10);
+    ProviderIndexMap providers;
+    HeaderColumnBlock block;
+    SelectionBitmap selection;
+
+    HeaderPredicate const never[] = {
+        HeaderPredicate(HeaderField::Id, CompareOp::Equal, uint64_t(1) << 40)};
+    HeaderFilter(never, providers)
+        .Evaluate(testEvents.Events(), providers, block, selection);
+    selection.ForEachSet([](size_t) { FAIL(); });
+
+    HeaderPredicate const always[] = {
+        HeaderPredicate(HeaderField::Id, CompareOp::Less, uint64_t(1) << 40)};
+    HeaderFilter(always, providers)
+        .Evaluate(testEvents.Events(), providers, block, selection);
+    size_t count = 0;
+    selection.ForEachSet([&](size_t) { ++count; });
+    EXPECT_EQ(10u, count);
+}
+
+TEST(HeaderFilterTest, RejectsOrderedProviderPredicates)
+{
+    TestEvents const testEvents(10);
+    ProviderIndexMap providers;
+    HeaderColumnBlock block;
+    SelectionBitmap selection;
+
+    HeaderPredicate const predicates[] = {
+        HeaderPredicate::Provider(ProviderA, CompareOp::Less),
+        HeaderPredicate(HeaderField::Level, CompareOp::LessEqual, 5),
+    };
+    EXPECT_FALSE(HeaderFilter::IsSupported(predicates[0]));
+    EXPECT_TRUE(HeaderFilter::IsSupported(predicates[1]));
+
+    HeaderFilter const filter(predicates, providers);
+    EXPECT_FALSE(filter.IsValid());
+    EXPECT_FALSE(filter.IsEmpty());
+
+    filter.Evaluate(testEvents.Events(), providers, block, selection);
+    selection.ForEachSet([](size_t) { FAIL(); });
+    for (EventInfo const& evt : testEvents.Events())
+        EXPECT_FALSE(filter.Matches(evt.Record()->EventHeader, providers));
+}
+
+// Compares rebuilding a filtered trace log with a filter callback that checks the
+// header fields itself, which is how filters were evaluated before, against the
+// same filter expressed as header predicates. Run explicitly with
+// --gtest_also_run_disabled_tests.
+TEST(HeaderFilterTest, DISABLED_Benchmark)
+{
+    size_t const eventCount = 1 << 20;
+    TestEvents const testEvents(eventCount);
+
+    auto [traceLog, filteredLog] = CreateFilteredTraceLog(nullptr, nullptr);
+    for (EventInfo const& evt : testEvents.Events())
+        traceLog->ProcessEvent(*evt.Record());
+
+    auto const waitFor = [](auto&& condition) {
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    };
+
+    ASSERT_TRUE(waitFor([&] { return traceLog->GetResolvedEventCount() == eventCount; }));
+
+    auto const measure = [&](char const* name, TraceLogFilter* filter) {
+        size_t const rebuilds = filteredLog->GetRebuildStatistics().CompletedRebuilds;
+        filteredLog->SetFilter(filter);
+        ASSERT_TRUE(waitFor([&] {
+            return filteredLog->GetRebuildStatistics().CompletedRebuilds > rebuilds;
+        }));
+
+        auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            filteredLog->GetRebuildStatistics().LastDuration);
+        std::printf("%-10s %8lld us  (%zu matches)\n", name,
+                    static_cast<long long>(elapsed.count()),
+                    filteredLog->GetEventCount());
+    };
+
+    TraceLogFilterEvent* perEvent = [](void* record, void*, size_t) {
+        auto const& header = static_cast<EVENT_RECORD*>(record)->EventHeader;
+        return header.ProviderId == ProviderA && header.EventDescriptor.Id != 5 &&
+               header.EventDescriptor.Level <= 4;
+    };
+    TraceLogFilterEvent* acceptAll = [](void*, void*, size_t) { return true; };
+
+    measure("PerEvent", new TraceLogFilter(perEvent));
+    std::vector<HeaderPredicate> predicates = {
+        HeaderPredicate::Provider(ProviderA),
+        HeaderPredicate(HeaderField::Id, CompareOp::NotEqual, 5),
+        HeaderPredicate(HeaderField::Level, CompareOp::LessEqual, 4),
+    };
+    measure("Header", new TraceLogFilter(acceptAll, std::move(predicates)));
+}
+
+} // namespace etk::tests
@@ -0,0 +1,108 @@
+#include "etk/MessageTemplate.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+std::wstring Format(MessageTemplate const& message,
+                    std::vector<std::wstring_view> const& properties,
+                    size_t bufferSize = 256)
+{
+    std::vector<wchar_t> buffer(bufferSize + 1, L'#');
+    size_t const length = message.Format(properties, buffer.data(), bufferSize);
+    EXPECT_EQ(L'#', buffer[bufferSize]);
+    EXPECT_EQ(L'\0', buffer[length]);
+    return std::wstring(buffer.data(), length);
+}
+
+} // namespace
+
+TEST(MessageTemplateTest, InsertsProperties)
+{
+    MessageTemplate const message(L"Opened %1 with %2 (%1)", 2);
+    EXPECT_EQ(2u, message.GetReferencedPropertyCount());
+    EXPECT_EQ(L"Opened file.txt with 0x3 (file.txt)",
+              Format(message, {L"file.txt", L"0x3"}));
+}
+
+TEST(MessageTemplateTest, Escapes)
+{
+    MessageTemplate const message(L"100%% done%n%.%!%t%r%q", 0);
+    EXPECT_EQ(0u, message.GetReferencedPropertyCount());
+    EXPECT_EQ(L"100% done\r\n.!\t\rq", Format(message, {}));
+
+    EXPECT_EQ(L"Trailing %", Format(MessageTemplate(L"Trailing %", 0), {}));
+    EXPECT_EQ(L"Ends here", Format(MessageTemplate(L"Ends here%0 not here", 0), {}));
+}
+
+TEST(MessageTemplateTest, SkipsFormatSpecs)
+{
+    MessageTemplate const message(L"Value: %1!08x!, Name: %2!s!!", 2);
+    EXPECT_EQ(L"Value: 42, Name: x!", Format(message, {L"42", L"x"}));
+}
+
+TEST(MessageTemplateTest, TwoDigitIndices)
+{
+    std::wstring text;
+    std::vector<std::wstring> values;
+    for (int i = 1; i <= 12; ++i) {
+        text += L"%" + std::to_wstring(i);
+        values.push_back(std::to_wstring(i * 10));
+    }
+    text += L"%123";
+
+    MessageTemplate const message(text, 12);
+    EXPECT_EQ(12u, message.GetReferencedPropertyCount());
+
+    std::vector<std::wstring_view> const properties(values.begin(), values.end());
+    EXPECT_EQ(L"102030405060708090100110120" L"1203", Format(message, properties));
+}
+
+TEST(MessageTemplateTest, KeepsMissingReferences)
+{
+    MessageTemplate const message(L"%1 of %3!u!", 2);
+    EXPECT_EQ(1u, message.GetReferencedPropertyCount());
+    EXPECT_EQ(L"a of %3!u!", Format(message, {L"a", L"b"}));
+}
+
+TEST(MessageTemplateTest, Truncates)
+{
+    MessageTemplate const message(L"Hello %1!", 1);
+    EXPECT_EQ(L"Hello Wo", Format(message, {L"World"}, 9));
+    EXPECT_EQ(L"Hello World!", Format(message, {L"World"}, 13));
+    EXPECT_EQ(L"", Format(message, {L"World"}, 1));
+
+    wchar_t untouched = L'#';
+    std::vector<std::wstring_view> const properties = {L"World"};
+    EXPECT_EQ(0u, message.Format(properties, &untouched, 0));
+    EXPECT_EQ(L'#', untouched);
+}
+
+TEST(MessageTemplateTest, Appends)
+{
+    MessageTemplate const message(L"Hello %1! %2", 2);
+    std::wstring const longName(5000, L'x');
+    std::vector<std::wstring_view> const properties = {longName, L"Bye"};
+
+    std::wstring output = L"> ";
+    message.Format(properties, output);
+    EXPECT_EQ(L"> Hello " + longName + L"! Bye", output);
+}
+
+TEST(MessageTemplateTest, Assign)
+{
+    MessageTemplate message(L"%1 and %2", 2);
+    message.Assign(L"only %1", 1);
+    EXPECT_EQ(1u, message.GetReferencedPropertyCount());
+    EXPECT_EQ(L"only x", Format(message, {L"x"}));
+}
+
+} // namespace etk::tests
@@ -0,0 +1,145 @@
+#include "etk/ParallelMessageFormatter.h"
+
+#include "etk/Support/StringConversions.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+// A schema with a single UINT32 property and the message "Value %1".
+std::vector<std::byte> MakeSchema()
+{
+    std::wstring_view const propertyName = L"Value";
+    std::wstring_view const message = L"Value %1";
+
+    size_t const propertyNameOffset = sizeof(TRACE_EVENT_INFO);
+    size_t const messageOffset =
+        propertyNameOffset + (propertyName.size() + 1) * sizeof(wchar_t);
+    size_t const size = messageOffset + (message.size() + 1) * sizeof(wchar_t);
+
+    std::vector<std::byte> buffer(size);
+    auto const info = reinterpret_cast<TRACE_EVENT_INFO*>(buffer.data());
+    info->PropertyCount = 1;
+    info->TopLevelPropertyCount = 1;
+    info->EventMessageOffset = static_cast<ULONG>(messageOffset);
+
+    EVENT_PROPERTY_INFO& propInfo = info->EventPropertyInfoArray[0];
+    propInfo.NameOffset = static_cast<ULONG>(propertyNameOffset);
+    propInfo.nonStructType.InType = TDH_INTYPE_UINT32;
+    propInfo.nonStructType.OutType = TDH_OUTTYPE_UNSIGNEDINT;
+    propInfo.count = 1;
+    propInfo.length = sizeof(uint32_t);
+
+    std::memcpy(buffer.data() + propertyNameOffset, propertyName.data(),
+                propertyName.size() * sizeof(wchar_t));
+    std::memcpy(buffer.data() + messageOffset, message.data(),
+                message.size() * sizeof(wchar_t));
+    return buffer;
+}
+
+} // namespace
+
+TEST(ParallelMessageFormatterTest, FormatsInOrder)
+{
+    auto const schema = MakeSchema();
+    auto const info = reinterpret_cast<TRACE_EVENT_INFO const*>(schema.data());
+
+    size_t const eventCount = 10 * ParallelMessageFormatter::DefaultChunkSize + 17;
+    std::vector<uint32_t> values(eventCount);
+    std::vector<EVENT_RECORD> records(eventCount);
+    std::wstring const stringOnly = L"Just a string";
+
+    for (size_t i = 0; i < eventCount; ++i) {
+        EVENT_RECORD& record = records[i];
+        record.EventHeader.Flags = EVENT_HEADER_FLAG_64_BIT_HEADER;
+        if (i % 100 == 50) {
+            record.EventHeader.Flags |= EVENT_HEADER_FLAG_STRING_ONLY;
+            record.UserData = const_cast<wchar_t*>(stringOnly.data());
+            record.UserDataLength =
+                static_cast<USHORT>(stringOnly.size() * sizeof(wchar_t));
+        } else {
+            values[i] = static_cast<uint32_t>(i * 3);
+            record.UserData = &values[i];
+            record.UserDataLength = sizeof(uint32_t);
+        }
+    }
+
+    std::vector<EventInfo> events;
+    for (size_t i = 0; i < eventCount; ++i) {
+        // Events without schema yield empty messages.
+        if (i % 100 == 99)
+            events.emplace_back();
+        else
+            events.emplace_back(&records[i], info, schema.size());
+    }
+
+    ParallelMessageFormatter formatter(4);
+    FormattedMessages messages;
+    formatter.FormatEventMessages(events, messages);
+
+    ASSERT_EQ(eventCount, messages.size());
+    for (size_t i = 0; i < eventCount; ++i) {
+        if (i % 100 == 50)
+            EXPECT_EQ(stringOnly, messages[i]) << i;
+        else if (i % 100 == 99)
+            EXPECT_EQ(L"", messages[i]) << i;
+        else
+            EXPECT_EQ(L"Value " + std::to_wstring(i * 3), messages[i]) << i;
+        EXPECT_EQ(i % 100 != 99, messages.IsFormatted(i)) << i;
+    }
+
+    FormattedMessagesU8 messagesU8;
+    formatter.FormatEventMessages(events, messagesU8);
+    ASSERT_EQ(eventCount, messagesU8.size());
+    for (size_t i = 0; i < eventCount; ++i)
+        EXPECT_EQ(U16To8(messages[i]), messagesU8[i]) << i;
+
+    // Output is replaced by later batches.
+    formatter.FormatEventMessages(cspan<EventInfo>(events).first(3), messages);
+    ASSERT_EQ(3u, messages.size());
+    EXPECT_EQ(L"Value 6", messages[2]);
+
+    // Workers are reused by later batches.
+    for (int round = 0; round < 100; ++round) {
+        formatter.FormatEventMessages(events, messagesU8);
+        ASSERT_EQ(eventCount, messagesU8.size());
+        ASSERT_EQ("Value 3", messagesU8[1]);
+    }
+    EXPECT_EQ(4u, formatter.GetThreadCount());
+
+    formatter.FormatEventMessages(cspan<EventInfo>(), messages);
+    EXPECT_EQ(0u, messages.size());
+    EXPECT_EQ(L"", messages.Text);
+}
+
+TEST(ParallelMessageFormatterTest, DoesNotTruncate)
+{
+    std::wstring const longMessage(10000, L'm');
+
+    EVENT_RECORD record = {};
+    record.EventHeader.Flags =
+        EVENT_HEADER_FLAG_64_BIT_HEADER | EVENT_HEADER_FLAG_STRING_ONLY;
+    record.UserData = const_cast<wchar_t*>(longMessage.data());
+    record.UserDataLength = static_cast<USHORT>(longMessage.size() * sizeof(wchar_t));
+
+    TRACE_EVENT_INFO const info = {};
+    std::vector<EventInfo> const events(3, EventInfo(&record, &info, sizeof(info)));
+
+    ParallelMessageFormatter formatter(2);
+    FormattedMessages messages;
+    formatter.FormatEventMessages(events, messages);
+
+    ASSERT_EQ(3u, messages.size());
+    for (size_t i = 0; i < messages.size(); ++i)
+        EXPECT_EQ(longMessage, messages[i]) << i;
+}
+
+} // namespace etk::tests
@@ -0,0 +1,131 @@
+#include "etk/PayloadFilter.h"
+
+#include "TestSupport.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+TEST(PayloadFilterTest, FixedOffsets)
+{
+    TestSchema schema;
+    schema.Add(L"Id", TDH_INTYPE_UINT32)
+        .Add(L"HResult", TDH_INTYPE_INT32)
+        .Add(L"Flags", TDH_INTYPE_HEXINT64)
+        .Build();
+
+    PayloadFilter filter({
+        PayloadPredicate::Number(L"HResult", CompareOp::Less, 0),
+        PayloadPredicate::Number(L"Flags", CompareOp::AnyBitsSet, 0x4),
+    });
+
+    TestPayload failed;
+    failed.Add<uint32_t>(1).Add<int32_t>(-2147467259).Add<uint64_t>(0x6);
+    EXPECT_TRUE(filter.Matches(failed.ToEvent(schema)));
+
+    TestPayload succeeded;
+    succeeded.Add<uint32_t>(1).Add<int32_t>(0).Add<uint64_t>(0x6);
+    EXPECT_FALSE(filter.Matches(succeeded.ToEvent(schema)));
+
+    TestPayload noFlag;
+    noFlag.Add<uint32_t>(1).Add<int32_t>(-1).Add<uint64_t>(0x3);
+    EXPECT_FALSE(filter.Matches(noFlag.ToEvent(schema)));
+}
+
+TEST(PayloadFilterTest, PropertiesAfterStrings)
+{
+    TestSchema schema;
+    schema.Add(L"Path", TDH_INTYPE_UNICODESTRING)
+        .Add(L"Module", TDH_INTYPE_ANSISTRING)
+        .Add(L"Code", TDH_INTYPE_UINT16)
+        .Build();
+
+    PayloadFilter filter({
+        PayloadPredicate::String(L"Path", StringMatch::Contains, L"FOO", true),
+        PayloadPredicate::String(L"Module", StringMatch::EndsWith, L".dll"),
+        PayloadPredicate::Number(L"Code", CompareOp::Equal, 7),
+    });
+
+    TestPayload match;
+    match.AddString(u"C:\\foo\\bar").AddAnsiString("kernel32.dll").Add<uint16_t>(7);
+    EXPECT_TRUE(filter.Matches(match.ToEvent(schema)));
+
+    TestPayload otherCode;
+    otherCode.AddString(u"C:\\foo\\bar").AddAnsiString("kernel32.dll").Add<uint16_t>(8);
+    EXPECT_FALSE(filter.Matches(otherCode.ToEvent(schema)));
+
+    TestPayload otherPath;
+    otherPath.AddString(u"C:\\fo\\bar").AddAnsiString("kernel32.dll").Add<uint16_t>(7);
+    EXPECT_FALSE(filter.Matches(otherPath.ToEvent(schema)));
+}
+
+TEST(PayloadFilterTest, UnresolvedPropertiesDoNotMatch)
+{
+    TestSchema schema;
+    schema.Add(L"Id", TDH_INTYPE_UINT32)
+        .Add(L"Sid", TDH_INTYPE_SID)
+        .Add(L"Status", TDH_INTYPE_UINT32)
+        .Build();
+
+    TestPayload payload;
+    payload.Add<uint32_t>(1).Add<uint32_t>(0).Add<uint32_t>(0);
+    EventInfo const evt = payload.ToEvent(schema);
+
+    EXPECT_TRUE(PayloadFilter({PayloadPredicate::Number(L"Id", CompareOp::Equal, 1)})
+                    .Matches(evt));
+    EXPECT_FALSE(
+        PayloadFilter({PayloadPredicate::Number(L"Missing", CompareOp::NotEqual, 1)})
+            .Matches(evt));
+    EXPECT_FALSE(
+        PayloadFilter({PayloadPredicate::String(L"Id", StringMatch::NotEqual, L"")})
+            .Matches(evt));
+    EXPECT_FALSE(
+        PayloadFilter({PayloadPredicate::Number(L"Status", CompareOp::Equal, 0)})
+            .Matches(evt));
+}
+
+TEST(PayloadFilterTest, TruncatedPayload)
+{
+    TestSchema schema;
+    schema.Add(L"Name", TDH_INTYPE_UNICODESTRING)
+        .Add(L"Value", TDH_INTYPE_UINT64)
+        .Build();
+
+    PayloadFilter filter({PayloadPredicate::Number(L"Value", CompareOp::Equal, 0)});
+
+    TestPayload payload;
+    payload.AddString(u"abc").Add<uint64_t>(0);
+    EXPECT_TRUE(filter.Matches(payload.ToEvent(schema)));
+
+    payload.Truncate(12);
+    EXPECT_FALSE(filter.Matches(payload.ToEvent(schema)));
+}
+
+TEST(PayloadFilterTest, LayoutPerSchema)
+{
+    TestSchema schemaA;
+    schemaA.Add(L"Value", TDH_INTYPE_UINT8).SetEventId(1).Build();
+    TestSchema schemaB;
+    schemaB.Add(L"Prefix", TDH_INTYPE_UINT32)
+        .Add(L"Value", TDH_INTYPE_UINT8)
+        .SetEventId(2)
+        .Build();
+
+    PayloadFilter filter({PayloadPredicate::Number(L"Value", CompareOp::Equal, 5)});
+
+    TestPayload a;
+    a.Add<uint8_t>(5);
+    TestPayload b;
+    b.Add<uint32_t>(9).Add<uint8_t>(5);
+
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_TRUE(filter.Matches(a.ToEvent(schemaA)));
+        EXPECT_TRUE(filter.Matches(b.ToEvent(schemaB)));
+    }
+}
+
+} // namespace etk::tests
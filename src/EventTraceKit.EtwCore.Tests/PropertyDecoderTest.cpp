@@ -0,0 +1,245 @@
+#include "etk/PropertyDecoder.h"
+
+#include "TestSupport.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+using ValueKind = PropertyValue::ValueKind;
+
+std::u16string ToU16(cspan<std::byte> data)
+{
+    std::u16string str(data.size() / sizeof(char16_t), u'\0');
+    std::memcpy(str.data(), data.data(), str.size() * sizeof(char16_t));
+    return str;
+}
+
+} // namespace
+
+TEST(PropertyDecoderTest, Scalars)
+{
+    GUID const guid = {
+        0x5F0C1E2D, 0xAAAA, 0xBBBB, {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80}};
+
+    TestSchema schema;
+    auto const info = schema.Add(TDH_INTYPE_INT8, 1)
+                          .Add(TDH_INTYPE_INT32, 4)
+                          .Add(TDH_INTYPE_UINT16, 2)
+                          .Add(TDH_INTYPE_HEXINT64, 8)
+                          .Add(TDH_INTYPE_POINTER)
+                          .Add(TDH_INTYPE_BOOLEAN, 4)
+                          .Add(TDH_INTYPE_FLOAT, 4)
+                          .Add(TDH_INTYPE_DOUBLE, 8)
+                          .Add(TDH_INTYPE_GUID, 16)
+                          .Build();
+
+    TestPayload payload;
+    payload.Add<int8_t>(-5)
+        .Add<int32_t>(-100000)
+        .Add<uint16_t>(65535)
+        .Add<uint64_t>(0xFEDCBA9876543210)
+        .Add<uint64_t>(0x7FF612340000)
+        .Add<uint32_t>(7)
+        .Add<float>(1.5f)
+        .Add<double>(-2.25)
+        .Add(guid);
+    EVENT_RECORD record = payload.MakeRecord();
+
+    PropertyValue values[9];
+    PropertyDecoder decoder;
+    ASSERT_EQ(9u, decoder.Decode(EventInfo(&record, info, schema.Size()), 8, values));
+
+    EXPECT_EQ(ValueKind::Signed, values[0].Kind);
+    EXPECT_EQ(-5, values[0].Int);
+    EXPECT_EQ(TDH_INTYPE_INT8, values[0].InType);
+    EXPECT_EQ(1u, values[0].Count);
+    EXPECT_EQ(ValueKind::Signed, values[1].Kind);
+    EXPECT_EQ(-100000, values[1].Int);
+    EXPECT_EQ(ValueKind::Unsigned, values[2].Kind);
+    EXPECT_EQ(65535u, values[2].UInt);
+    EXPECT_EQ(ValueKind::Unsigned, values[3].Kind);
+    EXPECT_EQ(0xFEDCBA9876543210u, values[3].UInt);
+    EXPECT_EQ(ValueKind::Unsigned, values[4].Kind);
+    EXPECT_EQ(0x7FF612340000u, values[4].UInt);
+    EXPECT_EQ(ValueKind::Boolean, values[5].Kind);
+    EXPECT_EQ(1u, values[5].UInt);
+    EXPECT_EQ(ValueKind::Float, values[6].Kind);
+    EXPECT_EQ(1.5, values[6].Double);
+    EXPECT_EQ(ValueKind::Float, values[7].Kind);
+    EXPECT_EQ(-2.25, values[7].Double);
+    EXPECT_EQ(ValueKind::Guid, values[8].Kind);
+    EXPECT_EQ(0, std::memcmp(&guid, &values[8].Guid, sizeof(GUID)));
+}
+
+TEST(PropertyDecoderTest, Times)
+{
+    TestSchema schema;
+    auto const info =
+        schema.Add(TDH_INTYPE_FILETIME, 8).Add(TDH_INTYPE_SYSTEMTIME, 16).Build();
+
+    // 2020-09-01T12:34:56.789Z
+    uint64_t const ticks = 132434372967890000;
+    TestPayload payload;
+    payload.Add<uint64_t>(ticks);
+    for (uint16_t field : {2020, 9, 2, 1, 12, 34, 56, 789})
+        payload.Add<uint16_t>(field);
+    EVENT_RECORD record = payload.MakeRecord();
+
+    PropertyValue values[2];
+    PropertyDecoder decoder;
+    ASSERT_EQ(2u, decoder.Decode(EventInfo(&record, info, schema.Size()), 8, values));
+
+    EXPECT_EQ(ValueKind::Time, values[0].Kind);
+    EXPECT_EQ(ticks, values[0].UInt);
+    EXPECT_EQ(ValueKind::Time, values[1].Kind);
+    EXPECT_EQ(ticks, values[1].UInt);
+
+    // SYSTEMTIME values with out-of-range fields are not decoded.
+    std::initializer_list<uint16_t> const invalidTimes[] = {
+        {2020, 0, 0, 1, 0, 0, 0, 0},    {2020, 13, 0, 1, 0, 0, 0, 0},
+        {2020, 9, 0, 0, 0, 0, 0, 0},    {2020, 9, 0, 31, 0, 0, 0, 0},
+        {2019, 2, 0, 29, 0, 0, 0, 0},   {2020, 9, 0, 1, 24, 0, 0, 0},
+        {2020, 9, 0, 1, 0, 60, 0, 0},   {2020, 9, 0, 1, 0, 0, 60, 0},
+        {2020, 9, 0, 1, 0, 0, 0, 1000}, {1600, 12, 0, 31, 0, 0, 0, 0},
+    };
+    for (auto const& fields : invalidTimes) {
+        TestPayload invalid;
+        invalid.Add<uint64_t>(ticks);
+        for (uint16_t field : fields)
+            invalid.Add<uint16_t>(field);
+        record = invalid.MakeRecord();
+
+        ASSERT_EQ(2u, decoder.Decode(EventInfo(&record, info, schema.Size()), 8, values));
+        EXPECT_EQ(ValueKind::Time, values[0].Kind);
+        EXPECT_EQ(ValueKind::None, values[1].Kind);
+    }
+
+    // Leap days are valid.
+    TestPayload leapDay;
+    leapDay.Add<uint64_t>(ticks);
+    for (uint16_t field : {2020, 2, 6, 29, 0, 0, 0, 0})
+        leapDay.Add<uint16_t>(field);
+    record = leapDay.MakeRecord();
+    ASSERT_EQ(2u, decoder.Decode(EventInfo(&record, info, schema.Size()), 8, values));
+    EXPECT_EQ(ValueKind::Time, values[1].Kind);
+}
+
+TEST(PropertyDecoderTest, StringsAndBinary)
+{
+    TestSchema schema;
+    auto const info = schema.Add(TDH_INTYPE_UNICODESTRING)
+                          .Add(TDH_INTYPE_ANSISTRING)
+                          .Add(TDH_INTYPE_UNICODESTRING, 4)
+                          .Add(TDH_INTYPE_COUNTEDSTRING)
+                          .Add(TDH_INTYPE_BINARY, 3)
+                          .Add(TDH_INTYPE_UINT32, 4, 2)
+                          .Build();
+
+    TestPayload payload;
+    payload.AddString(u"Hello")
+        .AddAnsiString("World")
+        .AddString(u"ab")
+        .Add<uint16_t>(0)
+        .Add<uint16_t>(6)
+        .Add<char16_t>(u'x')
+        .Add<char16_t>(u'y')
+        .Add<char16_t>(u'z')
+        .Add<uint8_t>(1)
+        .Add<uint8_t>(2)
+        .Add<uint8_t>(3)
+        .Add<uint32_t>(10)
+        .Add<uint32_t>(20);
+    EVENT_RECORD record = payload.MakeRecord();
+
+    PropertyValue values[6];
+    PropertyDecoder decoder;
+    ASSERT_EQ(6u, decoder.Decode(EventInfo(&record, info, schema.Size()), 8, values));
+
+    // Strings refer into the payload, without terminator and padding.
+    EXPECT_EQ(ValueKind::UnicodeString, values[0].Kind);
+    EXPECT_EQ(u"Hello", ToU16(values[0].Data));
+    EXPECT_EQ(static_cast<void const*>(record.UserData), values[0].Data.data());
+    EXPECT_EQ(ValueKind::AnsiString, values[1].Kind);
+    EXPECT_EQ("World", values[1].GetAnsiString());
+    EXPECT_EQ(ValueKind::UnicodeString, values[2].Kind);
+    EXPECT_EQ(u"ab", ToU16(values[2].Data));
+    EXPECT_EQ(ValueKind::UnicodeString, values[3].Kind);
+    EXPECT_EQ(u"xyz", ToU16(values[3].Data));
+
+    EXPECT_EQ(ValueKind::Binary, values[4].Kind);
+    ASSERT_EQ(3u, values[4].Data.size());
+    EXPECT_EQ(std::byte(3), values[4].Data[2]);
+
+    EXPECT_EQ(ValueKind::Array, values[5].Kind);
+    EXPECT_EQ(TDH_INTYPE_UINT32, values[5].InType);
+    EXPECT_EQ(2u, values[5].Count);
+    EXPECT_EQ(8u, values[5].Data.size());
+}
+
+TEST(PropertyDecoderTest, PartialAndInvalid)
+{
+    TestSchema schema;
+    auto const info = schema.Add(TDH_INTYPE_UINT32, 4)
+                          .Add(TDH_INTYPE_UINT64, 8)
+                          .Add(TDH_INTYPE_UINT32, 4)
+                          .Build();
+
+    TestPayload payload;
+    payload.Add<uint32_t>(1).Add<uint64_t>(2).Add<uint32_t>(3);
+    EVENT_RECORD record = payload.MakeRecord();
+    EventInfo const event(&record, info, schema.Size());
+
+    PropertyDecoder decoder;
+
+    // Only the requested leading properties are decoded, and only those the
+    // schema has.
+    PropertyValue values[4];
+    values[3].Kind = ValueKind::Signed;
+    EXPECT_EQ(1u, decoder.Decode(event, 8, span<PropertyValue>(values, 1)));
+    EXPECT_EQ(1u, values[0].UInt);
+    EXPECT_EQ(3u, decoder.Decode(event, 8, values));
+    EXPECT_EQ(3u, values[2].UInt);
+    EXPECT_EQ(ValueKind::None, values[3].Kind);
+
+    // Payloads too short for the schema decode nothing.
+    record.UserDataLength = 10;
+    EXPECT_EQ(0u, decoder.Decode(event, 8, values));
+    EXPECT_EQ(ValueKind::None, values[0].Kind);
+
+    EXPECT_EQ(0u, decoder.Decode(EventInfo(), 8, values));
+}
+
+TEST(PropertyDecoderTest, ValueKinds)
+{
+    auto const kindOf = [](USHORT inType, USHORT count = 1,
+                           PROPERTY_FLAGS flags = PROPERTY_FLAGS()) {
+        EVENT_PROPERTY_INFO propInfo = {};
+        propInfo.Flags = flags;
+        propInfo.nonStructType.InType = inType;
+        propInfo.count = count;
+        return PropertyDecoder::GetValueKind(propInfo);
+    };
+
+    EXPECT_EQ(ValueKind::Signed, kindOf(TDH_INTYPE_INT16));
+    EXPECT_EQ(ValueKind::Unsigned, kindOf(TDH_INTYPE_POINTER));
+    EXPECT_EQ(ValueKind::Time, kindOf(TDH_INTYPE_SYSTEMTIME));
+    EXPECT_EQ(ValueKind::UnicodeString, kindOf(TDH_INTYPE_COUNTEDSTRING));
+    EXPECT_EQ(ValueKind::AnsiString, kindOf(TDH_INTYPE_ANSICHAR));
+    EXPECT_EQ(ValueKind::Binary, kindOf(TDH_INTYPE_HEXDUMP));
+    EXPECT_EQ(ValueKind::Array, kindOf(TDH_INTYPE_UINT32, 4));
+    EXPECT_EQ(ValueKind::Struct, kindOf(TDH_INTYPE_NULL, 1, PropertyStruct));
+    EXPECT_EQ(ValueKind::None, kindOf(TDH_INTYPE_NULL));
+}
+
+} // namespace etk::tests
@@ -0,0 +1,321 @@
+#include "etk/PropertyFormatter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+std::vector<std::byte> Bytes(std::initializer_list<int> values)
+{
+    std::vector<std::byte> bytes;
+    for (int value : values)
+        bytes.push_back(static_cast<std::byte>(value));
+    return bytes;
+}
+
+template<typename T>
+std::vector<std::byte> BytesOf(T const& value)
+{
+    std::vector<std::byte> bytes(sizeof(value));
+    std::memcpy(bytes.data(), &value, sizeof(value));
+    return bytes;
+}
+
+std::vector<std::byte> Utf16(char16_t const* str, bool terminate = true)
+{
+    std::vector<std::byte> bytes;
+    for (; *str; ++str) {
+        bytes.push_back(static_cast<std::byte>(*str & 0xFF));
+        bytes.push_back(static_cast<std::byte>(*str >> 8));
+    }
+    if (terminate)
+        bytes.insert(bytes.end(), 2, std::byte(0));
+    return bytes;
+}
+
+struct Formatted
+{
+    ULONG Status;
+    std::wstring Text;
+    size_t Consumed;
+};
+
+Formatted Format(USHORT inType, USHORT outType, std::vector<std::byte> const& data,
+                 USHORT length = 0, size_t pointerSize = 8)
+{
+    Formatted result{};
+    result.Status = FormatPropertyValue(inType, outType, pointerSize, length, data,
+                                        result.Text, result.Consumed);
+    return result;
+}
+
+std::wstring FormatText(USHORT inType, USHORT outType,
+                        std::vector<std::byte> const& data, USHORT length = 0,
+                        size_t pointerSize = 8)
+{
+    Formatted const result = Format(inType, outType, data, length, pointerSize);
+    EXPECT_EQ(static_cast<ULONG>(ERROR_SUCCESS), result.Status);
+    return result.Text;
+}
+
+} // namespace
+
+TEST(PropertyFormatterTest, Integers)
+{
+    EXPECT_EQ(L"-2", FormatText(TDH_INTYPE_INT8, TDH_OUTTYPE_NULL, Bytes({0xFE})));
+    EXPECT_EQ(L"254", FormatText(TDH_INTYPE_UINT8, TDH_OUTTYPE_NULL, Bytes({0xFE})));
+    EXPECT_EQ(L"-32768", FormatText(TDH_INTYPE_INT16, TDH_OUTTYPE_NULL,
+                                    BytesOf<int16_t>(INT16_MIN)));
+    EXPECT_EQ(L"4000000000", FormatText(TDH_INTYPE_UINT32, TDH_OUTTYPE_NULL,
+                                        BytesOf<uint32_t>(4000000000u)));
+    EXPECT_EQ(L"-9223372036854775808", FormatText(TDH_INTYPE_INT64, TDH_OUTTYPE_NULL,
+                                                  BytesOf<int64_t>(INT64_MIN)));
+    EXPECT_EQ(L"18446744073709551615", FormatText(TDH_INTYPE_UINT64, TDH_OUTTYPE_NULL,
+                                                  BytesOf<uint64_t>(UINT64_MAX)));
+
+    EXPECT_EQ(L"0x2A", FormatText(TDH_INTYPE_UINT8, TDH_OUTTYPE_HEXINT8, Bytes({42})));
+    EXPECT_EQ(L"0xFFFFFFFF", FormatText(TDH_INTYPE_INT32, TDH_OUTTYPE_HEXINT32,
+                                        BytesOf<int32_t>(-1)));
+    EXPECT_EQ(L"0xABC", FormatText(TDH_INTYPE_HEXINT32, TDH_OUTTYPE_NULL,
+                                   BytesOf<uint32_t>(0xABC)));
+    EXPECT_EQ(L"0x0", FormatText(TDH_INTYPE_HEXINT64, TDH_OUTTYPE_NULL,
+                                 BytesOf<uint64_t>(0)));
+
+    EXPECT_EQ(L"true", FormatText(TDH_INTYPE_UINT8, TDH_OUTTYPE_BOOLEAN, Bytes({1})));
+    EXPECT_EQ(L"false", FormatText(TDH_INTYPE_BOOLEAN, TDH_OUTTYPE_NULL,
+                                   BytesOf<uint32_t>(0)));
+    EXPECT_EQ(L"A", FormatText(TDH_INTYPE_UINT8, TDH_OUTTYPE_STRING, Bytes({'A'})));
+    EXPECT_EQ(L"443", FormatText(TDH_INTYPE_UINT16, TDH_OUTTYPE_PORT, Bytes({1, 0xBB})));
+
+    auto const result = Format(TDH_INTYPE_UINT16, TDH_OUTTYPE_NULL, Bytes({1, 2, 3}));
+    EXPECT_EQ(2u, result.Consumed);
+    EXPECT_EQ(L"513", result.Text);
+}
+
+TEST(PropertyFormatterTest, FloatingPoint)
+{
+    EXPECT_EQ(L"0.1", FormatText(TDH_INTYPE_FLOAT, TDH_OUTTYPE_NULL, BytesOf(0.1f)));
+    EXPECT_EQ(L"-2.5", FormatText(TDH_INTYPE_DOUBLE, TDH_OUTTYPE_NULL, BytesOf(-2.5)));
+    EXPECT_EQ(L"1e+100", FormatText(TDH_INTYPE_DOUBLE, TDH_OUTTYPE_NULL, BytesOf(1e100)));
+}
+
+TEST(PropertyFormatterTest, Pointers)
+{
+    EXPECT_EQ(L"0x00000000DEADBEEF",
+              FormatText(TDH_INTYPE_POINTER, TDH_OUTTYPE_NULL,
+                         BytesOf<uint64_t>(0xDEADBEEF)));
+
+    auto const result = Format(TDH_INTYPE_POINTER, TDH_OUTTYPE_NULL,
+                               BytesOf<uint64_t>(0x1234), 0, 4);
+    EXPECT_EQ(L"0x00001234", result.Text);
+    EXPECT_EQ(4u, result.Consumed);
+
+    EXPECT_EQ(L"4096", FormatText(TDH_INTYPE_SIZET, TDH_OUTTYPE_UNSIGNEDLONG,
+                                  BytesOf<uint64_t>(4096)));
+}
+
+TEST(PropertyFormatterTest, Guid)
+{
+    auto const data = Bytes({0x78, 0x56, 0x34, 0x12, 0xBC, 0x9A, 0xF0, 0xDE, 0x01, 0x23,
+                             0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF});
+    EXPECT_EQ(L"{12345678-9ABC-DEF0-0123-456789ABCDEF}",
+              FormatText(TDH_INTYPE_GUID, TDH_OUTTYPE_NULL, data));
+}
+
+TEST(PropertyFormatterTest, Timestamps)
+{
+    // 2020-09-01T12:34:56.1234567Z
+    uint64_t const fileTime = 132434372961234567ULL;
+    EXPECT_EQ(L"2020-09-01T12:34:56.1234567Z",
+              FormatText(TDH_INTYPE_FILETIME, TDH_OUTTYPE_NULL, BytesOf(fileTime)));
+    EXPECT_EQ(L"1601-01-01T00:00:00.0000000Z",
+              FormatText(TDH_INTYPE_FILETIME, TDH_OUTTYPE_NULL, BytesOf<uint64_t>(0)));
+
+    uint16_t const systemTime[] = {2000, 2, 3, 29, 23, 59, 58, 7};
+    EXPECT_EQ(L"2000-02-29T23:59:58.007",
+              FormatText(TDH_INTYPE_SYSTEMTIME, TDH_OUTTYPE_NULL, BytesOf(systemTime)));
+}
+
+TEST(PropertyFormatterTest, Sids)
+{
+    // S-1-5-21-1 followed by unrelated data
+    auto const sid = Bytes({1, 2, 0, 0, 0, 0, 0, 5, 21, 0, 0, 0, 1, 0, 0, 0, 0xFF});
+    auto const result = Format(TDH_INTYPE_SID, TDH_OUTTYPE_NULL, sid);
+    EXPECT_EQ(L"S-1-5-21-1", result.Text);
+    EXPECT_EQ(16u, result.Consumed);
+
+    auto wbemSid = std::vector<std::byte>(8);
+    wbemSid.insert(wbemSid.end(), sid.begin(), sid.end() - 1);
+    auto const wbem = Format(TDH_INTYPE_WBEMSID, TDH_OUTTYPE_NULL, wbemSid, 0, 4);
+    EXPECT_EQ(L"S-1-5-21-1", wbem.Text);
+    EXPECT_EQ(24u, wbem.Consumed);
+
+    EXPECT_EQ(static_cast<ULONG>(ERROR_EVT_INVALID_EVENT_DATA),
+              Format(TDH_INTYPE_SID, TDH_OUTTYPE_NULL, Bytes({1, 2, 0, 0, 0, 0, 0, 5}))
+                  .Status);
+}
+
+TEST(PropertyFormatterTest, Addresses)
+{
+    EXPECT_EQ(L"192.168.0.1",
+              FormatText(TDH_INTYPE_UINT32, TDH_OUTTYPE_IPV4, Bytes({192, 168, 0, 1})));
+
+    auto const ipv6 = Bytes({0x20, 0x01, 0x0D, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1});
+    EXPECT_EQ(L"2001:db8::1", FormatText(TDH_INTYPE_BINARY, TDH_OUTTYPE_IPV6, ipv6));
+    EXPECT_EQ(L"::", FormatText(TDH_INTYPE_BINARY, TDH_OUTTYPE_IPV6,
+                                std::vector<std::byte>(16)));
+    EXPECT_EQ(L"1:0:2::", FormatText(TDH_INTYPE_BINARY, TDH_OUTTYPE_IPV6,
+                                     Bytes({0, 1, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 0})));
+    EXPECT_EQ(L"::ffff:10.0.0.1",
+              FormatText(TDH_INTYPE_BINARY, TDH_OUTTYPE_IPV6,
+                         Bytes({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 10, 0, 0, 1})));
+
+    auto sockaddrIn = Bytes({2, 0, 0x1F, 0x90, 127, 0, 0, 1});
+    sockaddrIn.resize(16);
+    EXPECT_EQ(L"127.0.0.1:8080", FormatText(TDH_INTYPE_BINARY, TDH_OUTTYPE_SOCKETADDRESS,
+                                            sockaddrIn, 16));
+
+    auto sockaddrIn6 = Bytes({23, 0, 0, 80, 0, 0, 0, 0});
+    sockaddrIn6.insert(sockaddrIn6.end(), ipv6.begin(), ipv6.end());
+    sockaddrIn6.insert(sockaddrIn6.end(), {std::byte(3), std::byte(0), std::byte(0),
+                                           std::byte(0)});
+    EXPECT_EQ(L"[2001:db8::1%3]:80",
+              FormatText(TDH_INTYPE_BINARY, TDH_OUTTYPE_SOCKETADDRESS, sockaddrIn6, 28));
+}
+
+TEST(PropertyFormatterTest, Strings)
+{
+    auto data = Utf16(u"Hello");
+    data.push_back(std::byte('X'));
+    auto const terminated = Format(TDH_INTYPE_UNICODESTRING, TDH_OUTTYPE_NULL, data);
+    EXPECT_EQ(L"Hello", terminated.Text);
+    EXPECT_EQ(12u, terminated.Consumed);
+
+    auto const fixed = Format(TDH_INTYPE_UNICODESTRING, TDH_OUTTYPE_NULL, data, 3);
+    EXPECT_EQ(L"Hel", fixed.Text);
+    EXPECT_EQ(6u, fixed.Consumed);
+
+    auto const unterminated =
+        Format(TDH_INTYPE_UNICODESTRING, TDH_OUTTYPE_NULL, Utf16(u"ab", false));
+    EXPECT_EQ(L"ab", unterminated.Text);
+    EXPECT_EQ(4u, unterminated.Consumed);
+
+    auto const ansi =
+        Format(TDH_INTYPE_ANSISTRING, TDH_OUTTYPE_NULL, Bytes({'a', 'b', 0, 'c'}));
+    EXPECT_EQ(L"ab", ansi.Text);
+    EXPECT_EQ(3u, ansi.Consumed);
+
+    EXPECT_EQ(L"\u00E4\u20AC", FormatText(TDH_INTYPE_ANSISTRING, TDH_OUTTYPE_UTF8,
+                                          Bytes({0xC3, 0xA4, 0xE2, 0x82, 0xAC, 0})));
+    EXPECT_EQ(L"a\uFFFD", FormatText(TDH_INTYPE_ANSISTRING, TDH_OUTTYPE_UTF8,
+                                     Bytes({'a', 0xC3, 0})));
+
+    auto counted = Bytes({4, 0});
+    auto const text = Utf16(u"xy", false);
+    counted.insert(counted.end(), text.begin(), text.end());
+    auto const countedResult =
+        Format(TDH_INTYPE_MANIFEST_COUNTEDSTRING, TDH_OUTTYPE_NULL, counted);
+    EXPECT_EQ(L"xy", countedResult.Text);
+    EXPECT_EQ(6u, countedResult.Consumed);
+
+    EXPECT_EQ(L"ok", FormatText(TDH_INTYPE_REVERSEDCOUNTEDANSISTRING, TDH_OUTTYPE_NULL,
+                                Bytes({0, 2, 'o', 'k'})));
+    EXPECT_EQ(L"Z", FormatText(TDH_INTYPE_UNICODECHAR, TDH_OUTTYPE_NULL, Utf16(u"Z")));
+}
+
+TEST(PropertyFormatterTest, Binary)
+{
+    auto const data = Bytes({0x01, 0xAB, 0xFF});
+    auto const result = Format(TDH_INTYPE_BINARY, TDH_OUTTYPE_NULL, data, 2);
+    EXPECT_EQ(L"0x01AB", result.Text);
+    EXPECT_EQ(2u, result.Consumed);
+
+    EXPECT_EQ(L"0xFF00", FormatText(TDH_INTYPE_MANIFEST_COUNTEDBINARY, TDH_OUTTYPE_NULL,
+                                    Bytes({2, 0, 0xFF, 0})));
+    EXPECT_EQ(L"0x7F", FormatText(TDH_INTYPE_HEXDUMP, TDH_OUTTYPE_NULL,
+                                  Bytes({1, 0, 0, 0, 0x7F})));
+}
+
+TEST(PropertyFormatterTest, Errors)
+{
+    std::wstring sink = L"keep";
+    size_t consumed = 1;
+    EXPECT_EQ(static_cast<ULONG>(ERROR_EVT_INVALID_EVENT_DATA),
+              FormatPropertyValue(TDH_INTYPE_UINT32, TDH_OUTTYPE_NULL, 8, 0,
+                                  Bytes({1, 2, 3}), sink, consumed));
+    EXPECT_EQ(L"keep", sink);
+    EXPECT_EQ(0u, consumed);
+
+    // Left to TDH
+    EXPECT_EQ(static_cast<ULONG>(ERROR_NOT_SUPPORTED),
+              Format(TDH_INTYPE_UINT32, TDH_OUTTYPE_WIN32ERROR, BytesOf<uint32_t>(5))
+                  .Status);
+    EXPECT_EQ(static_cast<ULONG>(ERROR_NOT_SUPPORTED),
+              Format(TDH_INTYPE_ANSISTRING, TDH_OUTTYPE_NULL, Bytes({'a', 0xE4, 0}))
+                  .Status);
+    EXPECT_EQ(static_cast<ULONG>(ERROR_NOT_SUPPORTED),
+              Format(TDH_INTYPE_NULL, TDH_OUTTYPE_NULL, Bytes({0})).Status);
+}
+
+TEST(PropertyFormatterTest, DISABLED_Benchmark)
+{
+    size_t const iterations = 1 << 20;
+    auto const number = BytesOf<uint32_t>(123456789);
+    auto const string = Utf16(u"C:\\Windows\\System32\\kernel32.dll");
+
+    using Clock = std::chrono::steady_clock;
+    auto const measure = [&](char const* name, auto&& function) {
+        auto const start = Clock::now();
+        size_t length = 0;
+        for (size_t i = 0; i < iterations; ++i)
+            length += function();
+        auto const elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+        std::printf("%-16s %8lld us  (%zu chars)\n", name,
+                    static_cast<long long>(elapsed.count()), length);
+    };
+
+    std::wstring sink;
+    size_t consumed;
+    auto const native = [&](USHORT inType, std::vector<std::byte> const& data) {
+        return [&, inType] {
+            sink.clear();
+            (void)FormatPropertyValue(inType, TDH_OUTTYPE_NULL, 8, 0, data, sink,
+                                      consumed);
+            return sink.size();
+        };
+    };
+
+    TRACE_EVENT_INFO info = {};
+    wchar_t buffer[256];
+    auto const tdh = [&](USHORT inType, std::vector<std::byte> const& data) {
+        return [&, inType] {
+            ULONG bufferSize = sizeof(buffer);
+            USHORT userDataConsumed = 0;
+            (void)TdhFormatProperty(
+                &info, nullptr, 8, inType, TDH_OUTTYPE_NULL, 0,
+                static_cast<USHORT>(data.size()),
+                const_cast<BYTE*>(reinterpret_cast<BYTE const*>(data.data())),
+                &bufferSize, buffer, &userDataConsumed);
+            return bufferSize / sizeof(wchar_t);
+        };
+    };
+
+    measure("native uint32", native(TDH_INTYPE_UINT32, number));
+    measure("tdh uint32", tdh(TDH_INTYPE_UINT32, number));
+    measure("native string", native(TDH_INTYPE_UNICODESTRING, string));
+    measure("tdh string", tdh(TDH_INTYPE_UNICODESTRING, string));
+}
+
+} // namespace etk::tests
@@ -0,0 +1,208 @@
+#include "etk/SchemaCacheFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+GUID const ProviderId = {
+    0x5F0C1E2D, 0xAAAA, 0xBBBB, {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80}};
+
+std::vector<std::byte> MakeEventInfo(USHORT eventId, ULONG propertyCount)
+{
+    size_t const size =
+        offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray) +
+        std::max<size_t>(propertyCount, 1) * sizeof(EVENT_PROPERTY_INFO) + 6;
+
+    TRACE_EVENT_INFO info = {};
+    info.ProviderGuid = ProviderId;
+    info.EventDescriptor.Id = eventId;
+    info.PropertyCount = propertyCount;
+
+    std::vector<std::byte> data(size);
+    std::memcpy(data.data(), &info, offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray));
+    return data;
+}
+
+TRACE_EVENT_INFO const* AsInfo(std::vector<std::byte> const& data)
+{
+    return reinterpret_cast<TRACE_EVENT_INFO const*>(data.data());
+}
+
+} // namespace
+
+TEST(SchemaCacheFileTest, StableHash)
+{
+    // FNV-1a test vectors
+    EXPECT_EQ(0xCBF29CE484222325ULL, ComputeStableHash(cspan<std::byte>()));
+
+    std::byte const a[] = {std::byte('a')};
+    EXPECT_EQ(0xAF63DC4C8601EC8CULL, ComputeStableHash(a));
+
+    std::byte const foobar[] = {std::byte('f'), std::byte('o'), std::byte('o'),
+                                std::byte('b'), std::byte('a'), std::byte('r')};
+    EXPECT_EQ(0x85944171F73967E8ULL, ComputeStableHash(foobar));
+    EXPECT_EQ(ComputeStableHash(foobar),
+              ComputeStableHash(cspan<std::byte>(foobar).subspan(3),
+                                ComputeStableHash(cspan<std::byte>(foobar, 3))));
+}
+
+TEST(SchemaCacheFileTest, RoundTrip)
+{
+    auto const first = MakeEventInfo(1, 2);
+    auto const second = MakeEventInfo(2, 0);
+
+    SchemaCacheWriter writer;
+    writer.Add(EventKey(ProviderId, 1, 0), 42, AsInfo(first), first.size());
+    writer.Add(EventKey(ProviderId, 2, 0), 42, AsInfo(second), second.size());
+    writer.Add(EventKey(ProviderId, 1, 0), 43, AsInfo(second), second.size());
+    EXPECT_EQ(3u, writer.GetEntryCount());
+
+    auto const contents = writer.Finish();
+
+    SchemaCacheFile file;
+    ASSERT_TRUE(file.Attach(contents));
+    EXPECT_EQ(3u, file.GetEntryCount());
+
+    auto const [info, infoSize] = file.Find(EventKey(ProviderId, 1, 0), 42);
+    ASSERT_NE(nullptr, info);
+    ASSERT_EQ(first.size(), infoSize);
+    EXPECT_EQ(0, std::memcmp(info, first.data(), first.size()));
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(info) % alignof(TRACE_EVENT_INFO));
+
+    // Schemas resolved with other manifests are kept apart.
+    auto const [other, otherSize] = file.Find(EventKey(ProviderId, 1, 0), 43);
+    ASSERT_NE(nullptr, other);
+    EXPECT_EQ(2, other->EventDescriptor.Id);
+
+    EXPECT_EQ(nullptr, std::get<0>(file.Find(EventKey(ProviderId, 1, 0), 44)));
+    EXPECT_EQ(nullptr, std::get<0>(file.Find(EventKey(ProviderId, 1, 1), 42)));
+    EXPECT_EQ(nullptr, std::get<0>(file.Find(EventKey(ProviderId, 3, 0), 42)));
+}
+
+TEST(SchemaCacheFileTest, ManyEntries)
+{
+    SchemaCacheWriter writer;
+    for (USHORT id = 0; id < 1000; ++id) {
+        auto const info = MakeEventInfo(id, id % 4);
+        writer.Add(EventKey(ProviderId, id, 0), 7, AsInfo(info), info.size());
+    }
+
+    auto const contents = writer.Finish();
+    SchemaCacheFile file;
+    ASSERT_TRUE(file.Attach(contents));
+    EXPECT_EQ(1000u, file.GetEntryCount());
+
+    for (USHORT id = 0; id < 1000; ++id) {
+        auto const [info, infoSize] = file.Find(EventKey(ProviderId, id, 0), 7);
+        ASSERT_NE(nullptr, info) << id;
+        EXPECT_EQ(id, info->EventDescriptor.Id);
+        EXPECT_EQ(id % 4u, info->PropertyCount);
+    }
+}
+
+TEST(SchemaCacheFileTest, Merge)
+{
+    auto const original = MakeEventInfo(1, 0);
+    auto const updated = MakeEventInfo(1, 1);
+
+    SchemaCacheWriter oldWriter;
+    oldWriter.Add(EventKey(ProviderId, 1, 0), 1, AsInfo(original), original.size());
+    oldWriter.Add(EventKey(ProviderId, 2, 0), 1, AsInfo(original), original.size());
+    oldWriter.Add(EventKey(ProviderId, 3, 0), 1, AsInfo(original), original.size());
+    auto const oldContents = oldWriter.Finish();
+
+    SchemaCacheFile oldFile;
+    ASSERT_TRUE(oldFile.Attach(oldContents));
+
+    // Newly resolved schemas take precedence over persisted ones.
+    SchemaCacheWriter writer;
+    writer.Add(EventKey(ProviderId, 1, 0), 1, AsInfo(updated), updated.size());
+    writer.Merge(oldFile, 2);
+    EXPECT_EQ(2u, writer.GetEntryCount());
+
+    auto const [info, infoSize] = writer.Find(EventKey(ProviderId, 1, 0), 1);
+    ASSERT_NE(nullptr, info);
+    EXPECT_EQ(1u, info->PropertyCount);
+
+    writer.Merge(oldFile, 10);
+    EXPECT_EQ(3u, writer.GetEntryCount());
+}
+
+TEST(SchemaCacheFileTest, RejectsInvalidContents)
+{
+    auto const info = MakeEventInfo(1, 1);
+    SchemaCacheWriter writer;
+    writer.Add(EventKey(ProviderId, 1, 0), 1, AsInfo(info), info.size());
+    auto const contents = writer.Finish();
+
+    SchemaCacheFile file;
+    EXPECT_FALSE(file.Attach(cspan<std::byte>()));
+    EXPECT_FALSE(file.Attach(cspan<std::byte>(contents.data(), contents.size() - 8)));
+
+    auto corrupted = contents;
+    corrupted.back() ^= std::byte(1);
+    EXPECT_FALSE(file.Attach(corrupted));
+
+    auto badVersion = contents;
+    badVersion[4] = std::byte(0x7F);
+    EXPECT_FALSE(file.Attach(badVersion));
+
+    EXPECT_EQ(0u, file.GetEntryCount());
+    EXPECT_EQ(nullptr, std::get<0>(file.Find(EventKey(ProviderId, 1, 0), 1)));
+
+    // Schemas whose property array exceeds their size are not persisted.
+    SchemaCacheWriter truncated;
+    truncated.Add(EventKey(ProviderId, 1, 0), 1, AsInfo(info), sizeof(TRACE_EVENT_INFO));
+    auto const truncatedInfo = MakeEventInfo(1, 5);
+    truncated.Add(EventKey(ProviderId, 2, 0), 1, AsInfo(truncatedInfo),
+                  sizeof(TRACE_EVENT_INFO));
+    EXPECT_EQ(1u, truncated.GetEntryCount());
+}
+
+TEST(SchemaCacheFileTest, RejectsOffsetsOutsideSchema)
+{
+    size_t const arrayOffset = offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray);
+    auto const setOffset = [](std::vector<std::byte>& info, size_t field, ULONG offset) {
+        std::memcpy(info.data() + field, &offset, sizeof(offset));
+    };
+
+    // The trailing bytes of the schema hold an empty string.
+    auto valid = MakeEventInfo(1, 1);
+    ULONG const stringOffset = static_cast<ULONG>(valid.size() - 6);
+    setOffset(valid, offsetof(TRACE_EVENT_INFO, ProviderNameOffset), stringOffset);
+    setOffset(valid, arrayOffset + offsetof(EVENT_PROPERTY_INFO, NameOffset),
+              stringOffset);
+
+    auto outsideName = valid;
+    setOffset(outsideName, offsetof(TRACE_EVENT_INFO, TaskNameOffset),
+              static_cast<ULONG>(outsideName.size()));
+
+    auto unterminatedName = valid;
+    unterminatedName.back() = std::byte('x');
+    setOffset(unterminatedName, offsetof(TRACE_EVENT_INFO, ProviderNameOffset),
+              static_cast<ULONG>(unterminatedName.size() - 2));
+
+    auto outsidePropertyName = valid;
+    setOffset(outsidePropertyName,
+              arrayOffset + offsetof(EVENT_PROPERTY_INFO, NameOffset), 0x10000);
+
+    SchemaCacheWriter writer;
+    writer.Add(EventKey(ProviderId, 1, 0), 1, AsInfo(valid), valid.size());
+    writer.Add(EventKey(ProviderId, 2, 0), 1, AsInfo(outsideName), outsideName.size());
+    writer.Add(EventKey(ProviderId, 3, 0), 1, AsInfo(unterminatedName),
+               unterminatedName.size());
+    writer.Add(EventKey(ProviderId, 4, 0), 1, AsInfo(outsidePropertyName),
+               outsidePropertyName.size());
+    EXPECT_EQ(1u, writer.GetEntryCount());
+    EXPECT_NE(nullptr, std::get<0>(writer.Find(EventKey(ProviderId, 1, 0), 1)));
+}
+
+} // namespace etk::tests
@@ -0,0 +1,66 @@
+#include "etk/Support/StringConversions.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+TEST(StringConversionsTest, Ascii)
+{
+    EXPECT_EQ("", U16To8(L""));
+    EXPECT_EQ(L"", U8To16(""));
+
+    // Long enough for the vector paths, with a tail.
+    std::string const ascii = "The quick brown fox jumps over the lazy dog 0123456789";
+    std::wstring const wide(ascii.begin(), ascii.end());
+    EXPECT_EQ(ascii, U16To8(wide));
+    EXPECT_EQ(wide, U8To16(ascii));
+}
+
+TEST(StringConversionsTest, NonAscii)
+{
+    std::wstring const wide =
+        L"Stra\xDF" L"e \x20AC 100 \U0001F600 and some trailing text";
+    std::string const utf8 = "Stra\xC3\x9F" "e \xE2\x82\xAC 100 \xF0\x9F\x98\x80"
+                             " and some trailing text";
+    EXPECT_EQ(utf8, U16To8(wide));
+    EXPECT_EQ(wide, U8To16(utf8));
+
+    // Non-ASCII characters in the middle of long ASCII runs.
+    std::wstring const mixed = std::wstring(20, L'a') + L"\xE9" + std::wstring(20, L'b');
+    EXPECT_EQ(mixed, U8To16(U16To8(mixed)));
+}
+
+TEST(StringConversionsTest, InvalidInput)
+{
+    // Unpaired surrogates.
+    EXPECT_EQ("a\xEF\xBF\xBD" "b", U16To8(std::wstring{L'a', wchar_t(0xD800), L'b'}));
+    EXPECT_EQ("\xEF\xBF\xBD", U16To8(std::wstring{wchar_t(0xDC00)}));
+
+    // Truncated sequences are replaced as a whole, invalid bytes one by one.
+    EXPECT_EQ(L"a\xFFFD", U8To16("a\xE2\x82"));
+    EXPECT_EQ(L"\xFFFDx", U8To16("\xE2\x82x"));
+    EXPECT_EQ(L"\xFFFD\xFFFD", U8To16("\xC0\xAF"));
+    EXPECT_EQ(L"\xFFFD\xFFFD\xFFFD", U8To16("\xED\xA0\x80"));
+    EXPECT_EQ(L"\xFFFD\xFFFD\xFFFD\xFFFD", U8To16("\xF4\x90\x80\x80"));
+    EXPECT_EQ(L"\xFFFDx", U8To16("\xFFx"));
+}
+
+TEST(StringConversionsTest, Append)
+{
+    std::string utf8 = "prefix ";
+    AppendU16To8(L"\xE9t\xE9", utf8);
+    EXPECT_EQ("prefix \xC3\xA9t\xC3\xA9", utf8);
+
+    std::wstring wide = L"prefix ";
+    AppendU8To16("\xC3\xA9t\xC3\xA9", wide);
+    EXPECT_EQ(L"prefix \xE9t\xE9", wide);
+
+    // The non-appending overloads replace the output.
+    EXPECT_TRUE(U16To8(L"new", utf8));
+    EXPECT_EQ("new", utf8);
+}
+
+} // namespace etk::tests
@@ -0,0 +1,300 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/ITraceLog.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <windows.h>
+
+namespace etk
+{
+class CompiledSchema;
+}
+
+namespace etk::tests
+{
+
+inline GUID const TestProviderId = {
+    0x6D35524C, 0xC587, 0x476A, {0x92, 0xD3, 0xF3, 0x33, 0xD2, 0x23, 0xBD, 0xCF}};
+
+// A record of TestProviderId with a 64-bit header and level 4 whose
+// timestamp is 1000 + id.
+inline EVENT_RECORD MakeRecord(USHORT id, ULONG processId = 0, ULONGLONG keyword = 0)
+{
+    EVENT_RECORD record = {};
+    record.EventHeader.Flags = EVENT_HEADER_FLAG_64_BIT_HEADER;
+    record.EventHeader.ProviderId = TestProviderId;
+    record.EventHeader.EventDescriptor.Id = id;
+    record.EventHeader.EventDescriptor.Level = 4;
+    record.EventHeader.EventDescriptor.Keyword = keyword;
+    record.EventHeader.ProcessId = processId;
+    record.EventHeader.TimeStamp.QuadPart = 1000 + id;
+    return record;
+}
+
+// Write callback appending to the std::string passed as state.
+inline bool AppendOutput(void const* data, size_t size, void* state)
+{
+    static_cast<std::string*>(state)->append(static_cast<char const*>(data), size);
+    return true;
+}
+
+// A trace log over records and schemas owned by the test.
+class TestTraceLog : public ITraceLog
+{
+public:
+    void Add(EVENT_RECORD const& record, TRACE_EVENT_INFO const* info = nullptr,
+             size_t infoSize = 0, CompiledSchema const* compiled = nullptr)
+    {
+        events.emplace_back(record, info, infoSize, compiled);
+    }
+
+    void ProcessEvent(EVENT_RECORD const&) override {}
+    size_t GetEventCount() const override { return events.size(); }
+
+    EventInfo GetEvent(size_t index) const override
+    {
+        auto const& [record, info, infoSize, compiled] = events[index];
+        return EventInfo(&record, info, infoSize, compiled);
+    }
+
+    void Clear() override
+    {
+        ++clearCount;
+        events.clear();
+    }
+
+    size_t GetClearCount() const override { return clearCount; }
+    HRESULT UpdateTraceData(cspan<std::wstring>) override { return S_OK; }
+    size_t GetResolvedEventCount() const override { return events.size(); }
+    void SetSchemasResolvedCallback(TraceLogSchemasResolvedCallback*, void*) override {}
+    void SetSchemaRetryPolicy(TraceLogSchemaRetryPolicy const&) override {}
+    void SetSchemaCacheCapacity(size_t) override {}
+    TraceLogSchemaStatistics GetSchemaStatistics() const override { return {}; }
+
+private:
+    // A deque keeps records in place, since events point into them.
+    std::deque<std::tuple<EVENT_RECORD, TRACE_EVENT_INFO const*, size_t,
+                          CompiledSchema const*>>
+        events;
+    size_t clearCount = 0;
+};
+
+// Builds a TRACE_EVENT_INFO. Empty names are left out of the schema.
+class TestSchema
+{
+public:
+    TestSchema() = default;
+
+    // A schema without properties with a provider name and a message.
+    TestSchema(std::wstring_view providerName, std::wstring_view message)
+    {
+        SetProviderName(providerName).SetMessage(message).Build();
+    }
+
+    TestSchema& Add(USHORT inType, USHORT length = 0, USHORT count = 1,
+                    PROPERTY_FLAGS flags = PROPERTY_FLAGS())
+    {
+        return Add({}, inType, length, count, flags);
+    }
+
+    TestSchema& Add(std::wstring_view name, USHORT inType, USHORT length = 0,
+                    USHORT count = 1, PROPERTY_FLAGS flags = PROPERTY_FLAGS())
+    {
+        EVENT_PROPERTY_INFO propInfo = {};
+        propInfo.Flags = flags;
+        propInfo.nonStructType.InType = inType;
+        propInfo.length = length;
+        propInfo.count = count;
+        properties.push_back(propInfo);
+        names.emplace_back(name);
+        return *this;
+    }
+
+    TestSchema& AddStruct(USHORT firstMember, USHORT memberCount, USHORT count = 1,
+                          PROPERTY_FLAGS flags = PROPERTY_FLAGS())
+    {
+        EVENT_PROPERTY_INFO propInfo = {};
+        propInfo.Flags = static_cast<PROPERTY_FLAGS>(flags | PropertyStruct);
+        propInfo.structType.StructStartIndex = firstMember;
+        propInfo.structType.NumOfStructMembers = memberCount;
+        propInfo.count = count;
+        properties.push_back(propInfo);
+        names.emplace_back();
+        return *this;
+    }
+
+    // Marks the last property as having its length given by another one.
+    TestSchema& LengthFrom(USHORT index)
+    {
+        auto& propInfo = properties.back();
+        propInfo.Flags =
+            static_cast<PROPERTY_FLAGS>(propInfo.Flags | PropertyParamLength);
+        propInfo.lengthPropertyIndex = index;
+        return *this;
+    }
+
+    // Marks the last property as having its count given by another one.
+    TestSchema& CountFrom(USHORT index)
+    {
+        auto& propInfo = properties.back();
+        propInfo.Flags =
+            static_cast<PROPERTY_FLAGS>(propInfo.Flags | PropertyParamCount);
+        propInfo.countPropertyIndex = index;
+        return *this;
+    }
+
+    TestSchema& SetEventId(USHORT id)
+    {
+        eventId = id;
+        return *this;
+    }
+
+    TestSchema& SetProviderName(std::wstring_view name)
+    {
+        providerName = name;
+        return *this;
+    }
+
+    TestSchema& SetTaskName(std::wstring_view name)
+    {
+        taskName = name;
+        return *this;
+    }
+
+    TestSchema& SetMessage(std::wstring_view str)
+    {
+        message = str;
+        return *this;
+    }
+
+    // All properties are top-level unless topLevelCount is given.
+    TRACE_EVENT_INFO const* Build(ULONG topLevelCount = 0)
+    {
+        size_t size =
+            sizeof(TRACE_EVENT_INFO) +
+            (std::max<size_t>(properties.size(), 1) - 1) * sizeof(EVENT_PROPERTY_INFO);
+
+        std::vector<std::tuple<size_t, std::wstring_view>> strings;
+        auto const addString = [&](std::wstring_view str) {
+            if (str.empty())
+                return ULONG();
+            size_t const offset = size;
+            strings.emplace_back(offset, str);
+            size += (str.size() + 1) * sizeof(wchar_t);
+            return static_cast<ULONG>(offset);
+        };
+
+        ULONG const providerNameOffset = addString(providerName);
+        ULONG const taskNameOffset = addString(taskName);
+        ULONG const messageOffset = addString(message);
+        for (size_t i = 0; i < properties.size(); ++i)
+            properties[i].NameOffset = addString(names[i]);
+
+        buffer.assign(size, std::byte());
+        auto const info = reinterpret_cast<TRACE_EVENT_INFO*>(buffer.data());
+        info->EventDescriptor.Id = eventId;
+        info->ProviderNameOffset = providerNameOffset;
+        info->TaskNameOffset = taskNameOffset;
+        info->EventMessageOffset = messageOffset;
+        info->PropertyCount = static_cast<ULONG>(properties.size());
+        info->TopLevelPropertyCount =
+            topLevelCount != 0 ? topLevelCount : static_cast<ULONG>(properties.size());
+        std::memcpy(info->EventPropertyInfoArray, properties.data(),
+                    properties.size() * sizeof(EVENT_PROPERTY_INFO));
+        for (auto const& [offset, str] : strings)
+            std::memcpy(buffer.data() + offset, str.data(), str.size() * sizeof(wchar_t));
+        return info;
+    }
+
+    // Builds the schema as an event without record.
+    EventInfo BuildEvent(ULONG topLevelCount = 0)
+    {
+        TRACE_EVENT_INFO const* const info = Build(topLevelCount);
+        return EventInfo(nullptr, info, buffer.size());
+    }
+
+    TRACE_EVENT_INFO const* Info() const
+    {
+        return reinterpret_cast<TRACE_EVENT_INFO const*>(buffer.data());
+    }
+
+    size_t Size() const { return buffer.size(); }
+
+private:
+    std::vector<EVENT_PROPERTY_INFO> properties;
+    std::vector<std::wstring> names;
+    std::wstring providerName;
+    std::wstring taskName;
+    std::wstring message;
+    USHORT eventId = 0;
+    std::vector<std::byte> buffer;
+};
+
+// Builds the user data of an event.
+class TestPayload
+{
+public:
+    template<typename T>
+    TestPayload& Add(T value)
+    {
+        auto const ptr = reinterpret_cast<std::byte const*>(&value);
+        data.insert(data.end(), ptr, ptr + sizeof(value));
+        return *this;
+    }
+
+    // Adds a null-terminated UTF-16 string.
+    TestPayload& AddString(std::u16string_view str)
+    {
+        for (char16_t c : str)
+            Add<uint16_t>(c);
+        return Add<uint16_t>(0);
+    }
+
+    TestPayload& AddAnsiString(std::string_view str)
+    {
+        for (char c : str)
+            Add<char>(c);
+        return Add<char>(0);
+    }
+
+    TestPayload& Truncate(size_t size)
+    {
+        data.resize(size);
+        return *this;
+    }
+
+    cspan<std::byte> Data() const { return data; }
+
+    // A record as made by MakeRecord with this payload as user data. The
+    // record points into the payload.
+    EVENT_RECORD MakeRecord(USHORT id = 0, ULONG processId = 0) const
+    {
+        EVENT_RECORD record = tests::MakeRecord(id, processId);
+        record.UserData = const_cast<std::byte*>(data.data());
+        record.UserDataLength = static_cast<USHORT>(data.size());
+        return record;
+    }
+
+    // An event of the schema with this payload. The event is valid until the
+    // next call.
+    EventInfo ToEvent(TestSchema const& schema)
+    {
+        record = MakeRecord(schema.Info()->EventDescriptor.Id);
+        return EventInfo(&record, schema.Info(), schema.Size());
+    }
+
+private:
+    std::vector<std::byte> data;
+    EVENT_RECORD record = {};
+};
+
+} // namespace etk::tests
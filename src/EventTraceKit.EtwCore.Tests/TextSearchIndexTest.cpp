@@ -0,0 +1,160 @@
+#include "etk/TextSearchIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+using DocumentIds = std::vector<uint32_t>;
+
+namespace
+{
+
+std::vector<uint32_t> FindBySubstring(std::vector<std::wstring> const& documents,
+                                      std::wstring const& query)
+{
+    std::vector<uint32_t> matches;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        if (documents[i].find(query) != std::wstring::npos)
+            matches.push_back(static_cast<uint32_t>(i));
+    }
+    return matches;
+}
+
+} // namespace
+
+TEST(TextSearchIndexTest, Substring)
+{
+    TextSearchIndex index;
+    index.Add(L"Opened file C:\\temp\\foo.txt");
+    index.Add(L"Closed handle 0x1234");
+    index.Add(L"Opened FILE C:\\bar.log");
+
+    EXPECT_EQ((DocumentIds{0, 2}), index.FindCandidates(L"file"));
+    EXPECT_EQ((DocumentIds{1}), index.FindCandidates(L"handle 0x"));
+    EXPECT_EQ((DocumentIds{0}), index.FindCandidates(L"foo.txt"));
+    EXPECT_TRUE(index.FindCandidates(L"missing").empty());
+}
+
+TEST(TextSearchIndexTest, AllTokens)
+{
+    TextSearchIndex index;
+    index.Add(L"Opened file C:\\temp\\foo.txt");
+    index.Add(L"Closed handle 0x1234");
+    index.Add(L"Opened handle for C:\\bar.log");
+
+    EXPECT_EQ((DocumentIds{2}),
+              index.FindCandidates(L"handle opened", TextSearchMode::AllTokens));
+    EXPECT_TRUE(
+        index.FindCandidates(L"handle opened", TextSearchMode::Substring).empty());
+}
+
+TEST(TextSearchIndexTest, ShortQueriesMatchEverything)
+{
+    TextSearchIndex index;
+    index.Add(L"abc");
+    index.Add(L"");
+    index.Add(L"xyz");
+
+    EXPECT_EQ((DocumentIds{0, 1, 2}), index.FindCandidates(L"ab"));
+    EXPECT_EQ((DocumentIds{0, 1, 2}),
+              index.FindCandidates(L"a b", TextSearchMode::AllTokens));
+}
+
+TEST(TextSearchIndexTest, CandidatesIncludeAllMatches)
+{
+    std::mt19937 rng(7);
+    std::vector<std::wstring> documents;
+    TextSearchIndex index;
+
+    // Large id gaps exercise multi-byte deltas in the posting lists.
+    for (int i = 0; i < 20000; ++i) {
+        std::wstring text;
+        size_t const length = rng() % 40;
+        for (size_t k = 0; k < length; ++k)
+            text.push_back(static_cast<wchar_t>(L'a' + rng() % 6));
+        if (i % 997 == 0)
+            text += L"needle";
+        documents.push_back(text);
+        index.Add(text);
+    }
+
+    for (std::wstring const query : {L"needle", L"abc", L"fedc", L"aaaa"}) {
+        std::vector<uint32_t> const expected = FindBySubstring(documents, query);
+        std::vector<uint32_t> const candidates = index.FindCandidates(query);
+        EXPECT_TRUE(std::includes(candidates.begin(), candidates.end(), expected.begin(),
+                                  expected.end()));
+    }
+
+    EXPECT_EQ(FindBySubstring(documents, L"needle"), index.FindCandidates(L"needle"));
+}
+
+TEST(TextSearchIndexTest, Clear)
+{
+    TextSearchIndex index;
+    index.Add(L"first document");
+    index.Clear();
+
+    EXPECT_EQ(0u, index.GetDocumentCount());
+    EXPECT_EQ(0u, index.Add(L"second document"));
+    EXPECT_EQ((DocumentIds{0}), index.FindCandidates(L"document"));
+    EXPECT_TRUE(index.FindCandidates(L"first").empty());
+}
+
+// Compares index lookups against a linear scan over all messages, which is how
+// searching worked before. Run explicitly with --gtest_also_run_disabled_tests.
+TEST(TextSearchIndexTest, DISABLED_Benchmark)
+{
+    std::mt19937 rng(3);
+    char const* const words[] = {"Opened",  "closed", "file",    "handle", "registry",
+                                 "key",     "value",  "process", "thread", "started",
+                                 "stopped", "error",  "status",  "0x0",    "access"};
+
+    size_t const documentCount = 1000000;
+    std::vector<std::wstring> documents;
+    documents.reserve(documentCount);
+    for (size_t i = 0; i < documentCount; ++i) {
+        std::wstring text;
+        for (int k = 0; k < 8; ++k) {
+            for (char const* c = words[rng() % std::size(words)]; *c; ++c)
+                text.push_back(static_cast<wchar_t>(*c));
+            text.push_back(L' ');
+        }
+        text += std::to_wstring(rng());
+        documents.push_back(std::move(text));
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto const elapsed = [](Clock::time_point start) {
+        return static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)
+                .count());
+    };
+
+    auto start = Clock::now();
+    TextSearchIndex index;
+    for (auto const& document : documents)
+        index.Add(document);
+    std::printf("Build     %8lld us  (%zu trigrams, %zu bytes)\n", elapsed(start),
+                index.GetTrigramCount(), index.GetMemoryUsage());
+
+    for (wchar_t const* query : {L"registry key", L"12345", L"error status 0x0"}) {
+        start = Clock::now();
+        size_t const scanned = FindBySubstring(documents, query).size();
+        long long const scanTime = elapsed(start);
+
+        start = Clock::now();
+        size_t const candidates = index.FindCandidates(query).size();
+        std::printf("%-18ls scan %8lld us (%zu)  index %8lld us (%zu)\n", query, scanTime,
+                    scanned, elapsed(start), candidates);
+    }
+}
+
+} // namespace etk::tests
@@ -0,0 +1,154 @@
+#include "etk/TraceLogExporter.h"
+
+#include "TestSupport.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+std::string Export(TraceLogExportOptions options, TraceLogExportSource source)
+{
+    std::string output;
+    TraceLogExporter exporter(std::move(options));
+    EXPECT_EQ(S_OK, exporter.Export(source, AppendOutput, &output));
+    return output;
+}
+
+} // namespace
+
+TEST(TraceLogExporterTest, Csv)
+{
+    TestSchema const schema(L"My-Provider", L"Said \"hi\", then left");
+
+    TestTraceLog log;
+    log.Add(MakeRecord(1, 10, 0x8000000000000001), schema.Info(), schema.Size());
+    log.Add(MakeRecord(2, 20));
+
+    TraceLogExportOptions options;
+    options.Columns = {ExportColumn::TimeStamp, ExportColumn::ProviderId,
+                       ExportColumn::ProviderName, ExportColumn::Id,
+                       ExportColumn::Level, ExportColumn::Keyword,
+                       ExportColumn::ProcessId, ExportColumn::Message};
+
+    EXPECT_EQ("TimeStamp,ProviderId,ProviderName,Id,Level,Keyword,ProcessId,Message\r\n"
+              "1001,{6D35524C-C587-476A-92D3-F333D223BDCF},My-Provider,1,4,"
+              "0x8000000000000001,10,\"Said \"\"hi\"\", then left\"\r\n"
+              "1002,{6D35524C-C587-476A-92D3-F333D223BDCF},,2,4,0x0,20,\r\n",
+              Export(options, log));
+}
+
+TEST(TraceLogExporterTest, JsonLines)
+{
+    TestSchema const schema(L"Provider", L"Line\nbreak \\ \"quoted\" \x01 \xE9");
+
+    TestTraceLog log;
+    log.Add(MakeRecord(1, 10), schema.Info(), schema.Size());
+    log.Add(MakeRecord(2, 20));
+
+    TraceLogExportOptions options;
+    options.Format = ExportFormat::JsonLines;
+    options.Columns = {ExportColumn::Id, ExportColumn::ProviderId,
+                       ExportColumn::ProviderName, ExportColumn::Message};
+
+    EXPECT_EQ("{\"Id\":1,\"ProviderId\":\"{6D35524C-C587-476A-92D3-F333D223BDCF}\","
+              "\"ProviderName\":\"Provider\","
+              "\"Message\":\"Line\\nbreak \\\\ \\\"quoted\\\" \\u0001 \xC3\xA9\"}\n"
+              "{\"Id\":2,\"ProviderId\":\"{6D35524C-C587-476A-92D3-F333D223BDCF}\","
+              "\"ProviderName\":null,\"Message\":null}\n",
+              Export(options, log));
+}
+
+TEST(TraceLogExporterTest, ExportsInOrder)
+{
+    TestSchema const schema(L"Provider", L"Hello");
+
+    TestTraceLog log;
+    size_t const eventCount = 1000;
+    for (size_t i = 0; i < eventCount; ++i) {
+        EVENT_RECORD const record =
+            MakeRecord(static_cast<USHORT>(i), static_cast<ULONG>(i * 7));
+        if (i % 2 == 0)
+            log.Add(record, schema.Info(), schema.Size());
+        else
+            log.Add(record);
+    }
+
+    TraceLogExportOptions options;
+    options.Format = ExportFormat::JsonLines;
+    options.Columns = {ExportColumn::Id, ExportColumn::ProcessId, ExportColumn::Message};
+    options.ThreadCount = 3;
+    options.ChunkSize = 7;
+    options.BufferSize = 100;
+
+    std::string expected;
+    for (size_t i = 0; i < eventCount; ++i) {
+        expected += "{\"Id\":" + std::to_string(i) +
+                    ",\"ProcessId\":" + std::to_string(i * 7) +
+                    (i % 2 == 0 ? ",\"Message\":\"Hello\"}\n" : ",\"Message\":null}\n");
+    }
+
+    struct Progress
+    {
+        size_t Calls = 0;
+        size_t Exported = 0;
+    } progress;
+
+    std::string output;
+    TraceLogExporter exporter(options);
+    exporter.SetProgressCallback(
+        [](size_t exported, size_t total, void* state) {
+            auto& progress = *static_cast<Progress*>(state);
+            EXPECT_EQ(1000u, total);
+            EXPECT_GT(exported, progress.Exported);
+            progress.Exported = exported;
+            ++progress.Calls;
+        },
+        &progress);
+
+    ASSERT_EQ(S_OK, exporter.Export(log, AppendOutput, &output));
+    EXPECT_EQ(expected, output);
+    EXPECT_EQ(eventCount, progress.Exported);
+    // Rounds of 3 workers * 4 chunks * 7 events.
+    EXPECT_EQ((eventCount + 83) / 84, progress.Calls);
+
+    TraceLogExportStatistics const statistics = exporter.GetStatistics();
+    EXPECT_EQ(eventCount, statistics.ExportedEvents);
+    EXPECT_EQ(expected.size(), statistics.WrittenBytes);
+
+    // The exporter can be reused.
+    progress = Progress();
+    output.clear();
+    ASSERT_EQ(S_OK, exporter.Export(log, AppendOutput, &output));
+    EXPECT_EQ(expected, output);
+}
+
+TEST(TraceLogExporterTest, Abort)
+{
+    TestTraceLog log;
+    for (USHORT i = 0; i < 100; ++i)
+        log.Add(MakeRecord(i, 0));
+
+    TraceLogExportOptions options;
+    options.Columns = {ExportColumn::Id};
+    options.ThreadCount = 1;
+    options.ChunkSize = 1;
+    options.BufferSize = 16;
+
+    size_t writes = 0;
+    TraceLogExporter exporter(options);
+    auto const write = [](void const*, size_t, void* state) {
+        return ++*static_cast<size_t*>(state) < 3;
+    };
+    HRESULT const hr = exporter.Export(log, write, &writes);
+
+    EXPECT_EQ(E_ABORT, hr);
+    EXPECT_EQ(3u, writes);
+}
+
+} // namespace etk::tests
@@ -0,0 +1,188 @@
+#include "etk/TraceLogRowWindow.h"
+
+#include "etk/CompiledSchema.h"
+#include "etk/FormattedMessageCache.h"
+
+#include "TestSupport.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+TEST(TraceLogRowWindowTest, RequestedColumns)
+{
+    TestSchema const schema(L"My-Provider", L"Hello");
+
+    TestTraceLog log;
+    for (USHORT i = 0; i < 10; ++i) {
+        // Timestamps are signed.
+        EVENT_RECORD record = MakeRecord(i);
+        record.EventHeader.TimeStamp.QuadPart = -1000 - i;
+        if (i % 2 == 0)
+            log.Add(record, schema.Info(), schema.Size());
+        else
+            log.Add(record);
+    }
+
+    ExportColumn const columns[] = {ExportColumn::TimeStamp, ExportColumn::ProviderId,
+                                    ExportColumn::ProviderName, ExportColumn::Id,
+                                    ExportColumn::Message};
+
+    TraceLogRowWindow window;
+    window.Update(log, 3, 4, columns);
+    ASSERT_EQ(3u, window.GetFirstRow());
+    ASSERT_EQ(4u, window.GetRowCount());
+    ASSERT_EQ(5u, window.GetColumnCount());
+    EXPECT_EQ(ExportColumn::ProviderName, window.GetColumn(2));
+
+    EXPECT_EQ(-1003, static_cast<int64_t>(window.GetNumber(0, 0)));
+    EXPECT_EQ(0, std::memcmp(&TestProviderId, &window.GetGuid(1, 1), sizeof(GUID)));
+    EXPECT_EQ(6u, window.GetNumber(3, 3));
+
+    EXPECT_FALSE(window.HasText(0, 2));
+    EXPECT_TRUE(window.HasText(1, 2));
+    EXPECT_EQ(L"My-Provider", window.GetText(1, 2));
+    EXPECT_EQ(L"Hello", window.GetText(1, 4));
+    EXPECT_EQ(L"Hello", window.GetText(3, 4));
+    EXPECT_FALSE(window.HasText(2, 4));
+    EXPECT_EQ(L"", window.GetText(2, 4));
+    EXPECT_EQ(2u, window.GetFormattedMessageCount());
+}
+
+TEST(TraceLogRowWindowTest, HiddenMessagesAreNotFormatted)
+{
+    TestSchema const schema(L"Provider", L"Message");
+
+    TestTraceLog log;
+    for (USHORT i = 0; i < 5; ++i)
+        log.Add(MakeRecord(i), schema.Info(), schema.Size());
+
+    ExportColumn const withMessage[] = {ExportColumn::Id, ExportColumn::Message};
+    ExportColumn const withoutMessage[] = {ExportColumn::Id, ExportColumn::ProviderName};
+
+    TraceLogRowWindow window;
+    window.Update(log, 0, 5, withMessage);
+    EXPECT_EQ(5u, window.GetFormattedMessageCount());
+
+    window.Update(log, 0, 5, withoutMessage);
+    EXPECT_EQ(0u, window.GetFormattedMessageCount());
+    EXPECT_EQ(4u, window.GetNumber(4, 0));
+    EXPECT_EQ(L"Provider", window.GetText(4, 1));
+
+    // Ranges are clamped to the trace log.
+    window.Update(log, 3, 100, withoutMessage);
+    EXPECT_EQ(2u, window.GetRowCount());
+    window.Update(log, 8, 1, withoutMessage);
+    EXPECT_EQ(5u, window.GetFirstRow());
+    EXPECT_EQ(0u, window.GetRowCount());
+}
+
+TEST(TraceLogRowWindowTest, MessagesUseCompiledSchemas)
+{
+    TestSchema const schema(L"Provider", L"Parsed");
+    TestSchema const cached(L"Provider", L"Cached");
+    CompiledSchema const compiled(EventInfo(nullptr, cached.Info(), cached.Size()));
+
+    TestTraceLog log;
+    log.Add(MakeRecord(1), schema.Info(), schema.Size(), &compiled);
+    log.Add(MakeRecord(2), schema.Info(), schema.Size());
+
+    ExportColumn const columns[] = {ExportColumn::Message};
+
+    // The message of the compiled schema is used instead of parsing the one
+    // of the schema.
+    TraceLogRowWindow window;
+    window.Update(log, 0, 2, columns);
+    EXPECT_EQ(L"Cached", window.GetText(0, 0));
+    EXPECT_EQ(L"Parsed", window.GetText(1, 0));
+}
+
+TEST(TraceLogRowWindowTest, MessagesUseMessageCache)
+{
+    TestSchema const schema(L"Provider", L"Formatted");
+
+    TestTraceLog log;
+    log.Add(MakeRecord(1), schema.Info(), schema.Size());
+    log.Add(MakeRecord(2), schema.Info(), schema.Size());
+
+    FormattedMessageCache cache;
+    auto const key = [&](size_t index) {
+        return FormattedMessageCache::MakeSequence(log.GetClearCount(), index);
+    };
+    cache.Add(key(0), L"Cached", cache.GetGeneration());
+
+    ExportColumn const columns[] = {ExportColumn::Message};
+
+    TraceLogRowWindow window;
+    window.SetMessageCache(&cache, &log);
+    window.Update(log, 0, 2, columns);
+    EXPECT_EQ(L"Cached", window.GetText(0, 0));
+    EXPECT_EQ(L"Formatted", window.GetText(1, 0));
+    EXPECT_EQ(1u, window.GetFormattedMessageCount());
+
+    // Formatted messages are added to the cache.
+    std::wstring message;
+    ASSERT_TRUE(cache.TryGet(key(1), message));
+    EXPECT_EQ(L"Formatted", message);
+
+    window.Update(log, 0, 2, columns);
+    EXPECT_EQ(L"Formatted", window.GetText(1, 0));
+    EXPECT_EQ(0u, window.GetFormattedMessageCount());
+}
+
+TEST(TraceLogRowWindowTest, ClearedMessagesAreNotReused)
+{
+    TestSchema const before(L"Provider", L"Before");
+    TestSchema const after(L"Provider", L"After");
+
+    TestTraceLog log;
+    log.Add(MakeRecord(1), before.Info(), before.Size());
+
+    FormattedMessageCache cache;
+    ExportColumn const columns[] = {ExportColumn::Message};
+
+    TraceLogRowWindow window;
+    window.SetMessageCache(&cache, &log);
+    window.Update(log, 0, 1, columns);
+    EXPECT_EQ(L"Before", window.GetText(0, 0));
+
+    // The new event takes the index of the cleared one, and possibly its
+    // record address, but not its message, even before the cache is cleared.
+    log.Clear();
+    log.Add(MakeRecord(1), after.Info(), after.Size());
+    window.Update(log, 0, 1, columns);
+    EXPECT_EQ(L"After", window.GetText(0, 0));
+    EXPECT_EQ(1u, window.GetFormattedMessageCount());
+}
+
+TEST(TraceLogRowWindowTest, AddColumnDecodesOnlyThatColumn)
+{
+    TestSchema const schema(L"Provider", L"Message");
+
+    TestTraceLog log;
+    for (USHORT i = 0; i < 4; ++i)
+        log.Add(MakeRecord(i), schema.Info(), schema.Size());
+
+    ExportColumn const columns[] = {ExportColumn::Message, ExportColumn::ProviderName};
+
+    TraceLogRowWindow window;
+    window.Update(log, 1, 2, columns);
+    EXPECT_EQ(2u, window.GetFormattedMessageCount());
+
+    window.AddColumn(ExportColumn::Id);
+    ASSERT_EQ(3u, window.GetColumnCount());
+    EXPECT_EQ(ExportColumn::Id, window.GetColumn(2));
+    EXPECT_EQ(0u, window.GetFormattedMessageCount());
+    EXPECT_EQ(2u, window.GetNumber(1, 2));
+
+    // Cells of the other columns are kept.
+    EXPECT_EQ(L"Message", window.GetText(0, 0));
+    EXPECT_EQ(L"Provider", window.GetText(1, 1));
+}
+
+} // namespace etk::tests
@@ -0,0 +1,331 @@
+#include "etk/TraceLoggingMetadata.h"
+
+#include "etk/EventInfo.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+// Builds metadata blobs byte by byte, the way TraceLoggingWrite lays them out.
+class MetadataBlob
+{
+public:
+    MetadataBlob& Bytes(std::initializer_list<uint8_t> values)
+    {
+        for (uint8_t value : values)
+            data.push_back(std::byte(value));
+        return *this;
+    }
+
+    MetadataBlob& String(char const* str)
+    {
+        for (; *str; ++str)
+            data.push_back(std::byte(*str));
+        data.push_back(std::byte(0));
+        return *this;
+    }
+
+    std::vector<std::byte> Finish() const
+    {
+        std::vector<std::byte> blob(2);
+        uint16_t const size = static_cast<uint16_t>(data.size() + 2);
+        std::memcpy(blob.data(), &size, sizeof(size));
+        blob.insert(blob.end(), data.begin(), data.end());
+        return blob;
+    }
+
+private:
+    std::vector<std::byte> data;
+};
+
+std::wstring GetName(EventInfo const& info, ULONG offset)
+{
+    wchar_t const* name = info.GetStringAt(offset);
+    return name ? name : L"<invalid>";
+}
+
+} // namespace
+
+TEST(TraceLoggingMetadataTest, ScalarFields)
+{
+    // TraceLoggingWrite(provider, "Opened",
+    //                   TraceLoggingInt32(status, "Status"),
+    //                   TraceLoggingWideString(path, "Path"),
+    //                   TraceLoggingHexUInt32(flags, "Flags"))
+    auto const blob = MetadataBlob()
+                          .Bytes({0x00})
+                          .String("Opened")
+                          .String("Status")
+                          .Bytes({0x07})
+                          .String("Path")
+                          .Bytes({0x01})
+                          .String("Flags")
+                          .Bytes({0x88, 4 /* TlgOutHEX */})
+                          .Finish();
+
+    TraceLoggingEventMetadata event;
+    ASSERT_TRUE(ParseTraceLoggingEventMetadata(blob, event));
+    EXPECT_EQ("Opened", event.Name);
+    EXPECT_EQ(0u, event.Tags);
+    ASSERT_EQ(3u, event.Fields.size());
+    EXPECT_EQ("Status", event.Fields[0].Name);
+    EXPECT_EQ(TDH_INTYPE_INT32, event.Fields[0].InType);
+    EXPECT_EQ("Path", event.Fields[1].Name);
+    EXPECT_EQ(TDH_INTYPE_UNICODESTRING, event.Fields[1].InType);
+    EXPECT_EQ(TDH_INTYPE_UINT32, event.Fields[2].InType);
+    EXPECT_EQ(TDH_OUTTYPE_HEXINT32, event.Fields[2].OutType);
+
+    EVENT_HEADER header = {};
+    header.EventDescriptor.Id = 7;
+    auto const [infoPtr, infoSize] =
+        CreateTraceLoggingEventInfo(header, event, "MyProvider");
+    ASSERT_NE(nullptr, infoPtr);
+
+    EventInfo const info(nullptr, infoPtr.get(), infoSize);
+    EXPECT_EQ(DecodingSourceTlg, info->DecodingSource);
+    EXPECT_EQ(7, info->EventDescriptor.Id);
+    EXPECT_EQ(L"MyProvider", GetName(info, info->ProviderNameOffset));
+    EXPECT_EQ(L"Opened", GetName(info, info->TaskNameOffset));
+    ASSERT_EQ(3u, info->PropertyCount);
+    ASSERT_EQ(3u, info->TopLevelPropertyCount);
+
+    auto const& status = info->EventPropertyInfoArray[0];
+    EXPECT_EQ(L"Status", GetName(info, status.NameOffset));
+    EXPECT_EQ(TDH_INTYPE_INT32, status.nonStructType.InType);
+    EXPECT_EQ(4, status.length);
+    EXPECT_EQ(1, status.count);
+
+    auto const& path = info->EventPropertyInfoArray[1];
+    EXPECT_EQ(L"Path", GetName(info, path.NameOffset));
+    EXPECT_EQ(0, path.length);
+
+    auto const& flags = info->EventPropertyInfoArray[2];
+    EXPECT_EQ(L"Flags", GetName(info, flags.NameOffset));
+    EXPECT_EQ(TDH_OUTTYPE_HEXINT32, flags.nonStructType.OutType);
+}
+
+TEST(TraceLoggingMetadataTest, Tags)
+{
+    auto const blob = MetadataBlob()
+                          .Bytes({0x81, 0x02})
+                          .String("Tagged")
+                          .String("Value")
+                          .Bytes({0x88, 0x80 | 4 /* TlgOutHEX */, 0x80, 0x05})
+                          .Finish();
+
+    TraceLoggingEventMetadata event;
+    ASSERT_TRUE(ParseTraceLoggingEventMetadata(blob, event));
+    EXPECT_EQ((1u << 21) | (2u << 14), event.Tags);
+    ASSERT_EQ(1u, event.Fields.size());
+    EXPECT_EQ(5u << 14, event.Fields[0].Tags);
+    EXPECT_EQ(TDH_OUTTYPE_HEXINT32, event.Fields[0].OutType);
+
+    auto const [info, size] = CreateTraceLoggingEventInfo(EVENT_HEADER(), event);
+    ASSERT_NE(nullptr, info);
+    EXPECT_EQ(event.Tags, info->Tags);
+    EXPECT_NE(0, info->EventPropertyInfoArray[0].Flags & PropertyHasTags);
+    EXPECT_EQ(5u << 14, info->EventPropertyInfoArray[0].Tags);
+}
+
+TEST(TraceLoggingMetadataTest, OutTypes)
+{
+    // TraceLogging out-types are mapped to TDH_OUTTYPE, and HEX, SIGNED and
+    // UNSIGNED depend on the in-type.
+    auto const blob = MetadataBlob()
+                          .Bytes({0x00})
+                          .String("OutTypes")
+                          .String("Char")
+                          .Bytes({0x80 | 0x03, 2 /* TlgOutSTRING */})
+                          .String("Pid")
+                          .Bytes({0x80 | 0x08, 5 /* TlgOutPID */})
+                          .String("Address")
+                          .Bytes({0x80 | 0x08, 8 /* TlgOutIPV4 */})
+                          .String("Result")
+                          .Bytes({0x80 | 0x07, 15 /* TlgOutHRESULT */})
+                          .String("Hex8")
+                          .Bytes({0x80 | 0x04, 4 /* TlgOutHEX */})
+                          .String("Hex64")
+                          .Bytes({0x80 | 0x0A, 4 /* TlgOutHEX */})
+                          .String("HexBlob")
+                          .Bytes({0x80 | 0x0E, 4 /* TlgOutHEX */})
+                          .String("Signed")
+                          .Bytes({0x80 | 0x06, 17 /* TlgOutSIGNED */})
+                          .String("Text")
+                          .Bytes({0x80 | 0x02, 35 /* TlgOutUTF8 */})
+                          .String("Unknown")
+                          .Bytes({0x80 | 0x08, 0x7F})
+                          .Finish();
+
+    TraceLoggingEventMetadata event;
+    ASSERT_TRUE(ParseTraceLoggingEventMetadata(blob, event));
+    ASSERT_EQ(10u, event.Fields.size());
+    EXPECT_EQ(TDH_OUTTYPE_STRING, event.Fields[0].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_PID, event.Fields[1].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_IPV4, event.Fields[2].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_HRESULT, event.Fields[3].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_HEXINT8, event.Fields[4].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_HEXINT64, event.Fields[5].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_HEXBINARY, event.Fields[6].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_SHORT, event.Fields[7].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_UTF8, event.Fields[8].OutType);
+    EXPECT_EQ(TDH_OUTTYPE_NULL, event.Fields[9].OutType);
+}
+
+TEST(TraceLoggingMetadataTest, Arrays)
+{
+    auto const blob = MetadataBlob()
+                          .Bytes({0x00})
+                          .String("Arrays")
+                          .String("Fixed")
+                          .Bytes({0x20 | 0x06, 0x03, 0x00})
+                          .String("Variable")
+                          .Bytes({0x40 | 0x02})
+                          .String("Blob")
+                          .Bytes({0x0E})
+                          .Finish();
+
+    TraceLoggingEventMetadata event;
+    ASSERT_TRUE(ParseTraceLoggingEventMetadata(blob, event));
+    ASSERT_EQ(3u, event.Fields.size());
+    EXPECT_EQ(TraceLoggingArrayKind::Fixed, event.Fields[0].Array);
+    EXPECT_EQ(3, event.Fields[0].Count);
+    EXPECT_EQ(TraceLoggingArrayKind::Variable, event.Fields[1].Array);
+    EXPECT_EQ(TDH_INTYPE_ANSISTRING, event.Fields[1].InType);
+    EXPECT_EQ(TDH_INTYPE_MANIFEST_COUNTEDBINARY, event.Fields[2].InType);
+
+    auto const [info, size] = CreateTraceLoggingEventInfo(EVENT_HEADER(), event);
+    ASSERT_NE(nullptr, info);
+
+    auto const& fixed = info->EventPropertyInfoArray[0];
+    EXPECT_EQ(PropertyParamFixedCount, fixed.Flags);
+    EXPECT_EQ(3, fixed.count);
+
+    auto const& variable = info->EventPropertyInfoArray[1];
+    EXPECT_EQ(PropertyParamCount, variable.Flags);
+    EXPECT_EQ(1, variable.countPropertyIndex);
+}
+
+TEST(TraceLoggingMetadataTest, NestedStructs)
+{
+    // TraceLoggingWrite(provider, "Nested",
+    //     TraceLoggingStruct(2, "Outer"),
+    //         TraceLoggingUInt8(a, "A"),
+    //         TraceLoggingStruct(1, "Inner"),
+    //             TraceLoggingGuid(id, "Id"),
+    //     TraceLoggingUInt64(b, "B"))
+    auto const blob = MetadataBlob()
+                          .Bytes({0x00})
+                          .String("Nested")
+                          .String("Outer")
+                          .Bytes({0x80 | 24, 2})
+                          .String("A")
+                          .Bytes({0x04})
+                          .String("Inner")
+                          .Bytes({0x80 | 24, 1})
+                          .String("Id")
+                          .Bytes({0x0F})
+                          .String("B")
+                          .Bytes({0x0A})
+                          .Finish();
+
+    TraceLoggingEventMetadata event;
+    ASSERT_TRUE(ParseTraceLoggingEventMetadata(blob, event));
+    ASSERT_EQ(5u, event.Fields.size());
+    EXPECT_TRUE(event.Fields[0].IsStruct);
+    EXPECT_EQ(2, event.Fields[0].MemberCount);
+    EXPECT_TRUE(event.Fields[2].IsStruct);
+
+    auto const [infoPtr, infoSize] = CreateTraceLoggingEventInfo(EVENT_HEADER(), event);
+    ASSERT_NE(nullptr, infoPtr);
+    EventInfo const info(nullptr, infoPtr.get(), infoSize);
+
+    ASSERT_EQ(5u, info->PropertyCount);
+    ASSERT_EQ(2u, info->TopLevelPropertyCount);
+
+    auto const& outer = info->EventPropertyInfoArray[0];
+    EXPECT_EQ(L"Outer", GetName(info, outer.NameOffset));
+    EXPECT_EQ(PropertyStruct, outer.Flags);
+    ASSERT_EQ(2, outer.structType.StructStartIndex);
+    ASSERT_EQ(2, outer.structType.NumOfStructMembers);
+
+    EXPECT_EQ(L"B", GetName(info, info->EventPropertyInfoArray[1].NameOffset));
+    EXPECT_EQ(L"A", GetName(info, info->EventPropertyInfoArray[2].NameOffset));
+
+    auto const& inner = info->EventPropertyInfoArray[3];
+    EXPECT_EQ(L"Inner", GetName(info, inner.NameOffset));
+    ASSERT_EQ(4, inner.structType.StructStartIndex);
+    ASSERT_EQ(1, inner.structType.NumOfStructMembers);
+
+    auto const& id = info->EventPropertyInfoArray[4];
+    EXPECT_EQ(L"Id", GetName(info, id.NameOffset));
+    EXPECT_EQ(TDH_INTYPE_GUID, id.nonStructType.InType);
+    EXPECT_EQ(16, id.length);
+}
+
+TEST(TraceLoggingMetadataTest, Utf8Names)
+{
+    auto const blob =
+        MetadataBlob().Bytes({0x00}).String("Gr\xC3\xBC\xC3\x9F" "e").Finish();
+
+    TraceLoggingEventMetadata event;
+    ASSERT_TRUE(ParseTraceLoggingEventMetadata(blob, event));
+
+    auto const [infoPtr, infoSize] = CreateTraceLoggingEventInfo(EVENT_HEADER(), event);
+    EventInfo const info(nullptr, infoPtr.get(), infoSize);
+    EXPECT_EQ(L"Gr\u00FC\u00DFe", GetName(info, info->TaskNameOffset));
+    EXPECT_EQ(0u, info->PropertyCount);
+}
+
+TEST(TraceLoggingMetadataTest, RejectsMalformedMetadata)
+{
+    TraceLoggingEventMetadata event;
+
+    // Size exceeds the blob.
+    std::vector<std::byte> blob = MetadataBlob().Bytes({0x00}).String("E").Finish();
+    blob[0] = std::byte(0x40);
+    EXPECT_FALSE(ParseTraceLoggingEventMetadata(blob, event));
+
+    // Unterminated field name.
+    blob = MetadataBlob().Bytes({0x00}).String("E").Bytes({'F'}).Finish();
+    EXPECT_FALSE(ParseTraceLoggingEventMetadata(blob, event));
+
+    // Missing struct members.
+    blob = MetadataBlob()
+               .Bytes({0x00})
+               .String("E")
+               .String("S")
+               .Bytes({0x80 | 24, 2})
+               .String("A")
+               .Bytes({0x04})
+               .Finish();
+    EXPECT_FALSE(ParseTraceLoggingEventMetadata(blob, event));
+
+    // Custom-schema fields are not supported.
+    blob = MetadataBlob().Bytes({0x00}).String("E").String("C").Bytes({0x6E}).Finish();
+    EXPECT_FALSE(ParseTraceLoggingEventMetadata(blob, event));
+
+    // Unknown field type.
+    blob = MetadataBlob().Bytes({0x00}).String("E").String("X").Bytes({0x1F}).Finish();
+    EXPECT_FALSE(ParseTraceLoggingEventMetadata(blob, event));
+}
+
+TEST(TraceLoggingMetadataTest, ProviderName)
+{
+    auto const traits =
+        MetadataBlob().String("My.Provider").Bytes({0x05, 0x00, 0x01}).Finish();
+
+    std::string name;
+    ASSERT_TRUE(ParseTraceLoggingProviderName(traits, name));
+    EXPECT_EQ("My.Provider", name);
+}
+
+} // namespace etk::tests
@@ -0,0 +1,166 @@
+#include "etk/ValueMap.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace etk::tests
+{
+
+namespace
+{
+
+GUID const ProviderId = {
+    0x5F0C1E2D, 0xAAAA, 0xBBBB, {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80}};
+
+class TestMap
+{
+public:
+    explicit TestMap(ULONG flags)
+        : flags(flags)
+    {}
+
+    TestMap& Add(ULONG value, std::wstring name)
+    {
+        entries.emplace_back(value, std::move(name));
+        return *this;
+    }
+
+    ValueMap Build(bool removeTrailingSpace = false)
+    {
+        size_t const headerSize = offsetof(EVENT_MAP_INFO, MapEntryArray) +
+                                  entries.size() * sizeof(EVENT_MAP_ENTRY);
+
+        size_t size = headerSize;
+        for (auto const& entry : entries)
+            size += (entry.second.size() + 1) * sizeof(wchar_t);
+
+        std::vector<uint64_t> buffer((size + 7) / 8);
+        auto const info = reinterpret_cast<EVENT_MAP_INFO*>(buffer.data());
+        info->Flag = static_cast<MAP_FLAGS>(flags);
+        info->EntryCount = static_cast<ULONG>(entries.size());
+
+        size_t offset = headerSize;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            info->MapEntryArray[i].Value = entries[i].first;
+            info->MapEntryArray[i].OutputOffset = static_cast<ULONG>(offset);
+
+            size_t const nameSize = (entries[i].second.size() + 1) * sizeof(wchar_t);
+            std::memcpy(reinterpret_cast<std::byte*>(info) + offset,
+                        entries[i].second.c_str(), nameSize);
+            offset += nameSize;
+        }
+
+        return ValueMap(info, size, removeTrailingSpace);
+    }
+
+private:
+    ULONG flags;
+    std::vector<std::pair<ULONG, std::wstring>> entries;
+};
+
+std::wstring Format(ValueMap const& map, uint32_t value)
+{
+    std::wstring sink = L"<";
+    if (!map.Format(value, sink))
+        return L"(unmapped)";
+    return sink.substr(1);
+}
+
+} // namespace
+
+TEST(ValueMapTest, Values)
+{
+    auto const map = TestMap(EVENTMAP_INFO_FLAG_MANIFEST_VALUEMAP)
+                         .Add(10, L"Ten ")
+                         .Add(1, L"One ")
+                         .Add(5, L"Five ")
+                         .Add(1, L"Uno ")
+                         .Build(true);
+
+    EXPECT_EQ(L"One", Format(map, 1));
+    EXPECT_EQ(L"Five", Format(map, 5));
+    EXPECT_EQ(L"Ten", Format(map, 10));
+    EXPECT_EQ(L"(unmapped)", Format(map, 0));
+    EXPECT_EQ(L"(unmapped)", Format(map, 7));
+    EXPECT_EQ(L"(unmapped)", Format(map, 11));
+
+    // The copy passed to TDH has its trailing spaces removed.
+    EVENT_MAP_INFO const* info = map.Info();
+    auto const name = reinterpret_cast<wchar_t const*>(
+        reinterpret_cast<std::byte const*>(info) + info->MapEntryArray[0].OutputOffset);
+    EXPECT_STREQ(L"Ten", name);
+}
+
+TEST(ValueMapTest, SingleBits)
+{
+    auto const map = TestMap(EVENTMAP_INFO_FLAG_MANIFEST_BITMAP)
+                         .Add(0x1, L"Read")
+                         .Add(0x4, L"Execute")
+                         .Add(0x2, L"Write")
+                         .Build();
+
+    EXPECT_EQ(L"Read", Format(map, 0x1));
+    EXPECT_EQ(L"Read | Write | Execute", Format(map, 0x7));
+    EXPECT_EQ(L"Write | Execute", Format(map, 0x6));
+
+    // Zero and unmapped bits are left to TDH, the sink is unchanged.
+    EXPECT_EQ(L"(unmapped)", Format(map, 0));
+    EXPECT_EQ(L"(unmapped)", Format(map, 0x9));
+
+    std::wstring sink = L"x";
+    EXPECT_FALSE(map.Format(0x80000001, sink));
+    EXPECT_EQ(L"x", sink);
+}
+
+TEST(ValueMapTest, MultipleBits)
+{
+    auto const map = TestMap(EVENTMAP_INFO_FLAG_MANIFEST_BITMAP)
+                         .Add(0x3, L"ReadWrite")
+                         .Add(0x4, L"Execute")
+                         .Add(0x10, L"Other")
+                         .Build();
+
+    EXPECT_EQ(L"ReadWrite | Execute", Format(map, 0x7));
+    EXPECT_EQ(L"Execute | Other", Format(map, 0x14));
+    EXPECT_EQ(L"(unmapped)", Format(map, 0x1));
+}
+
+TEST(ValueMapTest, Unsupported)
+{
+    auto const patternMap =
+        TestMap(EVENTMAP_INFO_FLAG_MANIFEST_PATTERNMAP).Add(1, L"One").Build();
+    EXPECT_EQ(L"(unmapped)", Format(patternMap, 1));
+    EXPECT_NE(nullptr, patternMap.Info());
+
+    auto const flagMap = TestMap(EVENTMAP_INFO_FLAG_WBEM_VALUEMAP |
+                                 EVENTMAP_INFO_FLAG_WBEM_FLAG)
+                             .Add(1, L"One")
+                             .Build();
+    EXPECT_EQ(L"(unmapped)", Format(flagMap, 1));
+}
+
+TEST(ValueMapTest, Cache)
+{
+    GUID otherProviderId = ProviderId;
+    otherProviderId.Data1 += 1;
+
+    ValueMapCache cache;
+    EXPECT_EQ(nullptr, cache.Find(ProviderId, L"Map"));
+
+    std::wstring name = L"Map";
+    ValueMap const* map =
+        cache.Add(ProviderId, name,
+                  TestMap(EVENTMAP_INFO_FLAG_MANIFEST_VALUEMAP).Add(1, L"A").Build());
+    name = L"Overwritten";
+
+    EXPECT_EQ(map, cache.Find(ProviderId, L"Map"));
+    EXPECT_EQ(nullptr, cache.Find(ProviderId, L"Other"));
+    EXPECT_EQ(nullptr, cache.Find(otherProviderId, L"Map"));
+    EXPECT_EQ(L"A", Format(*map, 1));
+}
+
+} // namespace etk::tests
@@ -0,0 +1,500 @@
+#pragma once
+#include "etk/Support/CompilerSupport.h"
+#include "etk/Support/Debug.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/hash/hash.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace etk
+{
+
+/// <summary>
+///   A hash map that supports concurrent lookups, insertions and removals.
+///   Lookups of existing keys are lock-free. Modifications lock one of
+///   <typeparamref name="ShardCount"/> shards.
+/// </summary>
+/// <remarks>
+///   Entries are never moved. Apart from <see cref="Erase"/>, entries are not
+///   freed individually, so references returned by <see cref="Find"/>,
+///   <see cref="GetOrCreate"/> and <see cref="GetOrUpdate"/> stay valid until
+///   the map is cleared twice or destroyed, even if the entry has been
+///   replaced meanwhile. This lets lookups that race with <see cref="Clear"/>
+///   or <see cref="GetOrUpdate"/> complete safely. Erased entries are freed
+///   once no <see cref="ReadGuard"/> created before the removal is alive, so
+///   lookups that may race with <see cref="Erase"/> have to hold one while
+///   they use the entry.
+/// </remarks>
+template<typename K, typename V, typename Hash = absl::Hash<K>, size_t ShardCount = 16>
+class ConcurrentHashMap
+{
+    static_assert((ShardCount & (ShardCount - 1)) == 0,
+                  "ShardCount must be a power of 2");
+
+    struct Shard;
+
+public:
+    ConcurrentHashMap() = default;
+    ConcurrentHashMap(ConcurrentHashMap const&) = delete;
+    ConcurrentHashMap& operator=(ConcurrentHashMap const&) = delete;
+
+    /// <summary>
+    ///   Keeps the entry found by <see cref="Find(K const&amp;, ReadGuard&amp;)"/>
+    ///   allocated while the guard is alive, even if it is erased meanwhile.
+    ///   Guards are meant to be short-lived, since they delay freeing all
+    ///   entries erased from the same shard.
+    /// </summary>
+    class ReadGuard
+    {
+    public:
+        ReadGuard() = default;
+        ReadGuard(ReadGuard const&) = delete;
+        ReadGuard& operator=(ReadGuard const&) = delete;
+
+        ~ReadGuard()
+        {
+            if (readers)
+                readers->fetch_sub(1, std::memory_order_release);
+        }
+
+    private:
+        friend class ConcurrentHashMap;
+
+        void Enter(Shard const& shard)
+        {
+            ETK_ASSERT_MSG(!readers, "ReadGuard is already in use");
+            for (;;) {
+                uint64_t const epoch = shard.Epoch.load();
+                readers = &shard.EpochReaders[epoch % EpochCount];
+                readers->fetch_add(1);
+                if (shard.Epoch.load() == epoch)
+                    return;
+                readers->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        std::atomic<size_t>* readers = nullptr;
+    };
+
+    /// <summary>
+    ///   Returns the value for <paramref name="key"/>, or <c>nullptr</c> if the
+    ///   key is not present.
+    /// </summary>
+    V const* Find(K const& key) const
+    {
+        ReadGuard guard;
+        return Find(key, guard);
+    }
+
+    /// <summary>
+    ///   Like <see cref="Find(K const&amp;)"/>, but the returned value stays
+    ///   valid while <paramref name="guard"/> is alive, even if the entry is
+    ///   erased concurrently. The guard must not have been used before.
+    /// </summary>
+    V const* Find(K const& key, ReadGuard& guard) const
+    {
+        size_t const hash = Hash()(key);
+        Shard const& shard = GetShard(hash);
+        guard.Enter(shard);
+        Node const* node = shard.Find(hash, key);
+        return node ? &node->Value : nullptr;
+    }
+
+    /// <summary>
+    ///   Returns the value for <paramref name="key"/>. If the key is not present,
+    ///   <paramref name="factory"/> is invoked with the shard locked and must
+    ///   return the key to store (comparing equal to <paramref name="key"/>)
+    ///   and its value. The stored key may differ from the lookup key in
+    ///   ownership, e.g. a copy of borrowed data.
+    /// </summary>
+    template<typename Factory>
+    V const& GetOrCreate(K const& key, Factory&& factory)
+    {
+        size_t const hash = Hash()(key);
+        Shard& shard = GetShard(hash);
+        {
+            ReadGuard guard;
+            guard.Enter(shard);
+            if (Node const* node = shard.Find(hash, key))
+                return node->Value;
+        }
+
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        if (Node const* node = shard.Find(hash, key))
+            return node->Value;
+
+        auto [storedKey, value] = factory(key);
+        return shard.Insert(hash, std::move(storedKey), std::move(value))->Value;
+    }
+
+    /// <summary>
+    ///   Like <see cref="GetOrCreate"/>, but also replaces an existing value for
+    ///   which <paramref name="isCurrent"/> returns false. The
+    ///   <paramref name="factory"/> is invoked with the shard locked and
+    ///   receives the key and the value to replace, or <c>nullptr</c>. It may
+    ///   return an empty optional to keep the existing value, e.g. after
+    ///   refreshing atomic members of it in place, which avoids retaining a
+    ///   replaced node.
+    /// </summary>
+    template<typename IsCurrent, typename Factory>
+    V const& GetOrUpdate(K const& key, IsCurrent&& isCurrent, Factory&& factory)
+    {
+        size_t const hash = Hash()(key);
+        Shard& shard = GetShard(hash);
+        {
+            ReadGuard guard;
+            guard.Enter(shard);
+            Node const* node = shard.Find(hash, key);
+            if (node && isCurrent(node->Value))
+                return node->Value;
+        }
+
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        Node const* node = shard.Find(hash, key);
+        if (node && isCurrent(node->Value))
+            return node->Value;
+
+        std::optional<std::pair<K, V>> result =
+            factory(key, node ? &node->Value : nullptr);
+        if (!result) {
+            ETK_ASSERT_MSG(node, "Only existing values can be kept");
+            return node->Value;
+        }
+
+        auto& [storedKey, value] = *result;
+        if (node)
+            return shard.Replace(node, std::move(storedKey), std::move(value))->Value;
+        return shard.Insert(hash, std::move(storedKey), std::move(value))->Value;
+    }
+
+    /// <summary>
+    ///   Invokes <paramref name="callback"/> with the key and value of each
+    ///   entry. Each shard is locked while its entries are visited, so the
+    ///   callback must not modify the map.
+    /// </summary>
+    template<typename Callback>
+    void ForEach(Callback&& callback)
+    {
+        for (Shard& shard : shards)
+            shard.ForEach(callback);
+    }
+
+    /// <summary>
+    ///   Removes the entry for <paramref name="key"/>. Concurrent lookups either
+    ///   find the entry or not. It is freed once all read guards that may
+    ///   refer to it are gone.
+    /// </summary>
+    bool Erase(K const& key)
+    {
+        size_t const hash = Hash()(key);
+        Shard& shard = GetShard(hash);
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        return shard.Erase(hash, key);
+    }
+
+    /// <summary>
+    ///   Removes all entries. Entries removed by the previous call are freed.
+    /// </summary>
+    void Clear()
+    {
+        for (Shard& shard : shards)
+            shard.Clear();
+    }
+
+    size_t Size() const
+    {
+        size_t size = 0;
+        for (Shard const& shard : shards)
+            size += shard.Count.load(std::memory_order_relaxed);
+        return size;
+    }
+
+private:
+    // Readers register with the epoch of their shard that is current when
+    // their guard is created. The epoch only advances once no reader of the
+    // previous epoch is left, so an object unlinked in epoch e can no longer
+    // be reached once the epoch reached e + 2.
+    static constexpr size_t EpochCount = 3;
+
+    struct Node
+    {
+        Node(size_t hash, size_t index, K key, V value)
+            : HashValue(hash)
+            , Index(index)
+            , Key(std::move(key))
+            , Value(std::move(value))
+        {}
+
+        size_t HashValue;
+        size_t Index; // Position in the owning node list of the shard.
+        K Key;
+        V Value;
+    };
+
+    // Open-addressing table of node pointers. Tables are never resized in
+    // place; a shard publishes a rebuilt copy instead and retires the old one
+    // once readers that may still probe it are gone.
+    struct Table
+    {
+        explicit Table(size_t capacity)
+            : Mask(capacity - 1)
+            , Slots(new std::atomic<Node*>[capacity])
+        {
+            for (size_t i = 0; i < capacity; ++i)
+                Slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        size_t Capacity() const { return Mask + 1; }
+
+        // Marks the slot of an erased node, so that readers keep probing past
+        // it to nodes that collided with it.
+        static Node* Tombstone()
+        {
+            alignas(Node) static std::byte tombstone[sizeof(Node)];
+            return reinterpret_cast<Node*>(tombstone);
+        }
+
+        Node const* Find(size_t hash, K const& key) const
+        {
+            for (size_t i = hash & Mask;; i = (i + 1) & Mask) {
+                Node const* node = Slots[i].load(std::memory_order_acquire);
+                if (!node)
+                    return nullptr;
+                if (node != Tombstone() && node->HashValue == hash && node->Key == key)
+                    return node;
+            }
+        }
+
+        // Replaces a node with one for the same key. Readers probing the
+        // slot concurrently see either node.
+        void Replace(Node const* oldNode, Node* newNode)
+        {
+            for (size_t i = oldNode->HashValue & Mask;; i = (i + 1) & Mask) {
+                if (Slots[i].load(std::memory_order_relaxed) == oldNode) {
+                    Slots[i].store(newNode, std::memory_order_release);
+                    return;
+                }
+            }
+        }
+
+        void Remove(Node const* node)
+        {
+            for (size_t i = node->HashValue & Mask;; i = (i + 1) & Mask) {
+                if (Slots[i].load(std::memory_order_relaxed) == node) {
+                    Slots[i].store(Tombstone());
+                    return;
+                }
+            }
+        }
+
+        // Requires the key of the node to be absent, so the first tombstone
+        // on its probe sequence can be reused.
+        void Insert(Node* node)
+        {
+            size_t i = node->HashValue & Mask;
+            for (;; i = (i + 1) & Mask) {
+                Node const* slot = Slots[i].load(std::memory_order_relaxed);
+                if (!slot) {
+                    ++UsedSlots;
+                    break;
+                }
+                if (slot == Tombstone())
+                    break;
+            }
+
+            Slots[i].store(node, std::memory_order_release);
+        }
+
+        size_t const Mask;
+        std::unique_ptr<std::atomic<Node*>[]> const Slots;
+        size_t UsedSlots = 0; // Occupied by nodes or tombstones.
+    };
+
+    struct Retired
+    {
+        std::vector<std::unique_ptr<Table>> Tables;
+        std::vector<std::unique_ptr<Node>> Nodes;
+        std::vector<std::unique_ptr<Node>> ReplacedNodes;
+    };
+
+    // An object unlinked by a shard and the epoch it was unlinked in.
+    template<typename T>
+    struct RetiredObject
+    {
+        uint64_t Epoch;
+        std::unique_ptr<T> Object;
+    };
+
+    struct alignas(64) Shard
+    {
+        static constexpr size_t InitialCapacity = 16;
+
+        Shard()
+        {
+            live.Tables.push_back(std::make_unique<Table>(InitialCapacity));
+            CurrentTable.store(live.Tables.back().get(), std::memory_order_relaxed);
+        }
+
+        // Requires a read guard or Mutex to be held.
+        Node const* Find(size_t hash, K const& key) const
+        {
+            return CurrentTable.load(std::memory_order_acquire)->Find(hash, key);
+        }
+
+        // Requires Mutex to be held.
+        Node const* Insert(size_t hash, K key, V value)
+        {
+            Table* table = CurrentTable.load(std::memory_order_relaxed);
+
+            // Keep the load factor, including tombstones, at or below 1/2 so
+            // probe sequences stay short and always reach an empty slot.
+            // Rebuilding drops the tombstones, and the table only grows if the
+            // remaining nodes would fill more than a third of it.
+            if ((table->UsedSlots + 1) * 2 > table->Capacity()) {
+                size_t const count = live.Nodes.size() + 1;
+                size_t capacity = table->Capacity();
+                while (count * 3 > capacity)
+                    capacity *= 2;
+
+                auto rebuilt = std::make_unique<Table>(capacity);
+                for (auto const& node : live.Nodes)
+                    rebuilt->Insert(node.get());
+
+                table = rebuilt.get();
+                CurrentTable.store(table, std::memory_order_release);
+                Retire(retiredTables, std::move(live.Tables.back()));
+                live.Tables.back() = std::move(rebuilt);
+            }
+
+            size_t const index = live.Nodes.size();
+            live.Nodes.push_back(
+                std::make_unique<Node>(hash, index, std::move(key), std::move(value)));
+            table->Insert(live.Nodes.back().get());
+            Count.store(live.Nodes.size(), std::memory_order_relaxed);
+            return live.Nodes.back().get();
+        }
+
+        // Requires Mutex to be held.
+        Node const* Replace(Node const* oldNode, K key, V value)
+        {
+            auto& owner = live.Nodes[oldNode->Index];
+            auto newNode = std::make_unique<Node>(oldNode->HashValue, oldNode->Index,
+                                                  std::move(key), std::move(value));
+            CurrentTable.load(std::memory_order_relaxed)->Replace(oldNode, newNode.get());
+            live.ReplacedNodes.push_back(std::move(owner));
+            owner = std::move(newNode);
+            return owner.get();
+        }
+
+        template<typename Callback>
+        void ForEach(Callback& callback)
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            for (auto const& node : live.Nodes)
+                callback(static_cast<K const&>(node->Key),
+                         static_cast<V const&>(node->Value));
+        }
+
+        // Requires Mutex to be held.
+        bool Erase(size_t hash, K const& key)
+        {
+            Node const* node = Find(hash, key);
+            if (!node)
+                return false;
+
+            CurrentTable.load(std::memory_order_relaxed)->Remove(node);
+
+            size_t const index = node->Index;
+            std::unique_ptr<Node> owner = std::move(live.Nodes[index]);
+            if (index != live.Nodes.size() - 1) {
+                live.Nodes[index] = std::move(live.Nodes.back());
+                live.Nodes[index]->Index = index;
+            }
+            live.Nodes.pop_back();
+            Count.store(live.Nodes.size(), std::memory_order_relaxed);
+
+            Retire(erasedNodes, std::move(owner));
+            return true;
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            retired = std::move(live);
+            live = Retired();
+            live.Tables.push_back(std::make_unique<Table>(InitialCapacity));
+            CurrentTable.store(live.Tables.back().get(), std::memory_order_release);
+            Count.store(0, std::memory_order_relaxed);
+        }
+
+        std::atomic<Table*> CurrentTable;
+        std::atomic<size_t> Count{};
+        std::mutex Mutex;
+
+        std::atomic<uint64_t> Epoch{};
+        mutable std::array<std::atomic<size_t>, EpochCount> EpochReaders{};
+
+    private:
+        // Requires Mutex to be held. The object must have been unlinked
+        // before, which the sequentially consistent load of the epoch orders
+        // before guards created in later epochs.
+        template<typename T>
+        void Retire(std::vector<RetiredObject<T>>& objects, std::unique_ptr<T> object)
+        {
+            objects.push_back({Epoch.load(), std::move(object)});
+
+            // Only the holder of Mutex advances the epoch.
+            uint64_t epoch = Epoch.load();
+            if (EpochReaders[(epoch + EpochCount - 1) % EpochCount].load() == 0)
+                Epoch.store(++epoch);
+
+            FreeUnreachable(erasedNodes, epoch);
+            FreeUnreachable(retiredTables, epoch);
+        }
+
+        template<typename T>
+        static void FreeUnreachable(std::vector<RetiredObject<T>>& objects,
+                                    uint64_t epoch)
+        {
+            objects.erase(std::remove_if(objects.begin(), objects.end(),
+                                         [&](RetiredObject<T> const& object) {
+                                             return object.Epoch + 2 <= epoch;
+                                         }),
+                          objects.end());
+        }
+
+        Retired live;
+        Retired retired;
+        std::vector<RetiredObject<Node>> erasedNodes;
+        std::vector<RetiredObject<Table>> retiredTables;
+    };
+
+    Shard& GetShard(size_t hash) { return shards[ShardIndex(hash)]; }
+    Shard const& GetShard(size_t hash) const { return shards[ShardIndex(hash)]; }
+
+    // Tables index slots with the low bits of the hash, so shards use the high
+    // bits to keep both independent.
+    static size_t ShardIndex(size_t hash)
+    {
+        return (hash >> (sizeof(size_t) * 8 - 8)) & (ShardCount - 1);
+    }
+
+    std::array<Shard, ShardCount> shards;
+};
+
+} // namespace etk
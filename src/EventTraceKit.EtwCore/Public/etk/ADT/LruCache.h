@@ -1,11 +1,26 @@
 #pragma once
+#include <cstddef>
 #include <list>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 namespace etk
 {
 
-template<typename K, typename T, typename Hasher = std::hash<K>>
+//! Weighs every entry as one, so that the capacity of an LruCache limits the
+//! number of entries.
+struct UnitWeigher
+{
+    template<typename T>
+    size_t operator()(T const&) const
+    {
+        return 1;
+    }
+};
+
+template<typename K, typename T, typename Hasher = std::hash<K>,
+         typename Weigher = UnitWeigher>
 class LruCache
 {
 public:
@@ -13,14 +28,19 @@ public:
     using mapped_type = T;
     using size_type = size_t;
 
-    LruCache(size_t capacity)
+    //! The capacity limits the total weight of all entries.
+    LruCache(size_t capacity, Weigher weigher = Weigher())
         : capacity(capacity)
+        , weigher(std::move(weigher))
     {
-        valueMap.reserve(capacity);
+        if constexpr (std::is_same_v<Weigher, UnitWeigher>)
+            valueMap.reserve(capacity);
     }
 
     size_t Capacity() const { return capacity; }
     size_t Size() const { return valueMap.size(); }
+    size_t Weight() const { return weight; }
+    bool Empty() const { return valueMap.empty(); }
 
     template<typename ValueFactory>
     T& operator()(K const& key, ValueFactory factory)
@@ -31,31 +51,69 @@ public:
     template<typename ValueFactory>
     T& GetOrCreate(K const& key, ValueFactory factory)
     {
-        auto it = valueMap.find(key);
-        if (it != valueMap.end()) {
-            // Move accessed key to the end of the LRU list.
-            lruKeys.splice(lruKeys.end(), lruKeys, it->second.second);
-            return it->second.first;
-        }
+        if (T* value = Find(key))
+            return *value;
 
         return Add(key, factory(key));
     }
 
-    void SetCapacity(size_t capacity)
+    //! Returns the value for the key and marks it as most recently used, or
+    //! returns nullptr if the key is not present.
+    T* Find(K const& key)
     {
-        for (size_t i = this->capacity; i > capacity; --i)
-            Evict();
+        auto it = valueMap.find(key);
+        if (it == valueMap.end())
+            return nullptr;
+
+        // Move accessed key to the end of the LRU list.
+        lruKeys.splice(lruKeys.end(), lruKeys, it->second.second);
+        return &it->second.first;
+    }
 
+    //! Adds or replaces the value for the key and marks it as most recently
+    //! used.
+    T& Insert(K const& key, T value)
+    {
+        Remove(key);
+        return Add(key, std::move(value));
+    }
+
+    void SetCapacity(size_t capacity)
+    {
         this->capacity = capacity;
+        while (weight > capacity && !lruKeys.empty())
+            Evict();
     }
 
-    void Remove(K const& key)
+    bool Remove(K const& key)
     {
         auto it = valueMap.find(key);
-        if (it != valueMap.end()) {
-            lruKeys.erase(it->second.second);
-            valueMap.erase(key);
-        }
+        if (it == valueMap.end())
+            return false;
+
+        weight -= weigher(it->second.first);
+        lruKeys.erase(it->second.second);
+        valueMap.erase(it);
+        return true;
+    }
+
+    //! Removes and returns the least recently used entry. The cache must not
+    //! be empty.
+    std::pair<K, T> PopLeastRecent()
+    {
+        auto it = valueMap.find(lruKeys.front());
+        std::pair<K, T> entry(std::move(lruKeys.front()), std::move(it->second.first));
+        weight -= weigher(entry.second);
+        valueMap.erase(it);
+        lruKeys.pop_front();
+        return entry;
+    }
+
+    void Clear()
+    {
+        valueMap.clear();
+        lruKeys.clear();
+        weight = 0;
     }
 
 private:
@@ -65,23 +123,29 @@ private:
 
     mapped_type& Add(key_type const& key, mapped_type&& value)
     {
-        if (lruKeys.size() == capacity)
+        size_t const valueWeight = weigher(value);
+        while (weight + valueWeight > capacity && !lruKeys.empty())
             Evict();
 
         auto lruIt = lruKeys.insert(lruKeys.end(), key);
         auto result = valueMap.insert({key, MapEntry(std::move(value), lruIt)});
+        weight += valueWeight;
         return result.first->second.first;
     }
 
     void Evict()
     {
-        valueMap.erase(lruKeys.front());
+        auto it = valueMap.find(lruKeys.front());
+        weight -= weigher(it->second.first);
+        valueMap.erase(it);
         lruKeys.pop_front();
     }
 
     KeyAccessList lruKeys;
     ValueMap valueMap;
     size_t capacity;
+    size_t weight = 0;
+    Weigher weigher;
 };
 
 } // namespace etk
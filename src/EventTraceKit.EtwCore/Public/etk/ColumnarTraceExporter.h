@@ -0,0 +1,155 @@
+#pragma once
+#include "etk/PropertyDecoder.h"
+#include "etk/Support/CompilerSupport.h"
+#include "etk/TraceLogExporter.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/flat_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <windows.h>
+
+namespace etk
+{
+
+//! Physical type of a column in a columnar export.
+enum class ColumnType : uint8_t
+{
+    //! One byte per row, zero or one.
+    Boolean = 1,
+    UInt8,
+    UInt16,
+    UInt32,
+    UInt64,
+    Int64,
+    Double,
+    //! 16 bytes per row.
+    Guid,
+    //! 100ns ticks since 1601-01-01 UTC in 8 bytes.
+    Time,
+    //! UTF-8 text.
+    String,
+    //! Raw bytes. Strings from ANSI properties are stored as Binary, since
+    //! their code page is unknown.
+    Binary,
+    //! UInt32 indices into the string dictionary of the file.
+    Dictionary,
+};
+
+struct ColumnarExportOptions
+{
+    //! Maximum number of rows of a table written at once. Rows of each table
+    //! are buffered until the batch is full or the export ends.
+    size_t BatchSize = 64 * 1024;
+
+    //! Size of the buffer collecting output before it is written.
+    size_t BufferSize = 1024 * 1024;
+
+    //! Whether to write columns with the decoded top-level properties of
+    //! events in addition to the header columns.
+    bool IncludeProperties = true;
+};
+
+//! Exports trace logs in a column-chunked binary layout in the spirit of the
+//! Arrow IPC stream format, so that analysis tools can load large traces
+//! without decoding payloads again.
+//!
+//! Events are split into one table per schema, and one table for events
+//! without schema. TraceLogging events carry their schema inline, so their
+//! tables are told apart by their metadata and not by id and version.
+//!
+//! Every table starts with the header columns Index (the position of the
+//! event in the source), TimeStamp, ProviderId, ProviderName, Id, Version,
+//! Channel, Level, Opcode, OpcodeName, Task, TaskName (the event name of
+//! TraceLogging events), Keyword, ProcessId, ThreadId and ProcessorIndex.
+//! Tables of schemas continue with one column per top-level property, typed
+//! after the property and named like it. Names are dictionary-encoded. Values
+//! that cannot be decoded are null.
+//!
+//! The file starts with a 16-byte header: the magic 'ETKC', the format
+//! version (u32) and eight reserved bytes. Blocks follow, each with a 16-byte
+//! header (type (u32), reserved (u32), body size (u64)) and a body that is a
+//! multiple of 8 bytes. Integers are little-endian.
+//!
+//! - Dictionary blocks append strings to the file dictionary: the index of
+//!   the first string and the number of strings (u32 each), then their u64
+//!   offsets (count + 1) and bytes as buffers.
+//! - Table blocks declare a table before its first batch: the table id and
+//!   column count (u32 each), the provider id (GUID), event id (u16) and
+//!   version (u8) of the schema, a flag (u8) set for tables of schemas, padded
+//!   to 32 bytes, then per column its type (u8), a reserved byte, the TDH
+//!   input type (u16) and the name size (u32), followed by the UTF-8 name
+//!   padded to 8 bytes.
+//! - Batch blocks hold rows of a table: the table id (u32), reserved (u32)
+//!   and the row count (u64), then the buffers of each column in order: a
+//!   validity bitmap (least significant bit first), then the fixed-width
+//!   values, or the u64 offsets (row count + 1) and bytes of String and Binary
+//!   columns.
+//!
+//! Each buffer is its size (u64) followed by its data padded to 8 bytes.
+//!
+//! A single export runs at a time, calls must not overlap.
+class ColumnarTraceExporter
+{
+public:
+    enum class BlockType : uint32_t
+    {
+        Dictionary = 1,
+        Table,
+        Batch,
+    };
+
+    static uint32_t const Magic = 0x434B5445; // 'ETKC'
+    static uint32_t const FormatVersion = 1;
+
+    explicit ColumnarTraceExporter(ColumnarExportOptions options = {});
+    ~ColumnarTraceExporter();
+
+    //! Writes the events of the source. Returns E_ABORT if the write callback
+    //! returns false.
+    HRESULT Export(TraceLogExportSource source, TraceLogExportWriteCallback* write,
+                   void* state);
+
+    //! Writes the events of the source to a new file, replacing an existing
+    //! one.
+    HRESULT ExportToFile(TraceLogExportSource source, std::wstring const& path);
+
+    //! Statistics of the most recent export.
+    TraceLogExportStatistics GetStatistics() const { return statistics; }
+
+    //! Number of tables written by the most recent export.
+    size_t GetTableCount() const { return tables.size(); }
+
+private:
+    class Column;
+    struct Table;
+    struct SchemaTables;
+    class Writer;
+
+    Table* GetTable(Writer& writer, EventInfo const& info);
+    void AddRow(Table& table, EventInfo const& info, size_t index);
+    bool WriteBatch(Writer& writer, Table& table);
+
+    ColumnarExportOptions options;
+    std::unique_ptr<SchemaTables> schemaTables;
+    std::unique_ptr<Table> headerOnlyTable;
+    std::vector<Table*> tables;
+    absl::flat_hash_map<std::string, uint32_t> dictionary;
+    PropertyDecoder decoder;
+    std::vector<PropertyValue> values;
+    std::string field;
+    TraceLogExportStatistics statistics;
+};
+
+} // namespace etk
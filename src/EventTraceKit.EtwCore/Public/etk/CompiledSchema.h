@@ -0,0 +1,38 @@
+#pragma once
+#include "etk/DecodePlan.h"
+#include "etk/EventInfo.h"
+#include "etk/MessageTemplate.h"
+
+#include <cwchar>
+#include <string_view>
+
+namespace etk
+{
+
+//! Data derived once from the TRACE_EVENT_INFO of a schema, so that events of
+//! the schema are decoded and formatted without interpreting it again.
+struct CompiledSchema
+{
+    //! The info of the event is only used while compiling.
+    explicit CompiledSchema(EventInfo const& info)
+        : Plan(info)
+    {
+        if (wchar_t const* const message = info.EventMessage()) {
+            size_t const maxLength =
+                (info.InfoSize() - info->EventMessageOffset) / sizeof(wchar_t);
+            Message.Assign(std::wstring_view(message, wcsnlen(message, maxLength)),
+                           info->TopLevelPropertyCount);
+        }
+    }
+
+    size_t GetMemorySize() const
+    {
+        return Message.GetMemorySize() + Plan.GetMemorySize();
+    }
+
+    //! Empty if the schema has no message.
+    MessageTemplate Message;
+    DecodePlan Plan;
+};
+
+} // namespace etk
@@ -0,0 +1,110 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/EventInfo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace etk
+{
+
+//! The layout of the payload of an event schema, compiled once from its
+//! TRACE_EVENT_INFO. Top-level properties with fixed offsets are located by
+//! arithmetic alone. Later properties are located by measuring the variable-
+//! length properties in front of them, with array counts and lengths given by
+//! other properties read from the payload instead of through TdhGetProperty.
+//!
+//! Planning stops at the first property whose size cannot be determined from
+//! the schema, like one whose length is given by a struct member. Properties
+//! following it are not located.
+class DecodePlan
+{
+public:
+    //! Where a top-level property is found in a payload.
+    struct Location
+    {
+        //! Offset of the first element, following a count prefix if any.
+        uint32_t Offset = 0;
+        //! Size of all elements.
+        uint32_t Size = 0;
+        //! Number of elements. One for properties that are not arrays.
+        uint16_t Count = 0;
+        //! The length of each element as passed to TdhFormatProperty, either
+        //! from the schema or the length property.
+        uint16_t Length = 0;
+    };
+
+    DecodePlan() = default;
+    explicit DecodePlan(EventInfo const& info);
+
+    //! Number of leading top-level properties that can be located.
+    size_t GetPlannedPropertyCount() const { return plannedCount; }
+
+    //! Number of leading top-level properties with fixed offsets.
+    size_t GetFixedPropertyCount() const { return fixedCount; }
+
+    //! Computes the locations of the first locations.size() top-level
+    //! properties. Returns false if more properties are requested than were
+    //! planned, or if the payload is too short.
+    bool Locate(cspan<std::byte> userData, size_t pointerSize,
+                span<Location> locations) const;
+
+    //! Approximate heap memory used by the plan.
+    size_t GetMemorySize() const;
+
+private:
+    enum class ElementKind : uint8_t
+    {
+        Fixed,             // Bytes + Pointers * pointer size
+        Sized,             // Length * Unit
+        UnicodeTerminated,
+        AnsiTerminated,
+        Counted,           // UINT16 byte count prefix
+        ReversedCounted,   // Big-endian UINT16 byte count prefix
+        Counted32,         // UINT32 byte count prefix
+        Sid,
+        WbemSid,           // TOKEN_USER followed by a SID
+        Remainder,         // Extends to the end of the payload
+        Struct,            // Members in sequence
+    };
+
+    enum class Source : uint8_t
+    {
+        Fixed,
+        Property, // Value of an earlier top-level property
+        Prefix,   // UINT16 in front of the elements
+    };
+
+    struct Field
+    {
+        ElementKind Kind = ElementKind::Fixed;
+        Source CountSource = Source::Fixed;
+        Source LengthSource = Source::Fixed;
+        uint8_t Unit = 1;
+        uint16_t Count = 1;  // Fixed count or property index
+        uint16_t Length = 0; // Fixed length or property index
+        uint16_t Bytes = 0;
+        uint16_t Pointers = 0;
+        uint16_t FirstMember = 0;
+        uint16_t MemberCount = 0;
+        //! Offset of properties with a fixed offset.
+        uint32_t PrefixBytes = 0;
+        uint32_t PrefixPointers = 0;
+    };
+
+    bool CompileField(EventInfo const& info, size_t index, bool topLevel);
+    bool IsIntegerProperty(EventInfo const& info, size_t index) const;
+    bool ReadInteger(size_t index, cspan<std::byte> userData,
+                     cspan<Location> locations, uint64_t& value) const;
+    size_t MeasureElement(Field const& field, size_t length, cspan<std::byte> userData,
+                          size_t offset, size_t pointerSize) const;
+    size_t MeasureMember(Field const& field, cspan<std::byte> userData, size_t offset,
+                         size_t pointerSize) const;
+
+    std::vector<Field> fields; // Indexed like EventPropertyInfoArray
+    size_t plannedCount = 0;
+    size_t fixedCount = 0;
+};
+
+} // namespace etk
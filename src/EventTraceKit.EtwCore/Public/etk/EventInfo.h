@@ -10,15 +10,28 @@
 namespace etk
 {
 
+inline size_t GetPointerSize(EVENT_HEADER const& header)
+{
+    if ((header.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER) != 0)
+        return 4;
+    if ((header.Flags & EVENT_HEADER_FLAG_64_BIT_HEADER) != 0)
+        return 8;
+    return sizeof(void*);
+}
+
+struct CompiledSchema;
+
 class EventInfo
 {
 public:
     EventInfo() = default;
 
-    EventInfo(EVENT_RECORD const* record, TRACE_EVENT_INFO const* info, size_t infoSize)
+    EventInfo(EVENT_RECORD const* record, TRACE_EVENT_INFO const* info, size_t infoSize,
+              CompiledSchema const* compiled = nullptr)
         : record(record)
         , info(info)
         , infoSize(infoSize)
+        , compiled(compiled)
     {}
 
     explicit operator bool() const { return info != nullptr; }
@@ -28,6 +41,9 @@ public:
     TRACE_EVENT_INFO const* Info() const { return info; }
     size_t InfoSize() const { return infoSize; }
 
+    //! The compiled form of the schema cached with it, if any.
+    CompiledSchema const* Compiled() const { return compiled; }
+
     cspan<std::byte> UserData() const
     {
         return {static_cast<std::byte*>(record->UserData),
@@ -70,6 +86,7 @@ private:
     EVENT_RECORD const* record = nullptr;
     TRACE_EVENT_INFO const* info = nullptr;
     size_t infoSize = 0;
+    CompiledSchema const* compiled = nullptr;
 };
 
 } // namespace etk
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include <windows.h>
+
+#include <evntcons.h>
+#include <evntprov.h>
+
+namespace etk
+{
+
+//! Identifies the schema of a manifest-based or classic event.
+class EventKey
+{
+public:
+    EventKey(GUID const& providerId, USHORT eventId, UCHAR version)
+    {
+        std::memcpy(data, &providerId, sizeof(providerId));
+        std::memcpy(data + sizeof(providerId), &eventId, sizeof(eventId));
+        std::memcpy(data + sizeof(providerId) + sizeof(eventId), &version,
+                    sizeof(version));
+    }
+
+    static EventKey FromEvent(EVENT_RECORD const& record)
+    {
+        return FromEventHeader(record.EventHeader);
+    }
+
+    static EventKey FromEventHeader(EVENT_HEADER const& header)
+    {
+        bool const isClassic = (header.Flags & EVENT_HEADER_FLAG_CLASSIC_HEADER) != 0;
+        return EventKey(header.ProviderId,
+                        !isClassic ? header.EventDescriptor.Id
+                                   : header.EventDescriptor.Opcode,
+                        header.EventDescriptor.Version);
+    }
+
+    GUID GetProviderId() const
+    {
+        GUID providerId;
+        std::memcpy(&providerId, data, sizeof(providerId));
+        return providerId;
+    }
+
+    USHORT GetEventId() const
+    {
+        USHORT eventId;
+        std::memcpy(&eventId, data + sizeof(GUID), sizeof(eventId));
+        return eventId;
+    }
+
+    UCHAR GetVersion() const
+    {
+        UCHAR version;
+        std::memcpy(&version, data + sizeof(GUID) + sizeof(USHORT), sizeof(version));
+        return version;
+    }
+
+    friend bool operator==(EventKey const& x, EventKey const& y)
+    {
+        return std::memcmp(&x, &y, sizeof(y)) == 0;
+    }
+
+    friend bool operator<(EventKey const& x, EventKey const& y)
+    {
+        return std::memcmp(&x, &y, sizeof(y)) < 0;
+    }
+
+    template<typename H>
+    friend H AbslHashValue(H state, EventKey const& key)
+    {
+        return H::combine_contiguous(std::move(state), key.data, std::size(key.data));
+    }
+
+private:
+    char data[sizeof(EVENT_HEADER::ProviderId) + sizeof(EVENT_DESCRIPTOR::Id) +
+              sizeof(EVENT_DESCRIPTOR::Version)];
+};
+
+} // namespace etk
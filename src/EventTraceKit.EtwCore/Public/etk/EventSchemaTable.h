@@ -0,0 +1,66 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/ADT/VarStructPtr.h"
+#include "etk/EventKey.h"
+#include "etk/Support/CompilerSupport.h"
+#include "etk/Support/Hashing.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/flat_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+#include <windows.h>
+
+#include <tdh.h>
+
+namespace etk
+{
+
+//! Schemas of manifest-based events, read from the binary event templates
+//! (the WEVT_TEMPLATE resource) that the message compiler embeds into
+//! provider binaries. Each schema is a TRACE_EVENT_INFO equivalent to what
+//! TdhGetEventInformation returns for the event after loading the manifest,
+//! but resolved with a single hash lookup and without calling into the OS.
+//!
+//! Names of levels, tasks, opcodes, keywords and channels use their localized
+//! messages if a message table is provided and their symbolic names otherwise.
+//! Value maps are referenced by name only.
+class EventSchemaTable
+{
+public:
+    //! Adds the schemas of all events of a WEVT_TEMPLATE ('CRIM') blob, and
+    //! resolves messages using the RT_MESSAGETABLE resource if not empty.
+    //! Existing schemas for the same events are replaced. Returns false if
+    //! the blob is malformed, in which case the table is left unchanged.
+    bool AddTemplates(cspan<std::byte> wevtTemplate,
+                      cspan<std::byte> messageTable = cspan<std::byte>());
+
+    std::tuple<TRACE_EVENT_INFO const*, size_t> Find(EventKey const& key) const
+    {
+        auto const it = schemas.find(key);
+        if (it == schemas.end())
+            return {nullptr, 0};
+        return {std::get<0>(it->second).get(), std::get<1>(it->second)};
+    }
+
+    size_t GetEventCount() const { return schemas.size(); }
+
+    //! Returns the distinct providers of all events in the table.
+    std::vector<GUID> GetProviderIds() const;
+
+    void Clear() { schemas.clear(); }
+
+private:
+    using SchemaPtr = std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>;
+    absl::flat_hash_map<EventKey, SchemaPtr> schemas;
+};
+
+} // namespace etk
@@ -0,0 +1,92 @@
+#pragma once
+#include "etk/ADT/LruCache.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace etk
+{
+
+struct FormattedMessageCacheStatistics
+{
+    //! The number of lookups that found a cached message.
+    size_t Hits = 0;
+
+    //! The number of lookups that did not find a cached message.
+    size_t Misses = 0;
+
+    //! The number of messages evicted because the cache exceeded its capacity.
+    size_t Evictions = 0;
+
+    //! The number of cached messages.
+    size_t CachedMessages = 0;
+
+    //! The approximate memory in bytes used by cached messages.
+    size_t CachedSize = 0;
+};
+
+//! Formatted messages of events keyed by a sequence number identifying the
+//! event in its trace log (see MakeSequence), so that rows shown again are not
+//! formatted again. The memory used by the messages is bounded, the least
+//! recently used ones are evicted first.
+//!
+//! Safe to call concurrently. Messages must be removed when the schema of
+//! their event is resolved later, and the cache must be cleared with the
+//! trace log. Both change the generation of the cache, and messages formatted
+//! from events read before are not added.
+class FormattedMessageCache
+{
+public:
+    //! The default limit of the memory used by cached messages.
+    static size_t const DefaultCapacity = 16 * 1024 * 1024;
+
+    explicit FormattedMessageCache(size_t capacity = DefaultCapacity);
+
+    //! Returns the sequence number of the event at index in the unfiltered
+    //! trace log, after the log was cleared clearCount times. Indices are kept
+    //! in the low 40 bits.
+    static uint64_t MakeSequence(size_t clearCount, size_t index)
+    {
+        return (static_cast<uint64_t>(clearCount) << 40) |
+               (static_cast<uint64_t>(index) & ((uint64_t(1) << 40) - 1));
+    }
+
+    //! Returns the current generation. Obtain it before reading the events
+    //! whose messages are added.
+    uint64_t GetGeneration() const { return generation.load(std::memory_order_acquire); }
+
+    //! Copies the cached message of the event into message and marks it as
+    //! most recently used. Returns false if the message is not cached.
+    bool TryGet(uint64_t sequence, std::wstring& message);
+
+    //! Adds or replaces the message of the event. Messages that alone exceed
+    //! the capacity are not cached, nor are messages of a generation other
+    //! than the current one, since their event may have changed.
+    void Add(uint64_t sequence, std::wstring_view message, uint64_t generation);
+
+    void Remove(uint64_t sequence);
+    void Clear();
+    void SetCapacity(size_t bytes);
+
+    FormattedMessageCacheStatistics GetStatistics() const;
+
+private:
+    struct MessageWeigher
+    {
+        size_t operator()(std::wstring const& message) const;
+    };
+
+    mutable std::mutex mutex;
+    LruCache<uint64_t, std::wstring, std::hash<uint64_t>, MessageWeigher> messages;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    std::atomic<uint64_t> generation{0};
+};
+
+} // namespace etk
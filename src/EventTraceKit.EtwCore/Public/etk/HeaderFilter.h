@@ -0,0 +1,194 @@
+#pragma once
+#include "etk/ADT/SmallVector.h"
+#include "etk/ADT/Span.h"
+#include "etk/EventInfo.h"
+#include "etk/HeaderPredicate.h"
+#include "etk/Support/CompilerSupport.h"
+#include "etk/Support/Hashing.h"
+#include "etk/Support/MathExtras.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/flat_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <array>
+#include <cstdint>
+
+namespace etk
+{
+
+//! Assigns dense indices to provider ids so that provider comparisons reduce to
+//! 32-bit integer compares. Indices are stable for the lifetime of the map.
+class ProviderIndexMap
+{
+public:
+    uint32_t GetOrAdd(GUID const& providerId)
+    {
+        if (lastIndex != InvalidIndex && providerId == lastProviderId)
+            return lastIndex;
+
+        auto const result =
+            indices.try_emplace(providerId, static_cast<uint32_t>(indices.size()));
+        lastProviderId = providerId;
+        lastIndex = result.first->second;
+        return lastIndex;
+    }
+
+private:
+    static uint32_t const InvalidIndex = ~uint32_t(0);
+
+    absl::flat_hash_map<GUID, uint32_t> indices;
+    GUID lastProviderId = {};
+    uint32_t lastIndex = InvalidIndex;
+};
+
+//! One bit per event of a block; set bits mark events that passed.
+class SelectionBitmap
+{
+public:
+    static size_t const Capacity = 256;
+    static size_t const WordCount = Capacity / 64;
+
+    void SelectFirst(size_t count)
+    {
+        for (size_t i = 0; i < WordCount; ++i) {
+            size_t const begin = i * 64;
+            if (count >= begin + 64)
+                words[i] = ~uint64_t(0);
+            else if (count > begin)
+                words[i] = (uint64_t(1) << (count - begin)) - 1;
+            else
+                words[i] = 0;
+        }
+    }
+
+    void Clear() { words.fill(0); }
+
+    bool IsSet(size_t index) const { return (words[index / 64] >> (index % 64)) & 1; }
+
+    template<typename Function>
+    void ForEachSet(Function&& function) const
+    {
+        for (size_t i = 0; i < WordCount; ++i) {
+            for (uint64_t word = words[i]; word != 0; word &= word - 1)
+                function(i * 64 + CountTrailingZeros(word));
+        }
+    }
+
+    uint64_t* data() { return words.data(); }
+    uint64_t const* data() const { return words.data(); }
+
+private:
+    std::array<uint64_t, WordCount> words{};
+};
+
+//! Event header fields of a block of events in columnar form. Small fields are
+//! widened to 32 bits so that every column can be evaluated by the same
+//! kernels.
+struct HeaderColumnBlock
+{
+    static size_t const Capacity = SelectionBitmap::Capacity;
+
+    size_t Count = 0;
+    alignas(32) uint32_t ProviderIndex[Capacity] = {};
+    alignas(32) uint32_t Id[Capacity] = {};
+    alignas(32) uint32_t Version[Capacity] = {};
+    alignas(32) uint32_t Channel[Capacity] = {};
+    alignas(32) uint32_t Level[Capacity] = {};
+    alignas(32) uint32_t Opcode[Capacity] = {};
+    alignas(32) uint32_t Task[Capacity] = {};
+    alignas(32) uint32_t ProcessId[Capacity] = {};
+    alignas(32) uint32_t ThreadId[Capacity] = {};
+    alignas(32) uint64_t Keyword[Capacity] = {};
+
+    uint32_t* Column32(HeaderField field);
+    uint32_t const* Column32(HeaderField field) const
+    {
+        return const_cast<HeaderColumnBlock*>(this)->Column32(field);
+    }
+};
+
+//! ANDs the result of comparing count column values against a value into the
+//! selection. Implementations may read up to the next multiple of their vector
+//! width, so columns must be padded to HeaderColumnBlock::Capacity.
+using Compare32Kernel = void(uint32_t const* column, size_t count, CompareOp op,
+                             uint32_t value, uint64_t* selection);
+using Compare64Kernel = void(uint64_t const* column, size_t count, CompareOp op,
+                             uint64_t value, uint64_t* selection);
+
+struct HeaderFilterKernels
+{
+    Compare32Kernel* Compare32;
+    Compare64Kernel* Compare64;
+};
+
+namespace kernels
+{
+void Compare32Scalar(uint32_t const* column, size_t count, CompareOp op, uint32_t value,
+                     uint64_t* selection);
+void Compare64Scalar(uint64_t const* column, size_t count, CompareOp op, uint64_t value,
+                     uint64_t* selection);
+void Compare32SSE41(uint32_t const* column, size_t count, CompareOp op, uint32_t value,
+                    uint64_t* selection);
+void Compare64SSE41(uint64_t const* column, size_t count, CompareOp op, uint64_t value,
+                    uint64_t* selection);
+void Compare32AVX2(uint32_t const* column, size_t count, CompareOp op, uint32_t value,
+                   uint64_t* selection);
+void Compare64AVX2(uint64_t const* column, size_t count, CompareOp op, uint64_t value,
+                   uint64_t* selection);
+} // namespace kernels
+
+HeaderFilterKernels const& GetScalarHeaderFilterKernels();
+
+//! Returns the fastest kernels supported by the current processor.
+HeaderFilterKernels const& GetHeaderFilterKernels();
+
+//! A conjunction of header predicates compiled for block-wise evaluation.
+class HeaderFilter
+{
+public:
+    HeaderFilter() = default;
+    HeaderFilter(cspan<HeaderPredicate> predicates, ProviderIndexMap& providers,
+                 HeaderFilterKernels const& kernels = GetHeaderFilterKernels());
+
+    //! Whether the predicate can be evaluated. Provider ids only support Equal
+    //! and NotEqual.
+    static bool IsSupported(HeaderPredicate const& predicate);
+
+    bool IsEmpty() const { return terms.empty() && !neverMatches; }
+
+    //! False if any predicate is not supported. Such a filter matches no events
+    //! rather than ignoring the predicate.
+    bool IsValid() const { return valid; }
+
+    //! Selects the events (at most SelectionBitmap::Capacity) matching all
+    //! predicates. The block is used as scratch storage for the columns.
+    void Evaluate(cspan<EventInfo> events, ProviderIndexMap& providers,
+                  HeaderColumnBlock& block, SelectionBitmap& selection) const;
+
+    //! Evaluates the predicates for a single event without vectorization.
+    bool Matches(EVENT_HEADER const& header, ProviderIndexMap& providers) const;
+
+private:
+    struct Term
+    {
+        HeaderField Field;
+        CompareOp Op;
+        uint64_t Value;
+    };
+
+    void LoadColumns(cspan<EventInfo> events, ProviderIndexMap& providers,
+                     HeaderColumnBlock& block) const;
+
+    SmallVector<Term, 4> terms;
+    unsigned fieldMask = 0;
+    bool neverMatches = false;
+    bool valid = true;
+    HeaderFilterKernels kernels = GetScalarHeaderFilterKernels();
+};
+
+} // namespace etk
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+
+#include <guiddef.h>
+
+namespace etk
+{
+
+enum class HeaderField : uint8_t
+{
+    ProviderId,
+    Id,
+    Version,
+    Channel,
+    Level,
+    Opcode,
+    Task,
+    Keyword,
+    ProcessId,
+    ThreadId,
+};
+
+enum class CompareOp : uint8_t
+{
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    //! (field & value) != 0
+    AnyBitsSet,
+    //! (field & value) == value
+    AllBitsSet,
+};
+
+template<typename T>
+constexpr bool EvaluateCompareOp(T x, CompareOp op, T value)
+{
+    switch (op) {
+    case CompareOp::Equal: return x == value;
+    case CompareOp::NotEqual: return x != value;
+    case CompareOp::Less: return x < value;
+    case CompareOp::LessEqual: return x <= value;
+    case CompareOp::Greater: return x > value;
+    case CompareOp::GreaterEqual: return x >= value;
+    case CompareOp::AnyBitsSet: return (x & value) != 0;
+    case CompareOp::AllBitsSet: return (x & value) == value;
+    }
+
+    return false;
+}
+
+//! Compares a single event header field against a constant. A filter may carry
+//! a conjunction of these which is evaluated natively over blocks of events
+//! before the filter callback is invoked for the remaining candidates.
+struct HeaderPredicate
+{
+    HeaderPredicate(HeaderField field, CompareOp op, uint64_t value)
+        : Field(field)
+        , Op(op)
+        , Value(value)
+    {}
+
+    //! Creates a predicate matching (or excluding) events of a provider. Only
+    //! Equal and NotEqual are supported for provider ids.
+    static HeaderPredicate Provider(GUID const& providerId,
+                                    CompareOp op = CompareOp::Equal)
+    {
+        HeaderPredicate predicate(HeaderField::ProviderId, op, 0);
+        predicate.ProviderId = providerId;
+        return predicate;
+    }
+
+    HeaderField Field;
+    CompareOp Op;
+    uint64_t Value;
+    GUID ProviderId = {};
+};
+
+} // namespace etk
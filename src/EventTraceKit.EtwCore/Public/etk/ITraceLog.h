@@ -1,21 +1,94 @@
 #pragma once
 #include "etk/EventInfo.h"
+#include "etk/HeaderPredicate.h"
+#include "etk/PayloadPredicate.h"
 #include "etk/IEventSink.h"
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace etk
 {
 
+using TraceLogSchemasResolvedCallback = void(size_t const* indices, size_t count,
+                                              void* state);
+
+//! Controls when failed schema lookups are attempted again. Failures are
+//! cached so that events of providers without schema do not repeat the
+//! expensive lookup for every event.
+struct TraceLogSchemaRetryPolicy
+{
+    //! Retry after new manifests have been loaded with UpdateTraceData.
+    bool RetryOnTraceDataUpdate = true;
+
+    //! Retry once this much time has passed since the lookup failed. Zero
+    //! disables time-based retries.
+    std::chrono::milliseconds RetryInterval{0};
+};
+
+struct TraceLogSchemaStatistics
+{
+    //! The number of distinct schemas that have been resolved.
+    size_t ResolvedSchemas = 0;
+
+    //! The number of distinct schemas whose lookup failed and that are cached
+    //! as unresolved.
+    size_t UnresolvedSchemas = 0;
+
+    //! The number of schema lookups that failed, including retries.
+    size_t FailedLookups = 0;
+
+    //! The number of events that were stored without schema because their
+    //! lookup had failed before.
+    size_t UnresolvedEvents = 0;
+
+    //! The approximate memory in bytes used by cached schemas and their keys.
+    size_t CachedSize = 0;
+
+    //! The number of cached schemas and failed lookups that were evicted
+    //! because the cache exceeded its capacity.
+    size_t EvictedSchemas = 0;
+};
+
 class ITraceLog : public IEventSink
 {
 public:
     virtual size_t GetEventCount() const = 0;
     virtual EventInfo GetEvent(size_t index) const = 0;
     virtual void Clear() = 0;
+
+    //! Returns the number of times the log was cleared. Consumers that refer
+    //! to events by index compare it to detect a clear even if the log has
+    //! been refilled since.
+    virtual size_t GetClearCount() const = 0;
+
     virtual HRESULT UpdateTraceData(cspan<std::wstring> eventManifests) = 0;
+
+    //! Returns the number of leading events whose schema lookup has finished.
+    //! Schemas of new kinds of events are resolved in the background, and
+    //! until then GetEvent returns such events without schema.
+    virtual size_t GetResolvedEventCount() const = 0;
+
+    //! Sets a callback that is invoked from the background thread with the
+    //! ascending indices of stored events whose schema lookup has finished,
+    //! so that views showing them can refresh these rows.
+    virtual void SetSchemasResolvedCallback(TraceLogSchemasResolvedCallback* callback,
+                                            void* state) = 0;
+
+    virtual void SetSchemaRetryPolicy(TraceLogSchemaRetryPolicy const& policy) = 0;
+
+    //! Limits the memory used by cached schemas and failed lookups that no
+    //! stored event refers to. Schemas of stored events are never evicted and
+    //! do not count against the limit.
+    virtual void SetSchemaCacheCapacity(size_t bytes) = 0;
+
+    //! Returns statistics of the schema lookups. The schema counts refer to the
+    //! schemas cached since the log was last cleared, the other counts cover
+    //! the lifetime of the log.
+    virtual TraceLogSchemaStatistics GetSchemaStatistics() const = 0;
 };
 
 using TraceLogFilterEvent = bool(void* record, void* info, size_t infoSize);
@@ -26,8 +99,61 @@ public:
     TraceLogFilter(TraceLogFilterEvent* filter)
         : Filter(filter)
     {}
+    TraceLogFilter(TraceLogFilterEvent* filter,
+                   std::vector<HeaderPredicate> headerPredicates,
+                   std::vector<PayloadPredicate> payloadPredicates = {})
+        : Filter(filter)
+        , HeaderPredicates(std::move(headerPredicates))
+        , PayloadPredicates(std::move(payloadPredicates))
+    {}
     virtual ~TraceLogFilter() = default;
     TraceLogFilterEvent* Filter;
+
+    //! Predicates on event header fields which all must hold for an event to be
+    //! passed to Filter. These are evaluated natively over blocks of events.
+    //! A filter with an unsupported predicate (see HeaderFilter::IsSupported)
+    //! matches no events.
+    std::vector<HeaderPredicate> HeaderPredicates;
+
+    //! Predicates on top-level event properties which all must hold for an event
+    //! to be passed to Filter. Property locations are resolved once per schema.
+    std::vector<PayloadPredicate> PayloadPredicates;
+};
+
+using TraceLogRebuildProgressCallback = void(size_t scanned, size_t total, void* state);
+
+struct TraceLogRebuildStatistics
+{
+    //! The number of rebuilds that ran to completion.
+    size_t CompletedRebuilds = 0;
+
+    //! The number of rebuilds that were abandoned because a newer filter was set.
+    size_t CancelledRebuilds = 0;
+
+    //! The number of events scanned by the most recent completed rebuild.
+    size_t LastEventsScanned = 0;
+
+    //! The duration of the most recent completed rebuild.
+    std::chrono::nanoseconds LastDuration{};
+
+    //! The longest duration of any completed rebuild.
+    std::chrono::nanoseconds MaxDuration{};
+
+    //! The accumulated duration of all rebuilds, including cancelled ones.
+    std::chrono::nanoseconds TotalDuration{};
+};
+
+//! Controls how often a filtered view publishes newly matched events through
+//! its changed callback. Publishing more often lowers the latency until matches
+//! become visible, publishing less often reduces the callback overhead while
+//! large logs are filtered.
+struct TraceLogNotificationPolicy
+{
+    //! The longest time matched events are held back before being published.
+    std::chrono::milliseconds MaxLatency{16};
+
+    //! The most matched events that are held back before being published.
+    size_t MaxBatchSize = 64 * 1024;
 };
 
 class IFilteredTraceLog
@@ -37,10 +163,24 @@ public:
     virtual size_t GetEventCount() = 0;
     virtual EventInfo GetEvent(size_t index) const = 0;
 
+    //! Returns the event at index like GetEvent, and its index in the source
+    //! trace log in sourceIndex.
+    virtual EventInfo GetEvent(size_t index, size_t& sourceIndex) const = 0;
+
     // Takes ownership of the passed in filter. Note: This cannot be a unique_ptr
     // directly due to a compiler bug:
     // https://developercommunity.visualstudio.com/content/problem/201217/ccli-stdmove-causes-stdunique-ptr-parameter-to-be.html
     virtual void SetFilter(TraceLogFilter* filter) = 0;
+
+    //! Sets a callback that is invoked from the filter thread while the filtered
+    //! view is rebuilt. The callback receives the number of events scanned so far
+    //! and the total number of events to scan.
+    virtual void SetRebuildProgressCallback(TraceLogRebuildProgressCallback* callback,
+                                            void* state) = 0;
+
+    virtual TraceLogRebuildStatistics GetRebuildStatistics() const = 0;
+
+    virtual void SetNotificationPolicy(TraceLogNotificationPolicy const& policy) = 0;
 };
 
 using TraceLogEventsChangedCallback = void(size_t, void*);
@@ -49,4 +189,9 @@ std::unique_ptr<ITraceLog> CreateEtwTraceLog(TraceLogEventsChangedCallback* call
 std::tuple<std::unique_ptr<ITraceLog>, std::unique_ptr<IFilteredTraceLog>>
 CreateFilteredTraceLog(TraceLogEventsChangedCallback* callback, TraceLogFilter* filter);
 
+//! Persists event schemas resolved by TDH in the given file, so that later
+//! sessions decode their first events without calling into TDH. Applies to
+//! trace logs created after all current trace logs have been destroyed.
+void SetSchemaCacheFile(std::wstring const& path);
+
 } // namespace etk
@@ -0,0 +1,58 @@
+#pragma once
+#include "etk/TextSearchIndex.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace etk
+{
+
+class ITraceLog;
+
+struct TraceLogTextIndexStatistics
+{
+    //! The number of events whose messages have been indexed.
+    size_t IndexedEvents = 0;
+
+    //! The number of distinct trigrams in the index.
+    size_t Trigrams = 0;
+
+    //! The approximate memory used by the index, in bytes.
+    size_t MemoryUsage = 0;
+
+    //! Whether indexing stopped because the index reached its memory limit.
+    //! Events from IndexedEvents on must be searched without the index.
+    bool LimitReached = false;
+};
+
+//! Formats the messages of a trace log on a background thread and maintains a
+//! trigram index over them. The index only grows until the log is cleared,
+//! and indexing stops once it reaches its memory limit.
+class ITraceLogTextIndex
+{
+public:
+    virtual ~ITraceLogTextIndex() = default;
+
+    //! Signals that events were added to or cleared from the source log. The
+    //! index also polls the log periodically, so calling this only reduces the
+    //! indexing latency.
+    virtual void Update() = 0;
+
+    //! Returns the indices (into the source log) of the indexed events whose
+    //! message may match the query, in ascending order. Callers must verify
+    //! the candidates; events not yet indexed are never returned.
+    virtual std::vector<uint32_t> FindCandidates(std::wstring_view query,
+                                                 TextSearchMode mode) const = 0;
+
+    virtual TraceLogTextIndexStatistics GetStatistics() const = 0;
+};
+
+//! Default memory limit of a trace log text index, in bytes.
+size_t const DefaultTextIndexMemoryLimit = 256 * 1024 * 1024;
+
+std::unique_ptr<ITraceLogTextIndex>
+CreateTraceLogTextIndex(ITraceLog const* log,
+                        size_t memoryLimit = DefaultTextIndexMemoryLimit);
+
+} // namespace etk
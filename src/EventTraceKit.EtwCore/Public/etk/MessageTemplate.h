@@ -0,0 +1,67 @@
+#pragma once
+#include "etk/ADT/Span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace etk
+{
+
+//! The message string of an event schema, parsed once into literal runs and
+//! references to top-level properties, so that formatting an event only
+//! copies strings.
+//!
+//! Follows the insert syntax of FormatMessage: %1 to %99 insert a property,
+//! an optional !printf-format! after the number is skipped because properties
+//! are already formatted. %n inserts a line break, %r a carriage return, %t a
+//! tab, %0 ends the message, and any other character after % is copied as is.
+//! References to missing properties are kept as literal text.
+class MessageTemplate
+{
+public:
+    MessageTemplate() = default;
+    MessageTemplate(std::wstring_view message, size_t propertyCount);
+
+    //! Parses the message again, reusing allocated memory.
+    void Assign(std::wstring_view message, size_t propertyCount);
+
+    //! Number of leading properties the message refers to. Later properties
+    //! need not be formatted.
+    size_t GetReferencedPropertyCount() const { return referencedPropertyCount; }
+
+    //! Approximate heap memory used by the template.
+    size_t GetMemorySize() const;
+
+    //! Writes the message with its inserts replaced by the formatted
+    //! properties into the buffer. The output is truncated to fit and always
+    //! null-terminated unless bufferSize is zero. Returns the number of
+    //! characters written, excluding the terminator.
+    size_t Format(cspan<std::wstring_view> properties, wchar_t* buffer,
+                  size_t bufferSize) const;
+
+    //! Appends the message with its inserts replaced by the formatted
+    //! properties to output, without truncation.
+    void Format(cspan<std::wstring_view> properties, std::wstring& output) const;
+
+private:
+    static uint32_t const LiteralRun = UINT32_MAX;
+
+    // Either a range of literal text or a property index.
+    struct Segment
+    {
+        uint32_t Property;
+        uint32_t Offset;
+        uint32_t Length;
+    };
+
+    void AppendLiteral(std::wstring_view text);
+
+    std::wstring literals;
+    std::vector<Segment> segments;
+    size_t referencedPropertyCount = 0;
+};
+
+} // namespace etk
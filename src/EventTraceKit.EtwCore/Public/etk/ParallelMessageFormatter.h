@@ -0,0 +1,91 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/EventInfo.h"
+#include "etk/TdhMessageFormatter.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace etk
+{
+
+//! Messages of a batch of events stored back to back in one buffer.
+template<typename Char>
+struct BasicFormattedMessages
+{
+    //! The message of the event at the given index of the batch. Empty if the
+    //! event could not be formatted.
+    std::basic_string_view<Char> operator[](size_t index) const
+    {
+        return std::basic_string_view<Char>(Text).substr(
+            Offsets[index], Offsets[index + 1] - Offsets[index]);
+    }
+
+    //! Whether the message of the event at the given index of the batch could
+    //! be formatted, to tell failures apart from empty messages.
+    bool IsFormatted(size_t index) const { return Formatted[index]; }
+
+    size_t size() const { return Offsets.empty() ? 0 : Offsets.size() - 1; }
+
+    std::basic_string<Char> Text;
+    //! Start of each message in Text, followed by the end of the last one.
+    std::vector<size_t> Offsets;
+    std::vector<bool> Formatted;
+};
+
+using FormattedMessages = BasicFormattedMessages<wchar_t>;
+
+//! Messages encoded as UTF-8, for exports and search indexes.
+using FormattedMessagesU8 = BasicFormattedMessages<char>;
+
+//! Formats the messages of many events at once, for exports and copying all
+//! rows. TdhMessageFormatter keeps scratch state and is not reentrant, so the
+//! events are split into chunks that worker threads format with a formatter
+//! each. The worker threads and their formatters are kept across batches, so
+//! threads are only started once and value maps only retrieved once.
+//!
+//! A single batch is formatted at a time, calls must not overlap.
+class ParallelMessageFormatter
+{
+public:
+    //! Uses one thread per processor if threadCount is zero.
+    explicit ParallelMessageFormatter(unsigned threadCount = 0,
+                                      size_t chunkSize = DefaultChunkSize);
+    ~ParallelMessageFormatter();
+
+    ParallelMessageFormatter(ParallelMessageFormatter const&) = delete;
+    ParallelMessageFormatter& operator=(ParallelMessageFormatter const&) = delete;
+
+    //! Formats the messages of the events into output, replacing its contents.
+    //! The calling thread takes part in formatting.
+    void FormatEventMessages(cspan<EventInfo> events, FormattedMessages& output);
+    void FormatEventMessages(cspan<EventInfo> events, FormattedMessagesU8& output);
+
+    //! Number of threads formatting a batch, including the calling thread.
+    size_t GetThreadCount() const { return workers.size(); }
+
+    //! Number of events formatted by a worker at once.
+    size_t GetChunkSize() const { return chunkSize; }
+
+    static size_t const DefaultChunkSize = 256;
+
+private:
+    struct Worker;
+    struct Pool;
+
+    template<typename Char>
+    void FormatChunks(cspan<EventInfo> events, BasicFormattedMessages<Char>& output);
+
+    // Runs the task on all workers and waits until they are done.
+    void RunOnWorkers(std::function<void(Worker&)> const& task);
+    void WorkerThreadProc(Worker& worker);
+
+    size_t const chunkSize;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<Pool> pool;
+};
+
+} // namespace etk
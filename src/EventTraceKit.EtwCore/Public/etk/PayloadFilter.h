@@ -0,0 +1,108 @@
+#pragma once
+#include "etk/ADT/SmallVector.h"
+#include "etk/ADT/Span.h"
+#include "etk/EventInfo.h"
+#include "etk/PayloadPredicate.h"
+#include "etk/Support/CompilerSupport.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/flat_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace etk
+{
+
+//! A conjunction of payload predicates. For every event schema the location and
+//! type of each referenced property is resolved once, so that evaluating an
+//! event reduces to loading the value at a precomputed offset. Properties
+//! following variable-length strings are located by skipping those strings.
+class PayloadFilter
+{
+public:
+    PayloadFilter() = default;
+    explicit PayloadFilter(std::vector<PayloadPredicate> predicates);
+
+    bool IsEmpty() const { return predicates.empty(); }
+
+    bool Matches(EventInfo const& info);
+
+    //! Discards all cached schema layouts. Must be called before the schemas
+    //! of previously evaluated events are freed.
+    void ClearLayouts() { layouts.clear(); }
+
+private:
+    enum class ExtentKind : uint8_t
+    {
+        Fixed,
+        UnicodeTerminated,
+        AnsiTerminated,
+        Counted,
+    };
+
+    //! Describes how many bytes a property occupies in the payload.
+    struct Extent
+    {
+        ExtentKind Kind = ExtentKind::Fixed;
+        uint16_t Size = 0;
+    };
+
+    enum class ValueType : uint8_t
+    {
+        Unresolved,
+        Signed,
+        Unsigned,
+        UnicodeString,
+        AnsiString,
+    };
+
+    struct FieldLocation
+    {
+        ValueType Type = ValueType::Unresolved;
+        Extent Value;
+        //! Offset from the start of the payload if StepCount is zero, otherwise
+        //! the offset is found by skipping the first StepCount variable steps.
+        uint32_t Offset = 0;
+        uint16_t StepCount = 0;
+    };
+
+    struct SchemaLayout
+    {
+        GUID ProviderId;
+        EVENT_DESCRIPTOR Descriptor;
+        ULONG PropertyCount;
+
+        //! Size of the leading properties with fixed offsets.
+        uint32_t FixedPrefixSize = 0;
+        //! Extents of all properties following the fixed prefix.
+        SmallVector<Extent, 4> Steps;
+        //! The location of the property referenced by each predicate.
+        SmallVector<FieldLocation, 4> Fields;
+    };
+
+    using LayoutKey = std::pair<TRACE_EVENT_INFO const*, uint8_t>;
+
+    static bool GetExtent(EVENT_PROPERTY_INFO const& propInfo, uint8_t pointerSize,
+                          Extent& extent);
+    static ValueType GetValueType(EVENT_PROPERTY_INFO const& propInfo);
+    static size_t Measure(Extent extent, cspan<std::byte> userData, size_t offset);
+
+    SchemaLayout const& GetLayout(EventInfo const& info, uint8_t pointerSize);
+    SchemaLayout CreateLayout(EventInfo const& info, uint8_t pointerSize) const;
+    bool Evaluate(PayloadPredicate const& predicate, FieldLocation const& field,
+                  SchemaLayout const& layout, cspan<std::byte> userData);
+
+    std::vector<PayloadPredicate> predicates;
+    absl::flat_hash_map<LayoutKey, SchemaLayout> layouts;
+    std::wstring stringBuffer;
+};
+
+} // namespace etk
@@ -0,0 +1,67 @@
+#pragma once
+#include "etk/HeaderPredicate.h"
+
+#include <cstdint>
+#include <string>
+
+namespace etk
+{
+
+enum class StringMatch : uint8_t
+{
+    Equal,
+    NotEqual,
+    Contains,
+    StartsWith,
+    EndsWith,
+};
+
+//! Compares a top-level event property against a constant. Events whose schema
+//! does not contain the property, or contains it with an incompatible type, do
+//! not match.
+struct PayloadPredicate
+{
+    enum class ValueKind : uint8_t
+    {
+        Number,
+        String,
+    };
+
+    //! Creates a predicate on an integral property. Signed properties are
+    //! compared as signed 64-bit integers, all others as unsigned 64-bit
+    //! integers with value reinterpreted accordingly.
+    static PayloadPredicate Number(std::wstring property, CompareOp op, int64_t value)
+    {
+        PayloadPredicate predicate(std::move(property), ValueKind::Number);
+        predicate.NumberOp = op;
+        predicate.NumberValue = value;
+        return predicate;
+    }
+
+    //! Creates a predicate on a Unicode or ANSI string property.
+    static PayloadPredicate String(std::wstring property, StringMatch op,
+                                   std::wstring value, bool ignoreCase = false)
+    {
+        PayloadPredicate predicate(std::move(property), ValueKind::String);
+        predicate.StringOp = op;
+        predicate.StringValue = std::move(value);
+        predicate.IgnoreCase = ignoreCase;
+        return predicate;
+    }
+
+    std::wstring Property;
+    ValueKind Kind;
+    CompareOp NumberOp = CompareOp::Equal;
+    StringMatch StringOp = StringMatch::Equal;
+    bool IgnoreCase = false;
+    int64_t NumberValue = 0;
+    std::wstring StringValue;
+
+private:
+    PayloadPredicate(std::wstring property, ValueKind kind)
+        : Property(std::move(property))
+        , Kind(kind)
+    {}
+};
+
+} // namespace etk
@@ -0,0 +1,106 @@
+#pragma once
+#include "etk/ADT/SmallVector.h"
+#include "etk/ADT/Span.h"
+#include "etk/DecodePlan.h"
+#include "etk/EventInfo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <windows.h>
+
+namespace etk
+{
+
+//! A top-level property of an event decoded into its typed value. Strings and
+//! binary values refer into the payload and are only valid while the event
+//! record is.
+struct PropertyValue
+{
+    enum class ValueKind : uint8_t
+    {
+        //! The property could not be decoded, like one of an unsupported type
+        //! or a SYSTEMTIME with out-of-range fields.
+        None,
+        //! Signed integers, in Int.
+        Signed,
+        //! Unsigned and hexadecimal integers, pointers and size_t values, in
+        //! UInt.
+        Unsigned,
+        //! Booleans, in UInt as zero or one.
+        Boolean,
+        //! Float and double values, in Double.
+        Float,
+        Guid,
+        //! FILETIME and SYSTEMTIME values, in UInt as 100ns ticks since
+        //! 1601-01-01 UTC.
+        Time,
+        //! UTF-16 strings and characters in Data, without terminator or
+        //! length prefix.
+        UnicodeString,
+        //! ANSI and UTF-8 strings and characters in Data, without terminator
+        //! or length prefix.
+        AnsiString,
+        //! Binary values and SIDs in Data, without length prefix.
+        Binary,
+        //! Arrays of any number of elements of InType in Data.
+        Array,
+        //! Structs, or arrays of them, with their members in Data.
+        Struct,
+    };
+
+    //! The characters of a UnicodeString value.
+    std::wstring_view GetUnicodeString() const
+    {
+        return {reinterpret_cast<wchar_t const*>(Data.data()),
+                Data.size() / sizeof(wchar_t)};
+    }
+
+    //! The characters of an AnsiString value.
+    std::string_view GetAnsiString() const
+    {
+        return {reinterpret_cast<char const*>(Data.data()), Data.size()};
+    }
+
+    ValueKind Kind = ValueKind::None;
+    //! TDH input and output type of the property, or of its elements.
+    USHORT InType = 0;
+    USHORT OutType = 0;
+    //! Number of elements of arrays. One for other properties.
+    uint16_t Count = 0;
+    union
+    {
+        int64_t Int;
+        uint64_t UInt = 0;
+        double Double;
+        GUID Guid;
+    };
+    cspan<std::byte> Data;
+};
+
+//! Decodes the top-level properties of events into typed values, so that
+//! payload values can be sorted, aggregated and charted without parsing
+//! formatted text. Properties are located with the decode plan compiled for
+//! the schema. Decoding does not allocate for schemas from the schema cache.
+//!
+//! Keeps scratch state and is not reentrant.
+class PropertyDecoder
+{
+public:
+    //! Decodes the first values.size() top-level properties of the event.
+    //! Returns the number of properties decoded, which is less than requested
+    //! if the schema has fewer properties, or if later ones cannot be located.
+    //! Values beyond that are reset. Returns zero for events without schema,
+    //! string-only events and payloads too short for the schema.
+    size_t Decode(EventInfo info, size_t pointerSize, span<PropertyValue> values);
+
+    //! The kind of values decoded for the property, or None if its type is
+    //! not supported. Decoded values have this kind or None.
+    static PropertyValue::ValueKind GetValueKind(EVENT_PROPERTY_INFO const& propInfo);
+
+private:
+    SmallVector<DecodePlan::Location, 16> locations;
+};
+
+} // namespace etk
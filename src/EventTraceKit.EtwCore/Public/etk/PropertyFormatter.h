@@ -0,0 +1,34 @@
+#pragma once
+#include "etk/ADT/Span.h"
+
+#include <cstddef>
+#include <string>
+
+#include <windows.h>
+
+#include <tdh.h>
+
+namespace etk
+{
+
+//! Formats a single value of the given TDH input and output type found at the
+//! start of the data and appends it to the sink, like TdhFormatProperty but
+//! without calling into TDH. Stores the number of bytes the value occupies in
+//! consumed.
+//!
+//! The length is the length of the property as given by the schema or its
+//! length property: the number of characters of fixed-length strings and the
+//! number of bytes of binary values. It is ignored for other types. Pointers
+//! and size_t values occupy pointerSize bytes.
+//!
+//! Integers are formatted in decimal, hexadecimal output types and pointers as
+//! 0x followed by upper-case digits. Timestamps are formatted as ISO 8601 in
+//! UTC. Returns ERROR_EVT_INVALID_EVENT_DATA if the data is too short, and
+//! ERROR_NOT_SUPPORTED for values that are left to TDH, like error codes that
+//! are formatted as message text, or ANSI strings beyond ASCII. The sink is
+//! unchanged if an error is returned.
+ULONG FormatPropertyValue(USHORT inType, USHORT outType, size_t pointerSize,
+                          USHORT length, cspan<std::byte> data, std::wstring& sink,
+                          size_t& consumed);
+
+} // namespace etk
@@ -0,0 +1,115 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/EventKey.h"
+#include "etk/Support/CompilerSupport.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/flat_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <tdh.h>
+
+namespace etk
+{
+
+//! Returns a hash of the bytes that is stable across processes and builds,
+//! unlike absl::Hash, so that it can be persisted. Passing the result of a
+//! previous call as seed hashes the concatenation of both inputs.
+uint64_t ComputeStableHash(cspan<std::byte> data,
+                           uint64_t seed = 0xCBF29CE484222325ULL) noexcept;
+
+//! A read-only view of a persisted schema cache. The file consists of a
+//! header, an open-addressing hash table and the TRACE_EVENT_INFO blobs it
+//! points to, so a memory-mapped file is used as is without parsing or
+//! copying.
+//!
+//! Entries are keyed by the event and a hash of the manifests the schema was
+//! resolved with, so schemas from different sets of manifests coexist. Callers
+//! include the registered resources of the provider in the hash, since TDH
+//! resolves schemas of registered providers from them.
+class SchemaCacheFile
+{
+public:
+    //! Uses the given contents, which must stay valid and unchanged while the
+    //! view is used. Returns false and leaves the view empty if the contents
+    //! are not a valid cache of the current format version.
+    bool Attach(cspan<std::byte> contents);
+
+    void Detach();
+
+    std::tuple<TRACE_EVENT_INFO const*, size_t> Find(EventKey const& key,
+                                                     uint64_t manifestHash) const;
+
+    size_t GetEntryCount() const { return entryCount; }
+
+    //! Invokes callback(key, manifestHash, info, infoSize) for each entry.
+    template<typename Callback>
+    void ForEach(Callback&& callback) const;
+
+private:
+    friend class SchemaCacheWriter;
+    struct Header;
+    struct Bucket;
+
+    Bucket const* GetBucket(size_t index) const;
+    static EventKey GetKey(Bucket const& bucket);
+    TRACE_EVENT_INFO const* GetInfo(Bucket const& bucket) const;
+    size_t GetInfoSize(Bucket const& bucket) const;
+    bool IsEmpty(Bucket const& bucket) const { return GetInfoSize(bucket) == 0; }
+    uint64_t GetManifestHash(Bucket const& bucket) const;
+
+    cspan<std::byte> contents;
+    size_t bucketCount = 0;
+    size_t entryCount = 0;
+};
+
+//! Builds the contents of a schema cache file.
+class SchemaCacheWriter
+{
+public:
+    //! Adds a schema, replacing an earlier entry for the same event and
+    //! manifest hash.
+    void Add(EventKey const& key, uint64_t manifestHash, TRACE_EVENT_INFO const* info,
+             size_t infoSize);
+
+    //! Adds all entries of an existing cache that are not already present,
+    //! up to a total of maxEntries.
+    void Merge(SchemaCacheFile const& file, size_t maxEntries);
+
+    std::tuple<TRACE_EVENT_INFO const*, size_t> Find(EventKey const& key,
+                                                     uint64_t manifestHash) const;
+
+    size_t GetEntryCount() const { return entries.size(); }
+    bool IsEmpty() const { return entries.empty(); }
+
+    std::vector<std::byte> Finish() const;
+
+private:
+    using EntryKey = std::pair<EventKey, uint64_t>;
+    absl::flat_hash_map<EntryKey, std::vector<std::byte>> entries;
+};
+
+template<typename Callback>
+void SchemaCacheFile::ForEach(Callback&& callback) const
+{
+    for (size_t i = 0; i < bucketCount; ++i) {
+        Bucket const& bucket = *GetBucket(i);
+        if (!IsEmpty(bucket))
+            callback(GetKey(bucket), GetManifestHash(bucket), GetInfo(bucket),
+                     GetInfoSize(bucket));
+    }
+}
+
+} // namespace etk
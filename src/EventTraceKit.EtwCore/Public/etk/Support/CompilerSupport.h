@@ -137,6 +137,17 @@
 #define ETK_GUARD_OVERFLOW
 #endif
 
+/// <summary>
+///   Enables code generation for the specified instruction set extensions in a
+///   single function (e.g. <c>ETK_TARGET("avx2")</c>). MSVC allows intrinsics
+///   without additional flags, so the attribute is a no-op there.
+/// </summary>
+#if defined(ETK_COMPILER_CLANG) || defined(ETK_COMPILER_GCC)
+#define ETK_TARGET(features) __attribute__((target(features)))
+#else
+#define ETK_TARGET(features)
+#endif
+
 #if defined(ETK_COMPILER_CLANG) || defined(ETK_COMPILER_GCC)
 #define ETK_ALIASING_BARRIER(ptr) asm volatile("" : : "rm"(ptr) : "memory")
 #else
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace etk
+{
+
+struct CpuFeatures
+{
+    bool SSE41 = false;
+    bool AVX2 = false;
+};
+
+//! Returns the instruction set extensions supported by both the processor and
+//! the operating system. The result is computed once and cached.
+CpuFeatures const& GetCpuFeatures();
+
+} // namespace etk
@@ -14,6 +14,13 @@ void hash_combine(std::size_t& seed, T const& value)
 
 } // namespace etk
 
+template<typename H>
+H AbslHashValue(H state, GUID const& key)
+{
+    return H::combine_contiguous(std::move(state), reinterpret_cast<uint8_t const*>(&key),
+                                 sizeof(key));
+}
+
 namespace std
 {
 
@@ -0,0 +1,34 @@
+#pragma once
+#include "etk/Support/CompilerSupport.h"
+
+#include <cstdint>
+
+#if defined(ETK_COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
+namespace etk
+{
+
+/// <summary>
+///   Returns the number of trailing zero bits in <paramref name="value"/>. The
+///   result is undefined for zero.
+/// </summary>
+ETK_ALWAYS_INLINE unsigned CountTrailingZeros(uint64_t value)
+{
+#if defined(ETK_COMPILER_MSVC) && defined(ETK_ARCH_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<unsigned>(index);
+#elif defined(ETK_COMPILER_MSVC)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+        return static_cast<unsigned>(index);
+    _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+    return static_cast<unsigned>(index) + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+} // namespace etk
@@ -117,6 +117,8 @@ public:
                                          LOBYTE(_WIN32_WINNT_WIN10), 16299);
     }
 
+    DWORD BuildNumber() const { return versionInfo.dwBuildNumber; }
+
 private:
     ETK_ALWAYS_INLINE
     bool IsWindowsVersionOrGreater(WORD majorVersion, WORD minorVersion,
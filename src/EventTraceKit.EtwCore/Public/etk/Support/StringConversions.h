@@ -5,10 +5,18 @@
 namespace etk
 {
 
+//! Conversions between UTF-8 and UTF-16. Runs of ASCII characters are
+//! converted with SSE2. Invalid input, like unpaired surrogates or malformed
+//! UTF-8 sequences, is converted to U+FFFD, so the conversions never fail.
+
 bool U8To16(std::string_view source, std::wstring& output);
 std::wstring U8To16(std::string_view source);
 
 bool U16To8(std::wstring_view source, std::string& output);
 std::string U16To8(std::wstring_view source);
 
+//! Appends the converted source to the output.
+void AppendU8To16(std::string_view source, std::wstring& output);
+void AppendU16To8(std::wstring_view source, std::string& output);
+
 } // namespace etk
@@ -1,6 +1,12 @@
 #pragma once
 #include "etk/ADT/SmallVector.h"
+#include "etk/DecodePlan.h"
 #include "etk/EventInfo.h"
+#include "etk/MessageTemplate.h"
+#include "etk/ValueMap.h"
+
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace etk
@@ -9,18 +15,32 @@ namespace etk
 class TdhMessageFormatter
 {
 public:
+    //! Formats the message into the buffer. The message is truncated to fit.
     bool FormatEventMessage(EventInfo info, size_t pointerSize, wchar_t* buffer,
                             size_t bufferSize);
 
+    //! Formats the message and appends it to output, without truncation. The
+    //! output is unchanged if the event cannot be formatted.
+    bool FormatEventMessage(EventInfo info, size_t pointerSize, std::wstring& output);
+
+    //! Formats the message and appends it to output encoded as UTF-8, without
+    //! truncation. The output is unchanged if the event cannot be formatted.
+    bool FormatEventMessage(EventInfo info, size_t pointerSize, std::string& output);
+
 private:
-    bool FormatMofEvent(EventInfo const& info, size_t pointerSize, wchar_t* buffer,
-                        size_t bufferSize);
+    MessageTemplate const* FormatMessageProperties(EventInfo const& info,
+                                                   size_t pointerSize);
+    bool FormatMofEvent(EventInfo const& info, size_t pointerSize, std::wstring& sink);
+    bool LocateProperties(EventInfo const& info, size_t pointerSize, size_t count);
 
     std::vector<wchar_t> propertyBuffer;
-    std::vector<BYTE> mapBuffer;
+    std::wstring messageText;
+    ValueMapCache valueMaps;
     std::wstring formattedProperties;
     SmallVector<size_t, 16> formattedPropertiesOffsets;
-    SmallVector<DWORD_PTR, 16> formattedPropertiesPointers;
+    SmallVector<std::wstring_view, 16> formattedPropertyViews;
+    MessageTemplate scratchTemplate;
+    SmallVector<DecodePlan::Location, 16> locations;
 };
 
 } // namespace etk
@@ -0,0 +1,71 @@
+#pragma once
+#include "etk/Support/CompilerSupport.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/flat_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace etk
+{
+
+enum class TextSearchMode : uint8_t
+{
+    //! The query must occur as a contiguous substring.
+    Substring,
+    //! Every whitespace-separated token of the query must occur somewhere.
+    AllTokens,
+};
+
+//! An inverted index mapping character trigrams to the documents containing
+//! them. Documents are identified by consecutive ids starting at zero. Lookups
+//! are case-insensitive for ASCII letters and return a superset of the
+//! matching documents, which callers verify against the actual text.
+//!
+//! Posting lists are stored as delta-encoded varints, so the typical cost is
+//! about one byte per distinct trigram of a document.
+class TextSearchIndex
+{
+public:
+    //! Indexes the text of the next document and returns its id.
+    uint32_t Add(std::wstring_view text);
+
+    void Clear();
+
+    size_t GetDocumentCount() const { return documentCount; }
+    size_t GetTrigramCount() const { return postings.size(); }
+    size_t GetMemoryUsage() const;
+
+    //! Returns the ids of all documents that may match the query, in ascending
+    //! order. Queries (or tokens) shorter than three characters cannot be
+    //! narrowed down and match every document.
+    std::vector<uint32_t> FindCandidates(
+        std::wstring_view query, TextSearchMode mode = TextSearchMode::Substring) const;
+
+private:
+    struct PostingList
+    {
+        std::vector<uint8_t> Data;
+        uint32_t Count = 0;
+        uint32_t LastDocument = 0;
+
+        void Append(uint32_t document);
+    };
+
+    using Trigram = uint64_t;
+
+    static void CollectTrigrams(std::wstring_view text, std::vector<Trigram>& trigrams);
+
+    absl::flat_hash_map<Trigram, PostingList> postings;
+    uint32_t documentCount = 0;
+    std::vector<Trigram> scratch;
+};
+
+} // namespace etk
@@ -0,0 +1,180 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/EventInfo.h"
+#include "etk/ITraceLog.h"
+#include "etk/ParallelMessageFormatter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+namespace etk
+{
+
+enum class ExportFormat : uint8_t
+{
+    //! Comma-separated values with a header row. Fields containing commas,
+    //! quotes or line breaks are quoted.
+    Csv,
+    //! One JSON object per line, keyed by column name.
+    JsonLines,
+};
+
+enum class ExportColumn : uint8_t
+{
+    //! The raw timestamp of the event header.
+    TimeStamp,
+    ProviderId,
+    ProviderName,
+    Id,
+    Version,
+    Channel,
+    Level,
+    Opcode,
+    OpcodeName,
+    Task,
+    TaskName,
+    //! Written as hexadecimal string, because JSON numbers cannot hold all
+    //! 64-bit values.
+    Keyword,
+    ProcessId,
+    ThreadId,
+    ProcessorIndex,
+    Message,
+};
+
+struct TraceLogExportOptions
+{
+    ExportFormat Format = ExportFormat::Csv;
+
+    //! The columns to write, in order.
+    std::vector<ExportColumn> Columns;
+
+    //! Number of threads formatting event messages. Uses one thread per
+    //! processor if zero.
+    unsigned ThreadCount = 0;
+
+    //! Number of event messages formatted by a thread at once.
+    size_t ChunkSize = 4096;
+
+    //! Size of the buffer collecting output before it is written.
+    size_t BufferSize = 1024 * 1024;
+};
+
+struct TraceLogExportStatistics
+{
+    size_t ExportedEvents = 0;
+    uint64_t WrittenBytes = 0;
+    std::chrono::nanoseconds Duration{};
+
+    double GetEventsPerSecond() const
+    {
+        return Duration.count() != 0 ? ExportedEvents * 1e9 / Duration.count() : 0;
+    }
+
+    double GetBytesPerSecond() const
+    {
+        return Duration.count() != 0 ? WrittenBytes * 1e9 / Duration.count() : 0;
+    }
+};
+
+//! The events to export: all events of a trace log, or those of a filtered
+//! view. Events added while exporting are not exported.
+class TraceLogExportSource
+{
+public:
+    TraceLogExportSource(ITraceLog const& log)
+        : log(&log)
+    {}
+
+    TraceLogExportSource(IFilteredTraceLog& filteredLog)
+        : filteredLog(&filteredLog)
+    {}
+
+    size_t GetEventCount() const
+    {
+        return log ? log->GetEventCount() : filteredLog->GetEventCount();
+    }
+
+    EventInfo GetEvent(size_t index) const
+    {
+        return log ? log->GetEvent(index) : filteredLog->GetEvent(index);
+    }
+
+    //! Returns the event at index, and its index in the unfiltered trace log
+    //! in sourceIndex.
+    EventInfo GetEvent(size_t index, size_t& sourceIndex) const
+    {
+        if (!log)
+            return filteredLog->GetEvent(index, sourceIndex);
+
+        sourceIndex = index;
+        return log->GetEvent(index);
+    }
+
+private:
+    ITraceLog const* log = nullptr;
+    IFilteredTraceLog* filteredLog = nullptr;
+};
+
+//! Receives exported UTF-8 output in order. Returns false to abort the export.
+using TraceLogExportWriteCallback = bool(void const* data, size_t size, void* state);
+
+using TraceLogExportProgressCallback = void(size_t exported, size_t total, void* state);
+
+//! Streams the events of a trace log as CSV or JSON Lines. Events are walked
+//! in rounds whose messages a ParallelMessageFormatter formats on worker
+//! threads kept for the lifetime of the exporter. Rows are then written in
+//! order through a buffer, so memory use is bounded by the round size and not
+//! by the number of events.
+//!
+//! A single export runs at a time, calls must not overlap.
+class TraceLogExporter
+{
+public:
+    explicit TraceLogExporter(TraceLogExportOptions options);
+    ~TraceLogExporter();
+
+    //! Sets a callback that is invoked after each round with the number of
+    //! events exported so far and the total number of events to export.
+    void SetProgressCallback(TraceLogExportProgressCallback* callback, void* state);
+
+    //! Writes the events of the source. Returns E_ABORT if the write callback
+    //! returns false.
+    HRESULT Export(TraceLogExportSource source, TraceLogExportWriteCallback* write,
+                   void* state);
+
+    //! Writes the events of the source to a new file, replacing an existing
+    //! one.
+    HRESULT ExportToFile(TraceLogExportSource source, std::wstring const& path);
+
+    //! Statistics of the most recent export.
+    TraceLogExportStatistics GetStatistics() const { return statistics; }
+
+    //! Number of chunks each thread formats per round.
+    static size_t const ChunksPerWorker = 4;
+
+private:
+    void FormatEvent(EventInfo const& info, size_t roundIndex, std::string& output);
+    void AppendColumn(EventInfo const& info, size_t roundIndex, ExportColumn column,
+                      std::string& output);
+
+    TraceLogExportOptions options;
+    // Only created if the Message column is exported.
+    std::unique_ptr<ParallelMessageFormatter> messageFormatter;
+    size_t roundSize = 0;
+    std::vector<EventInfo> roundEvents;
+    FormattedMessagesU8 roundMessages;
+    std::string row;
+    // UTF-8 text of the current string field before it is escaped.
+    std::string field;
+    TraceLogExportProgressCallback* progressCallback = nullptr;
+    void* progressState = nullptr;
+    TraceLogExportStatistics statistics;
+};
+
+} // namespace etk
@@ -0,0 +1,126 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/FormattedMessageCache.h"
+#include "etk/TdhMessageFormatter.h"
+#include "etk/TraceLogExporter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <windows.h>
+
+namespace etk
+{
+
+//! The cells of a range of rows of a trace log for the columns a grid shows.
+//! Only the requested columns are decoded, and event messages are only
+//! formatted if the Message column is requested, so the cost of updating the
+//! window is proportional to the number of visible cells and not to the
+//! number of columns available.
+//!
+//! Cells are stored per column. Text is copied into the window and valid
+//! until the next update.
+class TraceLogRowWindow
+{
+public:
+    //! Decodes the columns of the rows [first, first + count) of the source.
+    //! The range is clamped to the events of the source.
+    void Update(TraceLogExportSource source, size_t first, size_t count,
+                cspan<ExportColumn> columns);
+
+    //! Decodes another column for the rows of the most recent update, keeping
+    //! the cells of the other columns. The source must not have changed since,
+    //! other than by appending events.
+    void AddColumn(ExportColumn column);
+
+    //! Sets a cache of formatted messages of the events of log, the unfiltered
+    //! trace log of the source, keyed by FormattedMessageCache::MakeSequence.
+    //! Events are then read from log. Cached messages are copied instead of
+    //! formatted, and formatted messages are added to the cache.
+    void SetMessageCache(FormattedMessageCache* cache, ITraceLog const* log)
+    {
+        messageCache = cache;
+        messageLog = log;
+    }
+
+    size_t GetFirstRow() const { return firstRow; }
+    size_t GetRowCount() const { return rowCount; }
+    size_t GetColumnCount() const { return columns.size(); }
+    ExportColumn GetColumn(size_t column) const { return columns[column].Column; }
+
+    //! The value of a cell of a numeric column, that is any column but
+    //! ProviderId and the text columns ProviderName, OpcodeName, TaskName and
+    //! Message. TimeStamp values are signed.
+    uint64_t GetNumber(size_t row, size_t column) const
+    {
+        return columns[column].Numbers[row];
+    }
+
+    //! The value of a cell of the ProviderId column.
+    GUID const& GetGuid(size_t row, size_t column) const
+    {
+        return columns[column].Guids[row];
+    }
+
+    //! Whether a cell of a text column has a value. Events without schema have
+    //! no names, and messages that cannot be formatted are missing.
+    bool HasText(size_t row, size_t column) const
+    {
+        return columns[column].Texts[row].Offset != NoText;
+    }
+
+    //! The value of a cell of a text column. Empty if the cell has no value.
+    std::wstring_view GetText(size_t row, size_t column) const
+    {
+        TextRange const& range = columns[column].Texts[row];
+        if (range.Offset == NoText)
+            return {};
+        return std::wstring_view(text).substr(range.Offset, range.Length);
+    }
+
+    //! Number of messages formatted by the most recent update or added column.
+    //! Messages taken from the message cache are not counted.
+    size_t GetFormattedMessageCount() const { return formattedMessages; }
+
+private:
+    static size_t const NoText = ~size_t();
+
+    struct TextRange
+    {
+        size_t Offset;
+        size_t Length;
+    };
+
+    struct ColumnCells
+    {
+        ExportColumn Column;
+        std::vector<uint64_t> Numbers;
+        std::vector<GUID> Guids;
+        std::vector<TextRange> Texts;
+    };
+
+    void DecodeColumn(ColumnCells& cells);
+    void AppendText(ColumnCells& cells, wchar_t const* str);
+    void AppendMessage(ColumnCells& cells, size_t row);
+
+    std::vector<ColumnCells> columns;
+    size_t firstRow = 0;
+    size_t rowCount = 0;
+    std::wstring text;
+    std::vector<EventInfo> events;
+    TdhMessageFormatter formatter;
+    FormattedMessageCache* messageCache = nullptr;
+    ITraceLog const* messageLog = nullptr;
+
+    // Keys of the messages of the events, empty if the log was cleared while
+    // they were read.
+    std::vector<uint64_t> messageSequences;
+    uint64_t messageGeneration = 0;
+    std::wstring cachedMessage;
+    size_t formattedMessages = 0;
+};
+
+} // namespace etk
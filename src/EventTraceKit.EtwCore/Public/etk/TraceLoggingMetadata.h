@@ -0,0 +1,76 @@
+#pragma once
+#include "etk/ADT/Span.h"
+#include "etk/ADT/VarStructPtr.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <windows.h>
+
+#include <evntcons.h>
+#include <tdh.h>
+
+namespace etk
+{
+
+enum class TraceLoggingArrayKind : uint8_t
+{
+    None,
+    //! The element count is part of the metadata.
+    Fixed,
+    //! The element count is a UINT16 preceding the elements in the payload.
+    Variable,
+};
+
+//! A field of a TraceLogging event as declared by its self-describing
+//! metadata. Nested structs are stored inline: a struct field is directly
+//! followed by its members, which may be structs themselves.
+struct TraceLoggingField
+{
+    //! UTF-8 field name.
+    std::string Name;
+    //! The corresponding TDH_INTYPE, or TDH_INTYPE_NULL for structs.
+    uint16_t InType = TDH_INTYPE_NULL;
+    //! The corresponding TDH_OUTTYPE.
+    uint16_t OutType = TDH_OUTTYPE_NULL;
+    uint32_t Tags = 0;
+    TraceLoggingArrayKind Array = TraceLoggingArrayKind::None;
+    //! Element count of fixed-size arrays.
+    uint16_t Count = 1;
+    bool IsStruct = false;
+    //! Number of direct members of a struct.
+    uint8_t MemberCount = 0;
+};
+
+struct TraceLoggingEventMetadata
+{
+    //! UTF-8 event name.
+    std::string Name;
+    uint32_t Tags = 0;
+    std::vector<TraceLoggingField> Fields;
+};
+
+//! Parses the metadata blob of an EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL
+//! extended data item. Returns false if the blob is malformed or uses features
+//! that cannot be represented as TRACE_EVENT_INFO (custom-schema fields).
+bool ParseTraceLoggingEventMetadata(cspan<std::byte> metadata,
+                                    TraceLoggingEventMetadata& event);
+
+//! Parses the provider name from the traits blob of an
+//! EVENT_HEADER_EXT_TYPE_PROV_TRAITS extended data item.
+bool ParseTraceLoggingProviderName(cspan<std::byte> traits, std::string& name);
+
+//! Builds the TRACE_EVENT_INFO of a TraceLogging event without calling into
+//! TDH. Top-level fields come first, the members of each struct are stored
+//! contiguously after them. A variable-size array has PropertyParamCount set
+//! and its countPropertyIndex refers to the array itself, since the count is
+//! stored inline in front of the elements. Returns an empty pointer if the
+//! metadata has more properties than TRACE_EVENT_INFO can address.
+std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t> CreateTraceLoggingEventInfo(
+    EVENT_HEADER const& header, TraceLoggingEventMetadata const& event,
+    std::string const& providerName = std::string());
+
+} // namespace etk
@@ -0,0 +1,111 @@
+#pragma once
+#include "etk/Support/CompilerSupport.h"
+#include "etk/Support/Hashing.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/flat_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <tdh.h>
+
+namespace etk
+{
+
+//! A name/value map of a provider, copied once from the EVENT_MAP_INFO
+//! returned by TDH. Names of manifest maps end with a space which is removed
+//! from the copy, so Info() can be passed to TdhFormatProperty as is.
+//!
+//! Value maps are looked up in an array sorted by value. Bitmaps whose
+//! entries are single bits are looked up in a table indexed by bit.
+class ValueMap
+{
+public:
+    ValueMap(EVENT_MAP_INFO const* mapInfo, size_t mapInfoSize,
+             bool removeTrailingSpace);
+
+    EVENT_MAP_INFO const* Info() const
+    {
+        return reinterpret_cast<EVENT_MAP_INFO const*>(info.data());
+    }
+
+    //! Appends the name of the value, or the names of the bits set in it
+    //! separated by " | ". Returns false and leaves the sink unchanged if the
+    //! value or some of its bits are not mapped, or the map is of a kind only
+    //! TDH formats (pattern maps, WBEM maps of strings or flags).
+    bool Format(uint32_t value, std::wstring& sink) const;
+
+private:
+    enum class Kind : uint8_t
+    {
+        Unsupported,
+        Values,
+        Bits,
+    };
+
+    struct Entry
+    {
+        uint32_t Value;
+        uint32_t NameOffset; // Into info
+        uint32_t NameLength;
+    };
+
+    static uint8_t const NoEntry = 0xFF;
+
+    std::wstring_view GetName(Entry const& entry) const;
+
+    std::vector<std::byte> info;
+    std::vector<Entry> entries; // Sorted by value for value maps.
+    std::array<uint8_t, 32> bitEntries; // Entry index of each bit.
+    Kind kind = Kind::Unsupported;
+    bool singleBits = false;
+};
+
+//! Value maps by provider and map name, so that each map is retrieved from
+//! TDH and prepared only once. Maps are kept for the lifetime of the cache.
+class ValueMapCache
+{
+public:
+    ValueMap const* Find(GUID const& providerId, std::wstring_view mapName) const
+    {
+        auto const it = maps.find(Key(providerId, mapName));
+        return it != maps.end() ? &it->second->Map : nullptr;
+    }
+
+    ValueMap const* Add(GUID const& providerId, std::wstring_view mapName,
+                        ValueMap map)
+    {
+        auto entry =
+            std::make_unique<Entry>(Entry{std::wstring(mapName), std::move(map)});
+        auto const result =
+            maps.try_emplace(Key(providerId, entry->Name), std::move(entry));
+        return &result.first->second->Map;
+    }
+
+private:
+    struct Entry
+    {
+        std::wstring Name;
+        ValueMap Map;
+    };
+
+    // The name of the key refers to the name of the entry.
+    using Key = std::pair<GUID, std::wstring_view>;
+    absl::flat_hash_map<Key, std::unique_ptr<Entry>> maps;
+};
+
+} // namespace etk
@@ -0,0 +1,582 @@
+#include "etk/ColumnarTraceExporter.h"
+
+#include "ExportOutput.h"
+#include "SchemaKey.h"
+#include "etk/EventKey.h"
+#include "etk/Support/StringConversions.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace etk
+{
+
+namespace
+{
+
+using ValueKind = PropertyValue::ValueKind;
+
+size_t const Alignment = 8;
+uint32_t const NullIndex = ~uint32_t();
+
+struct HeaderColumn
+{
+    char const* Name;
+    ColumnType Type;
+};
+
+// The columns every table starts with, in order.
+HeaderColumn const HeaderColumns[] = {
+    {"Index", ColumnType::UInt64},      {"TimeStamp", ColumnType::Int64},
+    {"ProviderId", ColumnType::Guid},   {"ProviderName", ColumnType::Dictionary},
+    {"Id", ColumnType::UInt16},         {"Version", ColumnType::UInt8},
+    {"Channel", ColumnType::UInt8},     {"Level", ColumnType::UInt8},
+    {"Opcode", ColumnType::UInt8},      {"OpcodeName", ColumnType::Dictionary},
+    {"Task", ColumnType::UInt16},       {"TaskName", ColumnType::Dictionary},
+    {"Keyword", ColumnType::UInt64},    {"ProcessId", ColumnType::UInt32},
+    {"ThreadId", ColumnType::UInt32},   {"ProcessorIndex", ColumnType::UInt32},
+};
+
+struct FileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Reserved;
+};
+
+struct BlockHeader
+{
+    ColumnarTraceExporter::BlockType Type;
+    uint32_t Reserved;
+    uint64_t BodySize;
+};
+
+struct TableHeader
+{
+    uint32_t TableId;
+    uint32_t ColumnCount;
+    GUID ProviderId;
+    uint16_t EventId;
+    uint8_t Version;
+    uint8_t HasSchema;
+    uint8_t Reserved[4];
+};
+
+struct ColumnDescriptor
+{
+    ColumnType Type;
+    uint8_t Reserved;
+    uint16_t InType;
+    uint32_t NameSize;
+};
+
+struct DictionaryHeader
+{
+    uint32_t FirstIndex;
+    uint32_t Count;
+};
+
+struct BatchHeader
+{
+    uint32_t TableId;
+    uint32_t Reserved;
+    uint64_t RowCount;
+};
+
+static_assert(sizeof(FileHeader) == 16 && sizeof(BlockHeader) == 16 &&
+              sizeof(TableHeader) == 32 && sizeof(ColumnDescriptor) == 8 &&
+              sizeof(DictionaryHeader) == 8 && sizeof(BatchHeader) == 16);
+
+size_t AlignUp(size_t value)
+{
+    return (value + Alignment - 1) & ~(Alignment - 1);
+}
+
+// Size of a buffer including its size prefix and padding.
+uint64_t GetBufferSize(size_t dataSize)
+{
+    return sizeof(uint64_t) + AlignUp(dataSize);
+}
+
+size_t GetValueWidth(ColumnType type)
+{
+    switch (type) {
+    case ColumnType::Boolean:
+    case ColumnType::UInt8: return 1;
+    case ColumnType::UInt16: return 2;
+    case ColumnType::UInt32:
+    case ColumnType::Dictionary: return 4;
+    case ColumnType::UInt64:
+    case ColumnType::Int64:
+    case ColumnType::Double:
+    case ColumnType::Time: return 8;
+    case ColumnType::Guid: return 16;
+    case ColumnType::String:
+    case ColumnType::Binary: return 0;
+    }
+    return 0;
+}
+
+ColumnType GetPropertyColumnType(ValueKind kind)
+{
+    switch (kind) {
+    case ValueKind::Signed: return ColumnType::Int64;
+    case ValueKind::Unsigned: return ColumnType::UInt64;
+    case ValueKind::Boolean: return ColumnType::Boolean;
+    case ValueKind::Float: return ColumnType::Double;
+    case ValueKind::Guid: return ColumnType::Guid;
+    case ValueKind::Time: return ColumnType::Time;
+    case ValueKind::UnicodeString: return ColumnType::String;
+    default: return ColumnType::Binary;
+    }
+}
+
+} // namespace
+
+// Buffers the rows of a column until its batch is written.
+class ColumnarTraceExporter::Column
+{
+public:
+    Column(std::string name, ColumnType type, USHORT inType)
+        : name(std::move(name))
+        , type(type)
+        , inType(inType)
+        , width(GetValueWidth(type))
+    {
+        Clear();
+    }
+
+    std::string const& GetName() const { return name; }
+    ColumnType GetType() const { return type; }
+    USHORT GetInType() const { return inType; }
+    bool IsVariableWidth() const { return width == 0; }
+
+    void AppendNull()
+    {
+        AppendValidity(false);
+        if (IsVariableWidth())
+            AppendOffset();
+        else
+            values.append(width, '\0');
+    }
+
+    template<typename T>
+    void Append(T const& value)
+    {
+        AppendValidity(true);
+        values.append(reinterpret_cast<char const*>(&value), width);
+    }
+
+    void AppendBytes(cspan<std::byte> bytes)
+    {
+        AppendValidity(true);
+        heap.append(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+        AppendOffset();
+    }
+
+    void AppendString(std::wstring_view str)
+    {
+        AppendValidity(true);
+        AppendU16To8(str, heap);
+        AppendOffset();
+    }
+
+    void Clear()
+    {
+        rowCount = 0;
+        validity.clear();
+        values.clear();
+        heap.clear();
+        if (IsVariableWidth())
+            AppendOffset();
+    }
+
+    uint64_t GetBatchSize() const
+    {
+        uint64_t size = GetBufferSize(validity.size()) + GetBufferSize(values.size());
+        if (IsVariableWidth())
+            size += GetBufferSize(heap.size());
+        return size;
+    }
+
+    template<typename WriteBuffer>
+    bool WriteBatch(WriteBuffer&& writeBuffer) const
+    {
+        return writeBuffer(validity) && writeBuffer(values) &&
+               (!IsVariableWidth() || writeBuffer(heap));
+    }
+
+private:
+    void AppendValidity(bool valid)
+    {
+        if (rowCount % 8 == 0)
+            validity += '\0';
+        if (valid)
+            validity.back() |= static_cast<char>(1 << (rowCount % 8));
+        ++rowCount;
+    }
+
+    void AppendOffset()
+    {
+        uint64_t const offset = heap.size();
+        values.append(reinterpret_cast<char const*>(&offset), sizeof(offset));
+    }
+
+    std::string const name;
+    ColumnType const type;
+    USHORT const inType;
+    size_t const width;
+    size_t rowCount = 0;
+    std::string validity;
+    // Fixed-width values, or offsets into the heap.
+    std::string values;
+    std::string heap;
+};
+
+struct ColumnarTraceExporter::Table
+{
+    uint32_t Id = 0;
+    EventKey Key = EventKey(GUID(), 0, 0);
+    bool HasSchema = false;
+    uint32_t ProviderNameIndex = NullIndex;
+    uint32_t OpcodeNameIndex = NullIndex;
+    uint32_t TaskNameIndex = NullIndex;
+    std::vector<Column> Columns;
+    // Expected kinds of the decoded properties. Values of other kinds are
+    // null.
+    std::vector<ValueKind> PropertyKinds;
+    size_t RowCount = 0;
+};
+
+// Tables of events with schema. Keys own their TraceLogging metadata.
+struct ColumnarTraceExporter::SchemaTables
+{
+    absl::flat_hash_map<SchemaKey, std::unique_ptr<Table>> Tables;
+};
+
+// Writes blocks through the output buffer.
+class ColumnarTraceExporter::Writer
+{
+public:
+    Writer(size_t bufferSize, TraceLogExportWriteCallback* write, void* state)
+        : output(bufferSize, write, state)
+    {}
+
+    template<typename T>
+    bool Write(T const& value)
+    {
+        return output.Append(&value, sizeof(value));
+    }
+
+    bool WriteBlockHeader(BlockType type, uint64_t bodySize)
+    {
+        return Write(BlockHeader{type, 0, bodySize});
+    }
+
+    bool WriteBuffer(std::string_view data)
+    {
+        return Write(static_cast<uint64_t>(data.size())) && output.Append(data) &&
+               WritePadding(data.size());
+    }
+
+    bool WritePadding(size_t dataSize)
+    {
+        char const zeros[Alignment] = {};
+        return output.Append(zeros, AlignUp(dataSize) - dataSize);
+    }
+
+    bool WriteDictionary(uint32_t firstIndex, cspan<std::string> strings)
+    {
+        std::string offsets;
+        std::string bytes;
+        uint64_t offset = 0;
+        offsets.append(reinterpret_cast<char const*>(&offset), sizeof(offset));
+        for (std::string const& str : strings) {
+            bytes += str;
+            offset = bytes.size();
+            offsets.append(reinterpret_cast<char const*>(&offset), sizeof(offset));
+        }
+
+        DictionaryHeader const header{firstIndex, static_cast<uint32_t>(strings.size())};
+        return WriteBlockHeader(BlockType::Dictionary,
+                                sizeof(header) + GetBufferSize(offsets.size()) +
+                                    GetBufferSize(bytes.size())) &&
+               Write(header) && WriteBuffer(offsets) && WriteBuffer(bytes);
+    }
+
+    bool WriteTable(Table const& table)
+    {
+        uint64_t bodySize = sizeof(TableHeader);
+        for (Column const& column : table.Columns)
+            bodySize += sizeof(ColumnDescriptor) + AlignUp(column.GetName().size());
+
+        TableHeader header = {};
+        header.TableId = table.Id;
+        header.ColumnCount = static_cast<uint32_t>(table.Columns.size());
+        header.ProviderId = table.Key.GetProviderId();
+        header.EventId = table.Key.GetEventId();
+        header.Version = table.Key.GetVersion();
+        header.HasSchema = table.HasSchema ? 1 : 0;
+
+        if (!WriteBlockHeader(BlockType::Table, bodySize) || !Write(header))
+            return false;
+
+        for (Column const& column : table.Columns) {
+            std::string const& name = column.GetName();
+            ColumnDescriptor const descriptor{column.GetType(), 0, column.GetInType(),
+                                              static_cast<uint32_t>(name.size())};
+            if (!Write(descriptor) || !output.Append(name) || !WritePadding(name.size()))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool WriteBatch(Table const& table)
+    {
+        uint64_t bodySize = sizeof(BatchHeader);
+        for (Column const& column : table.Columns)
+            bodySize += column.GetBatchSize();
+
+        auto const writeBuffer = [&](std::string_view data) { return WriteBuffer(data); };
+
+        if (!WriteBlockHeader(BlockType::Batch, bodySize) ||
+            !Write(BatchHeader{table.Id, 0, table.RowCount}))
+            return false;
+
+        for (Column const& column : table.Columns) {
+            if (!column.WriteBatch(writeBuffer))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool Flush() { return output.Flush(); }
+    uint64_t GetWrittenBytes() const { return output.GetWrittenBytes(); }
+
+private:
+    OutputBuffer output;
+};
+
+ColumnarTraceExporter::ColumnarTraceExporter(ColumnarExportOptions options)
+    : options(std::move(options))
+    , schemaTables(std::make_unique<SchemaTables>())
+{
+    this->options.BatchSize = std::max<size_t>(this->options.BatchSize, 1);
+}
+
+ColumnarTraceExporter::~ColumnarTraceExporter() = default;
+
+HRESULT ColumnarTraceExporter::Export(TraceLogExportSource source,
+                                      TraceLogExportWriteCallback* write, void* state)
+{
+    auto const startTime = std::chrono::steady_clock::now();
+    statistics = TraceLogExportStatistics();
+    schemaTables->Tables.clear();
+    headerOnlyTable.reset();
+    tables.clear();
+    dictionary.clear();
+
+    Writer writer(options.BufferSize, write, state);
+    auto const finish = [&](HRESULT hr) {
+        statistics.WrittenBytes = writer.GetWrittenBytes();
+        statistics.Duration = std::chrono::steady_clock::now() - startTime;
+        return hr;
+    };
+
+    if (!writer.Write(FileHeader{Magic, FormatVersion, 0}))
+        return finish(E_ABORT);
+
+    size_t const total = source.GetEventCount();
+    for (size_t i = 0; i < total; ++i) {
+        EventInfo const info = source.GetEvent(i);
+        if (!info.Record())
+            continue;
+
+        Table* const table = GetTable(writer, info);
+        if (!table)
+            return finish(E_ABORT);
+
+        AddRow(*table, info, i);
+        if (table->RowCount == options.BatchSize && !WriteBatch(writer, *table))
+            return finish(E_ABORT);
+
+        ++statistics.ExportedEvents;
+    }
+
+    for (Table* const table : tables) {
+        if (table->RowCount != 0 && !WriteBatch(writer, *table))
+            return finish(E_ABORT);
+    }
+
+    if (!writer.Flush())
+        return finish(E_ABORT);
+
+    return finish(S_OK);
+}
+
+HRESULT ColumnarTraceExporter::ExportToFile(TraceLogExportSource source,
+                                            std::wstring const& path)
+{
+    return ExportToNewFile(path, [&](TraceLogExportWriteCallback* write, void* state) {
+        return Export(source, write, state);
+    });
+}
+
+ColumnarTraceExporter::Table* ColumnarTraceExporter::GetTable(Writer& writer,
+                                                              EventInfo const& info)
+{
+    std::unique_ptr<Table>* slot = &headerOnlyTable;
+    if (info) {
+        SchemaKey const key = SchemaKey::FromEvent(*info.Record());
+        auto it = schemaTables->Tables.find(key);
+        if (it == schemaTables->Tables.end())
+            it = schemaTables->Tables.emplace(key.Clone(), nullptr).first;
+        slot = &it->second;
+    }
+    if (*slot)
+        return slot->get();
+
+    auto table = std::make_unique<Table>();
+    table->Id = static_cast<uint32_t>(tables.size());
+
+    for (HeaderColumn const& column : HeaderColumns)
+        table->Columns.emplace_back(column.Name, column.Type, 0);
+
+    uint32_t const firstNewIndex = static_cast<uint32_t>(dictionary.size());
+    std::vector<std::string> newStrings;
+
+    if (info) {
+        table->Key = EventKey::FromEvent(*info.Record());
+        table->HasSchema = true;
+
+        auto const addName = [&](ULONG offset) {
+            wchar_t const* const str = info.GetStringAt(offset);
+            if (!str)
+                return NullIndex;
+
+            field.clear();
+            AppendU16To8(str, field);
+            auto const [it, inserted] =
+                dictionary.try_emplace(field, static_cast<uint32_t>(dictionary.size()));
+            if (inserted)
+                newStrings.push_back(field);
+            return it->second;
+        };
+
+        table->ProviderNameIndex = addName(info->ProviderNameOffset);
+        table->OpcodeNameIndex = addName(info->OpcodeNameOffset);
+        table->TaskNameIndex = addName(info->TaskNameOffset);
+
+        if (options.IncludeProperties && !info.IsStringOnly()) {
+            for (ULONG i = 0; i < info->TopLevelPropertyCount; ++i) {
+                EVENT_PROPERTY_INFO const& propInfo = info->EventPropertyInfoArray[i];
+                ValueKind const kind = PropertyDecoder::GetValueKind(propInfo);
+
+                std::string name;
+                if (wchar_t const* const propName = info.GetStringAt(propInfo.NameOffset))
+                    AppendU16To8(propName, name);
+
+                USHORT const inType = (propInfo.Flags & PropertyStruct) == 0
+                                          ? propInfo.nonStructType.InType
+                                          : 0;
+                table->Columns.emplace_back(std::move(name), GetPropertyColumnType(kind),
+                                            inType);
+                table->PropertyKinds.push_back(kind);
+            }
+        }
+    }
+
+    if (!newStrings.empty() && !writer.WriteDictionary(firstNewIndex, newStrings))
+        return nullptr;
+    if (!writer.WriteTable(*table))
+        return nullptr;
+
+    tables.push_back(table.get());
+    *slot = std::move(table);
+    return slot->get();
+}
+
+void ColumnarTraceExporter::AddRow(Table& table, EventInfo const& info,
+                                   size_t const index)
+{
+    EVENT_RECORD const& record = *info.Record();
+    EVENT_HEADER const& header = record.EventHeader;
+    EVENT_DESCRIPTOR const& descriptor = header.EventDescriptor;
+
+    auto const appendIndex = [](Column& column, uint32_t dictionaryIndex) {
+        if (dictionaryIndex != NullIndex)
+            column.Append(dictionaryIndex);
+        else
+            column.AppendNull();
+    };
+
+    // Ordered like HeaderColumns.
+    Column* column = table.Columns.data();
+    (column++)->Append(static_cast<uint64_t>(index));
+    (column++)->Append(static_cast<int64_t>(header.TimeStamp.QuadPart));
+    (column++)->Append(header.ProviderId);
+    appendIndex(*column++, table.ProviderNameIndex);
+    (column++)->Append(static_cast<uint16_t>(descriptor.Id));
+    (column++)->Append(static_cast<uint8_t>(descriptor.Version));
+    (column++)->Append(static_cast<uint8_t>(descriptor.Channel));
+    (column++)->Append(static_cast<uint8_t>(descriptor.Level));
+    (column++)->Append(static_cast<uint8_t>(descriptor.Opcode));
+    appendIndex(*column++, table.OpcodeNameIndex);
+    (column++)->Append(static_cast<uint16_t>(descriptor.Task));
+    appendIndex(*column++, table.TaskNameIndex);
+    (column++)->Append(static_cast<uint64_t>(descriptor.Keyword));
+    (column++)->Append(static_cast<uint32_t>(header.ProcessId));
+    (column++)->Append(static_cast<uint32_t>(header.ThreadId));
+    (column++)->Append(static_cast<uint32_t>(
+        (header.Flags & EVENT_HEADER_FLAG_PROCESSOR_INDEX) != 0
+            ? record.BufferContext.ProcessorIndex
+            : record.BufferContext.ProcessorNumber));
+
+    size_t const propertyCount = table.PropertyKinds.size();
+    if (propertyCount != 0) {
+        values.resize(propertyCount);
+        decoder.Decode(info, GetPointerSize(header), values);
+    }
+
+    for (size_t i = 0; i < propertyCount; ++i, ++column) {
+        PropertyValue const& value = values[i];
+        if (value.Kind != table.PropertyKinds[i]) {
+            column->AppendNull();
+            continue;
+        }
+
+        switch (value.Kind) {
+        case ValueKind::Signed: column->Append(value.Int); break;
+        case ValueKind::Unsigned:
+        case ValueKind::Time: column->Append(value.UInt); break;
+        case ValueKind::Boolean: column->Append(static_cast<uint8_t>(value.UInt)); break;
+        case ValueKind::Float: column->Append(value.Double); break;
+        case ValueKind::Guid: column->Append(value.Guid); break;
+        case ValueKind::UnicodeString:
+            column->AppendString(value.GetUnicodeString());
+            break;
+        case ValueKind::AnsiString:
+        case ValueKind::Binary:
+        case ValueKind::Array:
+        case ValueKind::Struct: column->AppendBytes(value.Data); break;
+        case ValueKind::None: column->AppendNull(); break;
+        }
+    }
+
+    ++table.RowCount;
+}
+
+bool ColumnarTraceExporter::WriteBatch(Writer& writer, Table& table)
+{
+    if (!writer.WriteBatch(table))
+        return false;
+
+    for (Column& column : table.Columns)
+        column.Clear();
+    table.RowCount = 0;
+    return true;
+}
+
+} // namespace etk
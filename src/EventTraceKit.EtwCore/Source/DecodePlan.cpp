@@ -0,0 +1,416 @@
+#include "etk/DecodePlan.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace etk
+{
+
+namespace
+{
+
+size_t const InvalidSize = static_cast<size_t>(-1);
+
+template<typename T>
+T LoadUnaligned(std::byte const* ptr)
+{
+    T value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+// Size of a SID at the start of the data, or InvalidSize.
+size_t MeasureSid(std::byte const* data, size_t available)
+{
+    if (available < 8)
+        return InvalidSize;
+    size_t const size = 8 + static_cast<uint8_t>(data[1]) * sizeof(uint32_t);
+    return size <= available ? size : InvalidSize;
+}
+
+// In-types TDH accepts for properties giving the count or length of another
+// property.
+bool IsIntegerInType(USHORT inType)
+{
+    switch (inType) {
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_UINT8:
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_UINT16:
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_INT64:
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_HEXINT64: return true;
+    default: return false;
+    }
+}
+
+} // namespace
+
+DecodePlan::DecodePlan(EventInfo const& info)
+{
+    size_t const propertyCount = info->PropertyCount;
+    size_t const arrayEnd = offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray) +
+                            propertyCount * sizeof(EVENT_PROPERTY_INFO);
+    if (arrayEnd > info.InfoSize() || propertyCount > UINT16_MAX ||
+        info->TopLevelPropertyCount > propertyCount)
+        return;
+
+    fields.resize(propertyCount);
+
+    uint32_t prefixBytes = 0;
+    uint32_t prefixPointers = 0;
+    bool fixedOffset = true;
+    for (size_t i = 0; i < info->TopLevelPropertyCount; ++i) {
+        if (!CompileField(info, i, true))
+            break;
+        ++plannedCount;
+
+        Field& field = fields[i];
+        if (!fixedOffset)
+            continue;
+
+        field.PrefixBytes = prefixBytes;
+        field.PrefixPointers = prefixPointers;
+        ++fixedCount;
+
+        if (field.Kind == ElementKind::Fixed && field.CountSource == Source::Fixed) {
+            prefixBytes += field.Bytes * field.Count;
+            prefixPointers += field.Pointers * field.Count;
+        } else {
+            fixedOffset = false;
+        }
+    }
+}
+
+bool DecodePlan::CompileField(EventInfo const& info, size_t index, bool topLevel)
+{
+    EVENT_PROPERTY_INFO const& propInfo = info->EventPropertyInfoArray[index];
+    Field& field = fields[index];
+
+    // Counts and lengths given by other properties are only supported for
+    // top-level properties referring to earlier integer properties.
+    if ((propInfo.Flags & PropertyParamCount) != 0) {
+        if (propInfo.countPropertyIndex == index) {
+            field.CountSource = Source::Prefix;
+        } else if (topLevel && IsIntegerProperty(info, propInfo.countPropertyIndex) &&
+                   propInfo.countPropertyIndex < index) {
+            field.CountSource = Source::Property;
+            field.Count = propInfo.countPropertyIndex;
+        } else {
+            return false;
+        }
+    } else {
+        field.Count = propInfo.count;
+    }
+
+    if ((propInfo.Flags & PropertyParamLength) != 0) {
+        if (!topLevel || !IsIntegerProperty(info, propInfo.lengthPropertyIndex) ||
+            propInfo.lengthPropertyIndex >= index)
+            return false;
+        field.LengthSource = Source::Property;
+        field.Length = propInfo.lengthPropertyIndex;
+    } else {
+        field.Length = propInfo.length;
+    }
+
+    if ((propInfo.Flags & PropertyStruct) != 0) {
+        size_t const first = propInfo.structType.StructStartIndex;
+        size_t const count = propInfo.structType.NumOfStructMembers;
+        if (first < info->TopLevelPropertyCount || first + count > fields.size())
+            return false;
+
+        bool fixed = true;
+        size_t bytes = 0;
+        size_t pointers = 0;
+        for (size_t i = first; i < first + count; ++i) {
+            if ((info->EventPropertyInfoArray[i].Flags & PropertyStruct) != 0 ||
+                !CompileField(info, i, false))
+                return false;
+
+            Field const& member = fields[i];
+            if (member.Kind != ElementKind::Fixed || member.CountSource != Source::Fixed)
+                fixed = false;
+            bytes += member.Bytes * member.Count;
+            pointers += member.Pointers * member.Count;
+        }
+
+        field.FirstMember = static_cast<uint16_t>(first);
+        field.MemberCount = static_cast<uint16_t>(count);
+        if (fixed && bytes <= UINT16_MAX && pointers <= UINT16_MAX) {
+            field.Kind = ElementKind::Fixed;
+            field.Bytes = static_cast<uint16_t>(bytes);
+            field.Pointers = static_cast<uint16_t>(pointers);
+        } else {
+            field.Kind = ElementKind::Struct;
+        }
+        return true;
+    }
+
+    bool const sized = field.LengthSource == Source::Property || field.Length != 0;
+    switch (propInfo.nonStructType.InType) {
+    case TDH_INTYPE_UNICODESTRING:
+        field.Kind = sized ? ElementKind::Sized : ElementKind::UnicodeTerminated;
+        field.Unit = sizeof(uint16_t);
+        break;
+    case TDH_INTYPE_ANSISTRING:
+        field.Kind = sized ? ElementKind::Sized : ElementKind::AnsiTerminated;
+        break;
+    case TDH_INTYPE_BINARY:
+        if (sized) {
+            field.Kind = ElementKind::Sized;
+        } else if (propInfo.nonStructType.OutType == TDH_OUTTYPE_IPV6) {
+            field.Bytes = 16;
+            field.Length = 16;
+        } else {
+            return false;
+        }
+        break;
+    case TDH_INTYPE_COUNTEDSTRING:
+    case TDH_INTYPE_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDSTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDBINARY: field.Kind = ElementKind::Counted; break;
+    case TDH_INTYPE_REVERSEDCOUNTEDSTRING:
+    case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING:
+        field.Kind = ElementKind::ReversedCounted;
+        break;
+    case TDH_INTYPE_HEXDUMP: field.Kind = ElementKind::Counted32; break;
+    case TDH_INTYPE_SID: field.Kind = ElementKind::Sid; break;
+    case TDH_INTYPE_WBEMSID: field.Kind = ElementKind::WbemSid; break;
+    case TDH_INTYPE_NONNULLTERMINATEDSTRING:
+    case TDH_INTYPE_NONNULLTERMINATEDANSISTRING:
+        field.Kind = ElementKind::Remainder;
+        break;
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_UINT8:
+    case TDH_INTYPE_ANSICHAR: field.Bytes = 1; break;
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_UINT16:
+    case TDH_INTYPE_UNICODECHAR: field.Bytes = 2; break;
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_BOOLEAN:
+    case TDH_INTYPE_FLOAT: field.Bytes = 4; break;
+    case TDH_INTYPE_INT64:
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT64:
+    case TDH_INTYPE_DOUBLE:
+    case TDH_INTYPE_FILETIME: field.Bytes = 8; break;
+    case TDH_INTYPE_GUID:
+    case TDH_INTYPE_SYSTEMTIME: field.Bytes = 16; break;
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET: field.Pointers = 1; break;
+    default: return false;
+    }
+
+    // Strings and binary values of fixed length have a fixed size.
+    if (field.Kind == ElementKind::Sized && field.LengthSource == Source::Fixed) {
+        size_t const bytes = field.Length * field.Unit;
+        if (bytes > UINT16_MAX)
+            return false;
+        field.Kind = ElementKind::Fixed;
+        field.Bytes = static_cast<uint16_t>(bytes);
+    }
+
+    return true;
+}
+
+bool DecodePlan::IsIntegerProperty(EventInfo const& info, size_t index) const
+{
+    if (index >= plannedCount)
+        return false;
+
+    // Fixed-size fields of other types, like floats, booleans or pointers, are
+    // not valid counts and leave the property to TDH.
+    EVENT_PROPERTY_INFO const& propInfo = info->EventPropertyInfoArray[index];
+    if ((propInfo.Flags & PropertyStruct) != 0 ||
+        !IsIntegerInType(propInfo.nonStructType.InType))
+        return false;
+
+    Field const& field = fields[index];
+    return field.Kind == ElementKind::Fixed && field.CountSource == Source::Fixed &&
+           field.Count == 1 && field.MemberCount == 0 && field.Pointers == 0 &&
+           (field.Bytes == 1 || field.Bytes == 2 || field.Bytes == 4 || field.Bytes == 8);
+}
+
+bool DecodePlan::ReadInteger(size_t index, cspan<std::byte> userData,
+                             cspan<Location> locations, uint64_t& value) const
+{
+    Location const& location = locations[index];
+    if (location.Size != fields[index].Bytes)
+        return false;
+
+    value = 0;
+    std::memcpy(&value, userData.data() + location.Offset, location.Size);
+    return true;
+}
+
+bool DecodePlan::Locate(cspan<std::byte> userData, size_t pointerSize,
+                        span<Location> locations) const
+{
+    if (locations.size() > plannedCount)
+        return false;
+
+    size_t offset = 0;
+    for (size_t i = 0; i < locations.size(); ++i) {
+        Field const& field = fields[i];
+        if (i < fixedCount)
+            offset = field.PrefixBytes + field.PrefixPointers * pointerSize;
+
+        uint64_t length = field.Length;
+        if (field.LengthSource == Source::Property &&
+            !ReadInteger(field.Length, userData, locations, length))
+            return false;
+
+        uint64_t count = field.Count;
+        if (field.CountSource == Source::Property) {
+            if (!ReadInteger(field.Count, userData, locations, count))
+                return false;
+        } else if (field.CountSource == Source::Prefix) {
+            if (offset > userData.size() || userData.size() - offset < sizeof(uint16_t))
+                return false;
+            count = LoadUnaligned<uint16_t>(userData.data() + offset);
+            offset += sizeof(uint16_t);
+        }
+
+        if (length > UINT16_MAX || count > UINT16_MAX || offset > userData.size())
+            return false;
+
+        size_t size = 0;
+        if (field.Kind == ElementKind::Fixed) {
+            size_t const elementSize = field.Bytes + field.Pointers * pointerSize;
+            size = static_cast<size_t>(count) * elementSize;
+            if (userData.size() - offset < size)
+                return false;
+        } else {
+            for (uint64_t k = 0; k < count; ++k) {
+                size_t const elementSize =
+                    MeasureElement(field, static_cast<size_t>(length), userData,
+                                   offset + size, pointerSize);
+                if (elementSize == InvalidSize)
+                    return false;
+                size += elementSize;
+            }
+        }
+
+        Location& location = locations[i];
+        location.Offset = static_cast<uint32_t>(offset);
+        location.Size = static_cast<uint32_t>(size);
+        location.Count = static_cast<uint16_t>(count);
+        location.Length = static_cast<uint16_t>(length);
+        offset += size;
+    }
+
+    return true;
+}
+
+// Returns the size of a single element at offset, or InvalidSize if the
+// payload is too short.
+size_t DecodePlan::MeasureElement(Field const& field, size_t length,
+                                  cspan<std::byte> userData, size_t offset,
+                                  size_t pointerSize) const
+{
+    if (offset > userData.size())
+        return InvalidSize;
+
+    size_t const available = userData.size() - offset;
+    std::byte const* const data = userData.data() + offset;
+
+    size_t size;
+    switch (field.Kind) {
+    case ElementKind::Fixed: size = field.Bytes + field.Pointers * pointerSize; break;
+    case ElementKind::Sized: size = length * field.Unit; break;
+
+    case ElementKind::UnicodeTerminated:
+        // An unterminated string extends to the end of the payload.
+        for (size_t i = 0; i + 1 < available; i += sizeof(uint16_t)) {
+            if (data[i] == std::byte(0) && data[i + 1] == std::byte(0))
+                return i + sizeof(uint16_t);
+        }
+        return available - available % sizeof(uint16_t);
+
+    case ElementKind::AnsiTerminated: {
+        auto const end = std::find(data, data + available, std::byte(0));
+        return end != data + available ? static_cast<size_t>(end - data) + 1 : available;
+    }
+
+    case ElementKind::Counted:
+    case ElementKind::ReversedCounted:
+        if (available < sizeof(uint16_t))
+            return InvalidSize;
+        size = field.Kind == ElementKind::Counted
+                   ? LoadUnaligned<uint16_t>(data)
+                   : (static_cast<size_t>(data[0]) << 8) | static_cast<size_t>(data[1]);
+        size += sizeof(uint16_t);
+        break;
+
+    case ElementKind::Counted32:
+        if (available < sizeof(uint32_t))
+            return InvalidSize;
+        size = sizeof(uint32_t) + static_cast<size_t>(LoadUnaligned<uint32_t>(data));
+        break;
+
+    case ElementKind::Sid: return MeasureSid(data, available);
+
+    case ElementKind::WbemSid: {
+        size_t const headerSize = 2 * pointerSize;
+        if (available < headerSize)
+            return InvalidSize;
+        size_t const sidSize = MeasureSid(data + headerSize, available - headerSize);
+        return sidSize != InvalidSize ? headerSize + sidSize : InvalidSize;
+    }
+
+    case ElementKind::Remainder: return available;
+
+    case ElementKind::Struct:
+        size = 0;
+        for (size_t i = 0; i < field.MemberCount; ++i) {
+            size_t const memberSize = MeasureMember(fields[field.FirstMember + i],
+                                                    userData, offset + size, pointerSize);
+            if (memberSize == InvalidSize)
+                return InvalidSize;
+            size += memberSize;
+        }
+        break;
+
+    default: return InvalidSize;
+    }
+
+    return size <= available ? size : InvalidSize;
+}
+
+// Returns the size of all elements of a struct member at offset, including a
+// count prefix, or InvalidSize.
+size_t DecodePlan::MeasureMember(Field const& field, cspan<std::byte> userData,
+                                 size_t offset, size_t pointerSize) const
+{
+    size_t size = 0;
+    size_t count = field.Count;
+    if (field.CountSource == Source::Prefix) {
+        if (offset > userData.size() || userData.size() - offset < sizeof(uint16_t))
+            return InvalidSize;
+        count = LoadUnaligned<uint16_t>(userData.data() + offset);
+        size = sizeof(uint16_t);
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        size_t const elementSize =
+            MeasureElement(field, field.Length, userData, offset + size, pointerSize);
+        if (elementSize == InvalidSize)
+            return InvalidSize;
+        size += elementSize;
+    }
+
+    return size;
+}
+
+size_t DecodePlan::GetMemorySize() const
+{
+    return sizeof(*this) + fields.capacity() * sizeof(Field);
+}
+
+} // namespace etk
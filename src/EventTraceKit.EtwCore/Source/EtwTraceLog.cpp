@@ -3,12 +3,30 @@
 #include "EventInfoCache.h"
 #include "ManualResetEventSlim.h"
 #include "TraceDataContext.h"
+#include "etk/HeaderFilter.h"
+#include "etk/PayloadFilter.h"
 #include "etk/Support/Allocator.h"
+#include "etk/Support/CompilerSupport.h"
 #include "etk/Support/SetThreadDescription.h"
 
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/container/node_hash_map.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <mutex>
 #include <shared_mutex>
+#include <thread>
+#include <vector>
 
 namespace etk
 {
@@ -20,6 +38,7 @@ class EtwTraceLog : public ITraceLog
 {
 public:
     explicit EtwTraceLog(TraceDataToken traceDataToken);
+    ~EtwTraceLog();
 
     void SetCallback(TraceLogEventsChangedCallback* callback, void* state)
     {
@@ -35,9 +54,45 @@ public:
 
     virtual void Clear() override;
 
+    virtual size_t GetClearCount() const override { return clearCount; }
+
     virtual HRESULT UpdateTraceData(cspan<std::wstring> eventManifests) override;
 
+    virtual size_t GetResolvedEventCount() const override { return resolvedCount; }
+
+    virtual void SetSchemasResolvedCallback(TraceLogSchemasResolvedCallback* callback,
+                                            void* state) override;
+
+    virtual void SetSchemaRetryPolicy(TraceLogSchemaRetryPolicy const& policy) override
+    {
+        eventInfoCache.SetRetryPolicy(policy);
+    }
+
+    virtual void SetSchemaCacheCapacity(size_t bytes) override;
+
+    virtual TraceLogSchemaStatistics GetSchemaStatistics() const override
+    {
+        return eventInfoCache.GetStatistics();
+    }
+
 private:
+    struct ResolveRequest
+    {
+        size_t EventIndex;
+        unsigned Generation;
+
+        // Requests to refresh schemas after manifests have been loaded carry
+        // the trace data generation from before loading them.
+        bool Refresh;
+        unsigned TraceDataGeneration;
+    };
+
+    void ResolverThreadProc();
+    void ResolveSchema(ResolveRequest const& request);
+    void RefreshSchemas(ResolveRequest const& request);
+    void NotifySchemasResolved(std::vector<size_t> const& indices, size_t count);
+    void UpdateResolvedCount();
+
     EventInfoCache eventInfoCache;
     TraceDataToken traceDataToken;
 
@@ -45,13 +100,33 @@ private:
     EventRecordAllocator eventRecordAllocator;
 
     std::deque<EventInfo> events;
+    std::deque<size_t> sourceIndices; // Parallel to events.
     std::atomic<size_t> eventCount{};
 
+    // Stored events whose schema is still being resolved. Keys refer to the
+    // TraceLogging metadata of the stored events.
+    absl::node_hash_map<SchemaKey, std::vector<size_t>> pendingEvents;
+    std::atomic<size_t> resolvedCount{};
+    unsigned generation = 0; // Incremented by Clear.
+    std::atomic<size_t> clearCount{};
+
     using SharedLock = std::shared_lock<std::shared_mutex>;
     using ExclusiveLock = std::unique_lock<std::shared_mutex>;
     mutable std::shared_mutex mutex;
     TraceLogEventsChangedCallback* changedCallback;
     void* changedCallbackState;
+
+    // Held while a schema is resolved. Clear takes it so that the stored
+    // record being resolved stays valid without holding the log lock.
+    std::mutex resolverMutex;
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<ResolveRequest> resolveQueue;
+    bool stopResolver = false;
+    TraceLogSchemasResolvedCallback* schemasResolvedCallback;
+    void* schemasResolvedCallbackState;
+    std::thread resolverThread;
 };
 
 template<typename Allocator>
@@ -86,6 +161,12 @@ EVENT_RECORD* CopyEvent(Allocator& alloc, EVENT_RECORD const* record)
 void NullCallback(size_t, void*)
 {}
 
+void NullRebuildProgressCallback(size_t, size_t, void*)
+{}
+
+void NullSchemasResolvedCallback(size_t const*, size_t, void*)
+{}
+
 class FilteredTraceLog : public IFilteredTraceLog
 {
 public:
@@ -93,6 +174,9 @@ public:
                               TraceLogFilter* filter = nullptr)
         : filterObj(filter)
         , filter(filter ? filter->Filter : nullptr)
+        , headerFilter(CreateHeaderFilter(filter))
+        , payloadFilter(filter ? filter->PayloadPredicates
+                               : std::vector<PayloadPredicate>())
         , changedCallback(callback ? callback : &NullCallback)
         , changedCallbackState(nullptr)
     {
@@ -122,12 +206,45 @@ public:
         return EventInfo();
     }
 
+    virtual EventInfo GetEvent(size_t index, size_t& sourceIndex) const override
+    {
+        if (index >= eventCount)
+            return EventInfo();
+
+        SharedLock lock(mutex);
+        if (index >= events.size())
+            return EventInfo();
+
+        sourceIndex = sourceIndices[index];
+        return events[index];
+    }
+
     virtual void SetFilter(TraceLogFilter* filter) override
     {
         pendingFilter = filter;
         changedEvent.Set();
     }
 
+    virtual void SetRebuildProgressCallback(TraceLogRebuildProgressCallback* callback,
+                                            void* state) override
+    {
+        std::lock_guard<std::mutex> lock(rebuildMutex);
+        rebuildProgressCallback = callback ? callback : &NullRebuildProgressCallback;
+        rebuildProgressCallbackState = state;
+    }
+
+    virtual TraceLogRebuildStatistics GetRebuildStatistics() const override
+    {
+        std::lock_guard<std::mutex> lock(rebuildMutex);
+        return rebuildStatistics;
+    }
+
+    virtual void SetNotificationPolicy(TraceLogNotificationPolicy const& policy) override
+    {
+        std::lock_guard<std::mutex> lock(policyMutex);
+        notificationPolicy = policy;
+    }
+
     void SetLog(ITraceLog* traceLog) { this->traceLog = traceLog; }
 
     static void Callback(size_t /*newCount*/, void* state)
@@ -146,10 +263,17 @@ private:
                 break;
 
             changedEvent.Reset();
+            {
+                std::lock_guard<std::mutex> lock(policyMutex);
+                activePolicy = notificationPolicy;
+            }
+
             auto const newFilter = pendingFilter.exchange(nullptr);
             if (newFilter) {
                 filterObj = std::unique_ptr<TraceLogFilter>(newFilter);
                 filter = filterObj->Filter;
+                headerFilter = CreateHeaderFilter(filterObj.get());
+                payloadFilter = PayloadFilter(filterObj->PayloadPredicates);
                 Rebuild();
                 continue;
             }
@@ -160,50 +284,162 @@ private:
 
     void ProcessEvents()
     {
-        size_t const newTotal = traceLog->GetEventCount();
+        // Events are filtered once their schema lookup has finished. The log
+        // signals a change when pending schemas are resolved.
+        size_t const newTotal = traceLog->GetResolvedEventCount();
 
-        if (newTotal > prevTotal)
+        if (newTotal > prevTotal) {
             ProcessLog(prevTotal, newTotal);
-        else if (newTotal == 0)
+            PublishMatches();
+            prevTotal = newTotal;
+        } else if (newTotal == 0) {
             Clear();
-        else if (newTotal < prevTotal)
-            Rebuild();
-
-        prevTotal = newTotal;
+            prevTotal = 0;
+        } else if (newTotal < prevTotal) {
+            Rebuild(); // Updates prevTotal.
+        }
     }
 
+    // A rebuild is abandoned as soon as a newer filter is pending or the log is
+    // shutting down. ThreadProc picks up the pending filter on its next iteration.
+    bool IsRebuildCancelled() const { return !running || pendingFilter.load() != nullptr; }
+
     void Rebuild()
     {
+        auto const startTime = Clock::now();
+
+        TraceLogRebuildProgressCallback* progressCallback;
+        void* progressCallbackState;
+        {
+            std::lock_guard<std::mutex> lock(rebuildMutex);
+            progressCallback = rebuildProgressCallback;
+            progressCallbackState = rebuildProgressCallbackState;
+        }
+
         Clear();
-        ProcessLog(0, traceLog->GetEventCount());
+
+        size_t const total = traceLog->GetResolvedEventCount();
+        progressCallback(0, total, progressCallbackState);
+
+        size_t scanned = 0;
+        bool cancelled = false;
+        while (scanned < total) {
+            if (IsRebuildCancelled()) {
+                cancelled = true;
+                break;
+            }
+
+            size_t const chunkEnd = std::min(scanned + RebuildChunkSize, total);
+            size_t const processed = ProcessLog(scanned, chunkEnd);
+            scanned = processed;
+            progressCallback(scanned, total, progressCallbackState);
+
+            // The source log was cleared while scanning.
+            if (processed != chunkEnd)
+                break;
+        }
+
+        PublishMatches();
+
+        // Events past the scanned range are picked up by ProcessEvents.
+        prevTotal = cancelled ? 0 : scanned;
+
+        auto const duration = Clock::now() - startTime;
+
+        std::lock_guard<std::mutex> lock(rebuildMutex);
+        rebuildStatistics.TotalDuration += duration;
+        if (cancelled) {
+            ++rebuildStatistics.CancelledRebuilds;
+        } else {
+            ++rebuildStatistics.CompletedRebuilds;
+            rebuildStatistics.LastEventsScanned = scanned;
+            rebuildStatistics.LastDuration = duration;
+            rebuildStatistics.MaxDuration =
+                std::max<std::chrono::nanoseconds>(rebuildStatistics.MaxDuration, duration);
+        }
     }
 
-    void ProcessLog(size_t begin, size_t end)
+    HeaderFilter CreateHeaderFilter(TraceLogFilter const* filter)
     {
-        size_t count = 0;
-        for (size_t i = begin; i < end; ++i) {
-            EventInfo const evt = traceLog->GetEvent(i);
-            if (!evt.Record())
-                break;
+        if (!filter)
+            return HeaderFilter();
+        return HeaderFilter(filter->HeaderPredicates, providerIndices);
+    }
 
-            if (MatchesFilter(evt)) {
-                std::unique_lock<decltype(mutex)> lock(mutex);
-                events.push_back(evt);
-                ++count;
+    // Returns the index of the first event that was not processed. This is less
+    // than end if the source log was cleared concurrently.
+    //
+    // Events are fetched in blocks so that header predicates can be evaluated
+    // column-wise before the filter callback runs for the remaining candidates.
+    // The matches of a block are appended under a single lock, and published
+    // according to the notification policy.
+    size_t ProcessLog(size_t begin, size_t end)
+    {
+        size_t i = begin;
+        while (i < end) {
+            size_t const blockSize = std::min(end - i, HeaderColumnBlock::Capacity);
+
+            size_t fetched = 0;
+            for (; fetched < blockSize; ++fetched) {
+                blockEvents[fetched] = traceLog->GetEvent(i + fetched);
+                if (!blockEvents[fetched].Record())
+                    break;
             }
 
-            if (count > RebuildBatchSize) {
-                AddCount(count);
-                count = 0;
+            cspan<EventInfo> const block(blockEvents.data(), fetched);
+            if (headerFilter.IsEmpty())
+                blockSelection.SelectFirst(fetched);
+            else
+                headerFilter.Evaluate(block, providerIndices, *headerColumns,
+                                      blockSelection);
+
+            // Matches are compacted in place. Selected indices are ascending, so
+            // this never overwrites an event that is yet to be visited.
+            size_t matchCount = 0;
+            blockSelection.ForEachSet([&](size_t index) {
+                if (MatchesFilter(block[index])) {
+                    blockIndices[matchCount] = i + index;
+                    blockEvents[matchCount++] = block[index];
+                }
+            });
+
+            if (matchCount != 0) {
+                std::unique_lock<decltype(mutex)> lock(mutex);
+                events.insert(events.end(), blockEvents.begin(),
+                              blockEvents.begin() + matchCount);
+                sourceIndices.insert(sourceIndices.end(), blockIndices.begin(),
+                                     blockIndices.begin() + matchCount);
             }
+
+            unpublishedCount += matchCount;
+            if (unpublishedCount >= activePolicy.MaxBatchSize ||
+                (unpublishedCount != 0 &&
+                 Clock::now() - lastPublishTime >= activePolicy.MaxLatency))
+                PublishMatches();
+
+            i += fetched;
+            if (fetched != blockSize)
+                break;
         }
 
-        if (count > 0)
-            AddCount(count);
+        return i;
     }
 
-    bool MatchesFilter(EventInfo const& evt) const
+    void PublishMatches()
     {
+        lastPublishTime = Clock::now();
+        if (unpublishedCount == 0)
+            return;
+
+        AddCount(unpublishedCount);
+        unpublishedCount = 0;
+    }
+
+    bool MatchesFilter(EventInfo const& evt)
+    {
+        if (!payloadFilter.Matches(evt))
+            return false;
+
         return !filter ||
                filter(const_cast<void*>(static_cast<void const*>(evt.Record())),
                       const_cast<void*>(static_cast<void const*>(evt.Info())),
@@ -212,10 +448,16 @@ private:
 
     void Clear()
     {
+        // The source log may have released the schemas of cleared events.
+        payloadFilter.ClearLayouts();
+        unpublishedCount = 0;
+
         SetCount(0);
         std::unique_lock<decltype(mutex)> lock(mutex);
         events.clear();
         events.shrink_to_fit();
+        sourceIndices.clear();
+        sourceIndices.shrink_to_fit();
     }
 
     void AddCount(size_t additionalCount)
@@ -230,18 +472,33 @@ private:
         changedCallback(newCount, changedCallbackState);
     }
 
-    static size_t const RebuildBatchSize = 50;
+    using Clock = std::chrono::steady_clock;
+
+    // Number of events scanned between cancellation checks and progress reports.
+    static size_t const RebuildChunkSize = 4096;
 
     // Owned by ThreadProc
     size_t prevTotal = 0;
+    size_t unpublishedCount = 0;
+    Clock::time_point lastPublishTime;
+    TraceLogNotificationPolicy activePolicy;
     std::unique_ptr<TraceLogFilter> filterObj;
     TraceLogFilterEvent* filter;
+    ProviderIndexMap providerIndices;
+    HeaderFilter headerFilter;
+    PayloadFilter payloadFilter;
+    std::unique_ptr<HeaderColumnBlock> headerColumns{
+        std::make_unique<HeaderColumnBlock>()};
+    std::array<EventInfo, HeaderColumnBlock::Capacity> blockEvents;
+    std::array<size_t, HeaderColumnBlock::Capacity> blockIndices;
+    SelectionBitmap blockSelection;
 
     // Shared
     using SharedLock = std::shared_lock<std::shared_mutex>;
     using ExclusiveLock = std::unique_lock<std::shared_mutex>;
     mutable std::shared_mutex mutex;
     std::deque<EventInfo> events;
+    std::deque<size_t> sourceIndices; // Parallel to events.
     std::atomic<size_t> eventCount{};
     std::atomic<TraceLogFilter*> pendingFilter{};
     ManualResetEventSlim changedEvent;
@@ -249,6 +506,14 @@ private:
     std::atomic<bool> running{};
     std::thread filterThread;
 
+    mutable std::mutex rebuildMutex;
+    TraceLogRebuildProgressCallback* rebuildProgressCallback = &NullRebuildProgressCallback;
+    void* rebuildProgressCallbackState = nullptr;
+    TraceLogRebuildStatistics rebuildStatistics;
+
+    mutable std::mutex policyMutex;
+    TraceLogNotificationPolicy notificationPolicy;
+
     // Immutable
     ITraceLog* traceLog{};
     TraceLogEventsChangedCallback* changedCallback;
@@ -258,28 +523,264 @@ private:
 } // namespace
 
 EtwTraceLog::EtwTraceLog(TraceDataToken traceDataToken)
-    : traceDataToken(std::move(traceDataToken))
+    : eventInfoCache(traceDataToken.Context())
+    , traceDataToken(std::move(traceDataToken))
     , changedCallback(&NullCallback)
     , changedCallbackState()
-{}
+    , schemasResolvedCallback(&NullSchemasResolvedCallback)
+    , schemasResolvedCallbackState()
+{
+    resolverThread = std::thread(&EtwTraceLog::ResolverThreadProc, this);
+}
+
+EtwTraceLog::~EtwTraceLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopResolver = true;
+    }
+
+    queueChanged.notify_one();
+    resolverThread.join();
+}
+
+void EtwTraceLog::SetSchemasResolvedCallback(TraceLogSchemasResolvedCallback* callback,
+                                             void* state)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    schemasResolvedCallback = callback ? callback : &NullSchemasResolvedCallback;
+    schemasResolvedCallbackState = state;
+}
+
+void EtwTraceLog::SetSchemaCacheCapacity(size_t bytes)
+{
+    // Trimming must not race with the resolver, which uses schemas before it
+    // pins them.
+    std::lock_guard<std::mutex> resolverLock(resolverMutex);
+    eventInfoCache.SetCapacity(bytes);
+    eventInfoCache.Trim();
+}
 
 void EtwTraceLog::ProcessEvent(EVENT_RECORD const& record)
 {
+    // New schemas may require TDH calls, so they are resolved on the resolver
+    // thread and the event is stored without schema until then. Known schemas
+    // are looked up without holding the log lock. TryGet pins the schema it
+    // returns, which keeps the resolver thread from evicting it.
+    EventInfo info;
+    bool const resolved = eventInfoCache.TryGet(record, info);
+
+    size_t newCount;
+    bool requestResolve = false;
+    ResolveRequest request;
     {
         ExclusiveLock lock(mutex);
         EVENT_RECORD* eventCopy = CopyEvent(eventRecordAllocator, &record);
-        events.push_back(eventInfoCache.Get(*eventCopy));
+        size_t const index = events.size();
+        events.push_back(
+            EventInfo(eventCopy, info.Info(), info.InfoSize(), info.Compiled()));
+        newCount = ++eventCount;
+
+        if (!resolved) {
+            auto& pending = pendingEvents[EventInfoCache::GetSchemaKey(*eventCopy)];
+            requestResolve = pending.empty();
+            pending.push_back(index);
+            request = {index, generation, false, 0};
+        } else if (pendingEvents.empty()) {
+            resolvedCount = newCount;
+        }
+    }
+
+    if (requestResolve) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        resolveQueue.push_back(request);
+        queueChanged.notify_one();
     }
 
-    size_t const newCount = ++eventCount;
     changedCallback(newCount, changedCallbackState);
 }
 
+void EtwTraceLog::ResolverThreadProc()
+{
+    SetCurrentThreadDescription(L"ETW Schema Resolver Thread");
+
+    for (;;) {
+        ResolveRequest request;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock,
+                              [&] { return stopResolver || !resolveQueue.empty(); });
+            if (stopResolver)
+                break;
+
+            request = resolveQueue.front();
+            resolveQueue.pop_front();
+        }
+
+        if (request.Refresh)
+            RefreshSchemas(request);
+        else
+            ResolveSchema(request);
+    }
+}
+
+void EtwTraceLog::ResolveSchema(ResolveRequest const& request)
+{
+    std::lock_guard<std::mutex> resolverLock(resolverMutex);
+
+    EVENT_RECORD const* record;
+    {
+        SharedLock lock(mutex);
+        if (request.Generation != generation)
+            return;
+        record = events[request.EventIndex].Record();
+    }
+
+    EventInfo const info = eventInfoCache.Get(*record);
+
+    std::vector<size_t> indices;
+    size_t count;
+    {
+        ExclusiveLock lock(mutex);
+        auto const it = pendingEvents.find(EventInfoCache::GetSchemaKey(*record));
+        if (it == pendingEvents.end())
+            return;
+
+        indices = std::move(it->second);
+        pendingEvents.erase(it);
+
+        for (size_t index : indices) {
+            EVENT_RECORD const* pendingRecord = events[index].Record();
+            events[index] =
+                EventInfo(pendingRecord, info.Info(), info.InfoSize(), info.Compiled());
+        }
+
+        eventInfoCache.Pin(*record, indices.size());
+        eventInfoCache.Trim();
+
+        UpdateResolvedCount();
+        count = eventCount;
+    }
+
+    NotifySchemasResolved(indices, count);
+}
+
+void EtwTraceLog::RefreshSchemas(ResolveRequest const& request)
+{
+    std::lock_guard<std::mutex> resolverLock(resolverMutex);
+
+    std::vector<GUID> providerIds;
+    bool const allProviders = !traceDataToken.Context()->GetChangedProviders(
+        request.TraceDataGeneration, providerIds);
+    eventInfoCache.Invalidate(providerIds, allProviders);
+
+    auto const isAffected = [&](SchemaKey const& key) {
+        if (key.IsTraceLogging())
+            return false;
+
+        GUID const providerId = key.GetEventKey().GetProviderId();
+        return allProviders || std::find(providerIds.begin(), providerIds.end(),
+                                         providerId) != providerIds.end();
+    };
+
+    // Group the stored events of affected providers by schema. Events still
+    // pending are resolved by their own request.
+    struct StaleSchema
+    {
+        EVENT_RECORD const* Record = nullptr;
+        std::vector<size_t> Indices;
+    };
+
+    absl::node_hash_map<SchemaKey, StaleSchema> staleSchemas;
+    {
+        SharedLock lock(mutex);
+        if (request.Generation != generation)
+            return;
+
+        for (size_t index = 0; index < events.size(); ++index) {
+            EventInfo const& event = events[index];
+            SchemaKey key = EventInfoCache::GetSchemaKey(*event.Record());
+            if (!isAffected(key) ||
+                (!event.Info() && pendingEvents.find(key) != pendingEvents.end()))
+                continue;
+
+            auto& stale = staleSchemas[std::move(key)];
+            stale.Record = event.Record();
+            stale.Indices.push_back(index);
+        }
+    }
+
+    // Resolve the schemas again without holding the log lock. Events keep
+    // their previous schema if the new lookup fails.
+    std::vector<std::tuple<EventInfo, std::vector<size_t> const*>> refreshed;
+    for (auto const& [key, stale] : staleSchemas) {
+        EventInfo const info = eventInfoCache.Get(*stale.Record);
+        if (info.Info())
+            refreshed.emplace_back(info, &stale.Indices);
+    }
+
+    if (refreshed.empty())
+        return;
+
+    std::vector<size_t> updatedIndices;
+    size_t count;
+    {
+        ExclusiveLock lock(mutex);
+        for (auto const& [info, indices] : refreshed) {
+            for (size_t index : *indices) {
+                EVENT_RECORD const* record = events[index].Record();
+                events[index] =
+                    EventInfo(record, info.Info(), info.InfoSize(), info.Compiled());
+            }
+
+            eventInfoCache.Pin(*info.Record(), indices->size());
+            updatedIndices.insert(updatedIndices.end(), indices->begin(), indices->end());
+        }
+
+        eventInfoCache.Trim();
+        count = eventCount;
+    }
+
+    std::sort(updatedIndices.begin(), updatedIndices.end());
+    NotifySchemasResolved(updatedIndices, count);
+}
+
+void EtwTraceLog::NotifySchemasResolved(std::vector<size_t> const& indices, size_t count)
+{
+    TraceLogSchemasResolvedCallback* callback;
+    void* callbackState;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        callback = schemasResolvedCallback;
+        callbackState = schemasResolvedCallbackState;
+    }
+
+    callback(indices.data(), indices.size(), callbackState);
+    changedCallback(count, changedCallbackState);
+}
+
+// Requires the exclusive log lock.
+void EtwTraceLog::UpdateResolvedCount()
+{
+    size_t firstPending = events.size();
+    for (auto const& entry : pendingEvents)
+        firstPending = std::min(firstPending, entry.second.front());
+
+    resolvedCount = firstPending;
+}
+
 void EtwTraceLog::Clear()
 {
+    ++clearCount;
     eventCount = 0;
+    resolvedCount = 0;
     {
+        // Wait for a schema being resolved since its record is about to be
+        // released. Requests still queued are discarded by generation.
+        std::lock_guard<std::mutex> resolverLock(resolverMutex);
         ExclusiveLock lock(mutex);
+        ++generation;
+        pendingEvents.clear();
         events.clear();
         events.shrink_to_fit();
         eventInfoCache.Clear();
@@ -302,7 +803,25 @@ EventInfo EtwTraceLog::GetEvent(size_t index) const
 
 HRESULT EtwTraceLog::UpdateTraceData(cspan<std::wstring> eventManifests)
 {
-    return traceDataToken.Update(eventManifests);
+    auto const& context = traceDataToken.Context();
+    unsigned const traceDataGeneration = context ? context->GetGeneration() : 0;
+    HR(traceDataToken.Update(eventManifests));
+
+    // Newly loaded manifests may describe events that are already cached or
+    // stored, so their schemas are refreshed in the background.
+    if (context && context->GetGeneration() != traceDataGeneration) {
+        ResolveRequest request = {0, 0, true, traceDataGeneration};
+        {
+            SharedLock lock(mutex);
+            request.Generation = generation;
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        resolveQueue.push_back(request);
+        queueChanged.notify_one();
+    }
+
+    return S_OK;
 }
 
 std::unique_ptr<ITraceLog> CreateEtwTraceLog(TraceLogEventsChangedCallback* callback)
@@ -325,4 +844,9 @@ CreateFilteredTraceLog(TraceLogEventsChangedCallback* callback, TraceLogFilter*
     return {std::move(traceLog), std::move(filteredLog)};
 }
 
+void SetSchemaCacheFile(std::wstring const& path)
+{
+    TraceDataContext::SetGlobalSchemaCachePath(path);
+}
+
 } // namespace etk
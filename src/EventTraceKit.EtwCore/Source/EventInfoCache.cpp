@@ -1,40 +1,285 @@
 #include "EventInfoCache.h"
 
+#include "etk/TraceLoggingMetadata.h"
+
+#include <optional>
+#include <utility>
+
 namespace etk
 {
 
-static EVENT_HEADER_EXTENDED_DATA_ITEM const* GetTlogEventSchemaExtendedItem(
-    EVENT_RECORD const& record)
+static EVENT_HEADER_EXTENDED_DATA_ITEM const* GetExtendedItem(EVENT_RECORD const& record,
+                                                              USHORT type)
 {
     for (unsigned i = 0; i < record.ExtendedDataCount; ++i) {
-        if (record.ExtendedData[i].ExtType == EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL)
+        if (record.ExtendedData[i].ExtType == type)
             return &record.ExtendedData[i];
     }
 
     return nullptr;
 }
 
-EventInfoCache::EventInfoCache()
-    : infos(50)
-{}
+static cspan<std::byte> GetExtendedData(EVENT_HEADER_EXTENDED_DATA_ITEM const& item)
+{
+    return {reinterpret_cast<std::byte const*>(item.DataPtr), item.DataSize};
+}
+
+static EventInfoCache::TraceEventInfoPtr CreateTlogEventInfo(
+    EVENT_RECORD const& record, EVENT_HEADER_EXTENDED_DATA_ITEM const& schemaItem)
+{
+    TraceLoggingEventMetadata metadata;
+    if (!ParseTraceLoggingEventMetadata(GetExtendedData(schemaItem), metadata))
+        return EventInfoCache::TraceEventInfoPtr(nullptr, 0);
+
+    std::string providerName;
+    if (auto const traits = GetExtendedItem(record, EVENT_HEADER_EXT_TYPE_PROV_TRAITS))
+        (void)ParseTraceLoggingProviderName(GetExtendedData(*traits), providerName);
+
+    return CreateTraceLoggingEventInfo(record.EventHeader, metadata, providerName);
+}
+
+// Schemas are compiled once instead of being interpreted for every formatted
+// event.
+static std::unique_ptr<CompiledSchema>
+CompileSchema(EventInfoCache::TraceEventInfoPtr const& info)
+{
+    auto const& [schema, schemaSize] = info;
+    if (!schema)
+        return nullptr;
+
+    return std::make_unique<CompiledSchema>(EventInfo(nullptr, schema.get(), schemaSize));
+}
+
+bool EventInfoCache::TryGet(EVENT_RECORD const& record, EventInfo& info)
+{
+    SchemaKey const key = GetSchemaKey(record);
+
+    // The guard keeps an entry evicted by a concurrent Trim allocated until
+    // the lookup is done with it.
+    decltype(infos)::ReadGuard guard;
+    auto const entry = infos.Find(key, guard);
+    if (!entry || IsOutdated(*entry))
+        return false;
+
+    auto const& [schema, schemaSize] = entry->Info;
+    if (schema) {
+        if (!Pin(key, *entry, 1))
+            return false;
+    } else {
+        unresolvedEvents.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(unpinnedMutex);
+        (void)unpinned.Find(key);
+    }
+
+    info = EventInfo(&record, schema.get(), schemaSize, entry->Compiled.get());
+    return true;
+}
 
 EventInfo EventInfoCache::Get(EVENT_RECORD const& record)
 {
-    auto tlogExt = GetTlogEventSchemaExtendedItem(record);
+    SchemaKey const key = GetSchemaKey(record);
+
+    bool created = false;
+    auto const& entry = infos.GetOrUpdate(
+        key, [&](Entry const& entry) { return !IsOutdated(entry); },
+        [&](SchemaKey const& key,
+            Entry const* previous) -> std::optional<std::pair<SchemaKey, Entry>> {
+            created = true;
+
+            unsigned const traceDataGeneration = context ? context->GetGeneration() : 0;
+            TraceEventInfoPtr info = CreateEventInfo(record);
+
+            // A retry that fails again only refreshes the failed entry, so that
+            // periodic retries do not accumulate replaced entries.
+            bool const wasUnresolved = previous && !std::get<0>(previous->Info);
+            if (!std::get<0>(info) && wasUnresolved) {
+                previous->TraceDataGeneration.store(traceDataGeneration,
+                                                    std::memory_order_relaxed);
+                previous->FailureTime.store(Clock::now().time_since_epoch().count(),
+                                            std::memory_order_relaxed);
+                previous->Stale.store(false, std::memory_order_relaxed);
+                failedLookups.fetch_add(1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+
+            Entry entry;
+            entry.TraceDataGeneration.store(traceDataGeneration,
+                                            std::memory_order_relaxed);
+            entry.Info = std::move(info);
+            entry.Compiled = CompileSchema(entry.Info);
+
+            SchemaKey storedKey = key.Clone();
+            entry.Size = sizeof(SchemaKey) + sizeof(Entry) +
+                         storedKey.GetMetadataSize() + std::get<1>(entry.Info);
+            if (entry.Compiled)
+                entry.Size += entry.Compiled->GetMemorySize();
+
+            cachedSize.fetch_add(entry.Size, std::memory_order_relaxed);
+            if (previous)
+                cachedSize.fetch_sub(previous->Size, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(unpinnedMutex);
+                unpinned.Insert(storedKey, entry.Size);
+            }
+
+            // Replaced entries stay allocated until the cache is cleared twice,
+            // so events still referring to a stale schema remain valid.
+            if (!std::get<0>(entry.Info)) {
+                entry.FailureTime.store(Clock::now().time_since_epoch().count(),
+                                        std::memory_order_relaxed);
+                failedLookups.fetch_add(1, std::memory_order_relaxed);
+                unresolvedSchemas.fetch_add(1, std::memory_order_relaxed);
+            } else if (wasUnresolved) {
+                unresolvedSchemas.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            return std::make_pair(std::move(storedKey), std::move(entry));
+        });
+
+    auto const& [schema, schemaSize] = entry.Info;
+    if (!schema && !created)
+        unresolvedEvents.fetch_add(1, std::memory_order_relaxed);
+
+    return EventInfo(&record, schema.get(), schemaSize, entry.Compiled.get());
+}
+
+void EventInfoCache::Pin(EVENT_RECORD const& record, size_t count)
+{
+    SchemaKey const key = GetSchemaKey(record);
+    if (auto const entry = infos.Find(key))
+        (void)Pin(key, *entry, count);
+}
+
+bool EventInfoCache::Pin(SchemaKey const& key, Entry const& entry, size_t count)
+{
+    if (!std::get<0>(entry.Info) || count == 0)
+        return true;
+
+    if (entry.Pins.fetch_add(count, std::memory_order_relaxed) != 0)
+        return true;
+
+    // Trim removes the entries it evicts from the unpinned ones first, so an
+    // entry that is no longer among them has lost the race with an eviction.
+    std::lock_guard<std::mutex> lock(unpinnedMutex);
+    return unpinned.Remove(key);
+}
+
+void EventInfoCache::SetCapacity(size_t bytes)
+{
+    capacity.store(bytes, std::memory_order_relaxed);
+}
+
+void EventInfoCache::Trim()
+{
+    // Pinned entries cannot be evicted, so only unpinned ones count against
+    // the capacity. Otherwise pinned schemas exceeding it would evict every
+    // failed lookup as soon as it is cached.
+    size_t const maxSize = capacity.load(std::memory_order_relaxed);
 
-    EventKey key = tlogExt ? CreateTlogEventKey(record.EventHeader.ProviderId, *tlogExt)
-                           : EventKey::FromEvent(record);
+    std::vector<SchemaKey> evicted;
+    {
+        std::lock_guard<std::mutex> lock(unpinnedMutex);
+        while (unpinned.Weight() > maxSize) {
+            auto [key, size] = unpinned.PopLeastRecent();
+            cachedSize.fetch_sub(size, std::memory_order_relaxed);
+            evicted.push_back(std::move(key));
+        }
+    }
 
-    auto& entry = infos[key];
-    if (!std::get<0>(entry))
-        entry = CreateEventInfo(record);
+    // Only Trim erases entries, so the entries found here stay valid.
+    for (SchemaKey const& key : evicted) {
+        if (auto const entry = infos.Find(key); entry && !std::get<0>(entry->Info))
+            unresolvedSchemas.fetch_sub(1, std::memory_order_relaxed);
+        infos.Erase(key);
+    }
 
-    return EventInfo(&record, std::get<0>(entry).get(), std::get<1>(entry));
+    evictedSchemas.fetch_add(evicted.size(), std::memory_order_relaxed);
+}
+
+size_t EventInfoCache::Invalidate(cspan<GUID> providerIds, bool allProviders)
+{
+    size_t count = 0;
+    infos.ForEach([&](SchemaKey const& key, Entry const& entry) {
+        if (key.IsTraceLogging())
+            return;
+
+        GUID const providerId = key.GetEventKey().GetProviderId();
+        if (allProviders || std::find(providerIds.begin(), providerIds.end(),
+                                      providerId) != providerIds.end()) {
+            entry.Stale.store(true, std::memory_order_relaxed);
+            ++count;
+        }
+    });
+
+    return count;
+}
+
+void EventInfoCache::SetRetryPolicy(TraceLogSchemaRetryPolicy const& policy)
+{
+    using std::chrono::duration_cast;
+    retryOnTraceDataUpdate.store(policy.RetryOnTraceDataUpdate,
+                                 std::memory_order_relaxed);
+    retryInterval.store(duration_cast<Clock::duration>(policy.RetryInterval).count(),
+                        std::memory_order_relaxed);
+}
+
+TraceLogSchemaStatistics EventInfoCache::GetStatistics() const
+{
+    TraceLogSchemaStatistics statistics;
+    statistics.UnresolvedSchemas = unresolvedSchemas.load(std::memory_order_relaxed);
+    statistics.ResolvedSchemas =
+        infos.Size() - std::min(infos.Size(), statistics.UnresolvedSchemas);
+    statistics.FailedLookups = failedLookups.load(std::memory_order_relaxed);
+    statistics.UnresolvedEvents = unresolvedEvents.load(std::memory_order_relaxed);
+    statistics.CachedSize = cachedSize.load(std::memory_order_relaxed);
+    statistics.EvictedSchemas = evictedSchemas.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void EventInfoCache::Clear()
+{
+    infos.Clear();
+    unresolvedSchemas.store(0, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(unpinnedMutex);
+    unpinned.Clear();
+    cachedSize.store(0, std::memory_order_relaxed);
+}
+
+bool EventInfoCache::IsOutdated(Entry const& entry) const
+{
+    if (entry.Stale.load(std::memory_order_relaxed))
+        return true;
+    if (std::get<0>(entry.Info))
+        return false;
+
+    if (context && retryOnTraceDataUpdate.load(std::memory_order_relaxed) &&
+        context->GetGeneration() !=
+            entry.TraceDataGeneration.load(std::memory_order_relaxed))
+        return true;
+
+    auto const interval = Clock::duration(retryInterval.load(std::memory_order_relaxed));
+    Clock::time_point const failureTime(
+        Clock::duration(entry.FailureTime.load(std::memory_order_relaxed)));
+    return interval != Clock::duration::zero() && Clock::now() - failureTime >= interval;
 }
 
 EventInfoCache::TraceEventInfoPtr EventInfoCache::CreateEventInfo(
-    EVENT_RECORD const& record)
+    EVENT_RECORD const& record) const
 {
+    // TraceLogging events describe themselves, so TDH is only needed for
+    // metadata the native decoder does not support.
+    auto const tlogExt = GetExtendedItem(record, EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL);
+    if (tlogExt) {
+        TraceEventInfoPtr info = CreateTlogEventInfo(record, *tlogExt);
+        if (std::get<0>(info))
+            return info;
+    } else if (context) {
+        TraceEventInfoPtr info = context->FindSchema(EventKey::FromEvent(record));
+        if (std::get<0>(info))
+            return info;
+    }
+
     TraceEventInfoPtr info;
 
     ULONG bufferSize = 0;
@@ -50,6 +295,14 @@ EventInfoCache::TraceEventInfoPtr EventInfoCache::CreateEventInfo(
         return TraceEventInfoPtr(nullptr, 0);
 
     std::get<1>(info) = bufferSize;
+
+    // Only manifest and MOF schemas are identified by their EventKey.
+    auto const source = std::get<0>(info)->DecodingSource;
+    if (context && !tlogExt &&
+        (source == DecodingSourceXMLFile || source == DecodingSourceWbem))
+        context->AddResolvedSchema(EventKey::FromEvent(record), std::get<0>(info).get(),
+                                   bufferSize);
+
     return info;
 }
 
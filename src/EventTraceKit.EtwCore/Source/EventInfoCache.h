@@ -1,173 +1,160 @@
 #pragma once
 #include "etk/EventInfo.h"
-
+#include "etk/EventKey.h"
+#include "etk/ITraceLog.h"
+#include "etk/CompiledSchema.h"
+#include "SchemaKey.h"
+#include "TraceDataContext.h"
+
+#include "etk/ADT/ConcurrentHashMap.h"
+#include "etk/ADT/LruCache.h"
 #include "etk/ADT/VarStructPtr.h"
-#include "etk/Support/Allocator.h"
 #include "etk/Support/CompilerSupport.h"
+#include "etk/Support/Hashing.h"
 
 ETK_DIAGNOSTIC_PUSH()
 ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
 ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
 ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
 ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
-#include <absl/container/flat_hash_map.h>
+#include <absl/hash/hash.h>
 ETK_DIAGNOSTIC_POP()
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
 #include <windows.h>
 
 #include <evntcons.h>
 #include <tdh.h>
 
-template<typename H>
-H AbslHashValue(H state, GUID const& key)
-{
-    return H::combine_contiguous(std::move(state), reinterpret_cast<uint8_t const*>(&key),
-                                 sizeof(key));
-}
-
 namespace etk
 {
 
-class EventKey
+class EventInfoCache
 {
 public:
-    EventKey(GUID const& providerId, USHORT eventId, UCHAR version)
-    {
-        std::memcpy(data, &providerId, sizeof(providerId));
-        std::memcpy(data + sizeof(providerId), &eventId, sizeof(eventId));
-        std::memcpy(data + sizeof(providerId) + sizeof(eventId), &version,
-                    sizeof(version));
-    }
+    // Schemas of manifest-based events are looked up in the provider binaries
+    // loaded by the context before falling back to TDH.
+    explicit EventInfoCache(std::shared_ptr<TraceDataContext> context = nullptr)
+        : context(std::move(context))
+    {}
 
-    static EventKey FromEvent(EVENT_RECORD const& record)
-    {
-        return FromEventHeader(record.EventHeader);
-    }
+    // The default limit of the memory used by cached schemas.
+    static size_t const DefaultCapacity = 64 * 1024 * 1024;
 
-    static EventKey FromEventHeader(EVENT_HEADER const& header)
-    {
-        bool const isClassic = (header.Flags & EVENT_HEADER_FLAG_CLASSIC_HEADER) != 0;
-        return EventKey(header.ProviderId,
-                        !isClassic ? header.EventDescriptor.Id
-                                   : header.EventDescriptor.Opcode,
-                        header.EventDescriptor.Version);
-    }
+    // Safe to call concurrently. Lookups of already cached schemas are
+    // lock-free, resolving a new schema only locks one shard of the cache.
+    // The returned schema is not pinned.
+    EventInfo Get(EVENT_RECORD const& record);
 
-    friend bool operator==(EventKey const& x, EventKey const& y)
+    // Lock-free lookup that never resolves a schema. Returns false if the
+    // schema of the event has not been looked up yet, if a failed lookup is
+    // due for a retry, or if the schema is being evicted by a concurrent Trim.
+    // A returned schema is pinned once. Safe to call concurrently with Trim.
+    bool TryGet(EVENT_RECORD const& record, EventInfo& info);
+
+    // Pins the schema of the event for each stored event referencing it, so
+    // that Trim keeps it. Pins are only released by Clear.
+    void Pin(EVENT_RECORD const& record, size_t count = 1);
+
+    // Limits the memory used by unpinned entries and their keys. Pinned
+    // schemas do not count against the capacity, since they cannot be evicted
+    // anyway.
+    void SetCapacity(size_t bytes);
+
+    // Evicts the least recently used unpinned entries while they exceed the
+    // capacity. Evicted entries are freed once concurrent TryGet calls are
+    // done with them. Must not run concurrently with Get, Pin or another Trim,
+    // and schemas returned by Get must have been pinned before if they are
+    // still used.
+    void Trim();
+
+    // Failed lookups are cached and only retried as permitted by the policy.
+    void SetRetryPolicy(TraceLogSchemaRetryPolicy const& policy);
+
+    // Marks the cached schemas of manifest-based events of the given
+    // providers, or of all providers, as stale. Stale schemas are resolved
+    // again by the next Get, and TryGet does not return them. Returns the
+    // number of stale entries.
+    size_t Invalidate(cspan<GUID> providerIds, bool allProviders);
+
+    TraceLogSchemaStatistics GetStatistics() const;
+
+    // The key refers to TraceLogging metadata of the record, if any, and must
+    // not outlive it.
+    static SchemaKey GetSchemaKey(EVENT_RECORD const& record)
     {
-        return std::memcmp(&x, &y, sizeof(y)) == 0;
+        return SchemaKey::FromEvent(record);
     }
 
-    friend bool operator<(EventKey const& x, EventKey const& y)
-    {
-        return std::memcmp(&x, &y, sizeof(y)) < 0;
-    }
+    // Schemas returned before remain valid until the next call to Clear, so
+    // that concurrent lookups and pending events referencing them can finish.
+    void Clear();
 
-    template<typename H>
-    friend H AbslHashValue(H state, EventKey const& key)
-    {
-        return H::combine_contiguous(std::move(state), key.data, std::size(key.data));
-    }
+    using TraceEventInfoPtr = std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>;
+    TraceEventInfoPtr CreateEventInfo(EVENT_RECORD const& record) const;
 
 private:
-    char data[sizeof(EVENT_HEADER::ProviderId) + sizeof(EVENT_DESCRIPTOR::Id) +
-              sizeof(EVENT_DESCRIPTOR::Version)];
-};
-
-class TlogEventMetadataKey
-{
-public:
-    explicit TlogEventMetadataKey(uint8_t const* metadata, uint16_t size)
-        : metadata_(metadata)
-        , size_(size)
-    {}
+    using Clock = std::chrono::steady_clock;
 
-    uint8_t const* data() const { return metadata_; }
-    uint16_t size() const { return size_; }
-
-    friend bool operator==(TlogEventMetadataKey const& lhs,
-                           TlogEventMetadataKey const& rhs)
-    {
-        return std::equal(lhs.metadata_, lhs.metadata_ + lhs.size_, rhs.metadata_,
-                          rhs.metadata_ + rhs.size_);
-    }
-
-    friend bool operator!=(TlogEventMetadataKey const& lhs,
-                           TlogEventMetadataKey const& rhs)
+    // Failed lookups are cached as entries without schema. These are never
+    // pinned. Entries are replaced when a retry is due or they became stale,
+    // except for failed entries whose retry fails again, which are refreshed
+    // in place.
+    struct Entry
     {
-        return !operator==(lhs, rhs);
-    }
+        Entry() = default;
+        Entry(Entry&& source) noexcept
+            : Info(std::move(source.Info))
+            , Compiled(std::move(source.Compiled))
+            , TraceDataGeneration(
+                  source.TraceDataGeneration.load(std::memory_order_relaxed))
+            , FailureTime(source.FailureTime.load(std::memory_order_relaxed))
+            , Size(source.Size)
+            , Pins(source.Pins.load(std::memory_order_relaxed))
+            , Stale(source.Stale.load(std::memory_order_relaxed))
+        {}
+
+        TraceEventInfoPtr Info;
+        std::unique_ptr<CompiledSchema> Compiled; // Derived from Info.
+        mutable std::atomic<unsigned> TraceDataGeneration{};
+        mutable std::atomic<Clock::duration::rep> FailureTime{}; // Since epoch.
+        size_t Size = 0; // Memory accounted against the capacity.
+        mutable std::atomic<size_t> Pins{};
+        mutable std::atomic<bool> Stale{};
+    };
 
-    template<typename H>
-    friend H AbslHashValue(H state, TlogEventMetadataKey const& key)
+    struct SizeWeigher
     {
-        return H::combine_contiguous(std::move(state), key.metadata_, key.size_);
-    }
-
-private:
-    uint8_t const* metadata_ = nullptr;
-    uint16_t size_ = 0;
-};
-
-class EventInfoCache
-{
-public:
-    EventInfoCache();
-    EventInfo Get(EVENT_RECORD const& record);
+        size_t operator()(size_t size) const { return size; }
+    };
 
-    void Clear() { infos.clear(); }
+    bool IsOutdated(Entry const& entry) const;
+    bool Pin(SchemaKey const& key, Entry const& entry, size_t count);
 
-    using TraceEventInfoPtr = std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>;
-    static TraceEventInfoPtr CreateEventInfo(EVENT_RECORD const& record);
+    std::shared_ptr<TraceDataContext> context;
+    ConcurrentHashMap<SchemaKey, Entry> infos;
 
-private:
-    using TlogEventMetadataKeyAllocator =
-        BumpPtrAllocator<MallocAllocator, 1 * 1024 * 1024>;
+    // Sizes of the unpinned entries in least recently used order. The weight of
+    // the cache is the size counted against the capacity.
+    std::mutex unpinnedMutex;
+    LruCache<SchemaKey, size_t, absl::Hash<SchemaKey>, SizeWeigher> unpinned{SIZE_MAX};
+    std::atomic<size_t> cachedSize{};
+    std::atomic<size_t> capacity{DefaultCapacity};
 
-    struct TlogProvider
-    {
-        using EventId = uint16_t;
-
-        absl::flat_hash_map<TlogEventMetadataKey, EventId> eventIdMap;
-        EventId uniqueEventId = 0;
-
-        EventId GetOrCreateUniqueId(TlogEventMetadataKeyAllocator& allocator,
-                                    EVENT_HEADER_EXTENDED_DATA_ITEM const& tlogExt)
-        {
-            auto key = TlogEventMetadataKey(
-                reinterpret_cast<uint8_t const*>(tlogExt.DataPtr), tlogExt.DataSize);
-
-            auto it = eventIdMap.find(key);
-            if (it != eventIdMap.end())
-                return it->second;
-
-            auto eventId = uniqueEventId++;
-            eventIdMap.insert(it, {AllocateKey(allocator, key), eventId});
-            return eventId;
-        }
-
-        TlogEventMetadataKey AllocateKey(TlogEventMetadataKeyAllocator& allocator,
-                                         TlogEventMetadataKey const& source)
-        {
-            auto const size = source.size();
-            auto ptr = allocator.Allocate<uint8_t>(size);
-            std::copy_n(source.data(), size, ptr);
-            return TlogEventMetadataKey(ptr, size);
-        }
-    };
-
-    EventKey CreateTlogEventKey(GUID const& providerId,
-                                EVENT_HEADER_EXTENDED_DATA_ITEM const& tlogExt)
-    {
-        auto& provider = tlogProviders[providerId];
-        auto eventId =
-            provider.GetOrCreateUniqueId(tlogEventMetadataKeyAllocator, tlogExt);
-        return EventKey(providerId, eventId, 0);
-    }
+    std::atomic<bool> retryOnTraceDataUpdate{true};
+    std::atomic<Clock::duration::rep> retryInterval{0};
 
-    absl::flat_hash_map<EventKey, TraceEventInfoPtr> infos;
-    absl::flat_hash_map<GUID, TlogProvider> tlogProviders;
-    TlogEventMetadataKeyAllocator tlogEventMetadataKeyAllocator;
+    std::atomic<size_t> unresolvedSchemas{};
+    std::atomic<size_t> failedLookups{};
+    std::atomic<size_t> unresolvedEvents{};
+    std::atomic<size_t> evictedSchemas{};
 };
 
 } // namespace etk
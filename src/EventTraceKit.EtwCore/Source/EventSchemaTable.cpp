@@ -0,0 +1,493 @@
+#include "etk/EventSchemaTable.h"
+
+#include "TraceEventInfoBuilder.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace etk
+{
+
+namespace
+{
+
+// Block magics and layouts match EventTemplateReader/EventTemplateWriter in
+// EventTraceKit.EventTracing. All offsets are relative to the start of the
+// 'CRIM' block.
+uint32_t const CrimMagic = 0x4D495243;
+uint32_t const WevtMagic = 0x54564557;
+uint32_t const EvntMagic = 0x544E5645;
+uint32_t const PrvaMagic = 0x41565250;
+uint32_t const TempMagic = 0x504D4554;
+uint32_t const VmapMagic = 0x50414D56;
+uint32_t const BmapMagic = 0x50414D42;
+uint32_t const QuerMagic = 0x52455551;
+
+uint32_t const EventListKind = 4;
+uint32_t const ProviderAttribsListKind = 13;
+uint32_t const ProviderNameAttrib = 0x10000001;
+
+uint32_t const UnusedMessageId = 0xFFFFFFFF;
+
+size_t const CrimHeaderSize = 16;
+size_t const ProviderEntrySize = 20;
+size_t const WevtHeaderSize = 16;
+size_t const EventEntrySize = 48;
+size_t const TemplateHeaderSize = 40;
+size_t const PropertyEntrySize = 20;
+
+// Property flags of compiled templates, which differ from PROPERTY_FLAGS.
+uint32_t const CrimPropertyStruct = 0x1;
+uint32_t const CrimPropertyFixedLength = 0x2;
+uint32_t const CrimPropertyVarLength = 0x4;
+uint32_t const CrimPropertyFixedCount = 0x8;
+uint32_t const CrimPropertyVarCount = 0x10;
+
+class BlobReader
+{
+public:
+    explicit BlobReader(cspan<std::byte> data)
+        : data(data)
+    {}
+
+    template<typename T>
+    bool Read(size_t offset, T& value) const
+    {
+        if (offset > data.size() || data.size() - offset < sizeof(T))
+            return false;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return true;
+    }
+
+    bool ReadMagic(size_t offset, uint32_t expected) const
+    {
+        uint32_t magic;
+        return Read(offset, magic) && magic == expected;
+    }
+
+    // A UINT32 byte count (including itself) followed by a UTF-16 string that
+    // may be padded with null characters.
+    bool ReadCountedString(size_t offset, std::wstring& str) const
+    {
+        uint32_t byteCount;
+        if (!Read(offset, byteCount) || byteCount < sizeof(byteCount))
+            return false;
+        return ReadUtf16(offset + sizeof(byteCount),
+                         (byteCount - sizeof(byteCount)) / sizeof(uint16_t), str);
+    }
+
+    bool ReadTerminatedString(size_t offset, std::wstring& str) const
+    {
+        str.clear();
+        for (uint16_t unit; Read(offset, unit); offset += sizeof(unit)) {
+            if (unit == 0)
+                return true;
+            str.push_back(static_cast<wchar_t>(unit));
+        }
+        return false;
+    }
+
+    bool ReadUtf16(size_t offset, size_t length, std::wstring& str) const
+    {
+        if (offset > data.size() || (data.size() - offset) / sizeof(uint16_t) < length)
+            return false;
+
+        str.resize(length);
+        for (size_t i = 0; i < length; ++i) {
+            uint16_t unit;
+            std::memcpy(&unit, data.data() + offset + i * sizeof(unit), sizeof(unit));
+            str[i] = static_cast<wchar_t>(unit);
+        }
+
+        while (!str.empty() && str.back() == L'\0')
+            str.pop_back();
+        return true;
+    }
+
+private:
+    cspan<std::byte> data;
+};
+
+using MessageMap = absl::flat_hash_map<uint32_t, std::wstring>;
+
+// Reads an RT_MESSAGETABLE resource (MESSAGE_RESOURCE_DATA).
+bool ReadMessageTable(cspan<std::byte> messageTable, MessageMap& messages)
+{
+    uint16_t const UnicodeFlag = 0x1;
+
+    BlobReader reader(messageTable);
+    uint32_t blockCount;
+    if (!reader.Read(0, blockCount))
+        return false;
+
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        size_t const blockOffset = sizeof(blockCount) + i * 3 * sizeof(uint32_t);
+        uint32_t lowId, highId, entryOffset;
+        if (!reader.Read(blockOffset, lowId) || !reader.Read(blockOffset + 4, highId) ||
+            !reader.Read(blockOffset + 8, entryOffset) || lowId > highId)
+            return false;
+
+        size_t offset = entryOffset;
+        for (uint64_t id = lowId; id <= highId; ++id) {
+            uint16_t length, flags;
+            if (!reader.Read(offset, length) || !reader.Read(offset + 2, flags) ||
+                length < 4)
+                return false;
+
+            std::wstring text;
+            if ((flags & UnicodeFlag) != 0) {
+                if (!reader.ReadUtf16(offset + 4, (length - 4) / sizeof(uint16_t), text))
+                    return false;
+            } else {
+                for (size_t k = 4; k < length; ++k) {
+                    uint8_t c;
+                    if (!reader.Read(offset + k, c))
+                        return false;
+                    text.push_back(static_cast<wchar_t>(c));
+                }
+            }
+
+            // Messages end with a line break added by the message compiler.
+            while (!text.empty() &&
+                   (text.back() == L'\0' || text.back() == L'\r' || text.back() == L'\n'))
+                text.pop_back();
+
+            messages[static_cast<uint32_t>(id)] = std::move(text);
+            offset += length;
+        }
+    }
+
+    return true;
+}
+
+class TemplateReader
+{
+public:
+    TemplateReader(cspan<std::byte> wevtTemplate, MessageMap const& messages)
+        : reader(wevtTemplate)
+        , messages(messages)
+    {}
+
+    template<typename Callback>
+    bool ReadProviders(Callback&& addSchema)
+    {
+        uint32_t providerCount;
+        if (!reader.ReadMagic(0, CrimMagic) || !reader.Read(12, providerCount))
+            return false;
+
+        for (uint32_t i = 0; i < providerCount; ++i) {
+            size_t const entryOffset = CrimHeaderSize + i * ProviderEntrySize;
+            GUID providerId;
+            uint32_t providerOffset;
+            if (!reader.Read(entryOffset, providerId) ||
+                !reader.Read(entryOffset + sizeof(GUID), providerOffset) ||
+                !ReadProvider(providerId, providerOffset, addSchema))
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+    template<typename Callback>
+    bool ReadProvider(GUID const& providerId, size_t offset, Callback& addSchema)
+    {
+        uint32_t messageId, listCount;
+        if (!reader.ReadMagic(offset, WevtMagic) || !reader.Read(offset + 8, messageId) ||
+            !reader.Read(offset + 12, listCount))
+            return false;
+
+        uint32_t eventsOffset = 0;
+        std::wstring providerName;
+        for (uint32_t i = 0; i < listCount; ++i) {
+            size_t const listOffset = offset + WevtHeaderSize + i * 8;
+            uint32_t kind, blockOffset;
+            if (!reader.Read(listOffset, kind) ||
+                !reader.Read(listOffset + 4, blockOffset))
+                return false;
+
+            if (kind == EventListKind)
+                eventsOffset = blockOffset;
+            else if (kind == ProviderAttribsListKind &&
+                     !ReadProviderName(blockOffset, providerName))
+                return false;
+        }
+
+        if (eventsOffset == 0)
+            return true;
+
+        uint32_t eventCount;
+        if (!reader.ReadMagic(eventsOffset, EvntMagic) ||
+            !reader.Read(eventsOffset + 8, eventCount))
+            return false;
+
+        for (uint32_t i = 0; i < eventCount; ++i) {
+            size_t const eventOffset = eventsOffset + 16 + i * EventEntrySize;
+            auto schema = ReadEvent(providerId, providerName, messageId, eventOffset);
+            if (!std::get<0>(schema))
+                return false;
+
+            auto const& descriptor = std::get<0>(schema)->EventDescriptor;
+            addSchema(EventKey(providerId, descriptor.Id, descriptor.Version),
+                      std::move(schema));
+        }
+
+        return true;
+    }
+
+    bool ReadProviderName(size_t offset, std::wstring& name) const
+    {
+        uint32_t count;
+        if (!reader.ReadMagic(offset, PrvaMagic) || !reader.Read(offset + 8, count))
+            return false;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t flags, valueOffset;
+            if (!reader.Read(offset + 12 + i * 8, flags) ||
+                !reader.Read(offset + 16 + i * 8, valueOffset))
+                return false;
+            if (flags == ProviderNameAttrib)
+                return reader.ReadTerminatedString(valueOffset, name);
+        }
+
+        return true;
+    }
+
+    std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>
+    ReadEvent(GUID const& providerId, std::wstring const& providerName,
+              uint32_t providerMessageId, size_t offset)
+    {
+        using Result = std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>;
+
+        EVENT_DESCRIPTOR descriptor;
+        uint32_t messageId, templateOffset, opcodeOffset, levelOffset, taskOffset;
+        uint32_t keywordCount, keywordsOffset, channelOffset;
+        if (!reader.Read(offset, descriptor) || !reader.Read(offset + 16, messageId) ||
+            !reader.Read(offset + 20, templateOffset) ||
+            !reader.Read(offset + 24, opcodeOffset) ||
+            !reader.Read(offset + 28, levelOffset) ||
+            !reader.Read(offset + 32, taskOffset) ||
+            !reader.Read(offset + 36, keywordCount) ||
+            !reader.Read(offset + 40, keywordsOffset) ||
+            !reader.Read(offset + 44, channelOffset))
+            return Result(nullptr, 0);
+
+        uint32_t paramCount = 0, propertyCount = 0, propertiesOffset = 0, flags = 0;
+        if (templateOffset != 0) {
+            if (!reader.ReadMagic(templateOffset, TempMagic) ||
+                !reader.Read(templateOffset + 8, paramCount) ||
+                !reader.Read(templateOffset + 12, propertyCount) ||
+                !reader.Read(templateOffset + 16, propertiesOffset) ||
+                !reader.Read(templateOffset + 20, flags) || paramCount > propertyCount ||
+                propertyCount > USHRT_MAX)
+                return Result(nullptr, 0);
+        }
+
+        TraceEventInfoBuilder builder(propertyCount);
+        TRACE_EVENT_INFO& info = builder.Info();
+        info.ProviderGuid = providerId;
+        info.EventDescriptor = descriptor;
+        info.DecodingSource = DecodingSourceXMLFile;
+        info.TopLevelPropertyCount = paramCount;
+        info.Flags = static_cast<TEMPLATE_FLAGS>(flags);
+
+        // Entries referenced by offset store their message id at a fixed
+        // position relative to the name offset: level (4, 8), task (4, 24),
+        // opcode (4, 8), keyword (8, 12), channel (12, 4).
+        std::wstring str;
+        if (!providerName.empty())
+            info.ProviderNameOffset = builder.AddString(providerName);
+        if (ReadDisplayName(levelOffset, 4, 8, str))
+            info.LevelNameOffset = builder.AddString(str);
+        if (ReadDisplayName(channelOffset, 12, 4, str))
+            info.ChannelNameOffset = builder.AddString(str);
+        if (ReadDisplayName(opcodeOffset, 4, 8, str))
+            info.OpcodeNameOffset = builder.AddString(str);
+        if (ReadDisplayName(taskOffset, 4, 24, str)) {
+            info.TaskNameOffset = builder.AddString(str);
+            (void)reader.Read(taskOffset + 8, info.EventGuid);
+        }
+        if (GetMessage(messageId, str))
+            info.EventMessageOffset = builder.AddString(str);
+        if (GetMessage(providerMessageId, str))
+            info.ProviderMessageOffset = builder.AddString(str);
+
+        // Keyword names are stored as a list terminated by an empty string.
+        for (uint32_t i = 0; i < keywordCount; ++i) {
+            uint32_t keywordOffset;
+            if (!reader.Read(keywordsOffset + i * sizeof(uint32_t), keywordOffset))
+                return Result(nullptr, 0);
+            if (!ReadDisplayName(keywordOffset, 8, 12, str))
+                continue;
+
+            ULONG const nameOffset = builder.AddString(str);
+            if (info.KeywordsNameOffset == 0)
+                info.KeywordsNameOffset = nameOffset;
+        }
+        if (info.KeywordsNameOffset != 0)
+            builder.AddString(std::wstring_view());
+
+        for (uint32_t i = 0; i < propertyCount; ++i) {
+            if (!ReadProperty(propertiesOffset + i * PropertyEntrySize, propertyCount,
+                              builder, builder.Property(i)))
+                return Result(nullptr, 0);
+        }
+
+        return builder.Build();
+    }
+
+    bool ReadProperty(size_t offset, uint32_t propertyCount,
+                      TraceEventInfoBuilder& builder, EVENT_PROPERTY_INFO& property)
+    {
+        uint32_t crimFlags, nameOffset;
+        uint16_t count, length;
+        if (!reader.Read(offset, crimFlags) || !reader.Read(offset + 12, count) ||
+            !reader.Read(offset + 14, length) || !reader.Read(offset + 16, nameOffset))
+            return false;
+
+        ULONG flags = 0;
+        if ((crimFlags & CrimPropertyStruct) != 0) {
+            uint16_t startIndex, memberCount;
+            if (!reader.Read(offset + 4, startIndex) ||
+                !reader.Read(offset + 6, memberCount) ||
+                startIndex + memberCount > propertyCount)
+                return false;
+
+            flags |= PropertyStruct;
+            property.structType.StructStartIndex = startIndex;
+            property.structType.NumOfStructMembers = memberCount;
+        } else {
+            uint8_t inType, outType;
+            uint32_t mapOffset;
+            if (!reader.Read(offset + 4, inType) || !reader.Read(offset + 5, outType) ||
+                !reader.Read(offset + 8, mapOffset))
+                return false;
+
+            property.nonStructType.InType = inType;
+            property.nonStructType.OutType = outType;
+
+            std::wstring mapName;
+            if (mapOffset != 0) {
+                if (!ReadMapName(mapOffset, mapName))
+                    return false;
+                property.nonStructType.MapNameOffset = builder.AddString(mapName);
+            }
+        }
+
+        if ((crimFlags & CrimPropertyVarLength) != 0) {
+            if (length >= propertyCount)
+                return false;
+            flags |= PropertyParamLength;
+        }
+        if ((crimFlags & CrimPropertyVarCount) != 0) {
+            if (count >= propertyCount)
+                return false;
+            flags |= PropertyParamCount;
+        }
+        if ((crimFlags & CrimPropertyFixedLength) != 0)
+            flags |= PropertyParamFixedLength;
+        if ((crimFlags & CrimPropertyFixedCount) != 0)
+            flags |= PropertyParamFixedCount;
+
+        // Properties without explicit count are scalars.
+        uint32_t const countFlags = CrimPropertyVarCount | CrimPropertyFixedCount;
+        if ((crimFlags & countFlags) == 0 && count == 0)
+            count = 1;
+
+        property.Flags = static_cast<PROPERTY_FLAGS>(flags);
+        property.count = count;
+        property.length = length;
+
+        std::wstring name;
+        if (!reader.ReadCountedString(nameOffset, name))
+            return false;
+        property.NameOffset = builder.AddString(name);
+        return true;
+    }
+
+    bool ReadMapName(size_t offset, std::wstring& name) const
+    {
+        uint32_t magic, nameOffset;
+        if (!reader.Read(offset, magic) || !reader.Read(offset + 8, nameOffset))
+            return false;
+        if (magic != VmapMagic && magic != BmapMagic && magic != QuerMagic)
+            return false;
+        return reader.ReadCountedString(nameOffset, name);
+    }
+
+    // Returns the localized message of an entry if available, or its name.
+    bool ReadDisplayName(size_t entryOffset, size_t messageIdOffset, size_t nameOffset,
+                         std::wstring& str) const
+    {
+        if (entryOffset == 0)
+            return false;
+
+        uint32_t messageId, nameStringOffset;
+        if (reader.Read(entryOffset + messageIdOffset, messageId) &&
+            GetMessage(messageId, str))
+            return true;
+
+        return reader.Read(entryOffset + nameOffset, nameStringOffset) &&
+               nameStringOffset != 0 && reader.ReadCountedString(nameStringOffset, str);
+    }
+
+    bool GetMessage(uint32_t messageId, std::wstring& str) const
+    {
+        if (messageId == UnusedMessageId)
+            return false;
+
+        auto const it = messages.find(messageId);
+        if (it == messages.end())
+            return false;
+
+        str = it->second;
+        return true;
+    }
+
+    BlobReader reader;
+    MessageMap const& messages;
+};
+
+} // namespace
+
+bool EventSchemaTable::AddTemplates(cspan<std::byte> wevtTemplate,
+                                    cspan<std::byte> messageTable)
+{
+    MessageMap messages;
+    if (!messageTable.empty() && !ReadMessageTable(messageTable, messages))
+        messages.clear();
+
+    std::vector<std::tuple<EventKey, SchemaPtr>> newSchemas;
+    TemplateReader reader(wevtTemplate, messages);
+    bool const success = reader.ReadProviders([&](EventKey const& key, SchemaPtr schema) {
+        newSchemas.emplace_back(key, std::move(schema));
+    });
+
+    if (!success)
+        return false;
+
+    for (auto& [key, schema] : newSchemas)
+        schemas.insert_or_assign(key, std::move(schema));
+
+    return true;
+}
+
+std::vector<GUID> EventSchemaTable::GetProviderIds() const
+{
+    // Binaries define few providers, so a linear search is sufficient.
+    std::vector<GUID> providerIds;
+    for (auto const& entry : schemas) {
+        GUID const providerId = entry.first.GetProviderId();
+        if (std::find(providerIds.begin(), providerIds.end(), providerId) ==
+            providerIds.end())
+            providerIds.push_back(providerId);
+    }
+
+    return providerIds;
+}
+
+} // namespace etk
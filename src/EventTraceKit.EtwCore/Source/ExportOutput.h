@@ -0,0 +1,121 @@
+#pragma once
+#include "etk/ADT/Handle.h"
+#include "etk/Support/ErrorHandling.h"
+#include "etk/TraceLogExporter.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <windows.h>
+
+namespace etk
+{
+
+// Collects exported output and passes it to the write callback in large
+// blocks.
+class OutputBuffer
+{
+public:
+    OutputBuffer(size_t capacity, TraceLogExportWriteCallback* write, void* state)
+        : capacity(std::max<size_t>(capacity, 1))
+        , write(write)
+        , state(state)
+    {
+        buffer.reserve(this->capacity);
+    }
+
+    bool Append(std::string_view data)
+    {
+        if (buffer.size() + data.size() > capacity) {
+            if (!Flush())
+                return false;
+
+            // Large blocks are written without copying them.
+            if (data.size() >= capacity)
+                return Write(data);
+        }
+
+        buffer += data;
+        return true;
+    }
+
+    bool Append(void const* data, size_t size)
+    {
+        return Append(std::string_view(static_cast<char const*>(data), size));
+    }
+
+    bool Flush()
+    {
+        if (buffer.empty())
+            return true;
+
+        bool const succeeded = Write(buffer);
+        buffer.clear();
+        return succeeded;
+    }
+
+    uint64_t GetWrittenBytes() const { return writtenBytes; }
+
+private:
+    bool Write(std::string_view data)
+    {
+        if (!write(data.data(), data.size(), state))
+            return false;
+        writtenBytes += data.size();
+        return true;
+    }
+
+    size_t const capacity;
+    TraceLogExportWriteCallback* const write;
+    void* const state;
+    std::string buffer;
+    uint64_t writtenBytes = 0;
+};
+
+// Creates or replaces the file and invokes exportContents(write, state) with
+// a write callback appending to it. Write errors are returned instead of the
+// E_ABORT they cause.
+template<typename ExportContents>
+HRESULT ExportToNewFile(std::wstring const& path, ExportContents&& exportContents)
+{
+    struct FileWriteState
+    {
+        HANDLE File;
+        DWORD LastError = ERROR_SUCCESS;
+    };
+
+    auto const writeToFile = [](void const* data, size_t size, void* state) {
+        auto& writeState = *static_cast<FileWriteState*>(state);
+        auto bytes = static_cast<std::byte const*>(data);
+
+        while (size != 0) {
+            auto const blockSize =
+                static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+            DWORD written = 0;
+            if (!WriteFile(writeState.File, bytes, blockSize, &written, nullptr)) {
+                writeState.LastError = GetLastError();
+                return false;
+            }
+            bytes += written;
+            size -= written;
+        }
+
+        return true;
+    };
+
+    FileHandle file(CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!file)
+        return GetLastErrorAsHResult();
+
+    FileWriteState state{file};
+    HRESULT const hr = exportContents(+writeToFile, &state);
+    if (hr == E_ABORT && state.LastError != ERROR_SUCCESS)
+        return HResultFromWin32(state.LastError);
+    return hr;
+}
+
+} // namespace etk
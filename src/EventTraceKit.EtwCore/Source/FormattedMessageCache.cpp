@@ -0,0 +1,89 @@
+#include "etk/FormattedMessageCache.h"
+
+namespace etk
+{
+
+// Approximate per-entry overhead of the hash map node and LRU list node.
+static size_t const EntryOverhead = 64;
+
+size_t FormattedMessageCache::MessageWeigher::operator()(
+    std::wstring const& message) const
+{
+    return sizeof(message) + message.capacity() * sizeof(wchar_t) + EntryOverhead;
+}
+
+FormattedMessageCache::FormattedMessageCache(size_t capacity)
+    : messages(capacity)
+{}
+
+bool FormattedMessageCache::TryGet(uint64_t sequence, std::wstring& message)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::wstring const* const cached = messages.Find(sequence);
+    if (!cached) {
+        ++misses;
+        return false;
+    }
+
+    ++hits;
+    message = *cached;
+    return true;
+}
+
+void FormattedMessageCache::Add(uint64_t sequence, std::wstring_view message,
+                                uint64_t generation)
+{
+    std::wstring value(message);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (generation != this->generation.load(std::memory_order_relaxed))
+        return;
+
+    messages.Remove(sequence);
+
+    // A message heavier than the capacity would evict all others and still
+    // exceed it.
+    if (MessageWeigher()(value) > messages.Capacity())
+        return;
+
+    size_t const previousSize = messages.Size();
+    messages.Insert(sequence, std::move(value));
+    evictions += previousSize + 1 - messages.Size();
+}
+
+void FormattedMessageCache::Remove(uint64_t sequence)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    messages.Remove(sequence);
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+void FormattedMessageCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    messages.Clear();
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+void FormattedMessageCache::SetCapacity(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t const previousSize = messages.Size();
+    messages.SetCapacity(bytes);
+    evictions += previousSize - messages.Size();
+}
+
+FormattedMessageCacheStatistics FormattedMessageCache::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    FormattedMessageCacheStatistics statistics;
+    statistics.Hits = hits;
+    statistics.Misses = misses;
+    statistics.Evictions = evictions;
+    statistics.CachedMessages = messages.Size();
+    statistics.CachedSize = messages.Weight();
+    return statistics;
+}
+
+} // namespace etk
@@ -0,0 +1,486 @@
+#include "etk/HeaderFilter.h"
+
+#include "etk/Support/CpuInfo.h"
+#include "etk/Support/Debug.h"
+
+#include <climits>
+
+#include <immintrin.h>
+
+namespace etk
+{
+
+namespace
+{
+
+// Every CompareOp is lowered to one of these plus an optional negation, so that
+// the vector kernels only need a handful of compare instructions.
+enum class BaseOp
+{
+    Equal,
+    Greater,
+    Less,
+    NoBitsSet,
+    AllBitsSet,
+};
+
+struct LoweredOp
+{
+    BaseOp Op;
+    bool Negate;
+};
+
+LoweredOp Lower(CompareOp op)
+{
+    switch (op) {
+    case CompareOp::Equal: return {BaseOp::Equal, false};
+    case CompareOp::NotEqual: return {BaseOp::Equal, true};
+    case CompareOp::Less: return {BaseOp::Less, false};
+    case CompareOp::LessEqual: return {BaseOp::Greater, true};
+    case CompareOp::Greater: return {BaseOp::Greater, false};
+    case CompareOp::GreaterEqual: return {BaseOp::Less, true};
+    case CompareOp::AnyBitsSet: return {BaseOp::NoBitsSet, true};
+    case CompareOp::AllBitsSet: return {BaseOp::AllBitsSet, false};
+    }
+
+    ETK_ASSERT(false && "Unknown CompareOp");
+    return {BaseOp::Equal, false};
+}
+
+using ResultBits = std::array<uint64_t, SelectionBitmap::WordCount>;
+
+void AndSelection(ResultBits const& result, size_t count, uint64_t* selection)
+{
+    for (size_t i = 0; i < SelectionBitmap::WordCount; ++i) {
+        size_t const begin = i * 64;
+        uint64_t mask;
+        if (count >= begin + 64)
+            mask = ~uint64_t(0);
+        else if (count > begin)
+            mask = (uint64_t(1) << (count - begin)) - 1;
+        else
+            mask = 0;
+
+        selection[i] &= result[i] & mask;
+    }
+}
+
+template<typename T>
+void CompareScalar(T const* column, size_t count, CompareOp op, T value,
+                   uint64_t* selection)
+{
+    ETK_ASSERT(count <= SelectionBitmap::Capacity);
+
+    ResultBits result{};
+    for (size_t i = 0; i < count; ++i) {
+        if (EvaluateCompareOp(column[i], op, value))
+            result[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    AndSelection(result, count, selection);
+}
+
+// Unsigned 32-bit ordering is done with signed compares on biased values.
+template<BaseOp Op>
+ETK_TARGET("sse4.1")
+ETK_ALWAYS_INLINE __m128i Compare32x4(__m128i x, __m128i v, __m128i bias)
+{
+    switch (Op) {
+    case BaseOp::Equal: return _mm_cmpeq_epi32(x, v);
+    case BaseOp::Greater:
+        return _mm_cmpgt_epi32(_mm_xor_si128(x, bias), _mm_xor_si128(v, bias));
+    case BaseOp::Less:
+        return _mm_cmpgt_epi32(_mm_xor_si128(v, bias), _mm_xor_si128(x, bias));
+    case BaseOp::NoBitsSet:
+        return _mm_cmpeq_epi32(_mm_and_si128(x, v), _mm_setzero_si128());
+    case BaseOp::AllBitsSet: return _mm_cmpeq_epi32(_mm_and_si128(x, v), v);
+    }
+
+    return _mm_setzero_si128();
+}
+
+template<BaseOp Op>
+ETK_TARGET("sse4.1")
+void Compare32SSE41Impl(uint32_t const* column, size_t count, bool negate, uint32_t value,
+                        uint64_t* selection)
+{
+    __m128i const v = _mm_set1_epi32(static_cast<int>(value));
+    __m128i const bias = _mm_set1_epi32(INT_MIN);
+    unsigned const flip = negate ? 0xF : 0;
+
+    ResultBits result{};
+    for (size_t i = 0; i < count; i += 4) {
+        __m128i const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(column + i));
+        __m128i const m = Compare32x4<Op>(x, v, bias);
+        unsigned const bits = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(m)));
+        result[i / 64] |= uint64_t(bits ^ flip) << (i % 64);
+    }
+
+    AndSelection(result, count, selection);
+}
+
+template<BaseOp Op>
+ETK_TARGET("sse4.1")
+ETK_ALWAYS_INLINE __m128i Compare64x2(__m128i x, __m128i v)
+{
+    switch (Op) {
+    case BaseOp::Equal: return _mm_cmpeq_epi64(x, v);
+    case BaseOp::NoBitsSet:
+        return _mm_cmpeq_epi64(_mm_and_si128(x, v), _mm_setzero_si128());
+    case BaseOp::AllBitsSet: return _mm_cmpeq_epi64(_mm_and_si128(x, v), v);
+    default: return _mm_setzero_si128(); // Ordered compares use the scalar path.
+    }
+}
+
+template<BaseOp Op>
+ETK_TARGET("sse4.1")
+void Compare64SSE41Impl(uint64_t const* column, size_t count, bool negate, uint64_t value,
+                        uint64_t* selection)
+{
+    __m128i const v = _mm_set1_epi64x(static_cast<long long>(value));
+    unsigned const flip = negate ? 0x3 : 0;
+
+    ResultBits result{};
+    for (size_t i = 0; i < count; i += 2) {
+        __m128i const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(column + i));
+        __m128i const m = Compare64x2<Op>(x, v);
+        unsigned const bits = static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(m)));
+        result[i / 64] |= uint64_t(bits ^ flip) << (i % 64);
+    }
+
+    AndSelection(result, count, selection);
+}
+
+template<BaseOp Op>
+ETK_TARGET("avx2")
+ETK_ALWAYS_INLINE __m256i Compare32x8(__m256i x, __m256i v, __m256i bias)
+{
+    switch (Op) {
+    case BaseOp::Equal: return _mm256_cmpeq_epi32(x, v);
+    case BaseOp::Greater:
+        return _mm256_cmpgt_epi32(_mm256_xor_si256(x, bias), _mm256_xor_si256(v, bias));
+    case BaseOp::Less:
+        return _mm256_cmpgt_epi32(_mm256_xor_si256(v, bias), _mm256_xor_si256(x, bias));
+    case BaseOp::NoBitsSet:
+        return _mm256_cmpeq_epi32(_mm256_and_si256(x, v), _mm256_setzero_si256());
+    case BaseOp::AllBitsSet: return _mm256_cmpeq_epi32(_mm256_and_si256(x, v), v);
+    }
+
+    return _mm256_setzero_si256();
+}
+
+template<BaseOp Op>
+ETK_TARGET("avx2")
+void Compare32AVX2Impl(uint32_t const* column, size_t count, bool negate, uint32_t value,
+                       uint64_t* selection)
+{
+    __m256i const v = _mm256_set1_epi32(static_cast<int>(value));
+    __m256i const bias = _mm256_set1_epi32(INT_MIN);
+    unsigned const flip = negate ? 0xFF : 0;
+
+    ResultBits result{};
+    for (size_t i = 0; i < count; i += 8) {
+        __m256i const x =
+            _mm256_loadu_si256(reinterpret_cast<__m256i const*>(column + i));
+        __m256i const m = Compare32x8<Op>(x, v, bias);
+        unsigned const bits =
+            static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        result[i / 64] |= uint64_t(bits ^ flip) << (i % 64);
+    }
+
+    AndSelection(result, count, selection);
+}
+
+template<BaseOp Op>
+ETK_TARGET("avx2")
+ETK_ALWAYS_INLINE __m256i Compare64x4(__m256i x, __m256i v, __m256i bias)
+{
+    switch (Op) {
+    case BaseOp::Equal: return _mm256_cmpeq_epi64(x, v);
+    case BaseOp::Greater:
+        return _mm256_cmpgt_epi64(_mm256_xor_si256(x, bias), _mm256_xor_si256(v, bias));
+    case BaseOp::Less:
+        return _mm256_cmpgt_epi64(_mm256_xor_si256(v, bias), _mm256_xor_si256(x, bias));
+    case BaseOp::NoBitsSet:
+        return _mm256_cmpeq_epi64(_mm256_and_si256(x, v), _mm256_setzero_si256());
+    case BaseOp::AllBitsSet: return _mm256_cmpeq_epi64(_mm256_and_si256(x, v), v);
+    }
+
+    return _mm256_setzero_si256();
+}
+
+template<BaseOp Op>
+ETK_TARGET("avx2")
+void Compare64AVX2Impl(uint64_t const* column, size_t count, bool negate, uint64_t value,
+                       uint64_t* selection)
+{
+    __m256i const v = _mm256_set1_epi64x(static_cast<long long>(value));
+    __m256i const bias = _mm256_set1_epi64x(LLONG_MIN);
+    unsigned const flip = negate ? 0xF : 0;
+
+    ResultBits result{};
+    for (size_t i = 0; i < count; i += 4) {
+        __m256i const x =
+            _mm256_loadu_si256(reinterpret_cast<__m256i const*>(column + i));
+        __m256i const m = Compare64x4<Op>(x, v, bias);
+        unsigned const bits =
+            static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+        result[i / 64] |= uint64_t(bits ^ flip) << (i % 64);
+    }
+
+    AndSelection(result, count, selection);
+}
+
+#define ETK_DISPATCH_BASE_OP(impl, op, ...)                                              \
+    switch (op.Op) {                                                                     \
+    case BaseOp::Equal: impl<BaseOp::Equal>(__VA_ARGS__); break;                         \
+    case BaseOp::Greater: impl<BaseOp::Greater>(__VA_ARGS__); break;                     \
+    case BaseOp::Less: impl<BaseOp::Less>(__VA_ARGS__); break;                           \
+    case BaseOp::NoBitsSet: impl<BaseOp::NoBitsSet>(__VA_ARGS__); break;                 \
+    case BaseOp::AllBitsSet: impl<BaseOp::AllBitsSet>(__VA_ARGS__); break;               \
+    }
+
+HeaderFilterKernels const ScalarKernels = {&kernels::Compare32Scalar,
+                                           &kernels::Compare64Scalar};
+HeaderFilterKernels const SSE41Kernels = {&kernels::Compare32SSE41,
+                                          &kernels::Compare64SSE41};
+HeaderFilterKernels const AVX2Kernels = {&kernels::Compare32AVX2,
+                                         &kernels::Compare64AVX2};
+
+HeaderFilterKernels const& SelectKernels()
+{
+    CpuFeatures const& features = GetCpuFeatures();
+    if (features.AVX2)
+        return AVX2Kernels;
+    if (features.SSE41)
+        return SSE41Kernels;
+    return ScalarKernels;
+}
+
+} // namespace
+
+namespace kernels
+{
+
+void Compare32Scalar(uint32_t const* column, size_t count, CompareOp op, uint32_t value,
+                     uint64_t* selection)
+{
+    CompareScalar(column, count, op, value, selection);
+}
+
+void Compare64Scalar(uint64_t const* column, size_t count, CompareOp op, uint64_t value,
+                     uint64_t* selection)
+{
+    CompareScalar(column, count, op, value, selection);
+}
+
+void Compare32SSE41(uint32_t const* column, size_t count, CompareOp op, uint32_t value,
+                    uint64_t* selection)
+{
+    LoweredOp const lowered = Lower(op);
+    ETK_DISPATCH_BASE_OP(Compare32SSE41Impl, lowered, column, count, lowered.Negate,
+                         value, selection);
+}
+
+void Compare64SSE41(uint64_t const* column, size_t count, CompareOp op, uint64_t value,
+                    uint64_t* selection)
+{
+    LoweredOp const lowered = Lower(op);
+    if (lowered.Op == BaseOp::Greater || lowered.Op == BaseOp::Less) {
+        CompareScalar(column, count, op, value, selection);
+        return;
+    }
+
+    ETK_DISPATCH_BASE_OP(Compare64SSE41Impl, lowered, column, count, lowered.Negate,
+                         value, selection);
+}
+
+void Compare32AVX2(uint32_t const* column, size_t count, CompareOp op, uint32_t value,
+                   uint64_t* selection)
+{
+    LoweredOp const lowered = Lower(op);
+    ETK_DISPATCH_BASE_OP(Compare32AVX2Impl, lowered, column, count, lowered.Negate,
+                         value, selection);
+}
+
+void Compare64AVX2(uint64_t const* column, size_t count, CompareOp op, uint64_t value,
+                   uint64_t* selection)
+{
+    LoweredOp const lowered = Lower(op);
+    ETK_DISPATCH_BASE_OP(Compare64AVX2Impl, lowered, column, count, lowered.Negate,
+                         value, selection);
+}
+
+} // namespace kernels
+
+#undef ETK_DISPATCH_BASE_OP
+
+HeaderFilterKernels const& GetScalarHeaderFilterKernels()
+{
+    return ScalarKernels;
+}
+
+HeaderFilterKernels const& GetHeaderFilterKernels()
+{
+    static HeaderFilterKernels const& kernels = SelectKernels();
+    return kernels;
+}
+
+uint32_t* HeaderColumnBlock::Column32(HeaderField field)
+{
+    switch (field) {
+    case HeaderField::ProviderId: return ProviderIndex;
+    case HeaderField::Id: return Id;
+    case HeaderField::Version: return Version;
+    case HeaderField::Channel: return Channel;
+    case HeaderField::Level: return Level;
+    case HeaderField::Opcode: return Opcode;
+    case HeaderField::Task: return Task;
+    case HeaderField::ProcessId: return ProcessId;
+    case HeaderField::ThreadId: return ThreadId;
+    case HeaderField::Keyword: break;
+    }
+
+    ETK_ASSERT(false && "Not a 32-bit column");
+    return nullptr;
+}
+
+bool HeaderFilter::IsSupported(HeaderPredicate const& predicate)
+{
+    if (predicate.Field == HeaderField::ProviderId)
+        return predicate.Op == CompareOp::Equal || predicate.Op == CompareOp::NotEqual;
+    return true;
+}
+
+HeaderFilter::HeaderFilter(cspan<HeaderPredicate> predicates, ProviderIndexMap& providers,
+                           HeaderFilterKernels const& kernels)
+    : kernels(kernels)
+{
+    for (HeaderPredicate const& predicate : predicates) {
+        Term term{predicate.Field, predicate.Op, predicate.Value};
+
+        if (predicate.Field == HeaderField::ProviderId) {
+            // Provider indices carry no ordering. Dropping the term would widen
+            // the filter, so the whole filter is rejected instead.
+            if (!IsSupported(predicate)) {
+                valid = false;
+                neverMatches = true;
+                terms.clear();
+                fieldMask = 0;
+                return;
+            }
+            term.Value = providers.GetOrAdd(predicate.ProviderId);
+        } else if (predicate.Field != HeaderField::Keyword &&
+                   predicate.Value > UINT32_MAX) {
+            // The value lies outside the range of the 32-bit column, which
+            // decides the comparison for all events.
+            switch (predicate.Op) {
+            case CompareOp::NotEqual:
+            case CompareOp::Less:
+            case CompareOp::LessEqual: continue;
+            case CompareOp::AnyBitsSet: term.Value &= UINT32_MAX; break;
+            default: neverMatches = true; continue;
+            }
+        }
+
+        terms.push_back(term);
+        fieldMask |= 1u << static_cast<unsigned>(predicate.Field);
+    }
+}
+
+void HeaderFilter::LoadColumns(cspan<EventInfo> events, ProviderIndexMap& providers,
+                               HeaderColumnBlock& block) const
+{
+    size_t const count = events.size();
+    block.Count = count;
+
+    auto const load = [&](HeaderField field, auto getter) {
+        if ((fieldMask & (1u << static_cast<unsigned>(field))) == 0)
+            return;
+        uint32_t* column = block.Column32(field);
+        for (size_t i = 0; i < count; ++i)
+            column[i] = static_cast<uint32_t>(getter(events[i].Record()->EventHeader));
+    };
+
+    if (fieldMask & (1u << static_cast<unsigned>(HeaderField::ProviderId))) {
+        for (size_t i = 0; i < count; ++i)
+            block.ProviderIndex[i] =
+                providers.GetOrAdd(events[i].Record()->EventHeader.ProviderId);
+    }
+
+    load(HeaderField::Id, [](EVENT_HEADER const& h) { return h.EventDescriptor.Id; });
+    load(HeaderField::Version,
+         [](EVENT_HEADER const& h) { return h.EventDescriptor.Version; });
+    load(HeaderField::Channel,
+         [](EVENT_HEADER const& h) { return h.EventDescriptor.Channel; });
+    load(HeaderField::Level,
+         [](EVENT_HEADER const& h) { return h.EventDescriptor.Level; });
+    load(HeaderField::Opcode,
+         [](EVENT_HEADER const& h) { return h.EventDescriptor.Opcode; });
+    load(HeaderField::Task, [](EVENT_HEADER const& h) { return h.EventDescriptor.Task; });
+    load(HeaderField::ProcessId, [](EVENT_HEADER const& h) { return h.ProcessId; });
+    load(HeaderField::ThreadId, [](EVENT_HEADER const& h) { return h.ThreadId; });
+
+    if (fieldMask & (1u << static_cast<unsigned>(HeaderField::Keyword))) {
+        for (size_t i = 0; i < count; ++i)
+            block.Keyword[i] = events[i].Record()->EventHeader.EventDescriptor.Keyword;
+    }
+}
+
+void HeaderFilter::Evaluate(cspan<EventInfo> events, ProviderIndexMap& providers,
+                            HeaderColumnBlock& block, SelectionBitmap& selection) const
+{
+    ETK_ASSERT(events.size() <= SelectionBitmap::Capacity);
+
+    if (neverMatches) {
+        selection.Clear();
+        return;
+    }
+
+    selection.SelectFirst(events.size());
+    if (terms.empty())
+        return;
+
+    LoadColumns(events, providers, block);
+
+    for (Term const& term : terms) {
+        if (term.Field == HeaderField::Keyword)
+            kernels.Compare64(block.Keyword, events.size(), term.Op, term.Value,
+                              selection.data());
+        else
+            kernels.Compare32(block.Column32(term.Field), events.size(), term.Op,
+                              static_cast<uint32_t>(term.Value), selection.data());
+    }
+}
+
+bool HeaderFilter::Matches(EVENT_HEADER const& header, ProviderIndexMap& providers) const
+{
+    if (neverMatches)
+        return false;
+
+    for (Term const& term : terms) {
+        uint64_t value;
+        switch (term.Field) {
+        case HeaderField::ProviderId:
+            value = providers.GetOrAdd(header.ProviderId);
+            break;
+        case HeaderField::Id: value = header.EventDescriptor.Id; break;
+        case HeaderField::Version: value = header.EventDescriptor.Version; break;
+        case HeaderField::Channel: value = header.EventDescriptor.Channel; break;
+        case HeaderField::Level: value = header.EventDescriptor.Level; break;
+        case HeaderField::Opcode: value = header.EventDescriptor.Opcode; break;
+        case HeaderField::Task: value = header.EventDescriptor.Task; break;
+        case HeaderField::Keyword: value = header.EventDescriptor.Keyword; break;
+        case HeaderField::ProcessId: value = header.ProcessId; break;
+        case HeaderField::ThreadId: value = header.ThreadId; break;
+        default: return false;
+        }
+
+        if (!EvaluateCompareOp(value, term.Op, term.Value))
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace etk
@@ -1,4 +1,5 @@
 #pragma once
+#include <chrono>
 #include <condition_variable>
 
 namespace etk
@@ -34,6 +35,13 @@ public:
             cv.wait(lock);
     }
 
+    template<typename Rep, typename Period>
+    bool WaitFor(std::chrono::duration<Rep, Period> const& timeout)
+    {
+        ExclusiveLock lock(mutex);
+        return cv.wait_for(lock, timeout, [this] { return signaled; });
+    }
+
 private:
     using ExclusiveLock = std::unique_lock<std::mutex>;
     std::mutex mutex;
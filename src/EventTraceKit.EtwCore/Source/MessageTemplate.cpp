@@ -0,0 +1,132 @@
+#include "etk/MessageTemplate.h"
+
+#include <algorithm>
+
+namespace etk
+{
+
+static bool IsDigit(wchar_t c)
+{
+    return c >= L'0' && c <= L'9';
+}
+
+MessageTemplate::MessageTemplate(std::wstring_view message, size_t propertyCount)
+{
+    Assign(message, propertyCount);
+}
+
+void MessageTemplate::Assign(std::wstring_view message, size_t propertyCount)
+{
+    literals.clear();
+    segments.clear();
+    referencedPropertyCount = 0;
+
+    size_t pos = 0;
+    while (pos < message.size()) {
+        size_t const percent = std::min(message.find(L'%', pos), message.size());
+        AppendLiteral(message.substr(pos, percent - pos));
+        if (percent == message.size())
+            break;
+
+        pos = percent + 1;
+        if (pos == message.size()) {
+            AppendLiteral(L"%");
+            break;
+        }
+
+        wchar_t const c = message[pos];
+        if (c == L'0')
+            break;
+
+        if (!IsDigit(c)) {
+            ++pos;
+            switch (c) {
+            case L'n': AppendLiteral(L"\r\n"); break;
+            case L'r': AppendLiteral(L"\r"); break;
+            case L't': AppendLiteral(L"\t"); break;
+            default: AppendLiteral(std::wstring_view(&c, 1)); break;
+            }
+            continue;
+        }
+
+        uint32_t index = c - L'0';
+        ++pos;
+        if (pos < message.size() && IsDigit(message[pos])) {
+            index = index * 10 + (message[pos] - L'0');
+            ++pos;
+        }
+
+        // Skip the format spec, properties are inserted as strings.
+        if (pos < message.size() && message[pos] == L'!') {
+            size_t const specEnd = message.find(L'!', pos + 1);
+            if (specEnd != std::wstring_view::npos)
+                pos = specEnd + 1;
+        }
+
+        if (index > propertyCount) {
+            AppendLiteral(message.substr(percent, pos - percent));
+            continue;
+        }
+
+        segments.push_back({index - 1, 0, 0});
+        referencedPropertyCount = std::max<size_t>(referencedPropertyCount, index);
+    }
+}
+
+void MessageTemplate::AppendLiteral(std::wstring_view text)
+{
+    if (text.empty())
+        return;
+
+    // Adjacent literal text is merged into a single run.
+    if (segments.empty() || segments.back().Property != LiteralRun)
+        segments.push_back({LiteralRun, static_cast<uint32_t>(literals.size()), 0});
+
+    literals.append(text);
+    segments.back().Length += static_cast<uint32_t>(text.size());
+}
+
+size_t MessageTemplate::GetMemorySize() const
+{
+    return sizeof(*this) + literals.capacity() * sizeof(wchar_t) +
+           segments.capacity() * sizeof(Segment);
+}
+
+size_t MessageTemplate::Format(cspan<std::wstring_view> properties, wchar_t* buffer,
+                               size_t bufferSize) const
+{
+    if (bufferSize == 0)
+        return 0;
+
+    size_t written = 0;
+    size_t const capacity = bufferSize - 1;
+    for (Segment const& segment : segments) {
+        std::wstring_view text;
+        if (segment.Property == LiteralRun)
+            text = std::wstring_view(literals).substr(segment.Offset, segment.Length);
+        else if (segment.Property < properties.size())
+            text = properties[segment.Property];
+
+        size_t const count = std::min(text.size(), capacity - written);
+        std::copy_n(text.data(), count, buffer + written);
+        written += count;
+        if (written == capacity)
+            break;
+    }
+
+    buffer[written] = L'\0';
+    return written;
+}
+
+void MessageTemplate::Format(cspan<std::wstring_view> properties,
+                             std::wstring& output) const
+{
+    for (Segment const& segment : segments) {
+        if (segment.Property == LiteralRun)
+            output.append(literals, segment.Offset, segment.Length);
+        else if (segment.Property < properties.size())
+            output += properties[segment.Property];
+    }
+}
+
+} // namespace etk
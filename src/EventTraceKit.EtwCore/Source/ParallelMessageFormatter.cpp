@@ -0,0 +1,199 @@
+#include "etk/ParallelMessageFormatter.h"
+
+#include "etk/Support/SetThreadDescription.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace etk
+{
+
+struct ParallelMessageFormatter::Worker
+{
+    TdhMessageFormatter Formatter;
+    // Not started for the first worker, which is the calling thread.
+    std::thread Thread;
+};
+
+struct ParallelMessageFormatter::Pool
+{
+    std::mutex Mutex;
+    std::condition_variable TaskStarted;
+    std::condition_variable TaskFinished;
+    std::function<void(Worker&)> const* Task = nullptr;
+    // Incremented for every task, so that workers run each task once.
+    uint64_t Generation = 0;
+    size_t PendingWorkers = 0;
+    bool Stopping = false;
+};
+
+namespace
+{
+
+// Messages of a chunk, formatted by a single worker.
+template<typename Char>
+struct Chunk
+{
+    std::basic_string<Char> Text;
+    std::vector<size_t> Lengths;
+    std::vector<bool> Formatted;
+};
+
+} // namespace
+
+ParallelMessageFormatter::ParallelMessageFormatter(unsigned threadCount,
+                                                   size_t chunkSize)
+    : chunkSize(std::max<size_t>(chunkSize, 1))
+    , pool(std::make_unique<Pool>())
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    workers.resize(threadCount);
+    for (auto& worker : workers)
+        worker = std::make_unique<Worker>();
+    for (size_t i = 1; i < workers.size(); ++i) {
+        workers[i]->Thread =
+            std::thread(&ParallelMessageFormatter::WorkerThreadProc, this,
+                        std::ref(*workers[i]));
+    }
+}
+
+ParallelMessageFormatter::~ParallelMessageFormatter()
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->Mutex);
+        pool->Stopping = true;
+    }
+    pool->TaskStarted.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker->Thread.joinable())
+            worker->Thread.join();
+    }
+}
+
+void ParallelMessageFormatter::WorkerThreadProc(Worker& worker)
+{
+    SetCurrentThreadDescription(L"ETW Message Formatter Thread");
+
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(pool->Mutex);
+    for (;;) {
+        pool->TaskStarted.wait(
+            lock, [&] { return pool->Stopping || pool->Generation != generation; });
+        if (pool->Stopping)
+            break;
+
+        generation = pool->Generation;
+        auto const& task = *pool->Task;
+        lock.unlock();
+        task(worker);
+        lock.lock();
+
+        if (--pool->PendingWorkers == 0)
+            pool->TaskFinished.notify_one();
+    }
+}
+
+void ParallelMessageFormatter::RunOnWorkers(std::function<void(Worker&)> const& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->Mutex);
+        pool->Task = &task;
+        pool->PendingWorkers = workers.size() - 1;
+        ++pool->Generation;
+    }
+    pool->TaskStarted.notify_all();
+
+    task(*workers[0]);
+
+    std::unique_lock<std::mutex> lock(pool->Mutex);
+    pool->TaskFinished.wait(lock, [&] { return pool->PendingWorkers == 0; });
+    pool->Task = nullptr;
+}
+
+void ParallelMessageFormatter::FormatEventMessages(cspan<EventInfo> events,
+                                                   FormattedMessages& output)
+{
+    FormatChunks(events, output);
+}
+
+void ParallelMessageFormatter::FormatEventMessages(cspan<EventInfo> events,
+                                                   FormattedMessagesU8& output)
+{
+    FormatChunks(events, output);
+}
+
+template<typename Char>
+void ParallelMessageFormatter::FormatChunks(cspan<EventInfo> events,
+                                            BasicFormattedMessages<Char>& output)
+{
+    size_t const chunkCount = (events.size() + chunkSize - 1) / chunkSize;
+    std::vector<Chunk<Char>> chunks(chunkCount);
+    std::atomic<size_t> nextChunk{0};
+
+    std::function<void(Worker&)> const formatChunks = [&](Worker& worker) {
+        for (;;) {
+            size_t const index = nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (index >= chunkCount)
+                break;
+
+            Chunk<Char>& chunk = chunks[index];
+            size_t const first = index * chunkSize;
+            auto const chunkEvents =
+                events.subspan(first, std::min(chunkSize, events.size() - first));
+            chunk.Lengths.reserve(chunkEvents.size());
+            chunk.Formatted.reserve(chunkEvents.size());
+
+            // Messages are appended directly to the chunk. Events that cannot
+            // be formatted leave it unchanged and yield empty messages.
+            for (EventInfo const& info : chunkEvents) {
+                size_t const chunkLength = chunk.Text.size();
+                bool formatted = false;
+                if (info && info.Record()) {
+                    size_t const pointerSize =
+                        GetPointerSize(info.Record()->EventHeader);
+                    formatted = worker.Formatter.FormatEventMessage(info, pointerSize,
+                                                                    chunk.Text);
+                }
+                chunk.Lengths.push_back(chunk.Text.size() - chunkLength);
+                chunk.Formatted.push_back(formatted);
+            }
+        }
+    };
+
+    // Small batches are not worth waking the workers for.
+    if (chunkCount > 1)
+        RunOnWorkers(formatChunks);
+    else
+        formatChunks(*workers[0]);
+
+    size_t totalLength = 0;
+    for (Chunk<Char> const& chunk : chunks)
+        totalLength += chunk.Text.size();
+
+    output.Text.clear();
+    output.Text.reserve(totalLength);
+    output.Offsets.clear();
+    output.Offsets.reserve(events.size() + 1);
+    output.Offsets.push_back(0);
+    output.Formatted.clear();
+    output.Formatted.reserve(events.size());
+
+    for (Chunk<Char> const& chunk : chunks) {
+        size_t offset = output.Text.size();
+        output.Text += chunk.Text;
+        for (size_t length : chunk.Lengths) {
+            offset += length;
+            output.Offsets.push_back(offset);
+        }
+        output.Formatted.insert(output.Formatted.end(), chunk.Formatted.begin(),
+                                chunk.Formatted.end());
+    }
+}
+
+} // namespace etk
@@ -0,0 +1,374 @@
+#include "etk/PayloadFilter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <string_view>
+
+#include <in6addr.h>
+
+namespace etk
+{
+
+namespace
+{
+
+size_t const InvalidSize = static_cast<size_t>(-1);
+
+bool IsArray(EVENT_PROPERTY_INFO const& propInfo)
+{
+    return (propInfo.Flags & (PropertyParamCount | PropertyParamFixedCount)) != 0 ||
+           propInfo.count > 1;
+}
+
+template<typename T>
+T LoadUnaligned(std::byte const* ptr)
+{
+    T value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+void FoldCase(std::wstring& str)
+{
+    for (wchar_t& c : str)
+        c = static_cast<wchar_t>(std::towupper(c));
+}
+
+bool MatchString(std::wstring_view str, StringMatch op, std::wstring_view value)
+{
+    switch (op) {
+    case StringMatch::Equal: return str == value;
+    case StringMatch::NotEqual: return str != value;
+    case StringMatch::Contains: return str.find(value) != std::wstring_view::npos;
+    case StringMatch::StartsWith:
+        return str.size() >= value.size() && str.compare(0, value.size(), value) == 0;
+    case StringMatch::EndsWith:
+        return str.size() >= value.size() &&
+               str.compare(str.size() - value.size(), value.size(), value) == 0;
+    }
+
+    return false;
+}
+
+} // namespace
+
+PayloadFilter::PayloadFilter(std::vector<PayloadPredicate> predicates)
+    : predicates(std::move(predicates))
+{
+    for (PayloadPredicate& predicate : this->predicates) {
+        if (predicate.Kind == PayloadPredicate::ValueKind::String && predicate.IgnoreCase)
+            FoldCase(predicate.StringValue);
+    }
+}
+
+bool PayloadFilter::Matches(EventInfo const& info)
+{
+    if (predicates.empty())
+        return true;
+
+    // Without a schema, or for string-only events, there are no properties to
+    // compare against.
+    if (!info || info.IsStringOnly())
+        return false;
+
+    auto const pointerSize =
+        static_cast<uint8_t>(GetPointerSize(info.Record()->EventHeader));
+    SchemaLayout const& layout = GetLayout(info, pointerSize);
+
+    cspan<std::byte> const userData = info.UserData();
+    for (size_t i = 0; i < predicates.size(); ++i) {
+        if (!Evaluate(predicates[i], layout.Fields[i], layout, userData))
+            return false;
+    }
+
+    return true;
+}
+
+PayloadFilter::SchemaLayout const& PayloadFilter::GetLayout(EventInfo const& info,
+                                                             uint8_t pointerSize)
+{
+    auto const [it, inserted] = layouts.try_emplace(LayoutKey(info.Info(), pointerSize));
+
+    // A schema may have been freed and its address reused for a different
+    // event, so cached layouts are validated against the schema identity.
+    SchemaLayout& layout = it->second;
+    if (inserted || layout.ProviderId != info->ProviderGuid ||
+        std::memcmp(&layout.Descriptor, &info->EventDescriptor,
+                    sizeof(EVENT_DESCRIPTOR)) != 0 ||
+        layout.PropertyCount != info->TopLevelPropertyCount)
+        layout = CreateLayout(info, pointerSize);
+
+    return layout;
+}
+
+PayloadFilter::SchemaLayout PayloadFilter::CreateLayout(EventInfo const& info,
+                                                        uint8_t pointerSize) const
+{
+    SchemaLayout layout;
+    layout.ProviderId = info->ProviderGuid;
+    layout.Descriptor = info->EventDescriptor;
+    layout.PropertyCount = info->TopLevelPropertyCount;
+    layout.Fields.resize(predicates.size());
+
+    size_t unresolved = predicates.size();
+    uint32_t offset = 0;
+    bool fixedOffset = true;
+
+    for (ULONG i = 0; i < info->TopLevelPropertyCount && unresolved != 0; ++i) {
+        EVENT_PROPERTY_INFO const& propInfo = info->EventPropertyInfoArray[i];
+
+        Extent extent;
+        bool const hasExtent = GetExtent(propInfo, pointerSize, extent);
+        ValueType const type = hasExtent ? GetValueType(propInfo) : ValueType::Unresolved;
+        bool const isNumber = type == ValueType::Signed || type == ValueType::Unsigned;
+        bool const isString =
+            type == ValueType::UnicodeString || type == ValueType::AnsiString;
+
+        wchar_t const* const name = info.GetStringAt(propInfo.NameOffset);
+        for (size_t k = 0; name && k < predicates.size(); ++k) {
+            FieldLocation& field = layout.Fields[k];
+            if (field.Type != ValueType::Unresolved || predicates[k].Property != name)
+                continue;
+
+            bool const compatible =
+                predicates[k].Kind == PayloadPredicate::ValueKind::Number ? isNumber
+                                                                           : isString;
+            if (!compatible)
+                continue;
+
+            field.Type = type;
+            field.Value = extent;
+            field.Offset = fixedOffset ? offset : 0;
+            field.StepCount = static_cast<uint16_t>(layout.Steps.size());
+            --unresolved;
+        }
+
+        // Properties following one whose size cannot be determined up front
+        // (structs, variable-length arrays, SIDs) are not located.
+        if (!hasExtent)
+            break;
+
+        if (fixedOffset && extent.Kind == ExtentKind::Fixed) {
+            offset += extent.Size;
+        } else {
+            fixedOffset = false;
+            layout.Steps.push_back(extent);
+        }
+    }
+
+    layout.FixedPrefixSize = offset;
+    return layout;
+}
+
+bool PayloadFilter::Evaluate(PayloadPredicate const& predicate,
+                             FieldLocation const& field, SchemaLayout const& layout,
+                             cspan<std::byte> userData)
+{
+    if (field.Type == ValueType::Unresolved)
+        return false;
+
+    size_t offset = field.Offset;
+    if (field.StepCount != 0) {
+        offset = layout.FixedPrefixSize;
+        for (size_t i = 0; i < field.StepCount; ++i) {
+            size_t const size = Measure(layout.Steps[i], userData, offset);
+            if (size == InvalidSize)
+                return false;
+            offset += size;
+        }
+    }
+
+    size_t size = Measure(field.Value, userData, offset);
+    if (size == InvalidSize)
+        return false;
+
+    std::byte const* data = userData.data() + offset;
+
+    if (field.Type == ValueType::Signed || field.Type == ValueType::Unsigned) {
+        uint64_t value = 0;
+        switch (size) {
+        case 1: value = LoadUnaligned<uint8_t>(data); break;
+        case 2: value = LoadUnaligned<uint16_t>(data); break;
+        case 4: value = LoadUnaligned<uint32_t>(data); break;
+        case 8: value = LoadUnaligned<uint64_t>(data); break;
+        default: return false;
+        }
+
+        if (field.Type == ValueType::Unsigned)
+            return EvaluateCompareOp(value, predicate.NumberOp,
+                                     static_cast<uint64_t>(predicate.NumberValue));
+
+        unsigned const shift = static_cast<unsigned>(64 - size * 8);
+        auto const signedValue = static_cast<int64_t>(value << shift) >> shift;
+        return EvaluateCompareOp(signedValue, predicate.NumberOp, predicate.NumberValue);
+    }
+
+    if (field.Value.Kind == ExtentKind::Counted) {
+        data += sizeof(uint16_t);
+        size -= sizeof(uint16_t);
+    }
+
+    stringBuffer.clear();
+    stringBuffer.reserve(size);
+    if (field.Type == ValueType::UnicodeString) {
+        for (size_t i = 0; i + 1 < size; i += sizeof(uint16_t)) {
+            auto const c = LoadUnaligned<uint16_t>(data + i);
+            stringBuffer.push_back(static_cast<wchar_t>(c));
+        }
+    } else {
+        for (size_t i = 0; i < size; ++i)
+            stringBuffer.push_back(static_cast<wchar_t>(static_cast<uint8_t>(data[i])));
+    }
+
+    // Strip the terminator, and any padding of fixed-length strings.
+    size_t const terminator = stringBuffer.find(L'\0');
+    if (terminator != std::wstring::npos)
+        stringBuffer.resize(terminator);
+
+    if (predicate.IgnoreCase)
+        FoldCase(stringBuffer);
+
+    return MatchString(stringBuffer, predicate.StringOp, predicate.StringValue);
+}
+
+bool PayloadFilter::GetExtent(EVENT_PROPERTY_INFO const& propInfo, uint8_t pointerSize,
+                              Extent& extent)
+{
+    if ((propInfo.Flags & (PropertyStruct | PropertyParamLength | PropertyParamCount)) !=
+        0)
+        return false;
+
+    size_t size;
+    switch (propInfo.nonStructType.InType) {
+    case TDH_INTYPE_UNICODESTRING:
+        if (propInfo.length == 0) {
+            extent.Kind = ExtentKind::UnicodeTerminated;
+            return !IsArray(propInfo);
+        }
+        size = propInfo.length * sizeof(uint16_t);
+        break;
+    case TDH_INTYPE_ANSISTRING:
+        if (propInfo.length == 0) {
+            extent.Kind = ExtentKind::AnsiTerminated;
+            return !IsArray(propInfo);
+        }
+        size = propInfo.length;
+        break;
+    case TDH_INTYPE_COUNTEDSTRING:
+    case TDH_INTYPE_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDSTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDBINARY:
+        extent.Kind = ExtentKind::Counted;
+        return !IsArray(propInfo);
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_UINT8:
+    case TDH_INTYPE_ANSICHAR: size = 1; break;
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_UINT16:
+    case TDH_INTYPE_UNICODECHAR: size = 2; break;
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_BOOLEAN:
+    case TDH_INTYPE_FLOAT: size = 4; break;
+    case TDH_INTYPE_INT64:
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT64:
+    case TDH_INTYPE_DOUBLE:
+    case TDH_INTYPE_FILETIME: size = 8; break;
+    case TDH_INTYPE_GUID:
+    case TDH_INTYPE_SYSTEMTIME: size = 16; break;
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET: size = pointerSize; break;
+    case TDH_INTYPE_BINARY:
+        if (propInfo.length != 0)
+            size = propInfo.length;
+        else if (propInfo.nonStructType.OutType == TDH_OUTTYPE_IPV6)
+            size = sizeof(IN6_ADDR);
+        else
+            return false;
+        break;
+    default: return false;
+    }
+
+    if (IsArray(propInfo))
+        size *= propInfo.count;
+    if (size > UINT16_MAX)
+        return false;
+
+    extent.Kind = ExtentKind::Fixed;
+    extent.Size = static_cast<uint16_t>(size);
+    return true;
+}
+
+PayloadFilter::ValueType PayloadFilter::GetValueType(EVENT_PROPERTY_INFO const& propInfo)
+{
+    if (IsArray(propInfo))
+        return ValueType::Unresolved;
+
+    switch (propInfo.nonStructType.InType) {
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_INT64: return ValueType::Signed;
+    case TDH_INTYPE_UINT8:
+    case TDH_INTYPE_UINT16:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_HEXINT64:
+    case TDH_INTYPE_BOOLEAN:
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET:
+    case TDH_INTYPE_ANSICHAR:
+    case TDH_INTYPE_UNICODECHAR: return ValueType::Unsigned;
+    case TDH_INTYPE_UNICODESTRING:
+    case TDH_INTYPE_COUNTEDSTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDSTRING: return ValueType::UnicodeString;
+    case TDH_INTYPE_ANSISTRING:
+    case TDH_INTYPE_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDANSISTRING: return ValueType::AnsiString;
+    default: return ValueType::Unresolved;
+    }
+}
+
+// Returns the number of bytes occupied by a property at offset, or InvalidSize
+// if the payload is too short.
+size_t PayloadFilter::Measure(Extent extent, cspan<std::byte> userData, size_t offset)
+{
+    if (offset > userData.size())
+        return InvalidSize;
+
+    size_t const available = userData.size() - offset;
+    std::byte const* const data = userData.data() + offset;
+
+    switch (extent.Kind) {
+    case ExtentKind::Fixed: return extent.Size <= available ? extent.Size : InvalidSize;
+
+    case ExtentKind::UnicodeTerminated:
+        // An unterminated string extends to the end of the payload.
+        for (size_t i = 0; i + 1 < available; i += sizeof(uint16_t)) {
+            if (data[i] == std::byte(0) && data[i + 1] == std::byte(0))
+                return i + sizeof(uint16_t);
+        }
+        return available;
+
+    case ExtentKind::AnsiTerminated: {
+        auto const end = std::find(data, data + available, std::byte(0));
+        return end != data + available ? static_cast<size_t>(end - data) + 1 : available;
+    }
+
+    case ExtentKind::Counted: {
+        if (available < sizeof(uint16_t))
+            return InvalidSize;
+        size_t const size = sizeof(uint16_t) + LoadUnaligned<uint16_t>(data);
+        return size <= available ? size : InvalidSize;
+    }
+    }
+
+    return InvalidSize;
+}
+
+} // namespace etk
@@ -0,0 +1,347 @@
+#include "etk/PropertyDecoder.h"
+
+#include "etk/CompiledSchema.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <tdh.h>
+
+namespace etk
+{
+
+namespace
+{
+
+uint64_t const FileTimeTicksPerMillisecond = 10000;
+uint64_t const FileTimeTicksPerSecond = 10000000;
+uint64_t const SecondsPerDay = 86400;
+// Days from 1601-01-01, the FILETIME epoch, to 1970-01-01.
+int64_t const FileTimeEpochDays = 134774;
+
+using ValueKind = PropertyValue::ValueKind;
+
+template<typename T>
+T LoadUnaligned(std::byte const* ptr)
+{
+    T value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+bool IsArray(EVENT_PROPERTY_INFO const& propInfo)
+{
+    return (propInfo.Flags & (PropertyParamCount | PropertyParamFixedCount)) != 0 ||
+           propInfo.count > 1;
+}
+
+bool IsLeapYear(unsigned year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+// Converts a SYSTEMTIME to FILETIME ticks. The date is interpreted in the
+// proleptic Gregorian calendar. Returns false for dates before 1601 and for
+// out-of-range fields, like SystemTimeToFileTime.
+bool SystemTimeToTicks(std::byte const* data, uint64_t& ticks)
+{
+    // wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds
+    auto const field = [&](size_t index) {
+        return static_cast<unsigned>(LoadUnaligned<uint16_t>(data + index * 2));
+    };
+
+    static unsigned const DaysInMonth[] = {31, 28, 31, 30, 31, 30,
+                                           31, 31, 30, 31, 30, 31};
+
+    unsigned const month = field(1);
+    unsigned const day = field(3);
+    if (field(0) < 1601 || month < 1 || month > 12 || day < 1 ||
+        day > DaysInMonth[month - 1] + (month == 2 && IsLeapYear(field(0))) ||
+        field(4) > 23 || field(5) > 59 || field(6) > 59 || field(7) > 999)
+        return false;
+
+    // Days since 1970-01-01 of a civil date.
+    int64_t const year = static_cast<int64_t>(field(0)) - (month <= 2);
+    int64_t const era = year / 400;
+    auto const yearOfEra = static_cast<unsigned>(year - era * 400);
+    unsigned const dayOfYear =
+        (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned const dayOfEra =
+        yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int64_t const days = era * 146097 + dayOfEra - 719468 + FileTimeEpochDays;
+
+    uint64_t const seconds = static_cast<uint64_t>(days) * SecondsPerDay +
+                             field(4) * 3600u + field(5) * 60u + field(6);
+    ticks = seconds * FileTimeTicksPerSecond + field(7) * FileTimeTicksPerMillisecond;
+    return true;
+}
+
+// Strips everything from the first null character on.
+template<typename Char>
+cspan<std::byte> TrimAtNull(cspan<std::byte> data)
+{
+    for (size_t i = 0; i + sizeof(Char) <= data.size(); i += sizeof(Char)) {
+        if (LoadUnaligned<Char>(data.data() + i) == 0)
+            return data.first(i);
+    }
+    return data.first(data.size() - data.size() % sizeof(Char));
+}
+
+bool IsAnsiString(USHORT inType)
+{
+    return inType == TDH_INTYPE_ANSISTRING ||
+           inType == TDH_INTYPE_COUNTEDANSISTRING ||
+           inType == TDH_INTYPE_MANIFEST_COUNTEDANSISTRING ||
+           inType == TDH_INTYPE_REVERSEDCOUNTEDANSISTRING ||
+           inType == TDH_INTYPE_NONNULLTERMINATEDANSISTRING;
+}
+
+// Decodes a single value that occupies all of data, as located by the decode
+// plan. Leaves the value unchanged if it cannot be decoded.
+void DecodeValue(USHORT inType, size_t pointerSize, cspan<std::byte> data,
+                 PropertyValue& value)
+{
+    std::byte const* const ptr = data.data();
+    size_t const size = data.size();
+
+    auto const setSigned = [&](size_t valueSize) {
+        if (size < valueSize)
+            return;
+        uint64_t bits = 0;
+        std::memcpy(&bits, ptr, valueSize);
+        unsigned const shift = static_cast<unsigned>(64 - valueSize * 8);
+        value.Kind = ValueKind::Signed;
+        value.Int = static_cast<int64_t>(bits << shift) >> shift;
+    };
+
+    auto const setUnsigned = [&](size_t valueSize, ValueKind kind) {
+        if (size < valueSize)
+            return;
+        uint64_t bits = 0;
+        std::memcpy(&bits, ptr, valueSize);
+        value.Kind = kind;
+        value.UInt = bits;
+    };
+
+    auto const setData = [&](ValueKind kind, cspan<std::byte> bytes) {
+        value.Kind = kind;
+        value.Data = bytes;
+    };
+
+    switch (inType) {
+    case TDH_INTYPE_INT8: setSigned(1); break;
+    case TDH_INTYPE_INT16: setSigned(2); break;
+    case TDH_INTYPE_INT32: setSigned(4); break;
+    case TDH_INTYPE_INT64: setSigned(8); break;
+    case TDH_INTYPE_UINT8: setUnsigned(1, ValueKind::Unsigned); break;
+    case TDH_INTYPE_UINT16: setUnsigned(2, ValueKind::Unsigned); break;
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_HEXINT32: setUnsigned(4, ValueKind::Unsigned); break;
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT64: setUnsigned(8, ValueKind::Unsigned); break;
+
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET:
+        if (pointerSize == 4 || pointerSize == 8)
+            setUnsigned(pointerSize, ValueKind::Unsigned);
+        break;
+
+    case TDH_INTYPE_BOOLEAN:
+        if (size >= sizeof(uint32_t)) {
+            value.Kind = ValueKind::Boolean;
+            value.UInt = LoadUnaligned<uint32_t>(ptr) != 0 ? 1 : 0;
+        }
+        break;
+
+    case TDH_INTYPE_FLOAT:
+        if (size >= sizeof(float)) {
+            value.Kind = ValueKind::Float;
+            value.Double = LoadUnaligned<float>(ptr);
+        }
+        break;
+
+    case TDH_INTYPE_DOUBLE:
+        if (size >= sizeof(double)) {
+            value.Kind = ValueKind::Float;
+            value.Double = LoadUnaligned<double>(ptr);
+        }
+        break;
+
+    case TDH_INTYPE_GUID:
+        if (size >= sizeof(GUID)) {
+            value.Kind = ValueKind::Guid;
+            value.Guid = LoadUnaligned<GUID>(ptr);
+        }
+        break;
+
+    case TDH_INTYPE_FILETIME: setUnsigned(8, ValueKind::Time); break;
+
+    case TDH_INTYPE_SYSTEMTIME:
+        if (size >= 16 && SystemTimeToTicks(ptr, value.UInt))
+            value.Kind = ValueKind::Time;
+        break;
+
+    case TDH_INTYPE_UNICODECHAR:
+        if (size >= sizeof(uint16_t))
+            setData(ValueKind::UnicodeString, data.first(sizeof(uint16_t)));
+        break;
+
+    case TDH_INTYPE_ANSICHAR:
+        if (size >= 1)
+            setData(ValueKind::AnsiString, data.first(1));
+        break;
+
+    // Fixed-length strings may be padded with null characters.
+    case TDH_INTYPE_UNICODESTRING:
+        setData(ValueKind::UnicodeString, TrimAtNull<uint16_t>(data));
+        break;
+    case TDH_INTYPE_ANSISTRING:
+        setData(ValueKind::AnsiString, TrimAtNull<uint8_t>(data));
+        break;
+
+    case TDH_INTYPE_COUNTEDSTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDSTRING:
+    case TDH_INTYPE_REVERSEDCOUNTEDSTRING:
+    case TDH_INTYPE_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDANSISTRING:
+    case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING:
+        if (size >= sizeof(uint16_t)) {
+            setData(IsAnsiString(inType) ? ValueKind::AnsiString
+                                         : ValueKind::UnicodeString,
+                    data.subspan(sizeof(uint16_t)));
+        }
+        break;
+
+    case TDH_INTYPE_NONNULLTERMINATEDSTRING:
+        setData(ValueKind::UnicodeString, data.first(size - size % sizeof(uint16_t)));
+        break;
+    case TDH_INTYPE_NONNULLTERMINATEDANSISTRING:
+        setData(ValueKind::AnsiString, data);
+        break;
+
+    case TDH_INTYPE_BINARY:
+    case TDH_INTYPE_SID: setData(ValueKind::Binary, data); break;
+    case TDH_INTYPE_HEXDUMP:
+        if (size >= sizeof(uint32_t))
+            setData(ValueKind::Binary, data.subspan(sizeof(uint32_t)));
+        break;
+    case TDH_INTYPE_MANIFEST_COUNTEDBINARY:
+        if (size >= sizeof(uint16_t))
+            setData(ValueKind::Binary, data.subspan(sizeof(uint16_t)));
+        break;
+    case TDH_INTYPE_WBEMSID:
+        // A TOKEN_USER structure (two pointers) followed by the SID.
+        if (size >= pointerSize * 2)
+            setData(ValueKind::Binary, data.subspan(pointerSize * 2));
+        break;
+
+    default: break;
+    }
+}
+
+} // namespace
+
+PropertyValue::ValueKind
+PropertyDecoder::GetValueKind(EVENT_PROPERTY_INFO const& propInfo)
+{
+    if ((propInfo.Flags & PropertyStruct) != 0)
+        return ValueKind::Struct;
+    if (IsArray(propInfo))
+        return ValueKind::Array;
+
+    switch (propInfo.nonStructType.InType) {
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_INT64: return ValueKind::Signed;
+    case TDH_INTYPE_UINT8:
+    case TDH_INTYPE_UINT16:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_HEXINT64:
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET: return ValueKind::Unsigned;
+    case TDH_INTYPE_BOOLEAN: return ValueKind::Boolean;
+    case TDH_INTYPE_FLOAT:
+    case TDH_INTYPE_DOUBLE: return ValueKind::Float;
+    case TDH_INTYPE_GUID: return ValueKind::Guid;
+    case TDH_INTYPE_FILETIME:
+    case TDH_INTYPE_SYSTEMTIME: return ValueKind::Time;
+    case TDH_INTYPE_UNICODECHAR:
+    case TDH_INTYPE_UNICODESTRING:
+    case TDH_INTYPE_COUNTEDSTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDSTRING:
+    case TDH_INTYPE_REVERSEDCOUNTEDSTRING:
+    case TDH_INTYPE_NONNULLTERMINATEDSTRING: return ValueKind::UnicodeString;
+    case TDH_INTYPE_ANSICHAR:
+    case TDH_INTYPE_ANSISTRING:
+    case TDH_INTYPE_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDANSISTRING:
+    case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING:
+    case TDH_INTYPE_NONNULLTERMINATEDANSISTRING: return ValueKind::AnsiString;
+    case TDH_INTYPE_BINARY:
+    case TDH_INTYPE_SID:
+    case TDH_INTYPE_HEXDUMP:
+    case TDH_INTYPE_MANIFEST_COUNTEDBINARY:
+    case TDH_INTYPE_WBEMSID: return ValueKind::Binary;
+    default: return ValueKind::None;
+    }
+}
+
+size_t PropertyDecoder::Decode(EventInfo const info, size_t const pointerSize,
+                               span<PropertyValue> values)
+{
+    std::fill(values.begin(), values.end(), PropertyValue());
+    if (!info || info.IsStringOnly())
+        return 0;
+
+    // Schemas from the cache come with their compiled plan. Others are
+    // planned on the fly.
+    DecodePlan scratchPlan;
+    DecodePlan const* plan = nullptr;
+    if (CompiledSchema const* const compiled = info.Compiled()) {
+        plan = &compiled->Plan;
+    } else {
+        scratchPlan = DecodePlan(info);
+        plan = &scratchPlan;
+    }
+
+    size_t const count =
+        std::min({values.size(), static_cast<size_t>(info->TopLevelPropertyCount),
+                  plan->GetPlannedPropertyCount()});
+    locations.resize(count);
+
+    cspan<std::byte> const userData = info.UserData();
+    if (!plan->Locate(userData, pointerSize, locations))
+        return 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        EVENT_PROPERTY_INFO const& propInfo = info->EventPropertyInfoArray[i];
+        DecodePlan::Location const& location = locations[i];
+        PropertyValue& value = values[i];
+
+        cspan<std::byte> const data = userData.subspan(location.Offset, location.Size);
+        value.Count = location.Count;
+
+        if ((propInfo.Flags & PropertyStruct) != 0) {
+            value.Kind = ValueKind::Struct;
+            value.Data = data;
+            continue;
+        }
+
+        value.InType = propInfo.nonStructType.InType;
+        value.OutType = propInfo.nonStructType.OutType;
+        if (IsArray(propInfo)) {
+            value.Kind = ValueKind::Array;
+            value.Data = data;
+            continue;
+        }
+
+        DecodeValue(value.InType, pointerSize, data, value);
+    }
+
+    return count;
+}
+
+} // namespace etk
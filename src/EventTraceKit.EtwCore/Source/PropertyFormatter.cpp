@@ -0,0 +1,711 @@
+#include "etk/PropertyFormatter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace etk
+{
+
+namespace
+{
+
+// Address families of SOCKADDR structures.
+uint16_t const AddressFamilyIPv4 = 2;
+uint16_t const AddressFamilyIPv6 = 23;
+
+uint64_t const FileTimeTicksPerSecond = 10000000;
+uint64_t const SecondsPerDay = 86400;
+// Days from 1601-01-01, the FILETIME epoch, to 1970-01-01.
+int64_t const FileTimeEpochDays = 134774;
+
+template<typename T>
+T LoadUnaligned(std::byte const* ptr)
+{
+    T value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+uint16_t LoadBigEndian16(std::byte const* ptr)
+{
+    return static_cast<uint16_t>((static_cast<unsigned>(ptr[0]) << 8) |
+                                 static_cast<unsigned>(ptr[1]));
+}
+
+void AppendAscii(std::wstring& sink, char const* begin, char const* end)
+{
+    sink.append(begin, end);
+}
+
+template<typename T>
+void AppendDecimal(std::wstring& sink, T value)
+{
+    char buffer[24];
+    auto const result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    AppendAscii(sink, buffer, result.ptr);
+}
+
+template<typename T>
+void AppendFloat(std::wstring& sink, T value)
+{
+    // Shortest representation that round-trips.
+    char buffer[32];
+    auto const result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    AppendAscii(sink, buffer, result.ptr);
+}
+
+void AppendHex(std::wstring& sink, uint64_t value, unsigned minDigits = 1)
+{
+    wchar_t const* const Digits = L"0123456789ABCDEF";
+
+    wchar_t buffer[16];
+    unsigned count = 0;
+    do {
+        buffer[15 - count++] = Digits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+
+    sink += L"0x";
+    for (; count < minDigits; --minDigits)
+        sink += L'0';
+    sink.append(buffer + 16 - count, count);
+}
+
+// Appends value with exactly digits decimal digits.
+void AppendFixed(std::wstring& sink, unsigned value, unsigned digits)
+{
+    wchar_t buffer[10];
+    for (unsigned i = digits; i > 0; --i) {
+        buffer[i - 1] = static_cast<wchar_t>(L'0' + value % 10);
+        value /= 10;
+    }
+    sink.append(buffer, digits);
+}
+
+void AppendHexBytes(std::wstring& sink, cspan<std::byte> bytes)
+{
+    wchar_t const* const Digits = L"0123456789ABCDEF";
+    if (bytes.empty())
+        return;
+
+    sink += L"0x";
+    for (std::byte b : bytes) {
+        sink += Digits[static_cast<unsigned>(b) >> 4];
+        sink += Digits[static_cast<unsigned>(b) & 0xF];
+    }
+}
+
+void AppendGuid(std::wstring& sink, std::byte const* data)
+{
+    wchar_t const* const Digits = L"0123456789ABCDEF";
+    auto const appendHex = [&](uint64_t value, unsigned digits) {
+        for (unsigned i = digits; i > 0; --i)
+            sink += Digits[(value >> ((i - 1) * 4)) & 0xF];
+    };
+
+    sink += L'{';
+    appendHex(LoadUnaligned<uint32_t>(data), 8);
+    sink += L'-';
+    appendHex(LoadUnaligned<uint16_t>(data + 4), 4);
+    sink += L'-';
+    appendHex(LoadUnaligned<uint16_t>(data + 6), 4);
+    sink += L'-';
+    for (size_t i = 8; i < 16; ++i) {
+        if (i == 10)
+            sink += L'-';
+        appendHex(static_cast<unsigned>(data[i]), 2);
+    }
+    sink += L'}';
+}
+
+void AppendIPv4(std::wstring& sink, std::byte const* data)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        if (i > 0)
+            sink += L'.';
+        AppendDecimal(sink, static_cast<unsigned>(data[i]));
+    }
+}
+
+// Formats the address as recommended by RFC 5952: lower-case hex digits
+// without leading zeros, and the longest run of zero groups compressed.
+void AppendIPv6(std::wstring& sink, std::byte const* data)
+{
+    wchar_t const* const Digits = L"0123456789abcdef";
+
+    uint16_t groups[8];
+    for (size_t i = 0; i < 8; ++i)
+        groups[i] = LoadBigEndian16(data + i * 2);
+
+    // IPv4-mapped addresses (::ffff:a.b.c.d)
+    if (std::all_of(groups, groups + 5, [](uint16_t g) { return g == 0; }) &&
+        groups[5] == 0xFFFF) {
+        sink += L"::ffff:";
+        AppendIPv4(sink, data + 12);
+        return;
+    }
+
+    size_t zeroBegin = 8;
+    size_t zeroLength = 1;
+    for (size_t i = 0; i < 8;) {
+        size_t end = i;
+        while (end < 8 && groups[end] == 0)
+            ++end;
+        if (end - i > zeroLength) {
+            zeroBegin = i;
+            zeroLength = end - i;
+        }
+        i = end == i ? i + 1 : end;
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+        if (i == zeroBegin) {
+            sink += L"::";
+            i += zeroLength - 1;
+            continue;
+        }
+        if (i > 0 && i != zeroBegin + zeroLength)
+            sink += L':';
+
+        uint16_t const group = groups[i];
+        bool leading = true;
+        for (int shift = 12; shift >= 0; shift -= 4) {
+            unsigned const digit = (group >> shift) & 0xF;
+            if (leading && digit == 0 && shift != 0)
+                continue;
+            leading = false;
+            sink += Digits[digit];
+        }
+    }
+}
+
+ULONG AppendSocketAddress(std::wstring& sink, cspan<std::byte> data)
+{
+    if (data.size() < sizeof(uint16_t))
+        return ERROR_EVT_INVALID_EVENT_DATA;
+
+    uint16_t const family = LoadUnaligned<uint16_t>(data.data());
+    if (family == AddressFamilyIPv4) {
+        // SOCKADDR_IN: family, port, address
+        if (data.size() < 8)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        AppendIPv4(sink, data.data() + 4);
+        sink += L':';
+        AppendDecimal(sink, LoadBigEndian16(data.data() + 2));
+        return ERROR_SUCCESS;
+    }
+
+    if (family == AddressFamilyIPv6) {
+        // SOCKADDR_IN6: family, port, flow info, address, scope id
+        if (data.size() < 28)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        sink += L'[';
+        AppendIPv6(sink, data.data() + 8);
+        if (uint32_t const scopeId = LoadUnaligned<uint32_t>(data.data() + 24)) {
+            sink += L'%';
+            AppendDecimal(sink, scopeId);
+        }
+        sink += L"]:";
+        AppendDecimal(sink, LoadBigEndian16(data.data() + 2));
+        return ERROR_SUCCESS;
+    }
+
+    return ERROR_NOT_SUPPORTED;
+}
+
+// Formats a SID in its string form (S-1-5-21-...). Returns the size of the
+// SID, or zero if the data is too short.
+size_t AppendSid(std::wstring& sink, cspan<std::byte> data)
+{
+    // Revision, sub-authority count, 48-bit big-endian identifier authority,
+    // and 32-bit sub-authorities.
+    if (data.size() < 8)
+        return 0;
+
+    size_t const subAuthorityCount = static_cast<uint8_t>(data[1]);
+    size_t const size = 8 + subAuthorityCount * sizeof(uint32_t);
+    if (data.size() < size)
+        return 0;
+
+    uint64_t authority = 0;
+    for (size_t i = 2; i < 8; ++i)
+        authority = (authority << 8) | static_cast<uint8_t>(data[i]);
+
+    sink += L"S-";
+    AppendDecimal(sink, static_cast<unsigned>(data[0]));
+    sink += L'-';
+    if (authority >> 32 != 0)
+        AppendHex(sink, authority, 12);
+    else
+        AppendDecimal(sink, authority);
+
+    for (size_t i = 0; i < subAuthorityCount; ++i) {
+        sink += L'-';
+        AppendDecimal(sink, LoadUnaligned<uint32_t>(data.data() + 8 + i * 4));
+    }
+
+    return size;
+}
+
+void AppendCodeUnit(std::wstring& sink, uint32_t codePoint)
+{
+    if constexpr (sizeof(wchar_t) == 2) {
+        if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            sink += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+            sink += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+            return;
+        }
+    }
+
+    sink += static_cast<wchar_t>(codePoint);
+}
+
+// Decodes UTF-8, replacing invalid sequences with U+FFFD.
+void AppendUtf8(std::wstring& sink, std::byte const* data, size_t size)
+{
+    size_t i = 0;
+    while (i < size) {
+        auto const lead = static_cast<uint8_t>(data[i]);
+        if (lead < 0x80) {
+            sink += static_cast<wchar_t>(lead);
+            ++i;
+            continue;
+        }
+
+        size_t length;
+        uint32_t codePoint;
+        uint32_t minCodePoint;
+        if ((lead & 0xE0) == 0xC0) {
+            length = 2;
+            codePoint = lead & 0x1F;
+            minCodePoint = 0x80;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length = 3;
+            codePoint = lead & 0x0F;
+            minCodePoint = 0x800;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length = 4;
+            codePoint = lead & 0x07;
+            minCodePoint = 0x10000;
+        } else {
+            sink += wchar_t(0xFFFD);
+            ++i;
+            continue;
+        }
+
+        size_t k = 1;
+        for (; k < length && i + k < size; ++k) {
+            auto const trail = static_cast<uint8_t>(data[i + k]);
+            if ((trail & 0xC0) != 0x80)
+                break;
+            codePoint = (codePoint << 6) | (trail & 0x3F);
+        }
+
+        if (k != length || codePoint < minCodePoint || codePoint > 0x10FFFF ||
+            (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            sink += wchar_t(0xFFFD);
+            i += k;
+            continue;
+        }
+
+        AppendCodeUnit(sink, codePoint);
+        i += length;
+    }
+}
+
+// Appends UTF-16 code units up to the first null character.
+void AppendUtf16(std::wstring& sink, std::byte const* data, size_t charCount)
+{
+    for (size_t i = 0; i < charCount; ++i) {
+        auto const c = LoadUnaligned<uint16_t>(data + i * sizeof(uint16_t));
+        if (c == 0)
+            break;
+        sink += static_cast<wchar_t>(c);
+    }
+}
+
+// Appends 8-bit characters up to the first null character. Only ASCII is
+// decoded natively unless the string is declared as UTF-8, other code pages
+// are left to TDH.
+ULONG AppendAnsi(std::wstring& sink, std::byte const* data, size_t size, USHORT outType)
+{
+    size = std::find(data, data + size, std::byte(0)) - data;
+
+    if (outType == TDH_OUTTYPE_UTF8) {
+        AppendUtf8(sink, data, size);
+        return ERROR_SUCCESS;
+    }
+
+    if (std::any_of(data, data + size, [](std::byte b) { return b >= std::byte(0x80); }))
+        return ERROR_NOT_SUPPORTED;
+
+    for (size_t i = 0; i < size; ++i)
+        sink += static_cast<wchar_t>(data[i]);
+    return ERROR_SUCCESS;
+}
+
+void AppendDateTime(std::wstring& sink, unsigned year, unsigned month, unsigned day,
+                    unsigned hour, unsigned minute, unsigned second)
+{
+    AppendFixed(sink, year, 4);
+    sink += L'-';
+    AppendFixed(sink, month, 2);
+    sink += L'-';
+    AppendFixed(sink, day, 2);
+    sink += L'T';
+    AppendFixed(sink, hour, 2);
+    sink += L':';
+    AppendFixed(sink, minute, 2);
+    sink += L':';
+    AppendFixed(sink, second, 2);
+}
+
+void AppendFileTime(std::wstring& sink, uint64_t ticks)
+{
+    uint64_t const seconds = ticks / FileTimeTicksPerSecond;
+    auto const fraction = static_cast<unsigned>(ticks % FileTimeTicksPerSecond);
+    auto const secondOfDay = static_cast<unsigned>(seconds % SecondsPerDay);
+
+    // Converts days since 1970-01-01 to a civil date (proleptic Gregorian).
+    int64_t const days =
+        static_cast<int64_t>(seconds / SecondsPerDay) - FileTimeEpochDays + 719468;
+    int64_t const era = (days >= 0 ? days : days - 146096) / 146097;
+    auto const dayOfEra = static_cast<unsigned>(days - era * 146097);
+    unsigned const yearOfEra =
+        (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned const dayOfYear =
+        dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned const mp = (5 * dayOfYear + 2) / 153;
+    unsigned const day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    unsigned const month = mp < 10 ? mp + 3 : mp - 9;
+    auto const year = static_cast<unsigned>(yearOfEra + era * 400 + (month <= 2));
+
+    AppendDateTime(sink, year, month, day, secondOfDay / 3600, secondOfDay / 60 % 60,
+                   secondOfDay % 60);
+    sink += L'.';
+    AppendFixed(sink, fraction, 7);
+    sink += L'Z';
+}
+
+void AppendSystemTime(std::wstring& sink, std::byte const* data)
+{
+    // wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds
+    auto const field = [&](size_t index) {
+        return static_cast<unsigned>(LoadUnaligned<uint16_t>(data + index * 2));
+    };
+
+    AppendDateTime(sink, field(0), field(1), field(3), field(4), field(5), field(6));
+    sink += L'.';
+    AppendFixed(sink, field(7), 3);
+}
+
+bool IsHexOutType(USHORT outType)
+{
+    return outType == TDH_OUTTYPE_HEXINT8 || outType == TDH_OUTTYPE_HEXINT16 ||
+           outType == TDH_OUTTYPE_HEXINT32 || outType == TDH_OUTTYPE_HEXINT64;
+}
+
+template<typename T>
+ULONG FormatInteger(USHORT outType, cspan<std::byte> data, std::wstring& sink,
+                    size_t& consumed)
+{
+    if (data.size() < sizeof(T))
+        return ERROR_EVT_INVALID_EVENT_DATA;
+    consumed = sizeof(T);
+
+    T const value = LoadUnaligned<T>(data.data());
+    using Unsigned = std::make_unsigned_t<T>;
+
+    switch (outType) {
+    case TDH_OUTTYPE_HEXINT8:
+    case TDH_OUTTYPE_HEXINT16:
+    case TDH_OUTTYPE_HEXINT32:
+    case TDH_OUTTYPE_HEXINT64: AppendHex(sink, static_cast<Unsigned>(value)); break;
+    case TDH_OUTTYPE_BOOLEAN: sink += value != 0 ? L"true" : L"false"; break;
+    case TDH_OUTTYPE_STRING:
+        sink += static_cast<wchar_t>(static_cast<Unsigned>(value));
+        break;
+    case TDH_OUTTYPE_PORT:
+        if constexpr (sizeof(T) != 2)
+            return ERROR_NOT_SUPPORTED;
+        AppendDecimal(sink, LoadBigEndian16(data.data()));
+        break;
+    case TDH_OUTTYPE_IPV4:
+        if constexpr (sizeof(T) != 4)
+            return ERROR_NOT_SUPPORTED;
+        AppendIPv4(sink, data.data());
+        break;
+    case TDH_OUTTYPE_ERRORCODE:
+    case TDH_OUTTYPE_WIN32ERROR:
+    case TDH_OUTTYPE_NTSTATUS:
+    case TDH_OUTTYPE_HRESULT:
+    case TDH_OUTTYPE_ETWTIME:
+    case TDH_OUTTYPE_DATETIME:
+    case TDH_OUTTYPE_CULTURE_INSENSITIVE_DATETIME:
+    case TDH_OUTTYPE_DATETIME_UTC: return ERROR_NOT_SUPPORTED;
+    default: AppendDecimal(sink, value); break;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+ULONG FormatValue(USHORT inType, USHORT outType, size_t pointerSize, USHORT length,
+                  cspan<std::byte> data, std::wstring& sink, size_t& consumed)
+{
+    std::byte const* const ptr = data.data();
+    size_t const size = data.size();
+
+    switch (inType) {
+    case TDH_INTYPE_INT8: return FormatInteger<int8_t>(outType, data, sink, consumed);
+    case TDH_INTYPE_UINT8: return FormatInteger<uint8_t>(outType, data, sink, consumed);
+    case TDH_INTYPE_INT16: return FormatInteger<int16_t>(outType, data, sink, consumed);
+    case TDH_INTYPE_UINT16: return FormatInteger<uint16_t>(outType, data, sink, consumed);
+    case TDH_INTYPE_INT32: return FormatInteger<int32_t>(outType, data, sink, consumed);
+    case TDH_INTYPE_UINT32: return FormatInteger<uint32_t>(outType, data, sink, consumed);
+    case TDH_INTYPE_INT64: return FormatInteger<int64_t>(outType, data, sink, consumed);
+    case TDH_INTYPE_UINT64: return FormatInteger<uint64_t>(outType, data, sink, consumed);
+
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_HEXINT64: {
+        size_t const valueSize = inType == TDH_INTYPE_HEXINT32 ? 4 : 8;
+        if (size < valueSize)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        AppendHex(sink, valueSize == 4 ? LoadUnaligned<uint32_t>(ptr)
+                                       : LoadUnaligned<uint64_t>(ptr));
+        consumed = valueSize;
+        return ERROR_SUCCESS;
+    }
+
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET:
+        if (pointerSize != 4 && pointerSize != 8)
+            return ERROR_NOT_SUPPORTED;
+        if (size < pointerSize)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        if (inType == TDH_INTYPE_SIZET && !IsHexOutType(outType) &&
+            outType != TDH_OUTTYPE_NULL) {
+            AppendDecimal(sink, pointerSize == 4 ? LoadUnaligned<uint32_t>(ptr)
+                                                 : LoadUnaligned<uint64_t>(ptr));
+        } else {
+            AppendHex(sink,
+                      pointerSize == 4 ? LoadUnaligned<uint32_t>(ptr)
+                                       : LoadUnaligned<uint64_t>(ptr),
+                      static_cast<unsigned>(pointerSize * 2));
+        }
+        consumed = pointerSize;
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_BOOLEAN:
+        if (size < 4)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        sink += LoadUnaligned<uint32_t>(ptr) != 0 ? L"true" : L"false";
+        consumed = 4;
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_FLOAT:
+        if (size < sizeof(float))
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        AppendFloat(sink, LoadUnaligned<float>(ptr));
+        consumed = sizeof(float);
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_DOUBLE:
+        if (size < sizeof(double))
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        AppendFloat(sink, LoadUnaligned<double>(ptr));
+        consumed = sizeof(double);
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_GUID:
+        if (size < 16)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        AppendGuid(sink, ptr);
+        consumed = 16;
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_FILETIME:
+        if (size < sizeof(uint64_t))
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        AppendFileTime(sink, LoadUnaligned<uint64_t>(ptr));
+        consumed = sizeof(uint64_t);
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_SYSTEMTIME:
+        if (size < 16)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        AppendSystemTime(sink, ptr);
+        consumed = 16;
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_SID:
+        consumed = AppendSid(sink, data);
+        return consumed != 0 ? ERROR_SUCCESS : ERROR_EVT_INVALID_EVENT_DATA;
+
+    case TDH_INTYPE_WBEMSID: {
+        // A TOKEN_USER structure (two pointers) followed by the SID.
+        size_t const headerSize = pointerSize * 2;
+        if (size < headerSize)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        size_t const sidSize = AppendSid(sink, data.subspan(headerSize));
+        if (sidSize == 0)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        consumed = headerSize + sidSize;
+        return ERROR_SUCCESS;
+    }
+
+    case TDH_INTYPE_UNICODECHAR:
+        if (size < sizeof(uint16_t))
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        sink += static_cast<wchar_t>(LoadUnaligned<uint16_t>(ptr));
+        consumed = sizeof(uint16_t);
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_ANSICHAR:
+        if (size < 1)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        if (ptr[0] >= std::byte(0x80))
+            return ERROR_NOT_SUPPORTED;
+        sink += static_cast<wchar_t>(ptr[0]);
+        consumed = 1;
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_UNICODESTRING: {
+        size_t charCount;
+        if (length != 0) {
+            charCount = length;
+            if (size < charCount * sizeof(uint16_t))
+                return ERROR_EVT_INVALID_EVENT_DATA;
+            consumed = charCount * sizeof(uint16_t);
+        } else {
+            // An unterminated string extends to the end of the data.
+            charCount = size / sizeof(uint16_t);
+            consumed = charCount * sizeof(uint16_t);
+            for (size_t i = 0; i < charCount; ++i) {
+                if (LoadUnaligned<uint16_t>(ptr + i * sizeof(uint16_t)) == 0) {
+                    charCount = i;
+                    consumed = (i + 1) * sizeof(uint16_t);
+                    break;
+                }
+            }
+        }
+        AppendUtf16(sink, ptr, charCount);
+        return ERROR_SUCCESS;
+    }
+
+    case TDH_INTYPE_ANSISTRING: {
+        size_t stringSize;
+        if (length != 0) {
+            if (size < length)
+                return ERROR_EVT_INVALID_EVENT_DATA;
+            stringSize = length;
+            consumed = length;
+        } else {
+            stringSize = std::find(ptr, ptr + size, std::byte(0)) - ptr;
+            consumed = std::min(stringSize + 1, size);
+        }
+        return AppendAnsi(sink, ptr, stringSize, outType);
+    }
+
+    case TDH_INTYPE_COUNTEDSTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDSTRING:
+    case TDH_INTYPE_REVERSEDCOUNTEDSTRING:
+    case TDH_INTYPE_COUNTEDANSISTRING:
+    case TDH_INTYPE_MANIFEST_COUNTEDANSISTRING:
+    case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING: {
+        if (size < sizeof(uint16_t))
+            return ERROR_EVT_INVALID_EVENT_DATA;
+
+        bool const reversed = inType == TDH_INTYPE_REVERSEDCOUNTEDSTRING ||
+                              inType == TDH_INTYPE_REVERSEDCOUNTEDANSISTRING;
+        size_t const byteCount =
+            reversed ? LoadBigEndian16(ptr) : LoadUnaligned<uint16_t>(ptr);
+        if (size - sizeof(uint16_t) < byteCount)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+
+        consumed = sizeof(uint16_t) + byteCount;
+        bool const ansi = inType == TDH_INTYPE_COUNTEDANSISTRING ||
+                          inType == TDH_INTYPE_MANIFEST_COUNTEDANSISTRING ||
+                          inType == TDH_INTYPE_REVERSEDCOUNTEDANSISTRING;
+        if (ansi)
+            return AppendAnsi(sink, ptr + sizeof(uint16_t), byteCount, outType);
+        AppendUtf16(sink, ptr + sizeof(uint16_t), byteCount / sizeof(uint16_t));
+        return ERROR_SUCCESS;
+    }
+
+    case TDH_INTYPE_NONNULLTERMINATEDSTRING:
+        consumed = size - size % sizeof(uint16_t);
+        AppendUtf16(sink, ptr, size / sizeof(uint16_t));
+        return ERROR_SUCCESS;
+
+    case TDH_INTYPE_NONNULLTERMINATEDANSISTRING:
+        consumed = size;
+        return AppendAnsi(sink, ptr, size, outType);
+
+    case TDH_INTYPE_BINARY: {
+        size_t valueSize = length;
+        if (valueSize == 0 && outType == TDH_OUTTYPE_IPV6)
+            valueSize = 16;
+        if (size < valueSize)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        consumed = valueSize;
+
+        if (outType == TDH_OUTTYPE_IPV6) {
+            if (valueSize != 16)
+                return ERROR_NOT_SUPPORTED;
+            AppendIPv6(sink, ptr);
+            return ERROR_SUCCESS;
+        }
+        if (outType == TDH_OUTTYPE_SOCKETADDRESS)
+            return AppendSocketAddress(sink, data.subspan(0, valueSize));
+        if (outType == TDH_OUTTYPE_PKCS7_WITH_TYPE_INFO)
+            return ERROR_NOT_SUPPORTED;
+
+        AppendHexBytes(sink, data.subspan(0, valueSize));
+        return ERROR_SUCCESS;
+    }
+
+    case TDH_INTYPE_HEXDUMP:
+    case TDH_INTYPE_MANIFEST_COUNTEDBINARY: {
+        size_t const prefixSize =
+            inType == TDH_INTYPE_HEXDUMP ? sizeof(uint32_t) : sizeof(uint16_t);
+        if (size < prefixSize)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        size_t const byteCount = prefixSize == sizeof(uint32_t)
+                                     ? LoadUnaligned<uint32_t>(ptr)
+                                     : LoadUnaligned<uint16_t>(ptr);
+        if (size - prefixSize < byteCount)
+            return ERROR_EVT_INVALID_EVENT_DATA;
+
+        AppendHexBytes(sink, data.subspan(prefixSize, byteCount));
+        consumed = prefixSize + byteCount;
+        return ERROR_SUCCESS;
+    }
+
+    default: return ERROR_NOT_SUPPORTED;
+    }
+}
+
+} // namespace
+
+ULONG FormatPropertyValue(USHORT inType, USHORT outType, size_t pointerSize,
+                          USHORT length, cspan<std::byte> data, std::wstring& sink,
+                          size_t& consumed)
+{
+    size_t const sinkSize = sink.size();
+    consumed = 0;
+
+    ULONG const ec =
+        FormatValue(inType, outType, pointerSize, length, data, sink, consumed);
+    if (ec != ERROR_SUCCESS) {
+        sink.resize(sinkSize);
+        consumed = 0;
+    }
+
+    return ec;
+}
+
+} // namespace etk
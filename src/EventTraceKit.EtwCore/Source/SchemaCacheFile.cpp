@@ -0,0 +1,343 @@
+#include "etk/SchemaCacheFile.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace etk
+{
+
+struct SchemaCacheFile::Header
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t BucketCount;
+    uint32_t EntryCount;
+    uint64_t FileSize;
+    uint64_t Checksum; // Of all bytes following the header.
+};
+
+struct SchemaCacheFile::Bucket
+{
+    uint8_t Key[sizeof(EventKey)];
+    uint8_t Reserved[5];
+    uint64_t ManifestHash;
+    uint32_t DataOffset;
+    uint32_t DataSize; // Zero for empty buckets.
+};
+
+namespace
+{
+
+uint32_t const CacheMagic = 0x534B5445; // 'ETKS'
+uint32_t const CacheVersion = 2;
+size_t const DataAlignment = 8;
+size_t const MinBucketCount = 16;
+
+static_assert(std::is_trivially_copyable_v<EventKey>);
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+size_t GetHomeBucket(EventKey const& key, uint64_t manifestHash, size_t bucketCount)
+{
+    uint64_t hash =
+        ComputeStableHash(cspan<std::byte>(reinterpret_cast<std::byte const*>(&key),
+                                           sizeof(key)));
+    hash = ComputeStableHash(
+        cspan<std::byte>(reinterpret_cast<std::byte const*>(&manifestHash),
+                         sizeof(manifestHash)),
+        hash);
+    return static_cast<size_t>(hash) & (bucketCount - 1);
+}
+
+template<typename T>
+T Load(std::byte const* data, size_t offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+// Checks that a string offset is zero (no string) or refers to a UTF-16 string
+// terminated within the blob.
+bool IsValidStringOffset(std::byte const* data, size_t size, ULONG offset)
+{
+    if (offset == 0)
+        return true;
+    if (offset % sizeof(uint16_t) != 0)
+        return false;
+
+    for (size_t i = offset; i + sizeof(uint16_t) <= size; i += sizeof(uint16_t)) {
+        if (Load<uint16_t>(data, i) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// Persisted blobs are used without copying, so every offset the decoder and
+// formatter follow must stay within the blob.
+bool IsValidEventInfo(std::byte const* data, size_t size)
+{
+    if (size < sizeof(TRACE_EVENT_INFO))
+        return false;
+
+    TRACE_EVENT_INFO info;
+    std::memcpy(&info, data, sizeof(info));
+
+    size_t const arrayOffset = offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray);
+    size_t const maxProperties = (size - arrayOffset) / sizeof(EVENT_PROPERTY_INFO);
+    if (info.PropertyCount > maxProperties ||
+        info.TopLevelPropertyCount > info.PropertyCount)
+        return false;
+
+    ULONG const stringOffsets[] = {
+        info.ProviderNameOffset, info.LevelNameOffset,       info.ChannelNameOffset,
+        info.KeywordsNameOffset, info.TaskNameOffset,        info.OpcodeNameOffset,
+        info.EventMessageOffset, info.ProviderMessageOffset, info.EventNameOffset,
+        info.EventAttributesOffset,
+    };
+    for (ULONG const offset : stringOffsets) {
+        if (!IsValidStringOffset(data, size, offset))
+            return false;
+    }
+
+    if (info.BinaryXMLOffset > size || size - info.BinaryXMLOffset < info.BinaryXMLSize)
+        return false;
+
+    for (ULONG i = 0; i < info.PropertyCount; ++i) {
+        size_t const propertyOffset = arrayOffset + i * sizeof(EVENT_PROPERTY_INFO);
+        auto const property = Load<EVENT_PROPERTY_INFO>(data, propertyOffset);
+        if (!IsValidStringOffset(data, size, property.NameOffset))
+            return false;
+
+        if ((property.Flags & PropertyStruct) != 0) {
+            size_t const end = size_t(property.structType.StructStartIndex) +
+                               property.structType.NumOfStructMembers;
+            if (end > info.PropertyCount)
+                return false;
+        } else if ((property.Flags & PropertyHasCustomSchema) != 0) {
+            if (property.customSchemaType.CustomSchemaOffset >= size)
+                return false;
+        } else if (!IsValidStringOffset(data, size,
+                                        property.nonStructType.MapNameOffset)) {
+            return false;
+        }
+
+        if ((property.Flags & PropertyParamCount) != 0 &&
+            property.countPropertyIndex >= info.PropertyCount)
+            return false;
+        if ((property.Flags & PropertyParamLength) != 0 &&
+            property.lengthPropertyIndex >= info.PropertyCount)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+uint64_t ComputeStableHash(cspan<std::byte> data, uint64_t seed) noexcept
+{
+    // 64-bit FNV-1a
+    uint64_t const Prime = 0x100000001B3ULL;
+
+    uint64_t hash = seed;
+    for (std::byte b : data) {
+        hash ^= static_cast<uint8_t>(b);
+        hash *= Prime;
+    }
+
+    return hash;
+}
+
+bool SchemaCacheFile::Attach(cspan<std::byte> contents)
+{
+    static_assert(sizeof(Header) == 32 && sizeof(Bucket) == 40);
+    static_assert(sizeof(Header) % DataAlignment == 0 &&
+                  sizeof(Bucket) % DataAlignment == 0);
+
+    Detach();
+
+    if (reinterpret_cast<uintptr_t>(contents.data()) % DataAlignment != 0 ||
+        contents.size() < sizeof(Header))
+        return false;
+
+    Header header;
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (header.Magic != CacheMagic || header.Version != CacheVersion ||
+        header.FileSize != contents.size() || header.BucketCount < MinBucketCount ||
+        (header.BucketCount & (header.BucketCount - 1)) != 0 ||
+        (contents.size() - sizeof(Header)) / sizeof(Bucket) < header.BucketCount)
+        return false;
+
+    if (ComputeStableHash(contents.subspan(sizeof(Header))) != header.Checksum)
+        return false;
+
+    // Validate all entries once so that lookups can trust the table.
+    size_t const dataStart = sizeof(Header) + header.BucketCount * sizeof(Bucket);
+    auto const buckets =
+        reinterpret_cast<Bucket const*>(contents.data() + sizeof(Header));
+
+    size_t count = 0;
+    for (size_t i = 0; i < header.BucketCount; ++i) {
+        Bucket const& bucket = buckets[i];
+        if (bucket.DataSize == 0)
+            continue;
+
+        if (bucket.DataOffset % DataAlignment != 0 || bucket.DataOffset < dataStart ||
+            bucket.DataOffset > contents.size() ||
+            contents.size() - bucket.DataOffset < bucket.DataSize ||
+            !IsValidEventInfo(contents.data() + bucket.DataOffset, bucket.DataSize))
+            return false;
+
+        ++count;
+    }
+
+    // Keep at least one empty bucket so that probing terminates.
+    if (count != header.EntryCount || count >= header.BucketCount)
+        return false;
+
+    this->contents = contents;
+    bucketCount = header.BucketCount;
+    entryCount = count;
+    return true;
+}
+
+void SchemaCacheFile::Detach()
+{
+    contents = cspan<std::byte>();
+    bucketCount = 0;
+    entryCount = 0;
+}
+
+std::tuple<TRACE_EVENT_INFO const*, size_t>
+SchemaCacheFile::Find(EventKey const& key, uint64_t manifestHash) const
+{
+    if (entryCount == 0)
+        return {nullptr, 0};
+
+    size_t index = GetHomeBucket(key, manifestHash, bucketCount);
+    for (;; index = (index + 1) & (bucketCount - 1)) {
+        Bucket const& bucket = *GetBucket(index);
+        if (IsEmpty(bucket))
+            return {nullptr, 0};
+
+        if (bucket.ManifestHash == manifestHash &&
+            std::memcmp(bucket.Key, &key, sizeof(key)) == 0)
+            return {GetInfo(bucket), GetInfoSize(bucket)};
+    }
+}
+
+SchemaCacheFile::Bucket const* SchemaCacheFile::GetBucket(size_t index) const
+{
+    return reinterpret_cast<Bucket const*>(contents.data() + sizeof(Header)) + index;
+}
+
+EventKey SchemaCacheFile::GetKey(Bucket const& bucket)
+{
+    EventKey key(GUID(), 0, 0);
+    std::memcpy(&key, bucket.Key, sizeof(key));
+    return key;
+}
+
+TRACE_EVENT_INFO const* SchemaCacheFile::GetInfo(Bucket const& bucket) const
+{
+    return reinterpret_cast<TRACE_EVENT_INFO const*>(contents.data() + bucket.DataOffset);
+}
+
+size_t SchemaCacheFile::GetInfoSize(Bucket const& bucket) const
+{
+    return bucket.DataSize;
+}
+
+uint64_t SchemaCacheFile::GetManifestHash(Bucket const& bucket) const
+{
+    return bucket.ManifestHash;
+}
+
+void SchemaCacheWriter::Add(EventKey const& key, uint64_t manifestHash,
+                            TRACE_EVENT_INFO const* info, size_t infoSize)
+{
+    if (!info || !IsValidEventInfo(reinterpret_cast<std::byte const*>(info), infoSize))
+        return;
+
+    auto const data = reinterpret_cast<std::byte const*>(info);
+    entries.insert_or_assign(EntryKey(key, manifestHash),
+                             std::vector<std::byte>(data, data + infoSize));
+}
+
+void SchemaCacheWriter::Merge(SchemaCacheFile const& file, size_t maxEntries)
+{
+    file.ForEach([&](EventKey const& key, uint64_t manifestHash,
+                     TRACE_EVENT_INFO const* info, size_t infoSize) {
+        if (entries.size() >= maxEntries)
+            return;
+
+        auto const data = reinterpret_cast<std::byte const*>(info);
+        entries.try_emplace(EntryKey(key, manifestHash), data, data + infoSize);
+    });
+}
+
+std::tuple<TRACE_EVENT_INFO const*, size_t>
+SchemaCacheWriter::Find(EventKey const& key, uint64_t manifestHash) const
+{
+    auto const it = entries.find(EntryKey(key, manifestHash));
+    if (it == entries.end())
+        return {nullptr, 0};
+
+    return {reinterpret_cast<TRACE_EVENT_INFO const*>(it->second.data()),
+            it->second.size()};
+}
+
+std::vector<std::byte> SchemaCacheWriter::Finish() const
+{
+    using Header = SchemaCacheFile::Header;
+    using Bucket = SchemaCacheFile::Bucket;
+
+    // A load factor of at most 0.5 keeps probe sequences short.
+    size_t bucketCount = MinBucketCount;
+    while (bucketCount < entries.size() * 2)
+        bucketCount *= 2;
+
+    size_t fileSize = sizeof(Header) + bucketCount * sizeof(Bucket);
+    for (auto const& entry : entries)
+        fileSize += AlignUp(entry.second.size(), DataAlignment);
+
+    std::vector<std::byte> contents(fileSize);
+    auto const buckets = reinterpret_cast<Bucket*>(contents.data() + sizeof(Header));
+
+    size_t dataOffset = sizeof(Header) + bucketCount * sizeof(Bucket);
+    for (auto const& [entryKey, data] : entries) {
+        auto const& [key, manifestHash] = entryKey;
+
+        size_t index = GetHomeBucket(key, manifestHash, bucketCount);
+        while (buckets[index].DataSize != 0)
+            index = (index + 1) & (bucketCount - 1);
+
+        Bucket& bucket = buckets[index];
+        std::memcpy(bucket.Key, &key, sizeof(key));
+        bucket.ManifestHash = manifestHash;
+        bucket.DataOffset = static_cast<uint32_t>(dataOffset);
+        bucket.DataSize = static_cast<uint32_t>(data.size());
+
+        std::memcpy(contents.data() + dataOffset, data.data(), data.size());
+        dataOffset += AlignUp(data.size(), DataAlignment);
+    }
+
+    Header header = {};
+    header.Magic = CacheMagic;
+    header.Version = CacheVersion;
+    header.BucketCount = static_cast<uint32_t>(bucketCount);
+    header.EntryCount = static_cast<uint32_t>(entries.size());
+    header.FileSize = fileSize;
+    header.Checksum =
+        ComputeStableHash(cspan<std::byte>(contents).subspan(sizeof(Header)));
+    std::memcpy(contents.data(), &header, sizeof(header));
+
+    return contents;
+}
+
+} // namespace etk
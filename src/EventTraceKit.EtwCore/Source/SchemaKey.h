@@ -0,0 +1,129 @@
+#pragma once
+#include "etk/EventKey.h"
+
+#include "etk/Support/CompilerSupport.h"
+
+ETK_DIAGNOSTIC_PUSH()
+ETK_DIAGNOSTIC_DISABLE_MSVC(4127)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4244)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4245)
+ETK_DIAGNOSTIC_DISABLE_MSVC(4996)
+#include <absl/hash/hash.h>
+ETK_DIAGNOSTIC_POP()
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include <windows.h>
+
+#include <evntcons.h>
+
+namespace etk
+{
+
+class TlogEventMetadataKey
+{
+public:
+    explicit TlogEventMetadataKey(uint8_t const* metadata, uint16_t size)
+        : metadata_(metadata)
+        , size_(size)
+    {}
+
+    uint8_t const* data() const { return metadata_; }
+    uint16_t size() const { return size_; }
+
+    friend bool operator==(TlogEventMetadataKey const& lhs,
+                           TlogEventMetadataKey const& rhs)
+    {
+        return std::equal(lhs.metadata_, lhs.metadata_ + lhs.size_, rhs.metadata_,
+                          rhs.metadata_ + rhs.size_);
+    }
+
+    friend bool operator!=(TlogEventMetadataKey const& lhs,
+                           TlogEventMetadataKey const& rhs)
+    {
+        return !operator==(lhs, rhs);
+    }
+
+    template<typename H>
+    friend H AbslHashValue(H state, TlogEventMetadataKey const& key)
+    {
+        return H::combine_contiguous(std::move(state), key.metadata_, key.size_);
+    }
+
+private:
+    uint8_t const* metadata_ = nullptr;
+    uint16_t size_ = 0;
+};
+
+// Identifies the schema of an event. Manifest-based events are identified by
+// provider, id and version. TraceLogging events carry their schema inline and
+// are identified by provider and metadata instead. Copies share the metadata
+// of the original, which is either borrowed from an event or owned by a clone.
+class SchemaKey
+{
+public:
+    explicit SchemaKey(EventKey const& key)
+        : key(key)
+        , tlogMetadata(nullptr, 0)
+    {}
+
+    SchemaKey(GUID const& providerId, TlogEventMetadataKey const& tlogMetadata)
+        : key(providerId, 0, 0)
+        , tlogMetadata(tlogMetadata)
+    {}
+
+    // Returns a copy that owns its TraceLogging metadata.
+    SchemaKey Clone() const
+    {
+        SchemaKey copy(key);
+        if (tlogMetadata.size() != 0) {
+            auto metadata = std::make_unique<uint8_t[]>(tlogMetadata.size());
+            std::copy_n(tlogMetadata.data(), tlogMetadata.size(), metadata.get());
+            copy.ownedMetadata = std::move(metadata);
+            copy.tlogMetadata =
+                TlogEventMetadataKey(copy.ownedMetadata.get(), tlogMetadata.size());
+        }
+        return copy;
+    }
+
+    // The key refers to TraceLogging metadata of the record, if any, and must
+    // not outlive it.
+    static SchemaKey FromEvent(EVENT_RECORD const& record)
+    {
+        for (unsigned i = 0; i < record.ExtendedDataCount; ++i) {
+            auto const& item = record.ExtendedData[i];
+            if (item.ExtType == EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL) {
+                return SchemaKey(record.EventHeader.ProviderId,
+                                 TlogEventMetadataKey(
+                                     reinterpret_cast<uint8_t const*>(item.DataPtr),
+                                     item.DataSize));
+            }
+        }
+
+        return SchemaKey(EventKey::FromEvent(record));
+    }
+
+    EventKey const& GetEventKey() const { return key; }
+    bool IsTraceLogging() const { return tlogMetadata.size() != 0; }
+    size_t GetMetadataSize() const { return tlogMetadata.size(); }
+
+    friend bool operator==(SchemaKey const& x, SchemaKey const& y)
+    {
+        return x.key == y.key && x.tlogMetadata == y.tlogMetadata;
+    }
+
+    template<typename H>
+    friend H AbslHashValue(H state, SchemaKey const& key)
+    {
+        return H::combine(std::move(state), key.key, key.tlogMetadata);
+    }
+
+private:
+    EventKey key;
+    TlogEventMetadataKey tlogMetadata;
+    std::shared_ptr<uint8_t const[]> ownedMetadata;
+};
+
+} // namespace etk
@@ -0,0 +1,77 @@
+#include "etk/Support/CpuInfo.h"
+
+#include "etk/Support/CompilerSupport.h"
+
+#if defined(ETK_COMPILER_MSVC)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace etk
+{
+
+namespace
+{
+
+void CpuId(int leaf, int subleaf, int (&regs)[4])
+{
+#if defined(ETK_COMPILER_MSVC)
+    __cpuidex(regs, leaf, subleaf);
+#else
+    unsigned a, b, c, d;
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+    regs[0] = static_cast<int>(a);
+    regs[1] = static_cast<int>(b);
+    regs[2] = static_cast<int>(c);
+    regs[3] = static_cast<int>(d);
+#endif
+}
+
+unsigned long long GetXCR0()
+{
+#if defined(ETK_COMPILER_MSVC)
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+CpuFeatures DetectCpuFeatures()
+{
+    CpuFeatures features;
+
+    int regs[4];
+    CpuId(0, 0, regs);
+    int const maxLeaf = regs[0];
+    if (maxLeaf < 1)
+        return features;
+
+    CpuId(1, 0, regs);
+    features.SSE41 = (regs[2] & (1 << 19)) != 0;
+
+    // AVX state must be enabled by the OS (OSXSAVE and XCR0 bits 1 and 2).
+    bool const osxsave = (regs[2] & (1 << 27)) != 0;
+    bool const avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (GetXCR0() & 0x6) != 0x6)
+        return features;
+
+    if (maxLeaf >= 7) {
+        CpuId(7, 0, regs);
+        features.AVX2 = (regs[1] & (1 << 5)) != 0;
+    }
+
+    return features;
+}
+
+} // namespace
+
+CpuFeatures const& GetCpuFeatures()
+{
+    static CpuFeatures const features = DetectCpuFeatures();
+    return features;
+}
+
+} // namespace etk
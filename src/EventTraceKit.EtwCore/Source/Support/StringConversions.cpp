@@ -1,140 +1,249 @@
 #include "etk/Support/StringConversions.h"
 
-#include <Windows.h>
+#include "etk/Support/CompilerSupport.h"
+
+#include <cstdint>
 #include <type_traits>
 
+#if defined(ETK_ARCH_X64) || defined(ETK_ARCH_X86)
+#include <emmintrin.h>
+#define ETK_STRING_CONVERSIONS_SSE2
+#endif
+
 namespace etk
 {
 
 namespace
 {
 
-struct U8To16Conversion
-{
-    using InputChar = char;
-    using OutputChar =
-        std::conditional_t<sizeof(wchar_t) == sizeof(char16_t), wchar_t, char16_t>;
-    static bool EstimateLength(InputChar const* source, size_t sourceLength,
-                               size_t& outLength) noexcept;
-    static size_t Convert(OutputChar* out, size_t outLength, InputChar const* source,
-                          size_t sourceLength) noexcept;
-};
-
-bool U8To16Conversion::EstimateLength(char const* source, size_t sourceLength,
-                                      size_t& outLength) noexcept
-{
-    int const length = MultiByteToWideChar(CP_UTF8, 0, source,
-                                           static_cast<int>(sourceLength), nullptr, 0);
-    if (length <= 0)
-        return false;
+// Code units of std::wstring are UTF-16 on Windows. The vector paths are only
+// used there.
+constexpr bool IsUtf16 = sizeof(wchar_t) == sizeof(char16_t);
 
-    outLength = static_cast<size_t>(length);
-    return true;
-}
+uint32_t const ReplacementChar = 0xFFFD;
 
-size_t U8To16Conversion::Convert(wchar_t* out, size_t outSize, char const* source,
-                                 size_t sourceLength) noexcept
+bool IsHighSurrogate(uint32_t c)
 {
-    if (outSize == 0)
-        return 0;
+    return c >= 0xD800 && c <= 0xDBFF;
+}
 
-    int const length =
-        MultiByteToWideChar(CP_UTF8, 0, source, static_cast<int>(sourceLength), out,
-                            static_cast<int>(outSize));
-    if (length <= 0)
-        return 0;
+bool IsLowSurrogate(uint32_t c)
+{
+    return c >= 0xDC00 && c <= 0xDFFF;
+}
 
-    return static_cast<size_t>(length);
+// Copies the leading ASCII characters of source to out, 8 at a time. Returns
+// the number of characters copied.
+size_t CopyAscii(wchar_t const* source, size_t length, char* out)
+{
+    size_t i = 0;
+#ifdef ETK_STRING_CONVERSIONS_SSE2
+    if constexpr (IsUtf16) {
+        __m128i const nonAsciiMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+        for (; i + 8 <= length; i += 8) {
+            __m128i const chars =
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chars, nonAsciiMask),
+                                                  _mm_setzero_si128())) != 0xFFFF)
+                break;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i),
+                             _mm_packus_epi16(chars, chars));
+        }
+    }
+#endif
+    return i;
 }
 
-struct U16To8Conversion
+// Copies the leading ASCII characters of source to out, 16 at a time. Returns
+// the number of characters copied.
+size_t CopyAscii(char const* source, size_t length, wchar_t* out)
 {
-    using InputChar =
-        std::conditional_t<sizeof(wchar_t) == sizeof(char16_t), wchar_t, char16_t>;
-    using OutputChar = char;
-    static bool EstimateLength(InputChar const* source, size_t sourceLength,
-                               size_t& outLength) noexcept;
-    static size_t Convert(OutputChar* out, size_t outLength, InputChar const* source,
-                          size_t sourceLength) noexcept;
-};
-
-bool U16To8Conversion::EstimateLength(wchar_t const* source, size_t sourceLength,
-                                      size_t& outLength) noexcept
+    size_t i = 0;
+#ifdef ETK_STRING_CONVERSIONS_SSE2
+    if constexpr (IsUtf16) {
+        __m128i const zero = _mm_setzero_si128();
+        for (; i + 16 <= length; i += 16) {
+            __m128i const chars =
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+            if (_mm_movemask_epi8(chars) != 0)
+                break;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                             _mm_unpacklo_epi8(chars, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),
+                             _mm_unpackhi_epi8(chars, zero));
+        }
+    }
+#endif
+    return i;
+}
+
+char* EncodeUtf8(uint32_t c, char* out)
 {
-    int const length = WideCharToMultiByte(
-        CP_UTF8, 0, source, static_cast<int>(sourceLength), nullptr, 0, nullptr, nullptr);
-    if (length <= 0)
-        return false;
+    if (c < 0x80) {
+        *out++ = static_cast<char>(c);
+    } else if (c < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (c >> 6));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (c >> 12));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (c >> 18));
+        *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    return out;
+}
 
-    outLength = static_cast<size_t>(length);
-    return true;
+wchar_t* EncodeUtf16(uint32_t c, wchar_t* out)
+{
+    if (IsUtf16 && c >= 0x10000) {
+        c -= 0x10000;
+        *out++ = static_cast<wchar_t>(0xD800 | (c >> 10));
+        *out++ = static_cast<wchar_t>(0xDC00 | (c & 0x3FF));
+    } else {
+        *out++ = static_cast<wchar_t>(c);
+    }
+    return out;
 }
 
-size_t U16To8Conversion::Convert(char* out, size_t outSize, wchar_t const* source,
-                                 size_t sourceLength) noexcept
+// Decodes the code point of the UTF-8 sequence at the start of source, which
+// must not be empty. An invalid sequence decodes to the replacement character
+// and consumes its maximal valid prefix, or a single byte, like
+// MultiByteToWideChar does.
+uint32_t DecodeUtf8(unsigned char const* source, size_t length, size_t& consumed)
 {
-    if (outSize == 0)
-        return 0;
+    unsigned char const lead = source[0];
+    consumed = 1;
+    if (lead < 0x80)
+        return lead;
+
+    // The range of the second byte excludes overlong forms, surrogates and
+    // code points beyond U+10FFFF.
+    size_t sequenceLength;
+    uint32_t c;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        sequenceLength = 2;
+        c = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        sequenceLength = 3;
+        c = lead & 0x0F;
+        if (lead == 0xE0)
+            low = 0xA0;
+        else if (lead == 0xED)
+            high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        sequenceLength = 4;
+        c = lead & 0x07;
+        if (lead == 0xF0)
+            low = 0x90;
+        else if (lead == 0xF4)
+            high = 0x8F;
+    } else {
+        return ReplacementChar;
+    }
 
-    int const length =
-        WideCharToMultiByte(CP_UTF8, 0, source, static_cast<int>(sourceLength), out,
-                            static_cast<int>(outSize), nullptr, nullptr);
-    if (length <= 0)
-        return 0;
+    for (size_t i = 1; i < sequenceLength; ++i) {
+        if (i == length || source[i] < low || source[i] > high)
+            return ReplacementChar;
+        c = (c << 6) | (source[i] & 0x3F);
+        consumed = i + 1;
+        low = 0x80;
+        high = 0xBF;
+    }
 
-    return static_cast<size_t>(length);
+    return c;
 }
 
-template<typename Converter,
-         typename OutputCharTraits = std::char_traits<typename Converter::OutputChar>,
-         typename OutputStringAllocator = std::allocator<typename Converter::OutputChar>>
-bool Convert(typename Converter::InputChar const* source, size_t sourceLength,
-             std::basic_string<typename Converter::OutputChar, OutputCharTraits,
-                               OutputStringAllocator>& buffer)
-{
-    if (sourceLength == 0)
-        return true;
+} // namespace
 
-    size_t outLength;
-    if (!Converter::EstimateLength(source, sourceLength, outLength))
-        return false;
+void AppendU16To8(std::wstring_view source, std::string& output)
+{
+    // A UTF-16 code unit needs at most 3 bytes, a surrogate pair 4 bytes.
+    size_t const maxBytesPerUnit = IsUtf16 ? 3 : 4;
+    size_t const originalSize = output.size();
+    output.resize(originalSize + source.size() * maxBytesPerUnit);
+
+    char* const begin = &output[0] + originalSize;
+    char* out = begin;
+    size_t i = 0;
+    while (i < source.size()) {
+        size_t const asciiLength = CopyAscii(source.data() + i, source.size() - i, out);
+        i += asciiLength;
+        out += asciiLength;
+        if (i == source.size())
+            break;
+
+        uint32_t c = static_cast<uint32_t>(source[i++]);
+        if (IsHighSurrogate(c) && i < source.size() &&
+            IsLowSurrogate(static_cast<uint32_t>(source[i]))) {
+            c = 0x10000 + ((c - 0xD800) << 10) +
+                (static_cast<uint32_t>(source[i++]) - 0xDC00);
+        } else if (IsHighSurrogate(c) || IsLowSurrogate(c) || c > 0x10FFFF) {
+            c = ReplacementChar;
+        }
+
+        out = EncodeUtf8(c, out);
+    }
 
-    buffer.resize(outLength);
+    output.resize(originalSize + static_cast<size_t>(out - begin));
+}
 
-    size_t const convertedLength =
-        Converter::Convert(&buffer[0], buffer.length() + 1, source, sourceLength);
-    if (convertedLength == 0) {
-        buffer.clear();
-        return false;
+void AppendU8To16(std::string_view source, std::wstring& output)
+{
+    // Every byte yields at most one UTF-16 code unit.
+    size_t const originalSize = output.size();
+    output.resize(originalSize + source.size());
+
+    auto const input = reinterpret_cast<unsigned char const*>(source.data());
+    wchar_t* const begin = &output[0] + originalSize;
+    wchar_t* out = begin;
+    size_t i = 0;
+    while (i < source.size()) {
+        size_t const asciiLength = CopyAscii(source.data() + i, source.size() - i, out);
+        i += asciiLength;
+        out += asciiLength;
+        if (i == source.size())
+            break;
+
+        size_t consumed;
+        uint32_t const c = DecodeUtf8(input + i, source.size() - i, consumed);
+        i += consumed;
+        out = EncodeUtf16(c, out);
     }
 
-    buffer.resize(convertedLength);
-    return true;
+    output.resize(originalSize + static_cast<size_t>(out - begin));
 }
 
-} // namespace
-
 bool U8To16(std::string_view source, std::wstring& output)
 {
-    return Convert<U8To16Conversion>(source.data(), source.length(), output);
+    output.clear();
+    AppendU8To16(source, output);
+    return true;
 }
 
 std::wstring U8To16(std::string_view source)
 {
     std::wstring buffer;
-    (void)Convert<U8To16Conversion>(source.data(), source.length(), buffer);
+    AppendU8To16(source, buffer);
     return buffer;
 }
 
 bool U16To8(std::wstring_view source, std::string& output)
 {
-    return Convert<U16To8Conversion>(source.data(), source.length(), output);
+    output.clear();
+    AppendU16To8(source, output);
+    return true;
 }
 
 std::string U16To8(std::wstring_view source)
 {
     std::string buffer;
-    (void)Convert<U16To8Conversion>(source.data(), source.length(), buffer);
+    AppendU16To8(source, buffer);
     return buffer;
 }
 
@@ -1,7 +1,13 @@
 #include "etk/TdhMessageFormatter.h"
 
 #include "etk/ADT/Span.h"
+#include "etk/CompiledSchema.h"
+#include "etk/PropertyFormatter.h"
+#include "etk/ValueMap.h"
 #include "etk/Support/ErrorHandling.h"
+#include "etk/Support/StringConversions.h"
+
+#include <cstring>
 
 #include <evntcons.h>
 #include <in6addr.h>
@@ -14,24 +20,6 @@ namespace etk
 namespace
 {
 
-template<typename T, typename U>
-ETK_ALWAYS_INLINE T GetAt(U* ptr, size_t offset)
-{
-    return reinterpret_cast<T>(reinterpret_cast<uint8_t*>(ptr) + offset);
-}
-
-// The mapped string values defined in a manifest will contain a trailing space
-// in the EVENT_MAP_ENTRY structure. Replace the trailing space with a null-
-// terminating character, so that the bit mapped strings are correctly formatted.
-void RemoveTrailingSpace(EVENT_MAP_INFO* mapInfo)
-{
-    for (ULONG i = 0; i < mapInfo->EntryCount; ++i) {
-        EVENT_MAP_ENTRY const& entry = mapInfo->MapEntryArray[i];
-        wchar_t* str = GetAt<wchar_t*>(mapInfo, entry.OutputOffset);
-        str[wcslen(str) - 1] = L'\0';
-    }
-}
-
 template<typename T>
 ULONG GetProperty(EVENT_RECORD const* record, PROPERTY_DATA_DESCRIPTOR& pdd, T& value)
 {
@@ -109,8 +97,11 @@ ULONG GetPropertyLength(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
 // the declaration or using the MAX qualifier. For manifest-based events, the
 // property can specify the size of the array using the count attribute. The
 // count attribute can specify the size directly or specify the name of another
-// property in the event data that contains the size.
-ULONG GetArraySize(EventInfo info, EVENT_PROPERTY_INFO const& propInfo, USHORT* arraySize)
+// property in the event data that contains the size. Variable-size arrays of
+// TraceLogging events refer to themselves as count property, the UINT16 count
+// is stored in front of the elements.
+ULONG GetArraySize(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
+                   cspan<std::byte>& userData, USHORT* arraySize)
 {
     if ((propInfo.Flags & PropertyParamCount) == 0) {
         *arraySize = propInfo.count;
@@ -119,58 +110,87 @@ ULONG GetArraySize(EventInfo info, EVENT_PROPERTY_INFO const& propInfo, USHORT*
 
     EVENT_PROPERTY_INFO const& paramInfo =
         info->EventPropertyInfoArray[propInfo.countPropertyIndex];
+    if (&paramInfo == &propInfo) {
+        if (userData.size() < sizeof(USHORT))
+            return ERROR_EVT_INVALID_EVENT_DATA;
+        std::memcpy(arraySize, userData.data(), sizeof(USHORT));
+        userData.remove_prefix(sizeof(USHORT));
+        return ERROR_SUCCESS;
+    }
+
     return GetProperty(info, paramInfo, *arraySize);
 }
 
 // Both MOF-based events and manifest-based events can specify name/value maps.
 // The map values can be integer values or bit values. If the property specifies
-// a value map, get the map.
-ULONG GetEventMapInfo(EVENT_RECORD const* event, wchar_t const* mapName,
-                      DWORD decodingSource, EVENT_MAP_INFO*& mapInfo,
-                      std::vector<BYTE>& mapBuffer)
+// a value map, get the map. Maps are retrieved from TDH once per provider and
+// map name, valueMap is null if TDH does not know the map.
+ULONG GetValueMap(EventInfo info, EVENT_PROPERTY_INFO const& propertyInfo,
+                  ValueMapCache& valueMaps, ValueMap const*& valueMap)
 {
-    mapInfo = new (mapBuffer.data()) EVENT_MAP_INFO;
+    wchar_t const* mapName;
+    if (!info.TryGetAt(propertyInfo.nonStructType.MapNameOffset, mapName))
+        return ERROR_EVT_INVALID_EVENT_DATA;
+
+    size_t const maxLength =
+        (info.InfoSize() - propertyInfo.nonStructType.MapNameOffset) / sizeof(wchar_t);
+    std::wstring_view const name(mapName, wcsnlen(mapName, maxLength));
+
+    valueMap = valueMaps.Find(info->ProviderGuid, name);
+    if (valueMap)
+        return ERROR_SUCCESS;
 
     // Retrieve the required buffer size for the map info.
-    DWORD bufferSize = static_cast<DWORD>(mapBuffer.size());
-    ULONG ec = TdhGetEventMapInformation(const_cast<EVENT_RECORD*>(event),
-                                         const_cast<wchar_t*>(mapName),
-                                         bufferSize ? mapInfo : nullptr, &bufferSize);
+    std::vector<BYTE> mapBuffer;
+    DWORD bufferSize = 0;
+    ULONG ec = TdhGetEventMapInformation(const_cast<EVENT_RECORD*>(info.Record()),
+                                         const_cast<wchar_t*>(mapName), nullptr,
+                                         &bufferSize);
 
     if (ec == ERROR_INSUFFICIENT_BUFFER) {
         mapBuffer.resize(bufferSize);
-        mapInfo = new (mapBuffer.data()) EVENT_MAP_INFO;
-        ec = TdhGetEventMapInformation(const_cast<EVENT_RECORD*>(event),
-                                       const_cast<wchar_t*>(mapName), mapInfo,
-                                       &bufferSize);
+        ec = TdhGetEventMapInformation(
+            const_cast<EVENT_RECORD*>(info.Record()), const_cast<wchar_t*>(mapName),
+            reinterpret_cast<EVENT_MAP_INFO*>(mapBuffer.data()), &bufferSize);
     }
 
-    if (ec == ERROR_SUCCESS) {
-        if (decodingSource == DecodingSourceXMLFile)
-            RemoveTrailingSpace(mapInfo);
-    } else if (ec == ERROR_NOT_FOUND) {
-        ec = ERROR_SUCCESS; // This case is okay.
-    }
+    // Unknown maps are not cached, loading manifests may provide them later.
+    if (ec == ERROR_NOT_FOUND)
+        return ERROR_SUCCESS; // This case is okay.
+    if (ec != ERROR_SUCCESS)
+        return ec;
 
-    return ec;
+    // The mapped string values defined in a manifest contain a trailing space
+    // which is removed, so that bit mapped strings are correctly formatted.
+    bool const removeTrailingSpace = info->DecodingSource == DecodingSourceXMLFile;
+    valueMap = valueMaps.Add(
+        info->ProviderGuid, name,
+        ValueMap(reinterpret_cast<EVENT_MAP_INFO const*>(mapBuffer.data()),
+                 mapBuffer.size(), removeTrailingSpace));
+    return ERROR_SUCCESS;
 }
 
-ULONG GetEventMapInfo(EventInfo info, EVENT_PROPERTY_INFO const& propertyInfo,
-                      EVENT_MAP_INFO*& mapInfo, std::vector<BYTE>& mapBuffer)
+// Reads the integer a value map is applied to.
+bool ReadMapInput(USHORT inType, cspan<std::byte> userData, uint32_t& value,
+                  size_t& size)
 {
-    if (propertyInfo.nonStructType.MapNameOffset == 0)
-        return ERROR_SUCCESS;
-
-    wchar_t const* mapName;
-    if (!info.TryGetAt(propertyInfo.nonStructType.MapNameOffset, mapName))
-        return ERROR_EVT_INVALID_EVENT_DATA;
+    switch (inType) {
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_UINT8: size = sizeof(uint8_t); break;
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_UINT16: size = sizeof(uint16_t); break;
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_HEXINT32: size = sizeof(uint32_t); break;
+    default: return false;
+    }
 
-    ULONG ec =
-        GetEventMapInfo(info.Record(), mapName, info->DecodingSource, mapInfo, mapBuffer);
-    if (ec != ERROR_SUCCESS)
-        return ec;
+    if (userData.size() < size)
+        return false;
 
-    return ERROR_SUCCESS;
+    value = 0;
+    std::memcpy(&value, userData.data(), size);
+    return true;
 }
 
 ULONG FormatProperty(TRACE_EVENT_INFO const& tei, EVENT_MAP_INFO const* emi,
@@ -186,9 +206,71 @@ ULONG FormatProperty(TRACE_EVENT_INFO const& tei, EVENT_MAP_INFO const* emi,
         buffer, userDataConsumed);
 }
 
+// Formats a single element of a property that is not a structure.
+ULONG FormatValue(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
+                  USHORT propertyLength, size_t pointerSize,
+                  cspan<std::byte>& userData, std::wstring& sink,
+                  std::vector<wchar_t>& buffer, ValueMapCache& valueMaps)
+{
+    ULONG ec;
+
+    // Get the name/value mapping if the property specifies a value map.
+    ValueMap const* valueMap = nullptr;
+    if (propInfo.nonStructType.MapNameOffset != 0) {
+        ec = GetValueMap(info, propInfo, valueMaps, valueMap);
+        if (ec != ERROR_SUCCESS)
+            return ec;
+    }
+
+    // Mapped values are looked up directly, others are formatted natively.
+    // TDH is only used for the remaining values and types.
+    if (valueMap) {
+        uint32_t value;
+        size_t size;
+        if (ReadMapInput(propInfo.nonStructType.InType, userData, value, size) &&
+            valueMap->Format(value, sink)) {
+            userData.remove_prefix(size);
+            return ERROR_SUCCESS;
+        }
+    } else {
+        size_t consumed = 0;
+        ec = FormatPropertyValue(propInfo.nonStructType.InType,
+                                 propInfo.nonStructType.OutType, pointerSize,
+                                 propertyLength, userData, sink, consumed);
+        if (ec == ERROR_SUCCESS) {
+            userData.remove_prefix(consumed);
+            return ec;
+        }
+        if (ec != ERROR_NOT_SUPPORTED)
+            return ec;
+    }
+
+    EVENT_MAP_INFO const* const mapInfo = valueMap ? valueMap->Info() : nullptr;
+    DWORD bufferSize = 0;
+    USHORT userDataConsumed = 0;
+
+    bufferSize = static_cast<DWORD>(buffer.size() * sizeof(wchar_t));
+    ec = FormatProperty(*info.Info(), mapInfo, pointerSize, propInfo, propertyLength,
+                        userData, &bufferSize, buffer.data(), &userDataConsumed);
+
+    if (ec == ERROR_INSUFFICIENT_BUFFER) {
+        buffer.resize(bufferSize / sizeof(wchar_t));
+        ec = FormatProperty(*info.Info(), mapInfo, pointerSize, propInfo, propertyLength,
+                            userData, &bufferSize, buffer.data(), &userDataConsumed);
+    }
+
+    if (ec != ERROR_SUCCESS)
+        return ec;
+
+    buffer.resize(bufferSize / sizeof(wchar_t));
+    userData.remove_prefix(userDataConsumed);
+    sink.append(buffer.data(), buffer.size() - 1); // buffer is null-terminated.
+    return ec;
+}
+
 ULONG FormatProperty(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
                      size_t pointerSize, cspan<std::byte>& userData, std::wstring& sink,
-                     std::vector<wchar_t>& buffer, std::vector<BYTE>& mapBuffer)
+                     std::vector<wchar_t>& buffer, ValueMapCache& valueMaps)
 {
     ULONG ec;
 
@@ -199,7 +281,7 @@ ULONG FormatProperty(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
 
     // Get the size of the array if the property is an array.
     USHORT arraySize = 0;
-    ec = GetArraySize(info, propInfo, &arraySize);
+    ec = GetArraySize(info, propInfo, userData, &arraySize);
     if (ec != ERROR_SUCCESS)
         return ec;
 
@@ -212,7 +294,7 @@ ULONG FormatProperty(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
             for (USHORT j = propInfo.structType.StructStartIndex; j < lastMember; ++j) {
                 EVENT_PROPERTY_INFO const& pi = info->EventPropertyInfoArray[j];
                 ec = FormatProperty(info, pi, pointerSize, userData, sink, buffer,
-                                    mapBuffer);
+                                    valueMaps);
                 if (ec != ERROR_SUCCESS)
                     return ec;
             }
@@ -220,37 +302,49 @@ ULONG FormatProperty(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
             continue;
         }
 
-        // Get the name/value mapping if the property specifies a value map.
-        EVENT_MAP_INFO* mapInfo = nullptr;
-        if (propInfo.nonStructType.MapNameOffset != 0) {
-            ec = GetEventMapInfo(info, propInfo, mapInfo, mapBuffer);
-            if (ec != ERROR_SUCCESS)
-                return ec;
-        }
+        ec = FormatValue(info, propInfo, propertyLength, pointerSize, userData, sink,
+                         buffer, valueMaps);
+        if (ec != ERROR_SUCCESS)
+            return ec;
+    }
 
-        DWORD bufferSize = 0;
-        USHORT userDataConsumed = 0;
+    return ec;
+}
 
-        bufferSize = static_cast<DWORD>(buffer.size() * sizeof(wchar_t));
-        ec = FormatProperty(*info.Info(), mapInfo, pointerSize, propInfo, propertyLength,
-                            userData, &bufferSize, buffer.data(), &userDataConsumed);
+// Formats a top-level property located by a decode plan. Lengths and counts
+// come from the plan, so TDH is not asked for the values of other properties.
+// Members of structures never refer to other properties in a plan.
+ULONG FormatProperty(EventInfo info, EVENT_PROPERTY_INFO const& propInfo,
+                     DecodePlan::Location const& location, size_t pointerSize,
+                     std::wstring& sink, std::vector<wchar_t>& buffer,
+                     ValueMapCache& valueMaps)
+{
+    cspan<std::byte> userData = info.UserData().subspan(location.Offset, location.Size);
+
+    for (USHORT k = 0; k < location.Count; ++k) {
+        ULONG ec;
+        if ((propInfo.Flags & PropertyStruct) == PropertyStruct) {
+            DWORD lastMember = propInfo.structType.StructStartIndex +
+                               propInfo.structType.NumOfStructMembers;
+
+            for (USHORT j = propInfo.structType.StructStartIndex; j < lastMember; ++j) {
+                EVENT_PROPERTY_INFO const& pi = info->EventPropertyInfoArray[j];
+                ec = FormatProperty(info, pi, pointerSize, userData, sink, buffer,
+                                    valueMaps);
+                if (ec != ERROR_SUCCESS)
+                    return ec;
+            }
 
-        if (ec == ERROR_INSUFFICIENT_BUFFER) {
-            buffer.resize(bufferSize / sizeof(wchar_t));
-            ec = FormatProperty(*info.Info(), mapInfo, pointerSize, propInfo,
-                                propertyLength, userData, &bufferSize, buffer.data(),
-                                &userDataConsumed);
+            continue;
         }
 
+        ec = FormatValue(info, propInfo, location.Length, pointerSize, userData, sink,
+                         buffer, valueMaps);
         if (ec != ERROR_SUCCESS)
             return ec;
-
-        buffer.resize(bufferSize / sizeof(wchar_t));
-        userData.remove_prefix(userDataConsumed);
-        sink.append(buffer.data(), buffer.size() - 1); // buffer is null-terminated.
     }
 
-    return ec;
+    return ERROR_SUCCESS;
 }
 
 } // namespace
@@ -263,121 +357,173 @@ bool TdhMessageFormatter::FormatEventMessage(EventInfo const info,
     if (!info)
         return false;
 
-    cspan<std::byte> userData = info.UserData();
     if (info.IsStringOnly()) {
+        cspan<std::byte> const userData = info.UserData();
         (void)StringCchCopyNW(buffer, bufferSize,
                               reinterpret_cast<wchar_t const*>(userData.data()),
                               userData.size() / sizeof(wchar_t));
         return true;
     }
 
-    formattedProperties.clear();
-    formattedPropertiesOffsets.clear();
-    formattedPropertiesPointers.clear();
+    if (!info.EventMessage()) {
+        formattedProperties.clear();
+        if (!FormatMofEvent(info, pointerSize, formattedProperties))
+            return false;
 
-    wchar_t const* const message = info.EventMessage();
-    if (!message)
-        return FormatMofEvent(info, pointerSize, buffer, bufferSize);
+        (void)StringCchCopyNW(buffer, bufferSize, formattedProperties.data(),
+                              formattedProperties.length());
+        return true;
+    }
 
-    for (ULONG i = 0; i < info->TopLevelPropertyCount; ++i) {
-        auto const& pi = info->EventPropertyInfoArray[i];
+    MessageTemplate const* const messageTemplate =
+        FormatMessageProperties(info, pointerSize);
+    if (!messageTemplate)
+        return false;
 
-        size_t begin = formattedProperties.size();
-        DWORD const ec = FormatProperty(info, pi, pointerSize, userData,
-                                        formattedProperties, propertyBuffer, mapBuffer);
-        if (ec != ERROR_SUCCESS)
-            return false;
+    (void)messageTemplate->Format(formattedPropertyViews, buffer, bufferSize);
+    return true;
+}
 
-        formattedProperties.push_back(0);
-        formattedPropertiesOffsets.push_back(begin);
+bool TdhMessageFormatter::FormatEventMessage(EventInfo const info,
+                                             size_t const pointerSize,
+                                             std::wstring& output)
+{
+    if (!info)
+        return false;
+
+    if (info.IsStringOnly()) {
+        cspan<std::byte> const userData = info.UserData();
+        auto const string = reinterpret_cast<wchar_t const*>(userData.data());
+        output.append(string, wcsnlen(string, userData.size() / sizeof(wchar_t)));
+        return true;
     }
 
-    for (auto const& begin : formattedPropertiesOffsets)
-        formattedPropertiesPointers.push_back(
-            reinterpret_cast<DWORD_PTR>(&formattedProperties[begin]));
-
-    auto const formatFlags = FORMAT_MESSAGE_FROM_STRING | FORMAT_MESSAGE_ARGUMENT_ARRAY;
-    DWORD const numWritten =
-        FormatMessageW(formatFlags, message, 0, 0, buffer, bufferSize,
-                       reinterpret_cast<va_list*>(formattedPropertiesPointers.data()));
-
-    return numWritten != 0;
-
-#if 0
-    wchar_t const* ptr = info.EventMessage();
-    while (ptr) {
-        auto begin = ptr;
-        while (*ptr && *ptr != L'%')
-            ++ptr;
-        if (ptr != begin)
-            sink.append(begin, ptr - begin);
-
-        if (!*ptr)
-            break;
-
-        ++ptr; // Skip %
-        if (*ptr == L'n') {
-            ++ptr;
-            sink += L'\n';
-            continue;
+    // Properties of MOF events are formatted directly into the output.
+    if (!info.EventMessage()) {
+        size_t const originalSize = output.size();
+        if (!FormatMofEvent(info, pointerSize, output)) {
+            output.resize(originalSize);
+            return false;
         }
+        return true;
+    }
 
-        begin = ptr;
-        int index = 0;
-        while (*ptr && *ptr >= L'0' && *ptr <= L'9') {
-            if (index >= 255)
-                break; // FIXME
-            index = (index * 10) + (*ptr - L'0');
-            ++ptr;
-        }
+    MessageTemplate const* const messageTemplate =
+        FormatMessageProperties(info, pointerSize);
+    if (!messageTemplate)
+        return false;
 
-        if (ptr == begin) {
-            // Invalid char after %, ignore.
-            ++ptr;
-            sink += L'%';
-            sink += *ptr;
-            continue;
-        }
+    messageTemplate->Format(formattedPropertyViews, output);
+    return true;
+}
 
-        if (index < 1 || static_cast<unsigned>(index) > info->TopLevelPropertyCount) {
-            sink.append(begin, ptr - begin);
-            continue;
-        }
+bool TdhMessageFormatter::FormatEventMessage(EventInfo const info,
+                                             size_t const pointerSize,
+                                             std::string& output)
+{
+    messageText.clear();
+    if (!FormatEventMessage(info, pointerSize, messageText))
+        return false;
+
+    AppendU16To8(messageText, output);
+    return true;
+}
 
-        sink.append(formattedProperties,
-                    formattedPropertiesOffsets[index - 1],
-                    formattedPropertiesOffsets[index] - formattedPropertiesOffsets[index - 1]);
+// Formats the properties referenced by the event message into
+// formattedPropertyViews. Returns the parsed message, or null if a property
+// cannot be formatted.
+MessageTemplate const*
+TdhMessageFormatter::FormatMessageProperties(EventInfo const& info,
+                                             size_t const pointerSize)
+{
+    formattedProperties.clear();
+    formattedPropertiesOffsets.clear();
+    formattedPropertyViews.clear();
+
+    // Schemas from the cache come with their parsed message. Others are
+    // parsed on the fly.
+    CompiledSchema const* const compiled = info.Compiled();
+    MessageTemplate const* messageTemplate = compiled ? &compiled->Message : nullptr;
+    if (!messageTemplate) {
+        wchar_t const* const message = info.EventMessage();
+        size_t const maxLength =
+            (info.InfoSize() - info->EventMessageOffset) / sizeof(wchar_t);
+        scratchTemplate.Assign(std::wstring_view(message, wcsnlen(message, maxLength)),
+                               info->TopLevelPropertyCount);
+        messageTemplate = &scratchTemplate;
     }
 
-    return true;
-#endif
+    // Properties are laid out in sequence, so only those up to the last one
+    // referenced by the message are formatted.
+    cspan<std::byte> userData = info.UserData();
+    size_t const propertyCount = messageTemplate->GetReferencedPropertyCount();
+    bool const located = LocateProperties(info, pointerSize, propertyCount);
+    for (ULONG i = 0; i < propertyCount; ++i) {
+        auto const& pi = info->EventPropertyInfoArray[i];
+
+        formattedPropertiesOffsets.push_back(formattedProperties.size());
+        DWORD const ec =
+            located ? FormatProperty(info, pi, locations[i], pointerSize,
+                                     formattedProperties, propertyBuffer, valueMaps)
+                    : FormatProperty(info, pi, pointerSize, userData,
+                                     formattedProperties, propertyBuffer, valueMaps);
+        if (ec != ERROR_SUCCESS)
+            return nullptr;
+    }
+    formattedPropertiesOffsets.push_back(formattedProperties.size());
+
+    std::wstring_view const properties = formattedProperties;
+    for (size_t i = 0; i < propertyCount; ++i) {
+        size_t const begin = formattedPropertiesOffsets[i];
+        formattedPropertyViews.push_back(
+            properties.substr(begin, formattedPropertiesOffsets[i + 1] - begin));
+    }
+
+    return messageTemplate;
 }
 
+// Appends the top-level properties of an event without message as
+// "Name: Value" pairs separated by semicolons.
 bool TdhMessageFormatter::FormatMofEvent(EventInfo const& info, size_t const pointerSize,
-                                         wchar_t* const buffer, size_t const bufferSize)
+                                         std::wstring& sink)
 {
     cspan<std::byte> userData = info.UserData();
 
+    bool const located = LocateProperties(info, pointerSize, info->TopLevelPropertyCount);
     for (ULONG i = 0; i < info->TopLevelPropertyCount; ++i) {
         auto const& pi = info->EventPropertyInfoArray[i];
 
         if (i > 0)
-            formattedProperties.append(L"; ");
+            sink.append(L"; ");
 
         if (wchar_t const* propertyName = info.GetStringAt(pi.NameOffset)) {
-            formattedProperties.append(propertyName);
-            formattedProperties.append(L": ");
+            sink.append(propertyName);
+            sink.append(L": ");
         }
 
-        DWORD const ec = FormatProperty(info, pi, pointerSize, userData,
-                                        formattedProperties, propertyBuffer, mapBuffer);
+        DWORD const ec =
+            located ? FormatProperty(info, pi, locations[i], pointerSize, sink,
+                                     propertyBuffer, valueMaps)
+                    : FormatProperty(info, pi, pointerSize, userData, sink,
+                                     propertyBuffer, valueMaps);
         if (ec != ERROR_SUCCESS)
             return false;
     }
 
-    (void)StringCchCopyNW(buffer, bufferSize, formattedProperties.data(),
-                          formattedProperties.length());
     return true;
 }
 
+// Locates the properties with the decode plan compiled for the schema. Returns
+// false if there is none, or it does not cover all requested properties.
+bool TdhMessageFormatter::LocateProperties(EventInfo const& info,
+                                           size_t const pointerSize, size_t const count)
+{
+    CompiledSchema const* const compiled = info.Compiled();
+    if (!compiled || compiled->Plan.GetPlannedPropertyCount() < count)
+        return false;
+
+    locations.resize(count);
+    return compiled->Plan.Locate(info.UserData(), pointerSize, locations);
+}
+
 } // namespace etk
@@ -0,0 +1,186 @@
+#include "etk/TextSearchIndex.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace etk
+{
+
+namespace
+{
+
+ETK_ALWAYS_INLINE uint64_t FoldChar(wchar_t c)
+{
+    auto const unit = static_cast<uint16_t>(c);
+    return (unit >= L'a' && unit <= L'z') ? unit - (L'a' - L'A') : unit;
+}
+
+ETK_ALWAYS_INLINE bool IsTokenSeparator(wchar_t c)
+{
+    return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n';
+}
+
+class PostingListReader
+{
+public:
+    PostingListReader(uint8_t const* data, uint8_t const* end)
+        : data(data)
+        , end(end)
+    {}
+
+    bool Next(uint32_t& document)
+    {
+        if (data == end)
+            return false;
+
+        uint32_t delta = 0;
+        for (unsigned shift = 0; data != end; shift += 7) {
+            uint8_t const byte = *data++;
+            delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                break;
+        }
+
+        current += delta;
+        document = current;
+        return true;
+    }
+
+private:
+    uint8_t const* data;
+    uint8_t const* end;
+    uint32_t current = 0;
+};
+
+} // namespace
+
+void TextSearchIndex::PostingList::Append(uint32_t document)
+{
+    // Documents are added in ascending order, so a repeated trigram within the
+    // same document is always the last entry.
+    if (Count != 0 && LastDocument == document)
+        return;
+
+    uint32_t delta = document - LastDocument;
+    while (delta >= 0x80) {
+        Data.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    Data.push_back(static_cast<uint8_t>(delta));
+
+    LastDocument = document;
+    ++Count;
+}
+
+uint32_t TextSearchIndex::Add(std::wstring_view text)
+{
+    uint32_t const document = documentCount++;
+
+    CollectTrigrams(text, scratch);
+    for (Trigram const trigram : scratch)
+        postings[trigram].Append(document);
+
+    return document;
+}
+
+void TextSearchIndex::Clear()
+{
+    postings.clear();
+    documentCount = 0;
+}
+
+size_t TextSearchIndex::GetMemoryUsage() const
+{
+    size_t size = postings.capacity() * sizeof(std::pair<Trigram, PostingList>);
+    for (auto const& [trigram, list] : postings)
+        size += list.Data.capacity();
+    return size;
+}
+
+std::vector<uint32_t> TextSearchIndex::FindCandidates(std::wstring_view query,
+                                                      TextSearchMode mode) const
+{
+    std::vector<Trigram> trigrams;
+    if (mode == TextSearchMode::Substring) {
+        CollectTrigrams(query, trigrams);
+    } else {
+        std::vector<Trigram> tokenTrigrams;
+        size_t begin = 0;
+        while (begin < query.size()) {
+            size_t end = begin;
+            while (end < query.size() && !IsTokenSeparator(query[end]))
+                ++end;
+
+            CollectTrigrams(query.substr(begin, end - begin), tokenTrigrams);
+            trigrams.insert(trigrams.end(), tokenTrigrams.begin(), tokenTrigrams.end());
+            begin = end + 1;
+        }
+    }
+
+    std::vector<uint32_t> candidates;
+    if (trigrams.empty()) {
+        candidates.resize(documentCount);
+        std::iota(candidates.begin(), candidates.end(), 0);
+        return candidates;
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    std::vector<PostingList const*> lists;
+    lists.reserve(trigrams.size());
+    for (Trigram const trigram : trigrams) {
+        auto const it = postings.find(trigram);
+        if (it == postings.end())
+            return candidates;
+        lists.push_back(&it->second);
+    }
+
+    // Intersect starting with the shortest list so that the candidate set is
+    // as small as possible from the start.
+    std::sort(lists.begin(), lists.end(), [](PostingList const* x, PostingList const* y) {
+        return x->Count < y->Count;
+    });
+
+    candidates.reserve(lists.front()->Count);
+    PostingListReader reader(lists.front()->Data.data(),
+                             lists.front()->Data.data() + lists.front()->Data.size());
+    for (uint32_t document; reader.Next(document);)
+        candidates.push_back(document);
+
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+        PostingListReader listReader(lists[i]->Data.data(),
+                                     lists[i]->Data.data() + lists[i]->Data.size());
+
+        size_t kept = 0;
+        uint32_t document;
+        bool hasDocument = listReader.Next(document);
+        for (size_t j = 0; j < candidates.size() && hasDocument; ++j) {
+            while (hasDocument && document < candidates[j])
+                hasDocument = listReader.Next(document);
+            if (hasDocument && document == candidates[j])
+                candidates[kept++] = candidates[j];
+        }
+
+        candidates.resize(kept);
+    }
+
+    return candidates;
+}
+
+void TextSearchIndex::CollectTrigrams(std::wstring_view text,
+                                      std::vector<Trigram>& trigrams)
+{
+    trigrams.clear();
+    if (text.size() < 3)
+        return;
+
+    trigrams.reserve(text.size() - 2);
+    Trigram trigram = (FoldChar(text[0]) << 16) | FoldChar(text[1]);
+    for (size_t i = 2; i < text.size(); ++i) {
+        trigram = ((trigram << 16) | FoldChar(text[i])) & 0xFFFFFFFFFFFF;
+        trigrams.push_back(trigram);
+    }
+}
+
+} // namespace etk
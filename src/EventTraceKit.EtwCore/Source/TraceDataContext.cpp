@@ -1,13 +1,184 @@
 #include "TraceDataContext.h"
 
+#include "etk/ADT/Handle.h"
 #include "etk/Support/BinaryFind.h"
 #include "etk/Support/ErrorHandling.h"
+#include "etk/Support/OSVersionInfo.h"
+
+#include <cstring>
+#include <cwctype>
+#include <iterator>
 
 #include <tdh.h>
 
 namespace etk
 {
 
+namespace
+{
+
+struct ModuleHandleTraits : NullIsInvalidHandleTraits<HMODULE>
+{
+    static void Close(HandleType h) noexcept { FreeLibrary(h); }
+};
+
+using ModuleHandle = Handle<ModuleHandleTraits>;
+
+struct FileMappingHandleTraits : NullIsInvalidHandleTraits<>
+{};
+
+using FileMappingHandle = Handle<FileMappingHandleTraits>;
+
+// Bounds the size of the schema cache file. Schemas resolved in the current
+// session are kept in favor of older ones.
+size_t const MaxPersistedSchemas = 64 * 1024;
+
+cspan<std::byte> AsBytes(void const* ptr, size_t size)
+{
+    return {static_cast<std::byte const*>(ptr), size};
+}
+
+template<typename T>
+cspan<std::byte> AsBytes(T const& value)
+{
+    return AsBytes(&value, sizeof(value));
+}
+
+HRESULT MapFile(std::wstring const& path, void const*& view, size_t& size)
+{
+    FileHandle file(CreateFileW(path.c_str(), GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!file)
+        return GetLastErrorAsHResult();
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+        return GetLastErrorAsHResult();
+    if (fileSize.QuadPart == 0 || static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX)
+        return E_FAIL;
+
+    FileMappingHandle mapping(
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping)
+        return GetLastErrorAsHResult();
+
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+        return GetLastErrorAsHResult();
+
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return S_OK;
+}
+
+// Hashes the manifest contents so that persisted schemas are not used after
+// the manifest changed. Falls back to the path if the file cannot be read.
+uint64_t HashManifest(std::wstring const& path)
+{
+    void const* view = nullptr;
+    size_t size = 0;
+    if (FAILED(MapFile(path, view, size)))
+        return ComputeStableHash(AsBytes(path.data(), path.size() * sizeof(wchar_t)));
+
+    uint64_t const hash = ComputeStableHash(AsBytes(view, size));
+    UnmapViewOfFile(view);
+    return hash;
+}
+
+bool IsXmlManifest(std::wstring const& path)
+{
+    size_t const dot = path.find_last_of(L".\\/");
+    if (dot == std::wstring::npos || path[dot] != L'.')
+        return false;
+
+    std::wstring extension = path.substr(dot + 1);
+    for (wchar_t& c : extension)
+        c = static_cast<wchar_t>(std::towlower(c));
+    return extension == L"man" || extension == L"xml";
+}
+
+cspan<std::byte> GetResource(HMODULE module, wchar_t const* type)
+{
+    HRSRC const resource = FindResourceW(module, MAKEINTRESOURCEW(1), type);
+    if (!resource)
+        return {};
+
+    HGLOBAL const data = LoadResource(module, resource);
+    void const* ptr = data ? LockResource(data) : nullptr;
+    if (!ptr)
+        return {};
+
+    return {static_cast<std::byte const*>(ptr), SizeofResource(module, resource)};
+}
+
+// Identifies the resources registered for a provider with the event log
+// service, which TDH reads the schemas of registered providers from. Includes
+// the size and modification time of each file so that persisted schemas are
+// not used after the provider binary was updated.
+uint64_t HashProviderResources(GUID const& providerId)
+{
+    wchar_t guidString[39];
+    int const capacity = static_cast<int>(std::size(guidString));
+    if (StringFromGUID2(providerId, guidString, capacity) == 0)
+        return 0;
+
+    std::wstring const key =
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\WINEVT\\Publishers\\" +
+        std::wstring(guidString);
+
+    uint64_t hash = ComputeStableHash(AsBytes(providerId));
+    for (wchar_t const* valueName : {L"ResourceFileName", L"MessageFileName"}) {
+        wchar_t value[MAX_PATH];
+        DWORD valueSize = sizeof(value);
+        DWORD const flags = RRF_RT_REG_SZ | RRF_RT_REG_EXPAND_SZ | RRF_NOEXPAND;
+        if (RegGetValueW(HKEY_LOCAL_MACHINE, key.c_str(), valueName, flags, nullptr,
+                         value, &valueSize) != ERROR_SUCCESS)
+            continue;
+
+        wchar_t path[MAX_PATH];
+        DWORD const length =
+            ExpandEnvironmentStringsW(value, path, static_cast<DWORD>(std::size(path)));
+        if (length == 0 || length > std::size(path))
+            continue;
+
+        hash = ComputeStableHash(AsBytes(path, (length - 1) * sizeof(wchar_t)), hash);
+
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (GetFileAttributesExW(path, GetFileExInfoStandard, &attributes)) {
+            hash = ComputeStableHash(AsBytes(attributes.ftLastWriteTime), hash);
+            hash = ComputeStableHash(AsBytes(attributes.nFileSizeLow), hash);
+            hash = ComputeStableHash(AsBytes(attributes.nFileSizeHigh), hash);
+        }
+    }
+
+    return hash;
+}
+
+// Reads the event templates compiled into the WEVT_TEMPLATE resource of a
+// provider binary, avoiding the round trip through the TDH manifest cache.
+std::unique_ptr<EventSchemaTable> LoadBinarySchemas(std::wstring const& path,
+                                                    uint64_t& contentHash)
+{
+    DWORD const flags = LOAD_LIBRARY_AS_DATAFILE | LOAD_LIBRARY_AS_IMAGE_RESOURCE;
+    ModuleHandle module(LoadLibraryExW(path.c_str(), nullptr, flags));
+    if (!module)
+        return nullptr;
+
+    auto const wevtTemplate = GetResource(module, L"WEVT_TEMPLATE");
+    if (wevtTemplate.empty())
+        return nullptr;
+
+    auto const messageTable = GetResource(module, RT_MESSAGETABLE);
+    auto schemas = std::make_unique<EventSchemaTable>();
+    if (!schemas->AddTemplates(wevtTemplate, messageTable))
+        return nullptr;
+
+    contentHash = ComputeStableHash(messageTable, ComputeStableHash(wevtTemplate));
+    return schemas;
+}
+
+} // namespace
+
 static HRESULT LoadManifest(std::wstring const& manifest)
 {
     return HResultFromWin32(TdhLoadManifest(const_cast<wchar_t*>(manifest.c_str())));
@@ -18,13 +189,28 @@ static HRESULT UnloadManifest(std::wstring const& manifest)
     return HResultFromWin32(TdhUnloadManifest(const_cast<wchar_t*>(manifest.c_str())));
 }
 
+// TDH keeps binaries registered this way until the process exits, so there is
+// no matching unload.
+static HRESULT LoadManifestFromBinary(std::wstring const& binary)
+{
+    if (!OSVersion.IsWindows8Point1OrGreater())
+        return HResultFromWin32(ERROR_NOT_SUPPORTED);
+    return HResultFromWin32(
+        TdhLoadManifestFromBinary(const_cast<wchar_t*>(binary.c_str())));
+}
+
 std::mutex TraceDataContext::globalContextLock;
 std::weak_ptr<TraceDataContext> TraceDataContext::globalContext;
+std::wstring TraceDataContext::globalSchemaCachePath;
 
 TraceDataContext::~TraceDataContext() noexcept
 {
-    for (auto const& entry : loadedManifests)
-        (void)TdhUnloadManifest(const_cast<wchar_t*>(entry.ManifestPath.c_str()));
+    (void)SaveSchemaCache();
+
+    for (auto const& entry : loadedManifests) {
+        if (entry.IsTdhManifest)
+            (void)TdhUnloadManifest(const_cast<wchar_t*>(entry.ManifestPath.c_str()));
+    }
 }
 
 HRESULT TraceDataContext::AddRefManifest(std::wstring const& manifestPath) noexcept
@@ -37,9 +223,33 @@ HRESULT TraceDataContext::AddRefManifest(std::wstring const& manifestPath) noexc
         return S_OK;
     }
 
-    HR(LoadManifest(manifestPath));
+    // Provider binaries are registered with TDH even though their schemas are
+    // read natively, since value maps and the TDH fallback paths of the
+    // formatter still look up the provider through TDH. TdhLoadManifest only
+    // accepts XML manifests, and the native schemas are used even if the
+    // registration fails.
+    std::unique_ptr<EventSchemaTable> schemas;
+    uint64_t contentHash = 0;
+    bool isTdhManifest = IsXmlManifest(manifestPath);
+    if (!isTdhManifest) {
+        schemas = LoadBinarySchemas(manifestPath, contentHash);
+        bool const registered = SUCCEEDED(LoadManifestFromBinary(manifestPath));
 
-    loadedManifests.insert(it, {manifestPath, 1});
+        // Anything else is left to TdhLoadManifest to accept or reject.
+        isTdhManifest = !schemas && !registered;
+    }
+
+    if (isTdhManifest)
+        HR(LoadManifest(manifestPath));
+    if (!schemas)
+        contentHash = HashManifest(manifestPath);
+
+    it = std::lower_bound(loadedManifests.begin(), loadedManifests.end(), manifestPath);
+    unsigned const newGeneration = generation.load(std::memory_order_relaxed) + 1;
+    loadedManifests.insert(it, {manifestPath, 1, std::move(schemas), contentHash,
+                                newGeneration, isTdhManifest});
+    UpdateManifestHash();
+    generation.store(newGeneration, std::memory_order_release);
     return S_OK;
 }
 
@@ -51,10 +261,161 @@ HRESULT TraceDataContext::ReleaseManifest(std::wstring const& manifestPath) noex
     if (it == loadedManifests.end() || --it->RefCount > 0)
         return S_OK;
 
+    bool const isTdhManifest = it->IsTdhManifest;
     loadedManifests.erase(it);
+    UpdateManifestHash();
 
-    HR(UnloadManifest(manifestPath));
+    if (isTdhManifest)
+        HR(UnloadManifest(manifestPath));
     return S_OK;
 }
 
+bool TraceDataContext::GetChangedProviders(unsigned sinceGeneration,
+                                           std::vector<GUID>& providerIds)
+{
+    SharedLock lock(mutex);
+
+    providerIds.clear();
+    for (auto const& entry : loadedManifests) {
+        if (entry.Generation <= sinceGeneration)
+            continue;
+        if (!entry.Schemas)
+            return false;
+
+        auto const ids = entry.Schemas->GetProviderIds();
+        providerIds.insert(providerIds.end(), ids.begin(), ids.end());
+    }
+
+    return true;
+}
+
+std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>
+TraceDataContext::FindSchema(EventKey const& key)
+{
+    SharedLock lock(mutex);
+
+    for (auto const& entry : loadedManifests) {
+        if (!entry.Schemas)
+            continue;
+
+        auto const [info, infoSize] = entry.Schemas->Find(key);
+        if (!info)
+            continue;
+
+        auto copy = make_vstruct<TRACE_EVENT_INFO>(infoSize);
+        std::memcpy(copy.get(), info, infoSize);
+        return {std::move(copy), infoSize};
+    }
+
+    uint64_t const schemaHash = GetSchemaHash(key.GetProviderId());
+    auto [info, infoSize] = persistedSchemas.Find(key, schemaHash);
+    if (!info)
+        std::tie(info, infoSize) = resolvedSchemas.Find(key, schemaHash);
+    if (!info)
+        return {nullptr, 0};
+
+    auto copy = make_vstruct<TRACE_EVENT_INFO>(infoSize);
+    std::memcpy(copy.get(), info, infoSize);
+    return {std::move(copy), infoSize};
+}
+
+void TraceDataContext::AddResolvedSchema(EventKey const& key,
+                                         TRACE_EVENT_INFO const* info, size_t infoSize)
+{
+    ExclusiveLock lock(mutex);
+    if (!schemaCachePath.empty())
+        resolvedSchemas.Add(key, GetSchemaHash(key.GetProviderId()), info, infoSize);
+}
+
+HRESULT TraceDataContext::LoadSchemaCache(std::wstring const& path) noexcept
+{
+    ExclusiveLock lock(mutex);
+
+    persistedSchemas.Detach();
+    schemaCacheView.Close();
+    schemaCachePath = path;
+    UpdateManifestHash();
+
+    return MapSchemaCache();
+}
+
+HRESULT TraceDataContext::SaveSchemaCache() noexcept
+{
+    ExclusiveLock lock(mutex);
+    if (schemaCachePath.empty() || resolvedSchemas.IsEmpty())
+        return S_OK;
+
+    resolvedSchemas.Merge(persistedSchemas, MaxPersistedSchemas);
+    std::vector<std::byte> const contents = resolvedSchemas.Finish();
+    resolvedSchemas = SchemaCacheWriter();
+
+    // Write a new file and replace the old one so that a concurrently
+    // starting process never maps a partially written cache.
+    std::wstring const tempPath = schemaCachePath + L".tmp";
+    {
+        FileHandle file(CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
+                                    CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!file)
+            return GetLastErrorAsHResult();
+
+        DWORD written = 0;
+        if (!WriteFile(file, contents.data(), static_cast<DWORD>(contents.size()),
+                       &written, nullptr))
+            return GetLastErrorAsHResult();
+        if (written != contents.size())
+            return E_FAIL;
+    }
+
+    // The old file cannot be replaced while it is mapped.
+    persistedSchemas.Detach();
+    schemaCacheView.Close();
+
+    if (!MoveFileExW(tempPath.c_str(), schemaCachePath.c_str(),
+                     MOVEFILE_REPLACE_EXISTING))
+        return GetLastErrorAsHResult();
+
+    return MapSchemaCache();
+}
+
+HRESULT TraceDataContext::MapSchemaCache()
+{
+    void const* view = nullptr;
+    size_t size = 0;
+    HR(MapFile(schemaCachePath, view, size));
+
+    schemaCacheView.Reset(view);
+    if (!persistedSchemas.Attach(AsBytes(view, size))) {
+        schemaCacheView.Close();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+void TraceDataContext::UpdateManifestHash()
+{
+    DWORD const osBuild = OSVersion.BuildNumber();
+
+    uint64_t hash = ComputeStableHash(AsBytes(osBuild));
+    for (auto const& entry : loadedManifests)
+        hash = ComputeStableHash(AsBytes(entry.ContentHash), hash);
+
+    manifestHash = hash;
+
+    std::lock_guard<std::mutex> lock(resourceHashMutex);
+    providerResourceHashes.clear();
+}
+
+uint64_t TraceDataContext::GetSchemaHash(GUID const& providerId)
+{
+    std::lock_guard<std::mutex> lock(resourceHashMutex);
+
+    auto it = providerResourceHashes.find(providerId);
+    if (it == providerResourceHashes.end())
+        it = providerResourceHashes.emplace(providerId, HashProviderResources(providerId))
+                 .first;
+
+    return ComputeStableHash(AsBytes(it->second), manifestHash);
+}
+
 } // namespace etk
@@ -1,11 +1,22 @@
 #pragma once
+#include "etk/ADT/Handle.h"
 #include "etk/ADT/Span.h"
+#include "etk/ADT/VarStructPtr.h"
+#include "etk/EventKey.h"
+#include "etk/EventSchemaTable.h"
+#include "etk/SchemaCacheFile.h"
 #include "etk/Support/ErrorHandling.h"
+#include "etk/Support/Hashing.h"
 
 #include <algorithm>
+#include <atomic>
 #include <iterator>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -22,6 +33,39 @@ public:
     HRESULT AddRefManifest(std::wstring const& manifestPath) noexcept;
     HRESULT ReleaseManifest(std::wstring const& manifestPath) noexcept;
 
+    //! Returns a counter that is incremented whenever a manifest is loaded,
+    //! so that failed schema lookups can tell whether a retry may succeed.
+    unsigned GetGeneration() const { return generation.load(std::memory_order_acquire); }
+
+    //! Gets the providers whose schemas may have changed because manifests
+    //! were loaded after the given generation. Returns false if this is not
+    //! known, e.g. for manifests registered with TDH, and any provider may
+    //! have changed.
+    bool GetChangedProviders(unsigned sinceGeneration, std::vector<GUID>& providerIds);
+
+    //! Returns a copy of the schema of an event if it is described by one of
+    //! the natively loaded provider binaries, or if it was resolved before
+    //! with the same set of manifests and persisted in the schema cache.
+    std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t> FindSchema(EventKey const& key);
+
+    //! Records a schema resolved by TDH so that it is persisted in the
+    //! schema cache.
+    void AddResolvedSchema(EventKey const& key, TRACE_EVENT_INFO const* info,
+                           size_t infoSize);
+
+    //! Maps the schema cache file, if it exists, and uses it for lookups.
+    //! Newly resolved schemas are written back by SaveSchemaCache, which is
+    //! also called when the context is destroyed.
+    HRESULT LoadSchemaCache(std::wstring const& path) noexcept;
+    HRESULT SaveSchemaCache() noexcept;
+
+    //! Sets the schema cache file used by contexts created by GlobalContext.
+    static void SetGlobalSchemaCachePath(std::wstring path)
+    {
+        std::unique_lock<std::mutex> lock(globalContextLock);
+        globalSchemaCachePath = std::move(path);
+    }
+
     static std::shared_ptr<TraceDataContext> GlobalContext()
     {
         std::unique_lock<std::mutex> lock(globalContextLock);
@@ -30,18 +74,27 @@ public:
             return context;
 
         context = std::make_shared<TraceDataContext>();
+        if (!globalSchemaCachePath.empty())
+            (void)context->LoadSchemaCache(globalSchemaCachePath);
         globalContext = context;
         return context;
     }
 
 private:
-    using ExclusiveLock = std::unique_lock<std::mutex>;
-    std::mutex mutex;
+    using ExclusiveLock = std::unique_lock<std::shared_mutex>;
+    using SharedLock = std::shared_lock<std::shared_mutex>;
+    std::shared_mutex mutex;
 
     struct Entry
     {
         std::wstring ManifestPath;
         unsigned RefCount;
+        std::unique_ptr<EventSchemaTable> Schemas;
+        uint64_t ContentHash;
+        unsigned Generation; // At which the manifest was loaded.
+        // Whether the manifest was registered with TdhLoadManifest and has to
+        // be unloaded.
+        bool IsTdhManifest;
 
         friend bool operator<(Entry const& lhs, std::wstring const& rhs)
         {
@@ -54,10 +107,40 @@ private:
         }
     };
 
+    struct FileViewTraits : NullIsInvalidHandleTraits<void const*>
+    {
+        static void Close(HandleType h) noexcept { UnmapViewOfFile(h); }
+    };
+
+    using FileView = Handle<FileViewTraits>;
+
+    void UpdateManifestHash();
+    HRESULT MapSchemaCache();
+
+    // Returns the hash schemas of the provider are persisted under. Requires
+    // the lock to be held.
+    uint64_t GetSchemaHash(GUID const& providerId);
+
     std::vector<Entry> loadedManifests;
+    std::atomic<unsigned> generation{};
+
+    // Identifies the set of loaded manifests. Schemas of registered providers
+    // change with OS updates, so the OS build is included as well.
+    uint64_t manifestHash = 0;
+
+    // Hashes of the resources registered for providers, computed on first use
+    // since they require registry and file system lookups.
+    std::mutex resourceHashMutex;
+    std::unordered_map<GUID, uint64_t> providerResourceHashes;
+
+    std::wstring schemaCachePath;
+    FileView schemaCacheView;
+    SchemaCacheFile persistedSchemas;
+    SchemaCacheWriter resolvedSchemas;
 
     static std::mutex globalContextLock;
     static std::weak_ptr<TraceDataContext> globalContext;
+    static std::wstring globalSchemaCachePath;
 };
 
 class TraceDataToken
@@ -119,6 +202,8 @@ public:
         return S_OK;
     }
 
+    std::shared_ptr<TraceDataContext> const& Context() const { return context; }
+
 private:
     TraceDataToken(std::shared_ptr<TraceDataContext> context,
                    cspan<std::wstring> eventManifests)
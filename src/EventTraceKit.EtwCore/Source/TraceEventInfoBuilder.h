@@ -0,0 +1,71 @@
+#pragma once
+#include "etk/ADT/VarStructPtr.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <windows.h>
+
+#include <tdh.h>
+
+namespace etk
+{
+
+// Assembles a self-contained TRACE_EVENT_INFO laid out like the result of
+// TdhGetEventInformation: the header and property array, followed by all
+// strings the offsets refer to.
+class TraceEventInfoBuilder
+{
+public:
+    explicit TraceEventInfoBuilder(size_t propertyCount)
+        : properties(propertyCount)
+        , headerSize(std::max(sizeof(TRACE_EVENT_INFO),
+                              offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray) +
+                                  propertyCount * sizeof(EVENT_PROPERTY_INFO)))
+    {
+        std::memset(&info, 0, sizeof(info));
+        info.PropertyCount = static_cast<ULONG>(propertyCount);
+    }
+
+    TRACE_EVENT_INFO& Info() { return info; }
+    EVENT_PROPERTY_INFO& Property(size_t index) { return properties[index]; }
+
+    // Appends a null-terminated copy of the string and returns its offset.
+    // Consecutive calls store strings contiguously, which is how string lists
+    // (e.g. keyword names) are represented.
+    ULONG AddString(std::wstring_view str)
+    {
+        size_t const offset = headerSize + strings.size() * sizeof(wchar_t);
+        strings.append(str);
+        strings.push_back(L'\0');
+        return static_cast<ULONG>(offset);
+    }
+
+    std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t> Build() const
+    {
+        size_t const totalSize = headerSize + strings.size() * sizeof(wchar_t);
+        auto result = make_vstruct<TRACE_EVENT_INFO>(totalSize);
+
+        auto const base = reinterpret_cast<std::byte*>(result.get());
+        std::memcpy(base, &info, offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray));
+        if (!properties.empty())
+            std::memcpy(result->EventPropertyInfoArray, properties.data(),
+                        properties.size() * sizeof(EVENT_PROPERTY_INFO));
+        std::memcpy(base + headerSize, strings.data(), strings.size() * sizeof(wchar_t));
+
+        return {std::move(result), totalSize};
+    }
+
+private:
+    TRACE_EVENT_INFO info;
+    std::vector<EVENT_PROPERTY_INFO> properties;
+    size_t const headerSize;
+    std::wstring strings;
+};
+
+} // namespace etk
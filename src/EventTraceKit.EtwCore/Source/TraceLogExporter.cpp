@@ -0,0 +1,331 @@
+#include "etk/TraceLogExporter.h"
+
+#include "ExportOutput.h"
+#include "etk/Support/StringConversions.h"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <string_view>
+#include <thread>
+
+namespace etk
+{
+
+namespace
+{
+
+// Indexed by ExportColumn.
+char const* const ColumnNames[] = {
+    "TimeStamp",  "ProviderId", "ProviderName", "Id",        "Version",
+    "Channel",    "Level",      "Opcode",       "OpcodeName", "Task",
+    "TaskName",   "Keyword",    "ProcessId",    "ThreadId",  "ProcessorIndex",
+    "Message",
+};
+
+static_assert(std::size(ColumnNames) == static_cast<size_t>(ExportColumn::Message) + 1);
+
+void AppendDecimal(std::string& output, uint64_t value)
+{
+    char buffer[20];
+    auto const result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    output.append(buffer, result.ptr);
+}
+
+void AppendHex(std::string& output, uint64_t value)
+{
+    char const* const Digits = "0123456789ABCDEF";
+
+    char buffer[16];
+    unsigned count = 0;
+    do {
+        buffer[15 - count++] = Digits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+
+    output += "0x";
+    output.append(buffer + 16 - count, count);
+}
+
+void AppendGuid(std::string& output, GUID const& guid)
+{
+    char const* const Digits = "0123456789ABCDEF";
+    auto const appendHex = [&](uint64_t value, unsigned digits) {
+        for (unsigned i = digits; i > 0; --i)
+            output += Digits[(value >> ((i - 1) * 4)) & 0xF];
+    };
+
+    output += '{';
+    appendHex(guid.Data1, 8);
+    output += '-';
+    appendHex(guid.Data2, 4);
+    output += '-';
+    appendHex(guid.Data3, 4);
+    output += '-';
+    for (size_t i = 0; i < 8; ++i) {
+        if (i == 2)
+            output += '-';
+        appendHex(guid.Data4[i], 2);
+    }
+    output += '}';
+}
+
+// Appends a JSON string literal. Bytes beyond ASCII are part of UTF-8
+// sequences and copied as is.
+void AppendJsonString(std::string& output, std::string_view text)
+{
+    char const* const Digits = "0123456789abcdef";
+
+    output += '"';
+    size_t runBegin = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        auto const c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        output.append(text, runBegin, i - runBegin);
+        runBegin = i + 1;
+        switch (c) {
+        case '"': output += "\\\""; break;
+        case '\\': output += "\\\\"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\t': output += "\\t"; break;
+        default:
+            output += "\\u00";
+            output += Digits[c >> 4];
+            output += Digits[c & 0xF];
+            break;
+        }
+    }
+    output.append(text, runBegin, text.size() - runBegin);
+    output += '"';
+}
+
+// Appends a CSV field, quoted if it contains separators, quotes or line
+// breaks.
+void AppendCsvField(std::string& output, std::string_view text)
+{
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        output += text;
+        return;
+    }
+
+    output += '"';
+    size_t runBegin = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"') {
+            output.append(text, runBegin, i + 1 - runBegin);
+            output += '"';
+            runBegin = i + 1;
+        }
+    }
+    output.append(text, runBegin, text.size() - runBegin);
+    output += '"';
+}
+
+} // namespace
+
+TraceLogExporter::TraceLogExporter(TraceLogExportOptions options)
+    : options(std::move(options))
+{
+    unsigned threadCount = this->options.ThreadCount;
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    this->options.ChunkSize = std::max<size_t>(this->options.ChunkSize, 1);
+    roundSize = threadCount * ChunksPerWorker * this->options.ChunkSize;
+
+    auto const& columns = this->options.Columns;
+    if (std::find(columns.begin(), columns.end(), ExportColumn::Message) !=
+        columns.end()) {
+        messageFormatter = std::make_unique<ParallelMessageFormatter>(
+            threadCount, this->options.ChunkSize);
+    }
+}
+
+TraceLogExporter::~TraceLogExporter() = default;
+
+void TraceLogExporter::SetProgressCallback(TraceLogExportProgressCallback* callback,
+                                           void* state)
+{
+    progressCallback = callback;
+    progressState = state;
+}
+
+HRESULT TraceLogExporter::Export(TraceLogExportSource source,
+                                 TraceLogExportWriteCallback* write, void* state)
+{
+    auto const startTime = std::chrono::steady_clock::now();
+    statistics = TraceLogExportStatistics();
+
+    OutputBuffer output(options.BufferSize, write, state);
+    auto const finish = [&](HRESULT hr) {
+        statistics.WrittenBytes = output.GetWrittenBytes();
+        statistics.Duration = std::chrono::steady_clock::now() - startTime;
+        return hr;
+    };
+
+    if (options.Format == ExportFormat::Csv) {
+        std::string header;
+        for (ExportColumn column : options.Columns) {
+            if (!header.empty())
+                header += ',';
+            header += ColumnNames[static_cast<size_t>(column)];
+        }
+        header += "\r\n";
+        if (!output.Append(header))
+            return finish(E_ABORT);
+    }
+
+    // Events are retrieved on this thread, trace logs need not support
+    // concurrent access.
+    size_t const total = source.GetEventCount();
+    roundEvents.reserve(std::min(total, roundSize));
+
+    for (size_t first = 0; first < total; first += roundSize) {
+        size_t const count = std::min(roundSize, total - first);
+        roundEvents.clear();
+        for (size_t i = first; i < first + count; ++i)
+            roundEvents.push_back(source.GetEvent(i));
+
+        // Formatting messages dominates, the other columns are cheap to write
+        // on this thread.
+        if (messageFormatter)
+            messageFormatter->FormatEventMessages(roundEvents, roundMessages);
+
+        for (size_t i = 0; i < count; ++i) {
+            row.clear();
+            FormatEvent(roundEvents[i], i, row);
+            if (!output.Append(row))
+                return finish(E_ABORT);
+        }
+
+        statistics.ExportedEvents += count;
+        if (progressCallback)
+            progressCallback(statistics.ExportedEvents, total, progressState);
+    }
+
+    if (!output.Flush())
+        return finish(E_ABORT);
+
+    return finish(S_OK);
+}
+
+HRESULT TraceLogExporter::ExportToFile(TraceLogExportSource source,
+                                       std::wstring const& path)
+{
+    return ExportToNewFile(path, [&](TraceLogExportWriteCallback* write, void* state) {
+        return Export(source, write, state);
+    });
+}
+
+void TraceLogExporter::FormatEvent(EventInfo const& info, size_t const roundIndex,
+                                   std::string& output)
+{
+    bool const json = options.Format == ExportFormat::JsonLines;
+    for (size_t i = 0; i < options.Columns.size(); ++i) {
+        ExportColumn const column = options.Columns[i];
+        if (json) {
+            output += i == 0 ? "{\"" : ",\"";
+            output += ColumnNames[static_cast<size_t>(column)];
+            output += "\":";
+        } else if (i > 0) {
+            output += ',';
+        }
+
+        AppendColumn(info, roundIndex, column, output);
+    }
+
+    output += json ? (options.Columns.empty() ? "{}\n" : "}\n") : "\r\n";
+}
+
+void TraceLogExporter::AppendColumn(EventInfo const& info, size_t const roundIndex,
+                                    ExportColumn const column, std::string& output)
+{
+    bool const json = options.Format == ExportFormat::JsonLines;
+
+    // GUIDs and hexadecimal numbers need no escaping, but are strings in JSON.
+    auto const appendQuote = [&] {
+        if (json)
+            output += '"';
+    };
+
+    // Missing values are left empty in CSV.
+    auto const appendNull = [&] {
+        if (json)
+            output += "null";
+    };
+
+    auto const appendField = [&](std::string_view text) {
+        if (json)
+            AppendJsonString(output, text);
+        else
+            AppendCsvField(output, text);
+    };
+
+    auto const appendString = [&](wchar_t const* str) {
+        if (!str) {
+            appendNull();
+            return;
+        }
+
+        field.clear();
+        AppendU16To8(str, field);
+        appendField(field);
+    };
+
+    EVENT_RECORD const* const record = info.Record();
+    if (!record) {
+        appendNull();
+        return;
+    }
+
+    EVENT_HEADER const& header = record->EventHeader;
+    EVENT_DESCRIPTOR const& descriptor = header.EventDescriptor;
+
+    switch (column) {
+    case ExportColumn::TimeStamp:
+        AppendDecimal(output, static_cast<uint64_t>(header.TimeStamp.QuadPart));
+        break;
+    case ExportColumn::ProviderId:
+        appendQuote();
+        AppendGuid(output, header.ProviderId);
+        appendQuote();
+        break;
+    case ExportColumn::ProviderName:
+        appendString(info ? info.GetStringAt(info->ProviderNameOffset) : nullptr);
+        break;
+    case ExportColumn::Id: AppendDecimal(output, descriptor.Id); break;
+    case ExportColumn::Version: AppendDecimal(output, descriptor.Version); break;
+    case ExportColumn::Channel: AppendDecimal(output, descriptor.Channel); break;
+    case ExportColumn::Level: AppendDecimal(output, descriptor.Level); break;
+    case ExportColumn::Opcode: AppendDecimal(output, descriptor.Opcode); break;
+    case ExportColumn::OpcodeName:
+        appendString(info ? info.GetStringAt(info->OpcodeNameOffset) : nullptr);
+        break;
+    case ExportColumn::Task: AppendDecimal(output, descriptor.Task); break;
+    case ExportColumn::TaskName:
+        appendString(info ? info.GetStringAt(info->TaskNameOffset) : nullptr);
+        break;
+    case ExportColumn::Keyword:
+        appendQuote();
+        AppendHex(output, descriptor.Keyword);
+        appendQuote();
+        break;
+    case ExportColumn::ProcessId: AppendDecimal(output, header.ProcessId); break;
+    case ExportColumn::ThreadId: AppendDecimal(output, header.ThreadId); break;
+    case ExportColumn::ProcessorIndex:
+        AppendDecimal(output, (header.Flags & EVENT_HEADER_FLAG_PROCESSOR_INDEX) != 0
+                                  ? record->BufferContext.ProcessorIndex
+                                  : record->BufferContext.ProcessorNumber);
+        break;
+    case ExportColumn::Message:
+        if (info && roundMessages.IsFormatted(roundIndex))
+            appendField(roundMessages[roundIndex]);
+        else
+            appendNull();
+        break;
+    }
+}
+
+} // namespace etk
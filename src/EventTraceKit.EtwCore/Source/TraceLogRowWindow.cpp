@@ -0,0 +1,204 @@
+#include "etk/TraceLogRowWindow.h"
+
+#include <algorithm>
+
+namespace etk
+{
+
+namespace
+{
+
+enum class CellKind
+{
+    Number,
+    Guid,
+    Text,
+};
+
+CellKind GetCellKind(ExportColumn column)
+{
+    switch (column) {
+    case ExportColumn::ProviderId: return CellKind::Guid;
+    case ExportColumn::ProviderName:
+    case ExportColumn::OpcodeName:
+    case ExportColumn::TaskName:
+    case ExportColumn::Message: return CellKind::Text;
+    default: return CellKind::Number;
+    }
+}
+
+uint64_t GetHeaderValue(EVENT_RECORD const& record, ExportColumn column)
+{
+    EVENT_HEADER const& header = record.EventHeader;
+    EVENT_DESCRIPTOR const& descriptor = header.EventDescriptor;
+
+    switch (column) {
+    case ExportColumn::TimeStamp:
+        return static_cast<uint64_t>(header.TimeStamp.QuadPart);
+    case ExportColumn::Id: return descriptor.Id;
+    case ExportColumn::Version: return descriptor.Version;
+    case ExportColumn::Channel: return descriptor.Channel;
+    case ExportColumn::Level: return descriptor.Level;
+    case ExportColumn::Opcode: return descriptor.Opcode;
+    case ExportColumn::Task: return descriptor.Task;
+    case ExportColumn::Keyword: return descriptor.Keyword;
+    case ExportColumn::ProcessId: return header.ProcessId;
+    case ExportColumn::ThreadId: return header.ThreadId;
+    case ExportColumn::ProcessorIndex:
+        return (header.Flags & EVENT_HEADER_FLAG_PROCESSOR_INDEX) != 0
+                   ? record.BufferContext.ProcessorIndex
+                   : record.BufferContext.ProcessorNumber;
+    default: return 0;
+    }
+}
+
+ULONG GetNameOffset(TRACE_EVENT_INFO const& info, ExportColumn column)
+{
+    switch (column) {
+    case ExportColumn::ProviderName: return info.ProviderNameOffset;
+    case ExportColumn::OpcodeName: return info.OpcodeNameOffset;
+    case ExportColumn::TaskName: return info.TaskNameOffset;
+    default: return 0;
+    }
+}
+
+} // namespace
+
+void TraceLogRowWindow::Update(TraceLogExportSource source, size_t const first,
+                               size_t const count, cspan<ExportColumn> requested)
+{
+    size_t const eventCount = source.GetEventCount();
+    firstRow = std::min(first, eventCount);
+    rowCount = std::min(count, eventCount - firstRow);
+    formattedMessages = 0;
+    text.clear();
+
+    // Read the generations first, so that messages of events changing while
+    // updating are not cached.
+    size_t clearCount = 0;
+    if (messageCache) {
+        clearCount = messageLog->GetClearCount();
+        messageGeneration = messageCache->GetGeneration();
+    }
+
+    // Events are retrieved once for all columns. With a message cache they
+    // are taken from the unfiltered log, so that they match their keys even if
+    // the source still refers to events of a cleared log.
+    events.clear();
+    events.reserve(rowCount);
+    messageSequences.clear();
+    for (size_t i = 0; i < rowCount; ++i) {
+        size_t sourceIndex;
+        EventInfo info = source.GetEvent(firstRow + i, sourceIndex);
+        if (messageCache && info.Record()) {
+            info = messageLog->GetEvent(sourceIndex);
+            messageSequences.push_back(
+                FormattedMessageCache::MakeSequence(clearCount, sourceIndex));
+        } else {
+            messageSequences.push_back(0);
+        }
+        events.push_back(info);
+    }
+
+    if (messageCache && messageLog->GetClearCount() != clearCount)
+        messageSequences.clear();
+
+    columns.resize(requested.size());
+    for (size_t c = 0; c < requested.size(); ++c) {
+        columns[c].Column = requested[c];
+        DecodeColumn(columns[c]);
+    }
+}
+
+void TraceLogRowWindow::AddColumn(ExportColumn const column)
+{
+    formattedMessages = 0;
+    columns.emplace_back();
+    columns.back().Column = column;
+    DecodeColumn(columns.back());
+}
+
+void TraceLogRowWindow::DecodeColumn(ColumnCells& cells)
+{
+    cells.Numbers.clear();
+    cells.Guids.clear();
+    cells.Texts.clear();
+
+    switch (GetCellKind(cells.Column)) {
+    case CellKind::Number:
+        cells.Numbers.reserve(rowCount);
+        for (EventInfo const& info : events) {
+            cells.Numbers.push_back(
+                info.Record() ? GetHeaderValue(*info.Record(), cells.Column) : 0);
+        }
+        break;
+
+    case CellKind::Guid:
+        cells.Guids.reserve(rowCount);
+        for (EventInfo const& info : events) {
+            cells.Guids.push_back(
+                info.Record() ? info.Record()->EventHeader.ProviderId : GUID());
+        }
+        break;
+
+    case CellKind::Text:
+        cells.Texts.reserve(rowCount);
+        for (size_t row = 0; row < events.size(); ++row) {
+            if (cells.Column == ExportColumn::Message) {
+                AppendMessage(cells, row);
+                continue;
+            }
+
+            EventInfo const& info = events[row];
+            AppendText(cells, info ? info.GetStringAt(
+                                         GetNameOffset(*info.Info(), cells.Column))
+                                   : nullptr);
+        }
+        break;
+    }
+}
+
+void TraceLogRowWindow::AppendText(ColumnCells& cells, wchar_t const* const str)
+{
+    if (!str) {
+        cells.Texts.push_back({NoText, 0});
+        return;
+    }
+
+    size_t const offset = text.size();
+    text.append(str);
+    cells.Texts.push_back({offset, text.size() - offset});
+}
+
+void TraceLogRowWindow::AppendMessage(ColumnCells& cells, size_t const row)
+{
+    EventInfo const& info = events[row];
+    size_t const offset = text.size();
+    if (!info || !info.Record()) {
+        cells.Texts.push_back({NoText, 0});
+        return;
+    }
+
+    bool const cached = messageCache && !messageSequences.empty();
+    if (cached && messageCache->TryGet(messageSequences[row], cachedMessage)) {
+        text += cachedMessage;
+        cells.Texts.push_back({offset, text.size() - offset});
+        return;
+    }
+
+    if (!formatter.FormatEventMessage(info, GetPointerSize(info.Record()->EventHeader),
+                                      text)) {
+        cells.Texts.push_back({NoText, 0});
+        return;
+    }
+
+    if (cached) {
+        messageCache->Add(messageSequences[row], std::wstring_view(text).substr(offset),
+                          messageGeneration);
+    }
+
+    ++formattedMessages;
+    cells.Texts.push_back({offset, text.size() - offset});
+}
+
+} // namespace etk
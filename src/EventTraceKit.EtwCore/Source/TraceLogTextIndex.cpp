@@ -0,0 +1,168 @@
+#include "etk/ITraceLogTextIndex.h"
+
+#include "ManualResetEventSlim.h"
+#include "etk/ITraceLog.h"
+#include "etk/Support/SetThreadDescription.h"
+#include "etk/TdhMessageFormatter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+
+namespace etk
+{
+
+namespace
+{
+
+class TraceLogTextIndex : public ITraceLogTextIndex
+{
+public:
+    TraceLogTextIndex(ITraceLog const* traceLog, size_t memoryLimit)
+        : traceLog(traceLog)
+        , memoryLimit(memoryLimit)
+    {
+        running = true;
+        indexThread = std::thread(&TraceLogTextIndex::ThreadProc, this);
+    }
+
+    ~TraceLogTextIndex()
+    {
+        running = false;
+        changedEvent.Set();
+        if (indexThread.joinable())
+            indexThread.join();
+    }
+
+    virtual void Update() override { changedEvent.Set(); }
+
+    virtual std::vector<uint32_t> FindCandidates(std::wstring_view query,
+                                                 TextSearchMode mode) const override
+    {
+        SharedLock lock(mutex);
+        return index.FindCandidates(query, mode);
+    }
+
+    virtual TraceLogTextIndexStatistics GetStatistics() const override
+    {
+        SharedLock lock(mutex);
+        TraceLogTextIndexStatistics statistics;
+        statistics.IndexedEvents = index.GetDocumentCount();
+        statistics.Trigrams = index.GetTrigramCount();
+        statistics.MemoryUsage = index.GetMemoryUsage();
+        statistics.LimitReached = limitReached;
+        return statistics;
+    }
+
+private:
+    void ThreadProc()
+    {
+        SetCurrentThreadDescription(L"ETW Text Index Thread");
+
+        for (;;) {
+            changedEvent.WaitFor(PollInterval);
+            if (!running)
+                break;
+
+            changedEvent.Reset();
+            IndexEvents();
+        }
+    }
+
+    void IndexEvents()
+    {
+        // The source log was cleared (and possibly refilled) since the last
+        // pass. Document ids must match event indices, so start over.
+        size_t const clearCount = traceLog->GetClearCount();
+        if (clearCount != indexedClearCount) {
+            ExclusiveLock lock(mutex);
+            index.Clear();
+            indexedCount = 0;
+            indexedClearCount = clearCount;
+            limitReached = false;
+        }
+
+        size_t const total = traceLog->GetResolvedEventCount();
+        while (indexedCount < total && running && !limitReached) {
+            size_t const batchEnd = std::min(indexedCount + BatchSize, total);
+
+            messages.clear();
+            messageOffsets.clear();
+            size_t i = indexedCount;
+            for (; i < batchEnd; ++i) {
+                EventInfo const evt = traceLog->GetEvent(i);
+                if (!evt.Record())
+                    break;
+
+                messageOffsets.push_back(messages.size());
+                size_t const pointerSize = GetPointerSize(evt.Record()->EventHeader);
+                (void)formatter.FormatEventMessage(evt, pointerSize, messages);
+            }
+            messageOffsets.push_back(messages.size());
+
+            // The events of this batch may already belong to the refilled log.
+            if (traceLog->GetClearCount() != indexedClearCount)
+                break;
+
+            // Formatting happens outside the lock, so queries only contend with
+            // the comparatively cheap index updates.
+            {
+                ExclusiveLock lock(mutex);
+                std::wstring_view const text = messages;
+                for (size_t k = 0; k + 1 < messageOffsets.size(); ++k) {
+                    size_t const begin = messageOffsets[k];
+                    index.Add(text.substr(begin, messageOffsets[k + 1] - begin));
+                }
+
+                // Indexing stops at the limit instead of evicting, since
+                // document ids must stay contiguous from the first event.
+                limitReached = index.GetMemoryUsage() >= memoryLimit;
+            }
+
+            indexedCount = i;
+            if (i != batchEnd)
+                break;
+        }
+    }
+
+    // Number of events formatted before they are added to the index at once.
+    static size_t const BatchSize = 1024;
+
+    static constexpr std::chrono::milliseconds PollInterval{250};
+
+    // Owned by ThreadProc
+    size_t indexedCount = 0;
+    size_t indexedClearCount = 0;
+    TdhMessageFormatter formatter;
+    std::wstring messages;
+    std::vector<size_t> messageOffsets;
+
+    // Shared
+    using SharedLock = std::shared_lock<std::shared_mutex>;
+    using ExclusiveLock = std::unique_lock<std::shared_mutex>;
+    mutable std::shared_mutex mutex;
+    TextSearchIndex index;
+    bool limitReached = false;
+    ManualResetEventSlim changedEvent;
+
+    std::atomic<bool> running{};
+    std::thread indexThread;
+
+    // Immutable
+    ITraceLog const* traceLog;
+    size_t const memoryLimit;
+};
+
+} // namespace
+
+std::unique_ptr<ITraceLogTextIndex> CreateTraceLogTextIndex(ITraceLog const* log,
+                                                            size_t memoryLimit)
+{
+    return std::make_unique<TraceLogTextIndex>(log, memoryLimit);
+}
+
+} // namespace etk
@@ -0,0 +1,498 @@
+#include "etk/TraceLoggingMetadata.h"
+
+#include "TraceEventInfoBuilder.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+
+namespace etk
+{
+
+namespace
+{
+
+// Encoding of the field type bytes, see TraceLoggingProvider.h.
+uint8_t const ChainFlag = 0x80;
+uint8_t const InTypeMask = 0x1F;
+uint8_t const InTypeArrayMask = 0x60;
+uint8_t const InTypeFixedCount = 0x20;
+uint8_t const InTypeVariableCount = 0x40;
+uint8_t const InTypeCustom = 0x60;
+uint8_t const OutTypeMask = 0x7F;
+
+uint8_t const TlgInBinary = 14;
+uint8_t const TlgInPointer = 16;
+uint8_t const TlgInStruct = 24;
+uint8_t const TlgInCountedBinary = 25;
+
+// TraceLogging out-types. Below TlgOutUtf8 they differ from TDH_OUTTYPE.
+enum TlgOutType : uint8_t
+{
+    TlgOutNull = 0,
+    TlgOutNoPrint = 1,
+    TlgOutString = 2,
+    TlgOutBoolean = 3,
+    TlgOutHex = 4,
+    TlgOutPid = 5,
+    TlgOutTid = 6,
+    TlgOutPort = 7,
+    TlgOutIpv4 = 8,
+    TlgOutIpv6 = 9,
+    TlgOutSocketAddress = 10,
+    TlgOutXml = 11,
+    TlgOutJson = 12,
+    TlgOutWin32Error = 13,
+    TlgOutNtStatus = 14,
+    TlgOutHResult = 15,
+    TlgOutFileTime = 16,
+    TlgOutSigned = 17,
+    TlgOutUnsigned = 18,
+    TlgOutUtf8 = 35,
+    TlgOutPkcs7WithTypeInfo = 36,
+    TlgOutCodePointer = 37,
+    TlgOutDateTimeUtc = 38,
+};
+
+// TDH refuses deeper nesting as well, and it bounds the recursion when parsing
+// untrusted metadata.
+unsigned const MaxStructDepth = 32;
+
+class MetadataReader
+{
+public:
+    explicit MetadataReader(cspan<std::byte> data)
+        : pos(data.data())
+        , end(data.data() + data.size())
+    {}
+
+    bool AtEnd() const { return pos == end; }
+
+    void Truncate(size_t size)
+    {
+        if (size < static_cast<size_t>(end - pos))
+            end = pos + size;
+    }
+
+    bool ReadByte(uint8_t& value)
+    {
+        if (pos == end)
+            return false;
+        value = static_cast<uint8_t>(*pos++);
+        return true;
+    }
+
+    bool ReadUInt16(uint16_t& value)
+    {
+        if (end - pos < static_cast<ptrdiff_t>(sizeof(value)))
+            return false;
+        std::memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+
+    bool ReadString(std::string& value)
+    {
+        auto const terminator = std::find(pos, end, std::byte(0));
+        if (terminator == end)
+            return false;
+        value.assign(reinterpret_cast<char const*>(pos), terminator - pos);
+        pos = terminator + 1;
+        return true;
+    }
+
+    // Tags are stored as a chain of up to four bytes, each contributing seven
+    // bits starting with the most significant ones. Further chained bytes are
+    // reserved and skipped.
+    bool ReadTags(uint32_t& tags)
+    {
+        tags = 0;
+        for (int shift = 21;; shift -= 7) {
+            uint8_t byte;
+            if (!ReadByte(byte))
+                return false;
+            if (shift >= 0)
+                tags |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & ChainFlag) == 0)
+                return true;
+        }
+    }
+
+private:
+    std::byte const* pos;
+    std::byte const* end;
+};
+
+bool MapInType(uint8_t tlgInType, uint16_t& inType)
+{
+    switch (tlgInType) {
+    case 0:
+    case TlgInPointer:
+    case TlgInStruct: return false;
+    case TlgInBinary:
+        // Both binary types are prefixed with their UINT16 size in the payload.
+        inType = TDH_INTYPE_MANIFEST_COUNTEDBINARY;
+        return true;
+    default:
+        // The remaining types share their values with TDH_INTYPE.
+        if (tlgInType > TlgInCountedBinary)
+            return false;
+        inType = tlgInType;
+        return true;
+    }
+}
+
+// Selects the out-type of the given size among the 8, 16, 32 and 64-bit
+// variants, or TDH_OUTTYPE_NULL for other in-types.
+uint16_t BySize(uint16_t inType, uint16_t out8, uint16_t out16, uint16_t out32,
+                uint16_t out64)
+{
+    switch (inType) {
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_UINT8: return out8;
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_UINT16: return out16;
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_HEXINT32: return out32;
+    case TDH_INTYPE_INT64:
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT64: return out64;
+    default: return TDH_OUTTYPE_NULL;
+    }
+}
+
+// Maps a TraceLogging out-type to the TDH_OUTTYPE of a field with the given
+// (already mapped) in-type. Unknown out-types use the default formatting.
+uint16_t MapOutType(uint8_t tlgOutType, uint16_t inType)
+{
+    switch (tlgOutType) {
+    case TlgOutString: return TDH_OUTTYPE_STRING;
+    case TlgOutBoolean: return TDH_OUTTYPE_BOOLEAN;
+    case TlgOutHex:
+        if (inType == TDH_INTYPE_BINARY || inType == TDH_INTYPE_MANIFEST_COUNTEDBINARY)
+            return TDH_OUTTYPE_HEXBINARY;
+        return BySize(inType, TDH_OUTTYPE_HEXINT8, TDH_OUTTYPE_HEXINT16,
+                      TDH_OUTTYPE_HEXINT32, TDH_OUTTYPE_HEXINT64);
+    case TlgOutPid: return TDH_OUTTYPE_PID;
+    case TlgOutTid: return TDH_OUTTYPE_TID;
+    case TlgOutPort: return TDH_OUTTYPE_PORT;
+    case TlgOutIpv4: return TDH_OUTTYPE_IPV4;
+    case TlgOutIpv6: return TDH_OUTTYPE_IPV6;
+    case TlgOutSocketAddress: return TDH_OUTTYPE_SOCKETADDRESS;
+    case TlgOutXml: return TDH_OUTTYPE_XML;
+    case TlgOutJson: return TDH_OUTTYPE_JSON;
+    case TlgOutWin32Error: return TDH_OUTTYPE_WIN32ERROR;
+    case TlgOutNtStatus: return TDH_OUTTYPE_NTSTATUS;
+    case TlgOutHResult: return TDH_OUTTYPE_HRESULT;
+    case TlgOutFileTime: return TDH_OUTTYPE_DATETIME;
+    case TlgOutSigned:
+        return BySize(inType, TDH_OUTTYPE_BYTE, TDH_OUTTYPE_SHORT, TDH_OUTTYPE_INT,
+                      TDH_OUTTYPE_LONG);
+    case TlgOutUnsigned:
+        return BySize(inType, TDH_OUTTYPE_UNSIGNEDBYTE, TDH_OUTTYPE_UNSIGNEDSHORT,
+                      TDH_OUTTYPE_UNSIGNEDINT, TDH_OUTTYPE_UNSIGNEDLONG);
+    case TlgOutUtf8: return TDH_OUTTYPE_UTF8;
+    case TlgOutPkcs7WithTypeInfo: return TDH_OUTTYPE_PKCS7_WITH_TYPE_INFO;
+    case TlgOutCodePointer: return TDH_OUTTYPE_CODE_POINTER;
+    case TlgOutDateTimeUtc: return TDH_OUTTYPE_DATETIME_UTC;
+    default: return TDH_OUTTYPE_NULL;
+    }
+}
+
+bool ParseField(MetadataReader& reader, std::vector<TraceLoggingField>& fields,
+                unsigned depth)
+{
+    TraceLoggingField field;
+    uint8_t inType;
+    if (!reader.ReadString(field.Name) || !reader.ReadByte(inType))
+        return false;
+
+    uint8_t outType = 0;
+    if ((inType & ChainFlag) != 0) {
+        if (!reader.ReadByte(outType))
+            return false;
+        if ((outType & ChainFlag) != 0 && !reader.ReadTags(field.Tags))
+            return false;
+    }
+
+    switch (inType & InTypeArrayMask) {
+    case InTypeFixedCount:
+        field.Array = TraceLoggingArrayKind::Fixed;
+        if (!reader.ReadUInt16(field.Count))
+            return false;
+        break;
+    case InTypeVariableCount: field.Array = TraceLoggingArrayKind::Variable; break;
+    case InTypeCustom: return false;
+    }
+
+    if ((inType & InTypeMask) != TlgInStruct) {
+        if (!MapInType(inType & InTypeMask, field.InType))
+            return false;
+        field.OutType = MapOutType(outType & OutTypeMask, field.InType);
+        fields.push_back(std::move(field));
+        return true;
+    }
+
+    // For structs the out-type byte holds the number of members.
+    field.IsStruct = true;
+    field.MemberCount = outType & OutTypeMask;
+    if (field.MemberCount == 0 || depth == MaxStructDepth)
+        return false;
+
+    uint8_t const memberCount = field.MemberCount;
+    fields.push_back(std::move(field));
+    for (uint8_t i = 0; i < memberCount; ++i) {
+        if (!ParseField(reader, fields, depth + 1))
+            return false;
+    }
+
+    return true;
+}
+
+uint16_t GetFixedSize(uint16_t inType)
+{
+    switch (inType) {
+    case TDH_INTYPE_INT8:
+    case TDH_INTYPE_UINT8: return 1;
+    case TDH_INTYPE_INT16:
+    case TDH_INTYPE_UINT16: return 2;
+    case TDH_INTYPE_INT32:
+    case TDH_INTYPE_UINT32:
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_FLOAT:
+    case TDH_INTYPE_BOOLEAN: return 4;
+    case TDH_INTYPE_INT64:
+    case TDH_INTYPE_UINT64:
+    case TDH_INTYPE_HEXINT64:
+    case TDH_INTYPE_DOUBLE:
+    case TDH_INTYPE_FILETIME: return 8;
+    case TDH_INTYPE_GUID:
+    case TDH_INTYPE_SYSTEMTIME: return 16;
+    default: return 0;
+    }
+}
+
+void AppendCodePoint(std::wstring& str, uint32_t codePoint)
+{
+    if (sizeof(wchar_t) == sizeof(char16_t) && codePoint >= 0x10000) {
+        codePoint -= 0x10000;
+        str.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+        str.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+    } else {
+        str.push_back(static_cast<wchar_t>(codePoint));
+    }
+}
+
+// Invalid sequences are replaced with U+FFFD.
+void AppendUtf8(std::wstring& str, std::string const& utf8)
+{
+    size_t i = 0;
+    while (i < utf8.size()) {
+        auto const lead = static_cast<uint8_t>(utf8[i]);
+
+        uint32_t codePoint = 0;
+        size_t length;
+        if (lead < 0x80) {
+            codePoint = lead;
+            length = 1;
+        } else if ((lead & 0xE0) == 0xC0) {
+            codePoint = lead & 0x1F;
+            length = 2;
+        } else if ((lead & 0xF0) == 0xE0) {
+            codePoint = lead & 0x0F;
+            length = 3;
+        } else if ((lead & 0xF8) == 0xF0) {
+            codePoint = lead & 0x07;
+            length = 4;
+        } else {
+            length = 0;
+        }
+
+        bool valid = length != 0 && i + length <= utf8.size();
+        for (size_t k = 1; valid && k < length; ++k) {
+            auto const trail = static_cast<uint8_t>(utf8[i + k]);
+            valid = (trail & 0xC0) == 0x80;
+            codePoint = (codePoint << 6) | (trail & 0x3F);
+        }
+
+        if (!valid || codePoint > 0x10FFFF) {
+            str.push_back(static_cast<wchar_t>(0xFFFD));
+            ++i;
+            continue;
+        }
+
+        AppendCodePoint(str, codePoint);
+        i += length;
+    }
+}
+
+std::wstring DecodeUtf8(std::string const& utf8)
+{
+    std::wstring str;
+    AppendUtf8(str, utf8);
+    return str;
+}
+
+} // namespace
+
+bool ParseTraceLoggingEventMetadata(cspan<std::byte> metadata,
+                                    TraceLoggingEventMetadata& event)
+{
+    MetadataReader reader(metadata);
+
+    // The leading size includes the size field itself.
+    uint16_t size;
+    if (!reader.ReadUInt16(size) || size < sizeof(size) || size > metadata.size())
+        return false;
+    reader.Truncate(size - sizeof(size));
+
+    event.Fields.clear();
+    if (!reader.ReadTags(event.Tags) || !reader.ReadString(event.Name))
+        return false;
+
+    while (!reader.AtEnd()) {
+        if (!ParseField(reader, event.Fields, 0))
+            return false;
+    }
+
+    return true;
+}
+
+bool ParseTraceLoggingProviderName(cspan<std::byte> traits, std::string& name)
+{
+    MetadataReader reader(traits);
+
+    uint16_t size;
+    if (!reader.ReadUInt16(size) || size < sizeof(size) || size > traits.size())
+        return false;
+    reader.Truncate(size - sizeof(size));
+
+    return reader.ReadString(name);
+}
+
+std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>
+CreateTraceLoggingEventInfo(EVENT_HEADER const& header,
+                            TraceLoggingEventMetadata const& event,
+                            std::string const& providerName)
+{
+    using Result = std::tuple<vstruct_ptr<TRACE_EVENT_INFO>, size_t>;
+
+    auto const& fields = event.Fields;
+    if (fields.size() > USHRT_MAX)
+        return Result(nullptr, 0);
+
+    // Collect the direct members of every struct. Top-level fields are stored
+    // as members of a virtual root at index fields.size().
+    size_t const root = fields.size();
+    std::vector<std::vector<size_t>> members(fields.size() + 1);
+    {
+        struct OpenStruct
+        {
+            size_t Index;
+            size_t Remaining;
+        };
+
+        std::vector<OpenStruct> open;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            while (!open.empty() && open.back().Remaining == 0)
+                open.pop_back();
+
+            if (open.empty()) {
+                members[root].push_back(i);
+            } else {
+                members[open.back().Index].push_back(i);
+                --open.back().Remaining;
+            }
+
+            if (fields[i].IsStruct) {
+                if (fields[i].MemberCount == 0)
+                    return Result(nullptr, 0);
+                open.push_back({i, fields[i].MemberCount});
+            }
+        }
+
+        while (!open.empty() && open.back().Remaining == 0)
+            open.pop_back();
+        if (!open.empty())
+            return Result(nullptr, 0);
+    }
+
+    // Assign property indices breadth-first, so that top-level properties come
+    // first and the members of each struct are contiguous.
+    std::vector<USHORT> propertyIndices(fields.size());
+    std::vector<USHORT> structStartIndices(fields.size());
+    {
+        std::deque<size_t> pending{root};
+        USHORT next = 0;
+        while (!pending.empty()) {
+            size_t const owner = pending.front();
+            pending.pop_front();
+
+            if (owner != root)
+                structStartIndices[owner] = next;
+            for (size_t member : members[owner]) {
+                propertyIndices[member] = next++;
+                if (fields[member].IsStruct)
+                    pending.push_back(member);
+            }
+        }
+    }
+
+    TraceEventInfoBuilder builder(fields.size());
+    TRACE_EVENT_INFO& info = builder.Info();
+    info.ProviderGuid = header.ProviderId;
+    info.EventDescriptor = header.EventDescriptor;
+    info.DecodingSource = DecodingSourceTlg;
+    info.TopLevelPropertyCount = static_cast<ULONG>(members[root].size());
+    info.Tags = event.Tags;
+    if (!providerName.empty())
+        info.ProviderNameOffset = builder.AddString(DecodeUtf8(providerName));
+    // TDH reports the event name as task name for TraceLogging events.
+    info.TaskNameOffset = builder.AddString(DecodeUtf8(event.Name));
+    info.EventNameOffset = info.TaskNameOffset;
+
+    for (size_t i = 0; i < fields.size(); ++i) {
+        TraceLoggingField const& field = fields[i];
+        USHORT const index = propertyIndices[i];
+
+        EVENT_PROPERTY_INFO& property = builder.Property(index);
+        property.NameOffset = builder.AddString(DecodeUtf8(field.Name));
+
+        ULONG flags = 0;
+        if (field.IsStruct) {
+            flags |= PropertyStruct;
+            property.structType.StructStartIndex = structStartIndices[i];
+            property.structType.NumOfStructMembers = field.MemberCount;
+        } else {
+            property.nonStructType.InType = field.InType;
+            property.nonStructType.OutType = field.OutType;
+            property.length = GetFixedSize(field.InType);
+        }
+
+        switch (field.Array) {
+        case TraceLoggingArrayKind::None: property.count = 1; break;
+        case TraceLoggingArrayKind::Fixed:
+            flags |= PropertyParamFixedCount;
+            property.count = field.Count;
+            break;
+        case TraceLoggingArrayKind::Variable:
+            flags |= PropertyParamCount;
+            property.countPropertyIndex = index;
+            break;
+        }
+
+        if (field.Tags != 0) {
+            flags |= PropertyHasTags;
+            property.Tags = field.Tags;
+        }
+
+        property.Flags = static_cast<PROPERTY_FLAGS>(flags);
+    }
+
+    return builder.Build();
+}
+
+} // namespace etk
@@ -0,0 +1,138 @@
+#include "etk/ValueMap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+
+namespace etk
+{
+
+ValueMap::ValueMap(EVENT_MAP_INFO const* mapInfo, size_t mapInfoSize,
+                   bool removeTrailingSpace)
+    : info(reinterpret_cast<std::byte const*>(mapInfo),
+           reinterpret_cast<std::byte const*>(mapInfo) + mapInfoSize)
+{
+    bitEntries.fill(NoEntry);
+    if (mapInfoSize < offsetof(EVENT_MAP_INFO, MapEntryArray))
+        return;
+
+    size_t const entriesEnd = offsetof(EVENT_MAP_INFO, MapEntryArray) +
+                              mapInfo->EntryCount * sizeof(EVENT_MAP_ENTRY);
+    if (mapInfoSize < entriesEnd)
+        return;
+
+    ULONG const flags = mapInfo->Flag;
+    bool const wbem = (flags & (EVENTMAP_INFO_FLAG_WBEM_VALUEMAP |
+                                EVENTMAP_INFO_FLAG_WBEM_BITMAP)) != 0;
+    if ((flags & (EVENTMAP_INFO_FLAG_MANIFEST_PATTERNMAP | EVENTMAP_INFO_FLAG_WBEM_FLAG |
+                  EVENTMAP_INFO_FLAG_WBEM_NO_MAP)) != 0 ||
+        (wbem && mapInfo->MapEntryValueType != EVENTMAP_ENTRY_VALUETYPE_ULONG))
+        return;
+
+    entries.reserve(mapInfo->EntryCount);
+    for (ULONG i = 0; i < mapInfo->EntryCount; ++i) {
+        EVENT_MAP_ENTRY const& mapEntry = mapInfo->MapEntryArray[i];
+        size_t const offset = mapEntry.OutputOffset;
+        if (offset < entriesEnd || offset >= mapInfoSize ||
+            offset % sizeof(wchar_t) != 0) {
+            entries.clear();
+            return;
+        }
+
+        auto name = reinterpret_cast<wchar_t*>(info.data() + offset);
+        size_t length = wcsnlen(name, (mapInfoSize - offset) / sizeof(wchar_t));
+        if (removeTrailingSpace && length != 0 && name[length - 1] == L' ')
+            name[--length] = L'\0';
+
+        entries.push_back({mapEntry.Value, static_cast<uint32_t>(offset),
+                           static_cast<uint32_t>(length)});
+    }
+
+    if ((flags & (EVENTMAP_INFO_FLAG_MANIFEST_VALUEMAP |
+                  EVENTMAP_INFO_FLAG_WBEM_VALUEMAP)) != 0) {
+        // Duplicate values keep their declaration order, so the first one is
+        // found like in a linear search.
+        std::stable_sort(
+            entries.begin(), entries.end(),
+            [](Entry const& x, Entry const& y) { return x.Value < y.Value; });
+        kind = Kind::Values;
+        return;
+    }
+
+    ULONG const bitmapFlags =
+        EVENTMAP_INFO_FLAG_MANIFEST_BITMAP | EVENTMAP_INFO_FLAG_WBEM_BITMAP;
+    if ((flags & bitmapFlags) == 0)
+        return;
+
+    kind = Kind::Bits;
+    singleBits = entries.size() < NoEntry;
+    for (size_t i = 0; i < entries.size() && singleBits; ++i) {
+        uint32_t const value = entries[i].Value;
+        if (value == 0 || (value & (value - 1)) != 0) {
+            singleBits = false;
+            break;
+        }
+
+        unsigned bit = 0;
+        while ((value >> bit) != 1)
+            ++bit;
+        if (bitEntries[bit] == NoEntry)
+            bitEntries[bit] = static_cast<uint8_t>(i);
+    }
+}
+
+std::wstring_view ValueMap::GetName(Entry const& entry) const
+{
+    return {reinterpret_cast<wchar_t const*>(info.data() + entry.NameOffset),
+            entry.NameLength};
+}
+
+bool ValueMap::Format(uint32_t value, std::wstring& sink) const
+{
+    if (kind == Kind::Values) {
+        auto const it = std::lower_bound(
+            entries.begin(), entries.end(), value,
+            [](Entry const& entry, uint32_t value) { return entry.Value < value; });
+        if (it == entries.end() || it->Value != value)
+            return false;
+        sink += GetName(*it);
+        return true;
+    }
+
+    // Unset bitmaps are left to TDH, as are values with unmapped bits.
+    if (kind != Kind::Bits || value == 0)
+        return false;
+
+    size_t const originalSize = sink.size();
+    uint32_t mapped = 0;
+    auto const append = [&](Entry const& entry) {
+        if (mapped != 0)
+            sink += L" | ";
+        sink += GetName(entry);
+        mapped |= entry.Value;
+    };
+
+    if (singleBits) {
+        for (unsigned bit = 0; bit < bitEntries.size(); ++bit) {
+            if ((value & (uint32_t(1) << bit)) == 0)
+                continue;
+            if (bitEntries[bit] == NoEntry)
+                break;
+            append(entries[bitEntries[bit]]);
+        }
+    } else {
+        for (Entry const& entry : entries) {
+            if (entry.Value != 0 && (value & entry.Value) == entry.Value)
+                append(entry);
+        }
+    }
+
+    if (mapped != value) {
+        sink.resize(originalSize);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace etk
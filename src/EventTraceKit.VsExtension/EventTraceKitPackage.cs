@@ -7,6 +7,7 @@ namespace EventTraceKit.VsExtension
     using System.Threading;
     using System.Threading.Tasks;
     using System.Windows;
+    using EventTraceKit.Tracing;
     using EventTraceKit.VsExtension.Resources;
     using EventTraceKit.VsExtension.Settings;
     using EventTraceKit.VsExtension.Views;
@@ -68,6 +69,7 @@ namespace EventTraceKit.VsExtension
 
             string appDataDirectory = GetAppDataDirectory(shell);
             settings = new SettingsServiceImpl(vsSolutionManager, appDataDirectory);
+            TraceLog.SetSchemaCacheFile(Path.Combine(appDataDirectory, "SchemaCache.bin"));
         }
 
         protected override void Dispose(bool disposing)
@@ -5,7 +5,9 @@ namespace EventTraceKit.VsExtension
     using System.Globalization;
     using System.Security.Principal;
     using System.Text;
+    using System.Threading;
     using System.Windows;
+    using EventTraceKit.Tracing;
     using EventTraceKit.VsExtension.Controls;
     using EventTraceKit.VsExtension.Extensions;
     using EventTraceKit.VsExtension.Formatting;
@@ -13,8 +15,10 @@ namespace EventTraceKit.VsExtension
     using EventTraceKit.VsExtension.Utilities;
     using EventTraceKit.VsExtension.Windows;
 
-    public sealed class GenericEventsViewModelSource
+    public sealed class GenericEventsViewModelSource : IDisposable
     {
+        private readonly List<CrimsonEventsInfo> eventsInfos = new List<CrimsonEventsInfo>();
+
         private readonly ColumnViewModelPreset providerIdPreset;
         private readonly ColumnViewModelPreset providerNamePreset;
         private readonly ColumnViewModelPreset idPreset;
@@ -521,6 +525,7 @@ namespace EventTraceKit.VsExtension
         {
             var formatterPool = new ObjectPool<IMessageFormatter>(() => new NativeTdhFormatter(), 10);
             var info = new CrimsonEventsInfo(eventInfoSource, formatterPool, symbolSource);
+            eventsInfos.Add(info);
 
             var table = new DataTable("Generic Events");
             var templatePreset = new AsyncDataViewModelPreset();
@@ -566,6 +571,17 @@ namespace EventTraceKit.VsExtension
             return Tuple.Create(table, templatePreset);
         }
 
+        /// <summary>
+        ///   Releases the native row windows of the tables created by this
+        ///   source. Rows read afterwards are decoded one by one.
+        /// </summary>
+        public void Dispose()
+        {
+            foreach (var info in eventsInfos)
+                info.Dispose();
+            eventsInfos.Clear();
+        }
+
         private void AddColumn(
             DataTable table, AsyncDataViewModelPreset templatePreset,
             ColumnViewModelPreset preset, DataColumn column)
@@ -580,7 +596,7 @@ namespace EventTraceKit.VsExtension
             templatePreset.ConfigurableColumns.Add(preset);
         }
 
-        private sealed class CrimsonEventsInfo
+        private sealed class CrimsonEventsInfo : IDisposable
         {
             private static readonly Guid ActivityIdSentinel =
                 new Guid(0xD733D8B0, 0x7D18, 0x4AEB, 0xA3, 0xFC, 0x8C, 0x46, 0x13, 0xBC, 0x2A, 0x40);
@@ -592,6 +608,18 @@ namespace EventTraceKit.VsExtension
 
             private readonly ParseTdhContext tdhContext = new ParseTdhContext();
 
+            // Rows are decoded natively in blocks around the requested row.
+            // Threads copying rows in parallel get their own window. Windows
+            // are released when the trace log of the source changes, so that
+            // they neither hold native memory nor keep the previous log alive.
+            // The lock is held for reading while a window is used.
+            private const int RowWindowSize = 128;
+            private readonly ThreadLocal<RowWindow> rowWindows =
+                new ThreadLocal<RowWindow>(() => new RowWindow(), trackAllValues: true);
+            private readonly ReaderWriterLockSlim rowWindowsLock = new ReaderWriterLockSlim();
+            private TraceLog rowWindowsLog;
+            private bool disposed;
+
             public CrimsonEventsInfo(
                 IEventInfoSource eventInfoSource,
                 ObjectPool<IMessageFormatter> messageFormatterPool,
@@ -638,6 +666,146 @@ namespace EventTraceKit.VsExtension
                 return eventInfoSource.GetEvent(index);
             }
 
+            public void Dispose()
+            {
+                rowWindowsLock.EnterWriteLock();
+                try {
+                    if (disposed)
+                        return;
+
+                    // The lock itself is kept, so that rows read afterwards
+                    // find the windows released.
+                    disposed = true;
+                    ReleaseRowWindows();
+                    rowWindows.Dispose();
+                } finally {
+                    rowWindowsLock.ExitWriteLock();
+                }
+            }
+
+            private sealed class RowWindow
+            {
+                // Created on first use, and released with the windows.
+                public TraceLogRowWindow Window;
+
+                // Columns requested since the rows of the window last moved.
+                // Columns no longer shown drop out with the next move.
+                public readonly List<TraceLogColumn> RequestedColumns =
+                    new List<TraceLogColumn>();
+
+                public void Release()
+                {
+                    Window?.Dispose();
+                    Window = null;
+                    RequestedColumns.Clear();
+                }
+            }
+
+            private void EnterRowWindows()
+            {
+                var log = eventInfoSource.GetTraceLog();
+                if (log != rowWindowsLog && !disposed) {
+                    rowWindowsLock.EnterWriteLock();
+                    try {
+                        if (!disposed && log != rowWindowsLog) {
+                            ReleaseRowWindows();
+                            rowWindowsLog = log;
+                        }
+                    } finally {
+                        rowWindowsLock.ExitWriteLock();
+                    }
+                }
+
+                rowWindowsLock.EnterReadLock();
+            }
+
+            private void ReleaseRowWindows()
+            {
+                foreach (var rowWindow in rowWindows.Values)
+                    rowWindow.Release();
+            }
+
+            // Must be called between EnterRowWindows and exiting the read lock.
+            private TraceLogRowWindow GetRowWindow(
+                int index, TraceLogColumn column, out int windowColumn)
+            {
+                windowColumn = -1;
+                var log = eventInfoSource.GetTraceLog();
+                if (log == null || disposed)
+                    return null;
+
+                var rowWindow = rowWindows.Value;
+                var window = rowWindow.Window ??
+                             (rowWindow.Window = new TraceLogRowWindow());
+                if (!rowWindow.RequestedColumns.Contains(column))
+                    rowWindow.RequestedColumns.Add(column);
+
+                if (window.IsCurrent(log) && window.ContainsRow(index)) {
+                    windowColumn = window.IndexOf(column);
+                    if (windowColumn == -1)
+                        windowColumn = window.AddColumn(column);
+                    return window;
+                }
+
+                // Start before the row so that scrolling up also hits the
+                // window.
+                var columns = rowWindow.RequestedColumns.ToArray();
+                rowWindow.RequestedColumns.Clear();
+                rowWindow.RequestedColumns.Add(column);
+
+                int first = Math.Max(0, index - RowWindowSize / 4);
+                window.Update(log, first, RowWindowSize, columns);
+
+                if (!window.ContainsRow(index))
+                    return null;
+
+                windowColumn = window.IndexOf(column);
+                return window;
+            }
+
+            private bool TryGetNumber(int index, TraceLogColumn column, out ulong value)
+            {
+                EnterRowWindows();
+                try {
+                    var window = GetRowWindow(index, column, out int windowColumn);
+                    value = window?.GetNumber(index, windowColumn) ?? 0;
+                    return window != null;
+                } finally {
+                    rowWindowsLock.ExitReadLock();
+                }
+            }
+
+            private bool TryGetText(int index, TraceLogColumn column, out string value)
+            {
+                EnterRowWindows();
+                try {
+                    var window = GetRowWindow(index, column, out int windowColumn);
+                    value = window?.GetText(index, windowColumn);
+                    return window != null;
+                } finally {
+                    rowWindowsLock.ExitReadLock();
+                }
+            }
+
+            private bool TryGetGuid(int index, TraceLogColumn column, out Guid value)
+            {
+                EnterRowWindows();
+                try {
+                    var window = GetRowWindow(index, column, out int windowColumn);
+                    value = window?.GetGuid(index, windowColumn) ?? Guid.Empty;
+                    return window != null;
+                } finally {
+                    rowWindowsLock.ExitReadLock();
+                }
+            }
+
+            private TimePoint GetTimePoint(int index)
+            {
+                if (TryGetNumber(index, TraceLogColumn.TimeStamp, out ulong value))
+                    return new TimePoint((long)value);
+                return GetEventRecord(index).TimePoint;
+            }
+
             public unsafe EventRecordCPtr GetEventRecord(int index)
             {
                 return new EventRecordCPtr(
@@ -653,11 +821,16 @@ namespace EventTraceKit.VsExtension
 
             public Guid ProjectProviderId(int index)
             {
+                if (TryGetGuid(index, TraceLogColumn.ProviderId, out Guid value))
+                    return value;
                 return GetEventRecord(index).EventHeader.ProviderId;
             }
 
             public string ProjectProviderName(int index)
             {
+                if (TryGetText(index, TraceLogColumn.ProviderName, out string name))
+                    return name ?? ProjectProviderId(index).ToString();
+
                 TraceEventInfoCPtr eventInfo = GetTraceEventInfo(index);
                 if (eventInfo.HasValue)
                     return eventInfo.ProviderName.ToString();
@@ -667,21 +840,29 @@ namespace EventTraceKit.VsExtension
 
             public uint ProjectProcessId(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.ProcessId, out ulong value))
+                    return (uint)value;
                 return GetEventRecord(index).EventHeader.ProcessId;
             }
 
             public ushort ProjectId(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.Id, out ulong value))
+                    return (ushort)value;
                 return GetEventRecord(index).EventHeader.EventDescriptor.Id;
             }
 
             public byte ProjectVersion(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.Version, out ulong value))
+                    return (byte)value;
                 return GetEventRecord(index).EventHeader.EventDescriptor.Version;
             }
 
             public byte ProjectChannel(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.Channel, out ulong value))
+                    return (byte)value;
                 return GetEventRecord(index).EventHeader.EventDescriptor.Channel;
             }
 
@@ -692,6 +873,8 @@ namespace EventTraceKit.VsExtension
 
             public byte ProjectLevel(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.Level, out ulong value))
+                    return (byte)value;
                 return GetEventRecord(index).EventHeader.EventDescriptor.Level;
             }
 
@@ -702,6 +885,8 @@ namespace EventTraceKit.VsExtension
 
             public ushort ProjectTask(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.Task, out ulong value))
+                    return (ushort)value;
                 return GetEventRecord(index).EventHeader.EventDescriptor.Task;
             }
 
@@ -712,6 +897,8 @@ namespace EventTraceKit.VsExtension
 
             public byte ProjectOpCode(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.Opcode, out ulong value))
+                    return (byte)value;
                 return GetEventRecord(index).EventHeader.EventDescriptor.Opcode;
             }
 
@@ -729,6 +916,8 @@ namespace EventTraceKit.VsExtension
 
             public Keyword ProjectKeyword(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.Keyword, out ulong value))
+                    return value;
                 return GetEventRecord(index).EventHeader.EventDescriptor.Keyword;
             }
 
@@ -754,6 +943,12 @@ namespace EventTraceKit.VsExtension
 
             public string ProjectMessage(int index)
             {
+                // Messages the window could not format are formatted through
+                // TDH as before.
+                if (TryGetText(index, TraceLogColumn.Message, out string message) &&
+                    message != null)
+                    return message;
+
                 var info = GetEventInfo(index);
 
                 var formatter = messageFormatterPool.Acquire();
@@ -848,12 +1043,14 @@ namespace EventTraceKit.VsExtension
 
             public uint ProjectThreadId(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.ThreadId, out ulong value))
+                    return (uint)value;
                 return GetEventRecord(index).EventHeader.ThreadId;
             }
 
             public TimePoint ProjectTimePoint(int index)
             {
-                return GetEventRecord(index).TimePoint;
+                return GetTimePoint(index);
             }
 
             private TimePoint GetStartTime()
@@ -867,20 +1064,22 @@ namespace EventTraceKit.VsExtension
 
             public DateTime ProjectTimeAbsolute(int index)
             {
-                var timePoint = GetEventRecord(index).TimePoint;
+                var timePoint = GetTimePoint(index);
                 return new DateTime(timePoint.Ticks, DateTimeKind.Utc).ToLocalTime();
             }
 
             public TimeSpan ProjectTimeRelative(int index)
             {
                 var startTime = GetStartTime();
-                var time = GetEventRecord(index).TimePoint;
+                var time = GetTimePoint(index);
                 var elapsedTicks = time.Ticks - startTime.Ticks;
                 return new TimeSpan(elapsedTicks);
             }
 
             public ulong ProjectCpu(int index)
             {
+                if (TryGetNumber(index, TraceLogColumn.ProcessorIndex, out ulong value))
+                    return value;
                 return GetEventRecord(index).ProcessorIndex;
             }
 
@@ -1,8 +1,16 @@
 namespace EventTraceKit.VsExtension
 {
+    using EventTraceKit.Tracing;
+
     public interface IEventInfoSource
     {
         EventSessionInfo GetInfo();
         EventInfo GetEvent(int index);
+
+        /// <summary>
+        ///   Gets the trace log whose filtered view the events are taken from,
+        ///   or <see langword="null"/>.
+        /// </summary>
+        TraceLog GetTraceLog();
     }
 }
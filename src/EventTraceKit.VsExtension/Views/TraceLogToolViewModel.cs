@@ -15,6 +15,7 @@ namespace EventTraceKit.VsExtension.Views
     using EventTraceKit.VsExtension.Views.PresetManager;
     using Microsoft.VisualStudio.Shell;
     using Microsoft.VisualStudio.Shell.Interop;
+    using Microsoft.Win32;
     using Task = System.Threading.Tasks.Task;
 
     public interface IFilterable
@@ -23,7 +24,7 @@ namespace EventTraceKit.VsExtension.Views
     }
 
     public class TraceLogToolViewModel
-        : ObservableModel, IEventInfoSource, IFilterable
+        : ObservableModel, IEventInfoSource, IFilterable, IDisposable
     {
         private readonly ISettingsService settings;
         private readonly ITraceController traceController;
@@ -34,6 +35,7 @@ namespace EventTraceKit.VsExtension.Views
         private SettingsStoreWrapper ambientStore;
 
         private readonly DispatcherTimer updateStatsTimer;
+        private readonly GenericEventsViewModelSource eventsViewModelSource;
         protected TraceProfileDescriptor traceProfile = new TraceProfileDescriptor();
 
         private enum LoggerState
@@ -52,6 +54,7 @@ namespace EventTraceKit.VsExtension.Views
 
         private TraceLog traceLog;
         private EventSession session;
+        private bool isExporting;
 
         private TraceSettingsViewModel settingsViewModel;
         private bool autoLog;
@@ -78,7 +81,8 @@ namespace EventTraceKit.VsExtension.Views
             traceController.SessionStarted += OnSessionStarted;
             traceController.SessionStopped += OnSessionStopped;
 
-            var tableTuple = new GenericEventsViewModelSource().CreateTable(this);
+            eventsViewModelSource = new GenericEventsViewModelSource();
+            var tableTuple = eventsViewModelSource.CreateTable(this);
             var dataTable = tableTuple.Item1;
             var templatePreset = tableTuple.Item2;
 
@@ -118,6 +122,11 @@ namespace EventTraceKit.VsExtension.Views
             settings.SaveAmbient();
         }
 
+        public void Dispose()
+        {
+            eventsViewModelSource.Dispose();
+        }
+
         private void LoadGlobalSettings()
         {
             globalStore = settings.GetGlobalStore().AsWrapper();
@@ -263,6 +272,10 @@ namespace EventTraceKit.VsExtension.Views
 
         public void Clear()
         {
+            // Exported events must stay alive until the export finishes.
+            if (isExporting)
+                return;
+
             try {
                 session?.Flush();
                 traceLog?.Clear();
@@ -273,6 +286,38 @@ namespace EventTraceKit.VsExtension.Views
             }
         }
 
+        private async void Export()
+        {
+            var log = traceLog;
+            if (log == null || isExporting)
+                return;
+
+            var dialog = new SaveFileDialog();
+            dialog.Title = "Export Log";
+            dialog.Filter = "CSV Files (*.csv)|*.csv|" +
+                            "JSON Lines Files (*.jsonl)|*.jsonl";
+            dialog.DefaultExt = ".csv";
+            dialog.OverwritePrompt = true;
+            dialog.AddExtension = true;
+            if (dialog.ShowModal() != true)
+                return;
+
+            var path = dialog.FileName;
+            var format = dialog.FilterIndex == 2 ? TraceLogExportFormat.JsonLines
+                                                 : TraceLogExportFormat.Csv;
+
+            isExporting = true;
+            uiShell?.UpdateCommandUI(0);
+            try {
+                await Task.Run(() => log.Export(path, format));
+            } catch (Exception ex) {
+                MessageHelper.ShowErrorMessage("Failed to export log", exception: ex);
+            } finally {
+                isExporting = false;
+                uiShell?.UpdateCommandUI(0);
+            }
+        }
+
         private void ChangeState(LoggerState newState)
         {
             if (state == newState)
@@ -434,7 +479,12 @@ namespace EventTraceKit.VsExtension.Views
                 (s, e) => ToggleCapture(), null, OnQueryToggleCaptureLog, id));
 
             id = new CommandID(PkgCmdId.TraceLogCmdSet, PkgCmdId.cmdidClearLog);
-            commandService.AddCommand(new OleMenuCommand((s, e) => Clear(), id));
+            commandService.AddCommand(
+                new OleMenuCommand((s, e) => Clear(), null, OnQueryClearLog, id));
+
+            id = new CommandID(PkgCmdId.TraceLogCmdSet, PkgCmdId.cmdidExportLog);
+            commandService.AddCommand(
+                new OleMenuCommand((s, e) => Export(), null, OnQueryExportLog, id));
 
             id = new CommandID(PkgCmdId.TraceLogCmdSet, PkgCmdId.cmdidAutoScroll);
             commandService.AddCommand(
@@ -479,6 +529,18 @@ namespace EventTraceKit.VsExtension.Views
             command.Checked = IsCollecting;
         }
 
+        private void OnQueryClearLog(object sender, EventArgs args)
+        {
+            var command = (MenuCommand)sender;
+            command.Enabled = !isExporting;
+        }
+
+        private void OnQueryExportLog(object sender, EventArgs args)
+        {
+            var command = (MenuCommand)sender;
+            command.Enabled = traceLog != null && !isExporting;
+        }
+
         private void OnQueryToggleAutoLog(object sender, EventArgs args)
         {
             var command = (MenuCommand)sender;
@@ -623,6 +685,11 @@ namespace EventTraceKit.VsExtension.Views
         {
             return traceLog?.GetEvent(index) ?? default;
         }
+
+        TraceLog IEventInfoSource.GetTraceLog()
+        {
+            return traceLog;
+        }
     }
 
     public class TraceLogPaneDesignTimeModel : TraceLogToolViewModel
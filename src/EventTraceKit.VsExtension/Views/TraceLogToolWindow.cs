@@ -36,6 +36,13 @@ namespace EventTraceKit.VsExtension.Views
             onClose(content?.DataContext);
         }
 
+        protected override void Dispose(bool disposing)
+        {
+            if (disposing)
+                (content?.DataContext as IDisposable)?.Dispose();
+            base.Dispose(disposing);
+        }
+
         public override bool SearchEnabled => false;
     }
 }